@@ -2,6 +2,7 @@
 
 RVS::Biomass::BiomassDIO::BiomassDIO(void) : RVS::DataManagement::DIO()
 {
+	queryStage = RVS::DataManagement::STAGE_QUERY_BIOMASS;
 	this->create_output_table();
 	this->create_intermediate_table();
 }
@@ -13,7 +14,7 @@ RVS::Biomass::BiomassDIO::~BiomassDIO(void)
 
 int* RVS::Biomass::BiomassDIO::create_output_table()
 {
-	std::stringstream sqlstream;
+	std::ostream& sqlstream = begin_write();
 	sqlstream << "CREATE TABLE " << BIOMASS_OUTPUT_TABLE << "(" << \
 		PLOT_NUM_FIELD << " INTEGER NOT NULL, " << \
 		PLOT_NAME_FIELD << " TEXT, " << \
@@ -40,16 +41,15 @@ int* RVS::Biomass::BiomassDIO::create_output_table()
 		LATITUDE_FIELD << " FLOAT, " << \
 		LONGITUDE_FIELD << " FLOAT);";
 
-	char* sql = new char;
-	sql = streamToCharPtr(&sqlstream);
-	queuedWrites.push_back(sql);
+	queue_write();
 
 	return RC;
 }
 
 int* RVS::Biomass::BiomassDIO::write_output_record(int* year, RVS::DataManagement::AnalysisPlot* ap)
 {
-	std::stringstream sqlstream;
+	if (WRITES_DISCARDED()) { return RC; }
+	std::ostream& sqlstream = begin_write();
 	sqlstream << "INSERT INTO " << BIOMASS_OUTPUT_TABLE << " (" << \
 		PLOT_NUM_FIELD << ", " << \
 		PLOT_NAME_FIELD << ", " << \
@@ -102,16 +102,14 @@ int* RVS::Biomass::BiomassDIO::write_output_record(int* year, RVS::DataManagemen
 		std::setprecision(10) << ap->LATITUDE() << "," << \
 		std::setprecision(10) << ap->LONGITUDE() << ");";
 
-	char* sql = new char;
-	sql = streamToCharPtr(&sqlstream);
-	queuedWrites.push_back(sql);
+	queue_write();
 
 	return RC;
 }
 
 int* RVS::Biomass::BiomassDIO::create_intermediate_table()
 {
-	std::stringstream sqlstream;
+	std::ostream& sqlstream = begin_write();
 	sqlstream << "CREATE TABLE " << BIOMASS_INTERMEDIATE_TABLE << " (" << \
 		PLOT_NUM_FIELD << " INTEGER NOT NULL, " << \
 		PLOT_NAME_FIELD << " TEXT, " << \
@@ -131,16 +129,15 @@ int* RVS::Biomass::BiomassDIO::create_intermediate_table()
 		PCH_CALC_FIELD << " REAL, " << \
 		BIOMASS_EQU_NUM << " INTEGER" << ");";
 
-	char* sql = new char; 
-	sql = streamToCharPtr(&sqlstream);
-	queuedWrites.push_back(sql);
+	queue_write();
 
 	return RC;
 }
 
 int* RVS::Biomass::BiomassDIO::write_intermediate_record(int* year, RVS::DataManagement::AnalysisPlot* ap, RVS::DataManagement::SppRecord* record)
 {
-	std::stringstream sqlstream;
+	if (WRITES_DISCARDED()) { return RC; }
+	std::ostream& sqlstream = begin_write();
 	sqlstream << "INSERT INTO " << BIOMASS_INTERMEDIATE_TABLE << " (" << \
 		PLOT_NUM_FIELD << ", " << \
 		PLOT_NAME_FIELD << ", " << \
@@ -178,13 +175,24 @@ int* RVS::Biomass::BiomassDIO::write_intermediate_record(int* year, RVS::DataMan
 		record->WIDTH() << "," << \
 		record->BATEQNUM() << ");";
 
-	char* sql = new char;
-	sql = streamToCharPtr(&sqlstream);
-	queuedWrites.push_back(sql);
+	queue_write();
 
 	return RC;
 }
 
+int* RVS::Biomass::BiomassDIO::write_repeat_records(int* year, int* lastYear, RVS::DataManagement::AnalysisPlot* ap)
+{
+	write_repeat_record(BIOMASS_OUTPUT_TABLE, ap->PLOT_ID(), *year, *lastYear);
+	write_repeat_record(BIOMASS_INTERMEDIATE_TABLE, ap->PLOT_ID(), *year, *lastYear);
+	return RC;
+}
+
+int* RVS::Biomass::BiomassDIO::create_year_index(void)
+{
+	index_by_year(BIOMASS_OUTPUT_TABLE);
+	return index_by_year(BIOMASS_INTERMEDIATE_TABLE);
+}
+
 int RVS::Biomass::BiomassDIO::query_crosswalk_table(std::string spp, std::string returnType)
 {
 	// Create the sqlite3 statment to query biomass crosswalk table on species
@@ -240,10 +248,7 @@ void RVS::Biomass::BiomassDIO::query_biogroup_coefs(string bps_model, double* gr
 			" WHERE " << GROUP_ID_FIELD << "='" << *grp_id << "';";
 	}
 
-	char* sql = new char;
-	sql = streamToCharPtr(&sqlstream);
-	
-	RVS::DataManagement::DataTable* dt2 = prep_datatable(sql, rvsdb);
+	RVS::DataManagement::DataTable* dt2 = prep_datatable(sqlstream.str().c_str(), rvsdb);
 
 	getVal(dt2->getStmt(), dt2->Columns[GROUP_CONST_FIELD], group_const);
 	getVal(dt2->getStmt(), dt2->Columns[NDVI_INTERACT_FIELD], ndvi_grp_interact);
@@ -37,6 +37,8 @@ namespace Biomass
 		int* create_intermediate_table();
 		int* write_output_record(int* year, RVS::DataManagement::AnalysisPlot* ap);
 		int* write_intermediate_record(int* year, RVS::DataManagement::AnalysisPlot* ap, RVS::DataManagement::SppRecord* record);
+		int* write_repeat_records(int* year, int* lastYear, RVS::DataManagement::AnalysisPlot* ap);
+		int* create_year_index(void);
 
 		//## Query functions ##//
 
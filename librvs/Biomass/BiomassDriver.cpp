@@ -2,6 +2,8 @@
 
 using RVS::Biomass::BiomassDriver;
 
+static const RVS::DataManagement::Symbol BACKUP_SPECIES = RVS::DataManagement::SymbolTable::intern(RVS::BIOMASS_BACKUP_SPP_CODE);
+
 
 
 BiomassDriver::BiomassDriver(RVS::Biomass::BiomassDIO* bdio, bool suppress_messages)
@@ -17,6 +19,7 @@ BiomassDriver::~BiomassDriver(void)
 
 int* BiomassDriver::BioMain(int year, string* climate, RVS::DataManagement::AnalysisPlot* ap)
 {
+	RVS_TIME(RVS::DataManagement::STAGE_BIOMASS);
 	this->ap = ap;
 	int plot_num = ap->PLOT_ID();
 	this->climate = climate;
@@ -31,6 +34,7 @@ int* BiomassDriver::BioMain(int year, string* climate, RVS::DataManagement::Anal
 	/////////// SHRUBS ///////////
 
 	vector<RVS::DataManagement::SppRecord*>* shrubs = ap->SHRUB_RECORDS();
+	RVS_COUNT(RVS::DataManagement::COUNT_SHRUBS, (long)shrubs->size());
 	double totalShrubCover = 0;
 	double runShrubHeight = 0;
 	double runShrubStem = 0;
@@ -108,15 +112,15 @@ double BiomassDriver::calcShrubBiomass(RVS::DataManagement::SppRecord* record)
 	int equationNumber = 0;
 	
 	
-	equationNumber = bdio->query_crosswalk_table(record->SPP_CODE(), BIOMASS_EQUATION_FIELD);
+	equationNumber = lookupCrosswalk(&batCrosswalk, record->SPP_CODE_ID(), BIOMASS_EQUATION_FIELD);
 	if (equationNumber == 0)
 	{
-		stringstream* s = new stringstream();
-		*s << "PLOT_ID: " << ap->PLOT_ID() << ". Shrub biomass equation not found for " << record->SPP_CODE() << ", using ARTR";
-		const char* c = bdio->streamToCharPtr(s);
-		bdio->write_debug_msg(c);
+		RVS_ALLOC_PAUSE();
+		stringstream s;
+		s << "PLOT_ID: " << ap->PLOT_ID() << ". Shrub biomass equation not found for " << record->SPP_CODE() << ", using ARTR";
+		bdio->write_debug_msg(s.str().c_str());
 
-		equationNumber = bdio->query_crosswalk_table(BIOMASS_BACKUP_SPP_CODE, BIOMASS_EQUATION_FIELD);
+		equationNumber = lookupCrosswalk(&batCrosswalk, BACKUP_SPECIES, BIOMASS_EQUATION_FIELD);
 	}
 
 	if (equationNumber == 1160 && record->requestValue("VOL") > 20000)
@@ -131,20 +135,22 @@ double BiomassDriver::calcShrubBiomass(RVS::DataManagement::SppRecord* record)
 	record->batEqNum = equationNumber;
 
 	// Populate the coefficients with values from the biomass equation table
-	double* coefs = new double[4];
-	string* paramNames = new string[3];
-	bdio->query_equation_parameters(equationNumber, paramNames, coefs);
+	const EquationData* equation = lookupEquation(equationNumber);
+	double coefs[4] = { equation->coefs[0], equation->coefs[1], equation->coefs[2], equation->coefs[3] };
+	const string* paramNames = equation->params;
 
-	std::map<string, double>* params = new std::map<string, double>();
+	// The record keeps its parameter map, a species' parameter names don't change between years
+	std::map<string, double>* params = &record->equationParams;
 
 	double val = 0.0;
-	for (int i = 0; i < paramNames->size(); i++)
+	for (int i = 0; i < paramNames->size() && i < 3; i++)
 	{
 		val = record->requestValue(paramNames[i]);
-		params->insert(pair<string, double>(paramNames[i], val));
+		(*params)[paramNames[i]] = val;
 	}
 
 	double biomass = BiomassEquations::eq_BAT(equationNumber, coefs, params);
+	RVS_COUNT(RVS::DataManagement::COUNT_EQUATIONS, 1);
 	return biomass;
 }
 
@@ -153,26 +159,25 @@ double BiomassDriver::calcStemsPerAcre(RVS::DataManagement::SppRecord* record)
 	// Lookup the equation number from the crosswalk table
 	int equationNumber = 0;
 
-	equationNumber = bdio->query_crosswalk_table(record->SPP_CODE(), STEMS_PER_ACRE_EQUATION_FIELD);
+	equationNumber = lookupCrosswalk(&pchCrosswalk, record->SPP_CODE_ID(), STEMS_PER_ACRE_EQUATION_FIELD);
 
 	if (equationNumber == 0)
 	{
-		stringstream* s = new stringstream();
-		*s << "PLOT_ID: " << ap->PLOT_ID() << ". Stems per acre equation not found for " << record->SPP_CODE() << ", using ARTR";
-		const char* c = bdio->streamToCharPtr(s);
-		bdio->write_debug_msg(c);
+		RVS_ALLOC_PAUSE();
+		stringstream s;
+		s << "PLOT_ID: " << ap->PLOT_ID() << ". Stems per acre equation not found for " << record->SPP_CODE() << ", using ARTR";
+		bdio->write_debug_msg(s.str().c_str());
 
-		equationNumber = bdio->query_crosswalk_table(BIOMASS_BACKUP_SPP_CODE, STEMS_PER_ACRE_EQUATION_FIELD);
+		equationNumber = lookupCrosswalk(&pchCrosswalk, BACKUP_SPECIES, STEMS_PER_ACRE_EQUATION_FIELD);
 	}
 	
 	record->pchEqNum = equationNumber;
 	
-	double* coefs = new double[4];
-
 	// Populate the coefficients with values from the biomass equation table
-	bdio->query_equation_coefficients(equationNumber, coefs);
+	const double* coefs = lookupEquation(equationNumber)->coefs;
 
 	double singleStem = BiomassEquations::eq_PCH(coefs[0], coefs[1], record->HEIGHT());
+	RVS_COUNT(RVS::DataManagement::COUNT_EQUATIONS, 1);
 
 	// While we're here, calculate width (singleStem is area)
 	double radius = std::sqrt(singleStem / 3.1415); // Use number for PI rather than constant cause it's the only thing needed out of CMATH
@@ -192,6 +197,25 @@ double BiomassDriver::calcStemsPerAcre(RVS::DataManagement::SppRecord* record)
 }
 
 
+int BiomassDriver::lookupCrosswalk(map<RVS::DataManagement::Symbol, int>* cache, RVS::DataManagement::Symbol spp, const char* field)
+{
+	map<RVS::DataManagement::Symbol, int>::iterator it = cache->find(spp);
+	if (it != cache->end()) { return it->second; }
+
+	int equationNumber = bdio->query_crosswalk_table(RVS::DataManagement::SymbolTable::name(spp), field);
+	cache->insert(pair<RVS::DataManagement::Symbol, int>(spp, equationNumber));
+	return equationNumber;
+}
+
+const RVS::Biomass::EquationData* BiomassDriver::lookupEquation(int equationNumber)
+{
+	map<int, EquationData>::iterator it = equations.find(equationNumber);
+	if (it != equations.end()) { return &it->second; }
+
+	EquationData equation = EquationData();
+	bdio->query_equation_parameters(equationNumber, equation.params, equation.coefs);
+	return &equations.insert(pair<int, EquationData>(equationNumber, equation)).first->second;
+}
 
 double BiomassDriver::calcHerbHoldover()
 {
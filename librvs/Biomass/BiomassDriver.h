@@ -20,6 +20,13 @@ namespace RVS
 {
 namespace Biomass
 {
+	// Coefficients and parameter names of a row in the biomass equation table
+	struct EquationData
+	{
+		double coefs[4];
+		string params[3];
+	};
+
 	class BiomassDriver
 	{
 	public:
@@ -43,6 +50,15 @@ namespace Biomass
 		bool suppress_messages;
 		string* climate;
 
+		// Equation lookups only depend on the species, so they are made once per driver.
+		// Crosswalk caches hold the raw table value, 0 when the species has no equation.
+		map<RVS::DataManagement::Symbol, int> batCrosswalk;
+		map<RVS::DataManagement::Symbol, int> pchCrosswalk;
+		map<int, EquationData> equations;
+
+		int lookupCrosswalk(map<RVS::DataManagement::Symbol, int>* cache, RVS::DataManagement::Symbol spp, const char* field);
+		const EquationData* lookupEquation(int equationNumber);
+
 		// Constants for herbaceous biomass calculation
 		double calcShrubBiomass(RVS::DataManagement::SppRecord* record);
 		double calcStemsPerAcre(RVS::DataManagement::SppRecord* record);
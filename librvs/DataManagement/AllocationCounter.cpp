@@ -0,0 +1,70 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+using RVS::DataManagement::AllocationCounter;
+
+namespace
+{
+	RVS_THREAD_LOCAL long allocations = 0;
+	RVS_THREAD_LOCAL int paused = 0;
+}
+
+long AllocationCounter::COUNT(void)
+{
+	return allocations;
+}
+
+void AllocationCounter::reset(void)
+{
+	allocations = 0;
+}
+
+AllocationCounter::Pause::Pause(void)
+{
+	paused++;
+}
+
+AllocationCounter::Pause::~Pause(void)
+{
+	paused--;
+}
+
+#if RVS_COUNT_ALLOCS
+
+void* operator new(std::size_t size)
+{
+	if (paused == 0) { allocations++; }
+
+	void* p = std::malloc(size > 0 ? size : 1);
+	if (p == NULL) { throw std::bad_alloc(); }
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t size) noexcept
+{
+	std::free(p);
+}
+
+void operator delete[](void* p, std::size_t size) noexcept
+{
+	std::free(p);
+}
+
+#endif
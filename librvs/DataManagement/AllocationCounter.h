@@ -0,0 +1,47 @@
+/// ********************************************************** ///
+/// Name: AllocationCounter.h                                  ///
+/// Desc: Test mode that counts heap allocations per thread.   ///
+/// Built with RVS_COUNT_ALLOCS the global operator new is     ///
+/// replaced by a counting one, and the simulation loop checks ///
+/// that plot-years in a steady state, output included, do not ///
+/// allocate. RVS_ALLOC_PAUSE() excludes diagnostics and cache ///
+/// misses that fill a table once.                             ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include "../RVSDEF.h"
+
+namespace RVS
+{
+namespace DataManagement
+{
+	class AllocationCounter
+	{
+	public:
+		// Allocations made by the calling thread since the last reset
+		static long COUNT(void);
+		static void reset(void);
+
+		// Allocations are not counted while a Pause is in scope
+		class Pause
+		{
+		public:
+			Pause(void);
+			~Pause(void);
+		};
+	};
+}
+}
+
+#if RVS_COUNT_ALLOCS
+	#define RVS_ALLOC_PAUSE() RVS::DataManagement::AllocationCounter::Pause allocationPause
+#else
+	#define RVS_ALLOC_PAUSE()
+#endif
+
+#endif
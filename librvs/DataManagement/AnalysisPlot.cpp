@@ -1,14 +1,18 @@
 #include "AnalysisPlot.h"
+#include "../Succession/SuccessionFastForward.h"
 
 using RVS::DataManagement::AnalysisPlot;
 
 AnalysisPlot::AnalysisPlot(RVS::DataManagement::DIO* dio, RVS::DataManagement::DataTable* dt)
 {
 	plot_id = 0;
-	plot_name = "";
+	plot_name = SymbolTable::EMPTY;
 	evt_num = 0;
 	bps_num = 0;
-	bps_model_num = "";
+	bps_model_num = SymbolTable::EMPTY;
+	grp_id = SymbolTable::EMPTY;
+	fbfmName = SymbolTable::EMPTY;
+	fbfmClass = RVS::Fuels::FBFM_NONE;
 	shrubHeight = 0;
 	shrubCover = 0;
 	totalBiomass = 0;
@@ -23,6 +27,10 @@ AnalysisPlot::AnalysisPlot(RVS::DataManagement::DIO* dio, RVS::DataManagement::D
 	precipValues = vector<double>();
 	disturbances = vector<Disturbance::DisturbAction>();
 	disturbed = false;
+	burned = false;
+	biomassReductionTotal = 0;
+	trajectory = NULL;
+	spareTrajectory = NULL;
 
 	previousHerbProductions = new double[3];
 	previousHerbProductions[0] = 0;
@@ -37,6 +45,118 @@ AnalysisPlot::AnalysisPlot(RVS::DataManagement::DIO* dio, RVS::DataManagement::D
 AnalysisPlot::~AnalysisPlot(void)
 {
 	shrubRecords.clear();
+	delete trajectory;
+	delete spareTrajectory;
+}
+
+AnalysisPlot* AnalysisPlot::clone(void)
+{
+	// The member-wise copy shares the pointers, resetTo gives the copy its own
+	AnalysisPlot* copy = new AnalysisPlot(*this);
+	copy->previousHerbProductions = new double[3];
+	copy->shrubRecords.clear();
+	copy->spareRecords.clear();
+	copy->trajectory = NULL;
+	copy->spareTrajectory = NULL;
+	copy->resetTo(*this);
+	return copy;
+}
+
+void AnalysisPlot::resetTo(const AnalysisPlot& initial)
+{
+	// Every record the plot owns, the spare ones after its shrubs
+	vector<SppRecord*> records;
+	records.swap(spareRecords);
+	records.insert(records.begin(), shrubRecords.begin(), shrubRecords.end());
+	double* productions = previousHerbProductions;
+	// Trajectories are planned with the driver's parameters, which may have changed. The
+	// last one is kept for the next plan to reuse.
+	if (trajectory != NULL)
+	{
+		delete spareTrajectory;
+		spareTrajectory = trajectory;
+	}
+	RVS::Succession::ShrubTrajectory* spare = spareTrajectory;
+
+	*this = initial;
+
+	previousHerbProductions = productions;
+	std::copy(initial.previousHerbProductions, initial.previousHerbProductions + 3, previousHerbProductions);
+	trajectory = NULL;
+	spareTrajectory = spare;
+
+	size_t count = initial.shrubRecords.size();
+	for (size_t r = 0; r < count; r++)
+	{
+		if (r < records.size())
+		{
+			// A record of the same species keeps its equation parameters, which BiomassDriver
+			// writes before every use
+			bool sameSpecies = records[r]->SPP_CODE_ID() == initial.shrubRecords[r]->SPP_CODE_ID();
+			std::map<std::string, double> params;
+			if (sameSpecies) { params.swap(records[r]->equationParams); }
+			*records[r] = *initial.shrubRecords[r];
+			if (sameSpecies) { records[r]->equationParams.swap(params); }
+		}
+		else
+		{
+			records.push_back(new SppRecord(*initial.shrubRecords[r]));
+		}
+	}
+	shrubRecords.assign(records.begin(), records.begin() + count);
+	records.erase(records.begin(), records.begin() + count);
+	spareRecords.swap(records);
+}
+
+bool AnalysisPlot::checkSteadyState(int year)
+{
+	captureState(&currentState);
+	bool unchanged = hasLastState && currentState == lastState;
+
+	std::swap(currentState, lastState);
+	hasLastState = true;
+
+	return unchanged && trajectory != NULL && trajectory->constantFrom(year, *YEARS);
+}
+
+void AnalysisPlot::captureState(RVS::DataManagement::PlotState* state)
+{
+	state->stage = currentStage;
+	state->stageType = currentStageType;
+	state->fbfm = FBFM();
+	state->fbfmName = fbfmName;
+
+	state->values.clear();
+	state->values.push_back(shrubHeight);
+	state->values.push_back(shrubCover);
+	state->values.push_back(herbHeight);
+	state->values.push_back(herbCover);
+	state->values.push_back(totalBiomass);
+	state->values.push_back(herbBiomass);
+	state->values.push_back(herbHoldoverBiomass);
+	state->values.push_back(rawProduction);
+	state->values.push_back(primaryProduction);
+	state->values.push_back(previousHerbProductions[0]);
+	state->values.push_back(previousHerbProductions[1]);
+	state->values.push_back(previousHerbProductions[2]);
+	state->values.push_back(shrubBiomass);
+	state->values.push_back(lower_confidence);
+	state->values.push_back(upper_confidence);
+	state->values.push_back(s2y);
+	state->values.push_back(shrub1HourWB);
+	state->values.push_back(shrub1HourFoliage);
+	state->values.push_back(shrub10Hour);
+	state->values.push_back(shrub100Hour);
+	state->values.push_back(shrub1000Hour);
+	state->values.push_back(total1HrFuel);
+	state->values.push_back(herbFuel);
+
+	state->shrubValues.clear();
+	for (auto &r : shrubRecords)
+	{
+		state->shrubValues.push_back(r->HEIGHT());
+		state->shrubValues.push_back(r->COVER());
+	}
 }
 
 void AnalysisPlot::buildAnalysisPlot(RVS::DataManagement::DIO* dio, RVS::DataManagement::DataTable* dt)
@@ -44,10 +164,14 @@ void AnalysisPlot::buildAnalysisPlot(RVS::DataManagement::DIO* dio, RVS::DataMan
 	sqlite3_stmt* stmt = dt->getStmt();
 	
 	dio->getVal(stmt, dt->Columns[PLOT_NUM_FIELD], &plot_id);
-	dio->getVal(stmt, dt->Columns[PLOT_NAME_FIELD], &plot_name);
+	std::string text = "";
+	dio->getVal(stmt, dt->Columns[PLOT_NAME_FIELD], &text);
+	plot_name = SymbolTable::intern(text);
 	dio->getVal(stmt, dt->Columns[EVT_NUM_FIELD], &evt_num);
 	dio->getVal(stmt, dt->Columns[BPS_NUM_FIELD], &bps_num);
-	dio->getVal(stmt, dt->Columns[BPS_MODEL_FIELD], &bps_model_num);
+	text = "";
+	dio->getVal(stmt, dt->Columns[BPS_MODEL_FIELD], &text);
+	bps_model_num = SymbolTable::intern(text);
 	dio->getVal(stmt, dt->Columns[HERB_COVER_FIELD], &herbCover);
 	dio->getVal(stmt, dt->Columns[HERB_HEIGHT_FIELD], &herbHeight);
 	dio->getVal(stmt, dt->Columns[SUCCESSION_CLASS_FIELD], &currentStage);
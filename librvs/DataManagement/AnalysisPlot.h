@@ -12,7 +12,10 @@
 
 #include "DataTable.h"
 #include "DIO.h"
+#include "PlotState.h"
 #include "SppRecord.h"
+#include "SymbolTable.h"
+#include "../Fuels/FBFM.h"
 #include "../Disturbance/DisturbAction.h"
 
 namespace RVS { namespace Biomass { class BiomassDriver; } }
@@ -20,11 +23,23 @@ namespace RVS { namespace Biomass { class BiomassEqDriver; } }
 namespace RVS { namespace Fuels   { class FuelsDriver;   } }
 namespace RVS { namespace Succession { class SuccessionDriver; } }
 namespace RVS { namespace Disturbance { class DisturbanceDriver; } }
+namespace RVS { namespace Disturbance { class GrazingEngine; } }
+namespace RVS { namespace Disturbance { class FireEngine; } }
+namespace RVS { namespace Disturbance { class RotationScheduler; } }
+namespace RVS { namespace Succession { class ShrubTrajectory; } }
+namespace RVS { namespace Succession { class Recolonization; } }
 
 namespace RVS
 {
 namespace DataManagement
 {
+	// A shrub species growing around a plot that lost its shrubs
+	struct SeedSource
+	{
+		Symbol species;
+		double cover;  // Mean cover of the species over the plot's neighbors, nearer ones weigh more (%)
+	};
+
 	class AnalysisPlot
 	{
 		friend class RVS::Biomass::BiomassDriver;
@@ -32,17 +47,34 @@ namespace DataManagement
 		friend class RVS::Biomass::BiomassEqDriver;
 		friend class RVS::Succession::SuccessionDriver;
 		friend class RVS::Disturbance::DisturbanceDriver;
+		friend class RVS::Disturbance::GrazingEngine;
+		friend class RVS::Disturbance::FireEngine;
+		friend class RVS::Disturbance::RotationScheduler;
+		friend class RVS::Succession::Recolonization;
 
 	public:
 		AnalysisPlot(RVS::DataManagement::DIO* dio, RVS::DataManagement::DataTable* dt);
 		virtual ~AnalysisPlot(void);
 
+		// Copy with its own shrub records and production history, for simulating the plot
+		// again from the same starting values
+		AnalysisPlot* clone(void);
+		// Sets the plot back to the values of initial, which may be another plot. The plot's
+		// shrub records and last trajectory are reused, so resetting a plot to the same initial
+		// plot again does not allocate.
+		void resetTo(const AnalysisPlot& initial);
+
+		// Records are kept for the whole run and come out of the record arena
+		static void* operator new(size_t size) { return RVS::DataManagement::Arena::allocateRecord(size); }
+		static void operator delete(void* p) { }
+
 		inline const int PLOT_ID() { return plot_id; }
-		inline const string PLOT_NAME() { return plot_name; }
+		inline const string& PLOT_NAME() { return SymbolTable::name(plot_name); }
 		inline const int EVT_NUM() { return evt_num; }
 		inline const int BPS_NUM() { return bps_num; }
-		inline const string BPS_MODEL_NUM() { return bps_model_num; }
-		inline const string GRP_ID() { return grp_id; }
+		inline const string& BPS_MODEL_NUM() { return SymbolTable::name(bps_model_num); }
+		inline Symbol BPS_MODEL_ID() { return bps_model_num; }
+		inline const string& GRP_ID() { return SymbolTable::name(grp_id); }
 		inline const bool ISDRY() { return dryClimate; }
 
 		inline const double LOWER_BOUND() { return lower_confidence; }
@@ -92,14 +124,18 @@ namespace DataManagement
 		
 		// Fuel model for the plot
 		inline int FBFM() { return calcFBFM == 0 ? defaultFBFM : calcFBFM; }
-		inline const string FBFM_NAME() { return fbfmName; }
+		inline const string& FBFM_NAME() { return SymbolTable::name(fbfmName); }
+		inline Symbol FBFM_ID() { return fbfmName; }
+		// Fuel model assigned by the classification rules for the current year
+		inline RVS::Fuels::FBFM FBFM_CLASS() { return fbfmClass; }
 
 		inline int CURRENT_SUCCESSION_STAGE() { return currentStage; }
-		inline string CURRENT_STAGE_TYPE() { return currentStageType; }
+		inline const string& CURRENT_STAGE_TYPE() { return SymbolTable::name(currentStageType); }
+		inline Symbol CURRENT_STAGE_TYPE_ID() { return currentStageType; }
 		inline int PLOT_AGE() { return plotAge; }
 
-		const float GRAMS_TO_POUNDS = 0.00220462f;
-		const float POUNDS_TO_GRAMS = 453.592f;
+		static constexpr float GRAMS_TO_POUNDS = 0.00220462f;
+		static constexpr float POUNDS_TO_GRAMS = 453.592f;
 
 		void push_shrub(RVS::DataManagement::DIO* dio, RVS::DataManagement::DataTable* dt);
 		void push_shrub(RVS::DataManagement::SppRecord* record);
@@ -113,18 +149,31 @@ namespace DataManagement
 
 		std::vector<RVS::Disturbance::DisturbAction> getDisturbancesForYear(int year);
 		inline void setDisturbances(vector<RVS::Disturbance::DisturbAction> dists) { disturbances = dists; }
+		inline size_t NUM_DISTURBANCES() { return disturbances.size(); }
 		// Returns the reduction amount in lbs/ac from grazing
 		inline double BIOMASS_DISTURB_AMOUNT() { return biomassReductionTotal * GRAMS_TO_POUNDS; }
+		// Grazed by a pasture rotation, which depends on the forage of the other plots in the pasture
+		inline bool IN_ROTATION() { return inRotation; }
+		inline void setInRotation(bool inRotation) { this->inRotation = inRotation; }
+		// Species that can recolonize the plot, most cover first. Empty unless the plot lost
+		// its shrubs and neighbors are searched (see Recolonization).
+		inline const std::vector<SeedSource>& SEED_SOURCES() { return seedSources; }
+
+		// Compares the plot with the year before. True if nothing written for the year changed and
+		// the planned shrub trajectory stays constant to the end of the simulation, in which case
+		// every remaining year would write the same records.
+		bool checkSteadyState(int year);
+		inline RVS::Succession::ShrubTrajectory* TRAJECTORY() { return trajectory; }
 
 	private:
 		int plot_id;
-		std::string plot_name;
+		Symbol plot_name;
 		int evt_num;
 		std::string evt_name;
 		int bps_num;
-		string bps_model_num;
+		Symbol bps_model_num;
 		int fallback_bps_num;
-		std::string grp_id;
+		Symbol grp_id;
 		double latitude;
 		double longitude;
 
@@ -170,7 +219,8 @@ namespace DataManagement
 		int defaultFBFM;	// Default FBFM. Used if FBFM calculation fails
 		int calcFBFM;		// Calculated FBFM
 		bool dryClimate;	// Dry or humid BPS (true = dry)
-		string fbfmName;
+		Symbol fbfmName;
+		RVS::Fuels::FBFM fbfmClass;
 
 		double fuel1HrProp;      // 1 Hr wood + bark proportion
 		double fuelFoilageProp;  // 1 Hr foliage proportion
@@ -186,14 +236,26 @@ namespace DataManagement
 		double herbFuel; 
 
 		std::vector<RVS::DataManagement::SppRecord*> shrubRecords;   // List of shrub records
+		std::vector<RVS::DataManagement::SppRecord*> spareRecords;   // Records a reset left over, reused by the next
 		std::vector<double> ndviValues;   // NDVI values for all years to be simulated
 		std::vector<double> precipValues; // PPT values for all years to be simulated
 
 		int currentStage = 0;
-		string currentStageType;
+		Symbol currentStageType = SymbolTable::EMPTY;
 		int plotAge = 0;
 		int timeInHerbStage = 0;
 
+		// Planned shrub growth for undisturbed plots. NULL until SuccessionDriver plans one
+		RVS::Succession::ShrubTrajectory* trajectory;
+		RVS::Succession::ShrubTrajectory* spareTrajectory;   // Trajectory a reset left over, planned into next
+
+		// Plot state of the last two simulated years, used for steady state detection
+		RVS::DataManagement::PlotState currentState;
+		RVS::DataManagement::PlotState lastState;
+		bool hasLastState = false;
+
+		void captureState(RVS::DataManagement::PlotState* state);
+
 		// Builds the AnalysisPlot by querying the appropriate tables(s) in the database
 		void buildAnalysisPlot(RVS::DataManagement::DIO* dio, RVS::DataManagement::DataTable* dt);
 		// Get basic fuels information (FBFM, climate)
@@ -202,6 +264,8 @@ namespace DataManagement
 		vector<RVS::Disturbance::DisturbAction> disturbances;
 		bool disturbed = false;
 		bool burned = false;
+		bool inRotation = false;
+		std::vector<SeedSource> seedSources;
 		// Total biomass to be removed via disturbance in g/ac
 		double biomassReductionTotal;
 
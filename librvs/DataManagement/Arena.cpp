@@ -0,0 +1,81 @@
+#include "Arena.h"
+
+using RVS::DataManagement::Arena;
+
+Arena::Arena(size_t chunkSize)
+{
+	this->chunkSize = chunkSize;
+	chunks = std::vector<Chunk>();
+	current = 0;
+	offset = 0;
+	used = 0;
+	reserved = 0;
+}
+
+Arena::~Arena(void)
+{
+	for (auto &c : chunks)
+	{
+		delete[] c.data;
+	}
+	chunks.clear();
+}
+
+void* Arena::allocate(size_t size, size_t align)
+{
+	while (true)
+	{
+		if (current < chunks.size())
+		{
+			Chunk* chunk = &chunks[current];
+			size_t start = (offset + align - 1) & ~(align - 1);
+			if (start + size <= chunk->size)
+			{
+				offset = start + size;
+				used += size;
+				return chunk->data + start;
+			}
+
+			// Does not fit, move on to the next chunk (kept from before a reset, or new)
+			if (current + 1 < chunks.size())
+			{
+				current++;
+				offset = 0;
+				continue;
+			}
+		}
+
+		// Chunk data comes from new[], which is aligned for any fundamental type
+		Chunk chunk = Chunk();
+		chunk.size = size + align > chunkSize ? size + align : chunkSize;
+		chunk.data = new char[chunk.size];
+		reserved += chunk.size;
+		chunks.push_back(chunk);
+
+		current = chunks.size() - 1;
+		offset = 0;
+	}
+}
+
+void Arena::reset(void)
+{
+	current = 0;
+	offset = 0;
+	used = 0;
+}
+
+Arena* Arena::scratch(void)
+{
+	static RVS_THREAD_LOCAL Arena arena;
+	return &arena;
+}
+
+void* Arena::allocateRecord(size_t size)
+{
+	static Arena records(1024 * 1024);
+#if USEMULTIT
+	static std::mutex recordMutex;
+	std::lock_guard<std::mutex> lock(recordMutex);
+#endif
+	return records.allocate(size);
+}
@@ -0,0 +1,73 @@
+/// ********************************************************** ///
+/// Name: Arena.h                                              ///
+/// Desc: Chunked bump allocator. Memory is handed out from    ///
+/// large chunks and only given back all at once, by reset()   ///
+/// or when the arena is destroyed. Chunks are kept on reset,  ///
+/// so a reused arena stops touching the heap.                 ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <vector>
+
+#include "../RVSDEF.h"
+#if USEMULTIT
+#include <mutex>
+#endif
+
+namespace RVS
+{
+namespace DataManagement
+{
+	class Arena
+	{
+	public:
+		Arena(size_t chunkSize = 64 * 1024);
+		virtual ~Arena(void);
+
+		// Returns size bytes aligned to align. Never returns NULL.
+		void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+		// Uninitialized array of count T
+		template <typename T> inline T* allocateArray(size_t count)
+		{
+			return static_cast<T*>(allocate(sizeof(T) * count, alignof(T)));
+		}
+
+		// Makes all memory available again. Nothing allocated before may be used afterwards.
+		void reset(void);
+
+		inline size_t BYTES_USED() { return used; }
+		inline size_t BYTES_RESERVED() { return reserved; }
+
+		// Arena for the temporaries of a single plot-year on the calling thread. Reset after
+		// every plot-year by the simulation loop.
+		static Arena* scratch(void);
+
+		// Memory for objects that live for the whole run (plots and their shrub records).
+		// Shared by all threads, never given back.
+		static void* allocateRecord(size_t size);
+
+	private:
+		struct Chunk
+		{
+			char* data;
+			size_t size;
+		};
+
+		size_t chunkSize;
+		std::vector<Chunk> chunks;
+		size_t current;   // Chunk being allocated from
+		size_t offset;    // Next free byte in the current chunk
+		size_t used;
+		size_t reserved;
+	};
+}
+}
+
+#endif
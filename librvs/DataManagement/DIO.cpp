@@ -1,18 +1,85 @@
 #include "DIO.h"
 
+#include <algorithm>
+
+// Write slots per output_batch span of a trace
+static const size_t OUTPUT_TRACE_BATCH = 1024;
+// Output statements of a plot-year: one per output table, and one per shrub record in each
+// per species table, with a few to spare
+static const size_t WRITES_PER_PLOT_YEAR = 8;
+static const size_t WRITES_PER_SHRUB = 2;
+
+namespace
+{
+	// Text of the statement a thread is building. The buffer is kept between statements, so
+	// it stops growing once it fits the longest one.
+	class StatementBuffer : public std::streambuf
+	{
+	public:
+		void restart(void)
+		{
+			char* begin = text.empty() ? NULL : &text[0];
+			setp(begin, begin + text.size());
+		}
+
+		inline const char* TEXT() { return pbase(); }
+		inline size_t LENGTH() { return pptr() - pbase(); }
+
+	protected:
+		int_type overflow(int_type c)
+		{
+			size_t length = LENGTH();
+			text.resize(std::max<size_t>(2 * text.size(), 1024));
+			setp(&text[0], &text[0] + text.size());
+			pbump((int)length);
+			if (!traits_type::eq_int_type(c, traits_type::eof()))
+			{
+				*pptr() = traits_type::to_char_type(c);
+				pbump(1);
+			}
+			return traits_type::not_eof(c);
+		}
+
+	private:
+		std::vector<char> text;
+	};
+
+	struct StatementStream
+	{
+		StatementBuffer buffer;
+		std::ostream stream;
+
+		StatementStream(void) : stream(&buffer) {}
+	};
+
+	StatementStream* statementStream(void)
+	{
+		static RVS_THREAD_LOCAL StatementStream statement;
+		return &statement;
+	}
+}
+
 // Static object decs //
 
 // RVS input database
-sqlite3* RVS::DataManagement::DIO::rvsdb;
+RVS_THREAD_LOCAL sqlite3* RVS::DataManagement::DIO::rvsdb;
 // RVS ouput database
 sqlite3* RVS::DataManagement::DIO::outdb;
 
-map<string, shared_ptr<RVS::DataManagement::DataTable>> RVS::DataManagement::DIO::activeQueries;
-vector<const char*> RVS::DataManagement::DIO::queuedWrites;
+RVS_THREAD_LOCAL map<string, shared_ptr<RVS::DataManagement::DataTable>> RVS::DataManagement::DIO::activeQueries;
+RVS::DataManagement::SqlQueue RVS::DataManagement::DIO::queuedWrites;
+vector<RVS::DataManagement::RepeatRecord> RVS::DataManagement::DIO::queuedRepeats;
+vector<RVS::DataManagement::SqlQueue> RVS::DataManagement::DIO::slotWrites;
+RVS_THREAD_LOCAL int RVS::DataManagement::DIO::currentSlot = -1;
+#if USEMULTIT
+std::mutex RVS::DataManagement::DIO::writeMutex;
+std::mutex RVS::DataManagement::DIO::debugMutex;
+#endif
 
 // Constructor
 RVS::DataManagement::DIO::DIO(void)
 {
+	queryStage = STAGE_QUERY_INPUT;
 	char* err = NULL;
 	if (rvsdb == NULL)
 	{
@@ -25,6 +92,7 @@ RVS::DataManagement::DIO::DIO(void)
 			RC = open_db_connection(":memory:", &rvsdb);
 			buildInMemDB(rvsdb, RVS_DB_PATH, 0);
 		}
+		RVS_SQL_ATTACH(rvsdb, "rvsdb");
 	}
 	
 	checkDBStatus(rvsdb);
@@ -32,6 +100,7 @@ RVS::DataManagement::DIO::DIO(void)
 	if (outdb == NULL)
 	{
 		RC = create_output_db();
+		RVS_SQL_ATTACH(outdb, "outdb");
 	}
 	
 	checkDBStatus(outdb);
@@ -93,6 +162,40 @@ int* RVS::DataManagement::DIO::open_db_connection(char* pathToDb, sqlite3** db)
 	return RC;
 }
 
+int* RVS::DataManagement::DIO::open_thread_connection(void)
+{
+	if (rvsdb != NULL) { return RC; }
+
+	*RC = sqlite3_open_v2(RVS_DB_PATH, &rvsdb, SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL);
+	if (*RC != SQLITE_OK)
+	{
+		fprintf(stderr, "Can't open database: %s\n", sqlite3_errmsg(rvsdb));
+		sqlite3_close(rvsdb);
+		rvsdb = NULL;
+		return RC;
+	}
+
+	// Threads share the file through the page cache rather than each holding a copy in memory
+	sqlite3_exec(rvsdb, "PRAGMA mmap_size = 1073741824", NULL, NULL, NULL);
+	RVS_SQL_ATTACH(rvsdb, "rvsdb");
+
+	return RC;
+}
+
+int* RVS::DataManagement::DIO::close_thread_connection(void)
+{
+	// Statements have to be finalized before their connection closes
+	activeQueries.clear();
+
+	if (rvsdb != NULL)
+	{
+		*RC = sqlite3_close(rvsdb);
+		rvsdb = NULL;
+	}
+
+	return RC;
+}
+
 int* RVS::DataManagement::DIO::create_output_db()
 {
 	RC = create_output_db(OUT_DB_PATH);
@@ -109,12 +212,14 @@ int* RVS::DataManagement::DIO::create_output_db(char* path)
 
 RVS::DataManagement::DataTable* RVS::DataManagement::DIO::prep_datatable(const char* sql, sqlite3* db, bool addToActive, bool reset)
 {
+	RVS_TIME(queryStage);
 	shared_ptr<DataTable> dt;
 	if (isQueryActive(sql))
 	{
 		dt = activeQueries[sql];
 		if (reset)
 		{
+			RVS_COUNT(COUNT_SQL_EXECUTED, 1);
 			*RC = sqlite3_reset(dt->getStmt());
 			*RC = sqlite3_step(dt->getStmt());
 			*(dt->STATUS()) = *RC;
@@ -128,6 +233,8 @@ RVS::DataManagement::DataTable* RVS::DataManagement::DIO::prep_datatable(const c
 
 		// Prepare SQL query as object code
 		*RC = sqlite3_prepare_v2(db, sql, nByte, &stmt, NULL);
+		RVS_COUNT(COUNT_SQL_PREPARED, 1);
+		RVS_COUNT(COUNT_SQL_EXECUTED, 1);
 		//checkDBStatus(db, sql);
 		*RC = sqlite3_step(stmt);
 		//checkDBStatus(db, sql);
@@ -144,16 +251,39 @@ RVS::DataManagement::DataTable* RVS::DataManagement::DIO::prep_datatable(const c
 
 int* RVS::DataManagement::DIO::write_output(void)
 {
-	char* err = new char();
+	RVS_TIME(STAGE_OUTPUT);
+	char* err = NULL;
 	*RC = sqlite3_exec(outdb, "BEGIN TRANSACTION", NULL, NULL, &err);
 
-	for (int w = 0; w < queuedWrites.size(); w++)
+	for (size_t w = 0; w < queuedWrites.SIZE(); w++)
 	{
 		const char* sql = queuedWrites.at(w);
 		*RC = sqlite3_exec(outdb, sql, NULL, NULL, &err);
 		checkDBStatus(outdb, sql, err);
 		sqlite3_free(err);
 	}
+	queuedWrites.clear();
+
+	for (size_t batch = 0; batch < slotWrites.size(); batch += OUTPUT_TRACE_BATCH)
+	{
+		RVS_TRACE_SPAN("output_batch", "output", (int)batch);
+		for (size_t s = batch; s < slotWrites.size() && s < batch + OUTPUT_TRACE_BATCH; s++)
+		{
+			for (size_t w = 0; w < slotWrites[s].SIZE(); w++)
+			{
+				const char* sql = slotWrites[s].at(w);
+				*RC = sqlite3_exec(outdb, sql, NULL, NULL, &err);
+				checkDBStatus(outdb, sql, err);
+				sqlite3_free(err);
+			}
+			slotWrites[s].clear();
+		}
+	}
+
+	{
+		RVS_TRACE_SPAN("expand_repeats", "output", (int)queuedRepeats.size());
+		expand_repeat_records();
+	}
 
 	*RC = sqlite3_exec(outdb, "END TRANSACTION", NULL, NULL, &err);
 	checkDBStatus(outdb, NULL, err);
@@ -162,26 +292,221 @@ int* RVS::DataManagement::DIO::write_output(void)
 	return RC;
 }
 
+// DisturbanceDIO has no per plot rows, output classes with them override this
+int* RVS::DataManagement::DIO::write_repeat_records(int*, int*, RVS::DataManagement::AnalysisPlot*)
+{
+	return RC;
+}
+
+int* RVS::DataManagement::DIO::create_year_index(void)
+{
+	return RC;
+}
+
+int* RVS::DataManagement::DIO::index_by_year(const char* table)
+{
+	std::stringstream sqlstream;
+	sqlstream << "CREATE INDEX IF NOT EXISTS " << table << "_" << YEAR_OUT_FIELD << \
+		" ON " << table << " (" << YEAR_OUT_FIELD << ", " << PLOT_NUM_FIELD << ");";
+
+	char* err = NULL;
+	*RC = sqlite3_exec(outdb, sqlstream.str().c_str(), NULL, NULL, &err);
+	checkDBStatus(outdb, sqlstream.str().c_str(), err);
+	sqlite3_free(err);
+
+	return RC;
+}
+
+bool RVS::DataManagement::DIO::table_exists(const char* table)
+{
+	std::stringstream ss;
+	ss << "SELECT name FROM sqlite_master WHERE type='table' AND name='" << table << "';";
+	RVS::DataManagement::DataTable* dt = prep_datatable(scratchCharPtr(&ss), rvsdb, true, true);
+	return *dt->STATUS() == SQLITE_ROW;
+}
+
+int* RVS::DataManagement::DIO::write_repeat_record(const char* table, int plot_id, int fromYear, int toYear, const char* incrementField)
+{
+	if (WRITES_DISCARDED()) { return RC; }
+	if (toYear <= fromYear) { return RC; }
+
+	RepeatRecord r = RepeatRecord();
+	r.table = table;
+	r.incrementField = incrementField;
+	r.plotId = plot_id;
+	r.fromYear = fromYear;
+	r.toYear = toYear;
+
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(writeMutex);
+#endif
+	queuedRepeats.push_back(r);
+
+	return RC;
+}
+
+void RVS::DataManagement::DIO::expand_repeat_records(void)
+{
+	if (queuedRepeats.empty()) { return; }
+
+	// One statement per table, the plot and year range are bound per repeat
+	map<string, sqlite3_stmt*> statements;
+
+	for (auto &r : queuedRepeats)
+	{
+		string key = r.table + "." + r.incrementField;
+		sqlite3_stmt* stmt = NULL;
+
+		if (statements.find(key) == statements.end())
+		{
+			// Rows are copied by plot and year, so index the table before copying
+			std::stringstream index;
+			index << "CREATE INDEX IF NOT EXISTS " << r.table << "_" << PLOT_NUM_FIELD << "_" << YEAR_OUT_FIELD << \
+				" ON " << r.table << " (" << PLOT_NUM_FIELD << ", " << YEAR_OUT_FIELD << ");";
+			*RC = sqlite3_exec(outdb, index.str().c_str(), NULL, NULL, NULL);
+
+			std::stringstream pragma;
+			pragma << "PRAGMA table_info(" << r.table << ");";
+			sqlite3_stmt* info = NULL;
+			*RC = sqlite3_prepare_v2(outdb, pragma.str().c_str(), -1, &info, NULL);
+
+			std::stringstream fields;
+			std::stringstream values;
+			int count = 0;
+			while (sqlite3_step(info) == SQLITE_ROW)
+			{
+				string field = string((char*)sqlite3_column_text(info, 1));
+				if (count > 0)
+				{
+					fields << ", ";
+					values << ", ";
+				}
+				fields << "\"" << field << "\"";
+
+				if (field.compare(YEAR_OUT_FIELD) == 0)
+				{
+					values << "y";
+				}
+				else if (field.compare(r.incrementField) == 0)
+				{
+					values << "\"" << field << "\" + (y - ?2)";
+				}
+				else
+				{
+					values << "\"" << field << "\"";
+				}
+				count++;
+			}
+			sqlite3_finalize(info);
+
+			std::stringstream sqlstream;
+			sqlstream << "WITH RECURSIVE years(y) AS (SELECT ?2 + 1 UNION ALL SELECT y + 1 FROM years WHERE y < ?3) " << \
+				"INSERT INTO " << r.table << " (" << fields.str() << ") " << \
+				"SELECT " << values.str() << " FROM " << r.table << ", years " << \
+				"WHERE " << PLOT_NUM_FIELD << " = ?1 AND " << YEAR_OUT_FIELD << " = ?2;";
+
+			*RC = sqlite3_prepare_v2(outdb, sqlstream.str().c_str(), -1, &stmt, NULL);
+			checkDBStatus(outdb, sqlstream.str().c_str());
+			statements[key] = stmt;
+		}
+		else
+		{
+			stmt = statements[key];
+		}
+
+		if (stmt == NULL) { continue; }
+
+		sqlite3_bind_int(stmt, 1, r.plotId);
+		sqlite3_bind_int(stmt, 2, r.fromYear);
+		sqlite3_bind_int(stmt, 3, r.toYear);
+		*RC = sqlite3_step(stmt);
+		sqlite3_reset(stmt);
+	}
+
+	for (auto &s : statements)
+	{
+		sqlite3_finalize(s.second);
+	}
+	*RC = SQLITE_OK;
+	queuedRepeats.clear();
+}
+
+void RVS::DataManagement::DIO::reserve_write_slots(size_t count)
+{
+	slotWrites.resize(count);
+}
+
+void RVS::DataManagement::DIO::begin_write_slot(int slot)
+{
+	currentSlot = slot;
+}
+
+void RVS::DataManagement::DIO::reserve_writes(size_t numShrubs)
+{
+	if (WRITES_DISCARDED()) { return; }
+	size_t count = WRITES_PER_PLOT_YEAR + WRITES_PER_SHRUB * numShrubs;
+	if (currentSlot >= 0)
+	{
+		slotWrites[currentSlot].reserve(count);
+		return;
+	}
+
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(writeMutex);
+#endif
+	queuedWrites.reserve(count);
+}
+
+std::ostream& RVS::DataManagement::DIO::begin_write(void)
+{
+	StatementStream* statement = statementStream();
+	statement->buffer.restart();
+	statement->stream.clear();
+	statement->stream.flags(std::ios_base::skipws | std::ios_base::dec);
+	statement->stream.precision(6);
+	statement->stream.width(0);
+	return statement->stream;
+}
+
+void RVS::DataManagement::DIO::queue_write(void)
+{
+	if (WRITES_DISCARDED()) { return; }
+	RVS_COUNT(COUNT_OUTPUT_STATEMENTS, 1);
+	StatementBuffer* statement = &statementStream()->buffer;
+	// A slot is only ever written by the thread running its plot
+	if (currentSlot >= 0)
+	{
+		slotWrites[currentSlot].push(statement->TEXT(), statement->LENGTH());
+		return;
+	}
+
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(writeMutex);
+#endif
+	queuedWrites.push(statement->TEXT(), statement->LENGTH());
+}
+
 void RVS::DataManagement::DIO::write_debug_msg(const char* msg)
 {
+	// Diagnostics, not output. Messages in the simulation are warnings about missing input.
+	RVS_ALLOC_PAUSE();
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(debugMutex);
+#endif
+
 	time_t t = time(NULL);
 	char strTime[25];
 	strftime(strTime, 25, "%d/%m/%y %H:%M:%S", localtime(&t));
-
-	ofstream* dfile = new ofstream(DEBUG_FILE, ios::app);
-	*dfile << strTime << " " << msg << std::endl;
-	dfile->close();
+	ofstream dfile(DEBUG_FILE, ios::app);
+	dfile << strTime << " " << msg << std::endl;
 }
 
 std::vector<int> RVS::DataManagement::DIO::query_analysis_plots()
 {
-	std::stringstream* selectStream = new std::stringstream();
-	*selectStream << "SELECT DISTINCT " << PLOT_NUM_FIELD << " FROM " << RVS_INPUT_TABLE << "; ";
-	
-	char* selectString = new char;
-	selectString = streamToCharPtr(selectStream);
+	std::stringstream selectStream;
+	selectStream << "SELECT DISTINCT " << PLOT_NUM_FIELD << " FROM " << RVS_INPUT_TABLE << "; ";
 	
-	RVS::DataManagement::DataTable* dt = prep_datatable(selectString, rvsdb);
+	RVS::DataManagement::DataTable* dt = prep_datatable(selectStream.str().c_str(), rvsdb);
 	std::vector<int> items;
 	int plot;
 	while (*RC == SQLITE_ROW)
@@ -191,86 +516,64 @@ std::vector<int> RVS::DataManagement::DIO::query_analysis_plots()
 		*RC = sqlite3_step(dt->getStmt());
 	}
 
-	delete selectStream;
-	delete selectString;
-
 	return items;
 }
 
 const char* RVS::DataManagement::DIO::query_base(const char* table)
 {
-	std::stringstream* selectStream = new std::stringstream();
-	*selectStream << "SELECT * FROM " << table << "; ";
+	std::stringstream selectStream;
+	selectStream << "SELECT * FROM " << table << "; ";
 
-	char* selectString = new char;
-	selectString = streamToCharPtr(selectStream);
-	delete selectStream;
-	return selectString;
+	return scratchCharPtr(&selectStream);
 }
 
 const char* RVS::DataManagement::DIO::query_base(const char* table, const char* field)
 {
-	std::stringstream* selectStream = new std::stringstream();
-	*selectStream << "SELECT " << field << " FROM " << table << "; ";
+	std::stringstream selectStream;
+	selectStream << "SELECT " << field << " FROM " << table << "; ";
 
-	char* selectString = new char;
-	selectString = streamToCharPtr(selectStream);
-	delete selectStream;
-	return selectString;
+	return scratchCharPtr(&selectStream);
 }
 
 const char* RVS::DataManagement::DIO::query_base(const char* table, const char* field, int whereclause)
 {
-	std::stringstream* selectStream = new std::stringstream();
-	*selectStream << "SELECT * FROM " << table << " WHERE " << field << "=" << whereclause << "; ";
+	std::stringstream selectStream;
+	selectStream << "SELECT * FROM " << table << " WHERE " << field << "=" << whereclause << "; ";
 
-	char* selectString = new char;
-	selectString = streamToCharPtr(selectStream);
-	delete selectStream;
-	return selectString;
+	return scratchCharPtr(&selectStream);
 }
 
 const char* RVS::DataManagement::DIO::query_base(const char* table, const char* field, string whereclause)
 {
-	std::stringstream* selectStream = new std::stringstream();
-	*selectStream << "SELECT * FROM " << table << " WHERE " << field << "='" << whereclause << "'; ";
+	std::stringstream selectStream;
+	selectStream << "SELECT * FROM " << table << " WHERE " << field << "='" << whereclause << "'; ";
 	
-	char* selectString = new char;
-	selectString = streamToCharPtr(selectStream);
-	delete selectStream;
-	return selectString;
+	return scratchCharPtr(&selectStream);
 }
 
 const char* RVS::DataManagement::DIO::query_base(const char* table, const char* field, int whereclause, string order)
 {
-	std::stringstream* selectStream = new std::stringstream();
-	*selectStream << "SELECT * FROM " << table << " WHERE " << field << "=" << whereclause;
-	*selectStream << " ORDER BY " << order << ";";
+	std::stringstream selectStream;
+	selectStream << "SELECT * FROM " << table << " WHERE " << field << "=" << whereclause;
+	selectStream << " ORDER BY " << order << ";";
 
-	char* selectString = new char;
-	selectString = streamToCharPtr(selectStream);
-	delete selectStream;
-	return selectString;
+	return scratchCharPtr(&selectStream);
 }
 
 const char* RVS::DataManagement::DIO::query_base(const char* table, const char* field, string whereclause, string order)
 {
-	std::stringstream* selectStream = new std::stringstream();
-	*selectStream << "SELECT * FROM " << table << " WHERE " << field << "='" << whereclause << "'";
-	*selectStream << " ORDER BY " << order << ";";
+	std::stringstream selectStream;
+	selectStream << "SELECT * FROM " << table << " WHERE " << field << "='" << whereclause << "'";
+	selectStream << " ORDER BY " << order << ";";
 
-	char* selectString = new char;
-	selectString = streamToCharPtr(selectStream);
-	delete selectStream;
-	return selectString;
+	return scratchCharPtr(&selectStream);
 }
 
 RVS::DataManagement::DataTable* RVS::DataManagement::DIO::query_input_table(void)
 {
-	std::stringstream* sqlStream = new std::stringstream();
-	*sqlStream << "SELECT * FROM " << RVS_INPUT_TABLE << ";";
-	const char* sql = streamToCharPtr(sqlStream);
-	RVS::DataManagement::DataTable* dt = prep_datatable(sql, rvsdb);
+	std::stringstream sqlStream;
+	sqlStream << "SELECT * FROM " << RVS_INPUT_TABLE << ";";
+	RVS::DataManagement::DataTable* dt = prep_datatable(sqlStream.str().c_str(), rvsdb);
 	return dt;
 }
 
@@ -283,10 +586,9 @@ RVS::DataManagement::DataTable* RVS::DataManagement::DIO::query_input_table(int
 
 RVS::DataManagement::DataTable* RVS::DataManagement::DIO::query_shrubs_table(void)
 {
-	std::stringstream* sqlStream = new std::stringstream();
-	*sqlStream << "SELECT * FROM " << SHRUB_INPUT_TABLE << ";";
-	const char* sql = streamToCharPtr(sqlStream);
-	RVS::DataManagement::DataTable* dt = prep_datatable(sql, rvsdb, true);
+	std::stringstream sqlStream;
+	sqlStream << "SELECT * FROM " << SHRUB_INPUT_TABLE << ";";
+	RVS::DataManagement::DataTable* dt = prep_datatable(sqlStream.str().c_str(), rvsdb, true);
 	return dt;
 }
 
@@ -489,10 +791,9 @@ void RVS::DataManagement::DIO::query_fuels_basic_info(const int* bps, int* fbfm,
 
 	if (*RC == 101)
 	{
-		stringstream* s = new stringstream();
-		*s << "Fuels input not found for BPS " << *bps << ", assuming DRY climate";
-		const char* c = streamToCharPtr(s);
-		write_debug_msg(c);
+		stringstream s;
+		s << "Fuels input not found for BPS " << *bps << ", assuming DRY climate";
+		write_debug_msg(s.str().c_str());
 
 		*isDry = true;
 	}
@@ -509,14 +810,11 @@ int* RVS::DataManagement::DIO::finalizeQueries(void)
 	return RC;
 }
 
-char* RVS::DataManagement::DIO::streamToCharPtr(stringstream* stream)
+const char* RVS::DataManagement::DIO::scratchCharPtr(stringstream* stream)
 {
-	// Get the string representation of the stream
 	string nstring = stream->str();
-	// Create a character array of the size of string
-	char* str = new char[nstring.size() + 1];
-	// Copy the string value into the array and terminate
-	std::copy(nstring.begin(), nstring.end(), str); // apparently this has been depreciated
+	char* str = Arena::scratch()->allocateArray<char>(nstring.size() + 1);
+	std::copy(nstring.begin(), nstring.end(), str);
 	str[nstring.size()] = '\0';
 	return str;
 }
@@ -16,12 +16,21 @@
 #include <vector>
 
 #include <boost/any.hpp>
+#if USEMULTIT
+#include <mutex>
+#endif
 
 
 #include "../RVSDBNAMES.h"
 #include "../RVSDEF.h"
+#include "AllocationCounter.h"
+#include "Arena.h"
 #include "DataTable.h"
+#include "Instrumentation.h"
+#include "TraceRecorder.h"
 #include "RVSException.h"
+#include "SqlProfiler.h"
+#include "SqlQueue.h"
 
 // Need to avoid circular reference here, so declare empty classes
 namespace RVS { namespace DataManagement { class AnalysisPlot; } }
@@ -33,6 +42,16 @@ namespace RVS
 {
 namespace DataManagement
 {
+	// A plot's output rows for fromYear, copied for every following year up to toYear
+	struct RepeatRecord
+	{
+		std::string table;
+		std::string incrementField;  // Optional field that grows by one each repeated year
+		int plotId;
+		int fromYear;
+		int toYear;
+	};
+
 	// Class for querying the database (and eventually writing output database)
 	class DIO
 	{
@@ -69,10 +88,32 @@ namespace DataManagement
 		virtual void query_fuels_basic_info(const int* bps, int* fbfm, bool* isDry);
 
 		int* write_output(void);
+		// Queues the rows of plots that reached a steady state for the remaining years
+		virtual int* write_repeat_records(int* year, int* lastYear, RVS::DataManagement::AnalysisPlot* ap);
+		// Indexes the output tables by year, for output not written in year order
+		virtual int* create_year_index(void);
 		void write_debug_msg(const char* msg);
 
-		// Converts a std::stringstream to a char pointer (array)
-		char* streamToCharPtr(std::stringstream* stream);
+		// Opens and closes a read-only input connection for the calling simulation thread.
+		// Threads sharing one connection would take turns on its mutex for every query.
+		static int* open_thread_connection(void);
+		static int* close_thread_connection(void);
+
+		// Output statements can be collected in numbered slots, which write_output writes in
+		// slot order. Plots then keep their output position however they are ordered or scheduled.
+		static void reserve_write_slots(size_t count);
+		// Sends the calling thread's output to a slot, -1 for the shared queue
+		static void begin_write_slot(int slot);
+		static inline int WRITE_SLOT() { return currentSlot; }
+		// Makes room in the calling thread's queue for the output of a plot-year with numShrubs
+		// shrub records, so the simulation does not allocate to queue it
+		static void reserve_writes(size_t numShrubs);
+		// Slot that drops the output, for runs that are only read in memory
+		static const int DISCARD_WRITES = -2;
+		static inline bool WRITES_DISCARDED() { return currentSlot == DISCARD_WRITES; }
+
+		// Copies a std::stringstream to the thread's scratch arena. Only valid for the current plot-year.
+		const char* scratchCharPtr(std::stringstream* stream);
 
 	protected:
 		virtual int* create_output_table() = 0;
@@ -80,6 +121,13 @@ namespace DataManagement
 		virtual int* write_output_record(int* year, RVS::DataManagement::AnalysisPlot* ap) = 0;
 		virtual int* write_intermediate_record(int* year, RVS::DataManagement::AnalysisPlot* ap, RVS::DataManagement::SppRecord* spp) = 0;
 
+		// Queues a compact "repeat until toYear" record instead of one insert per year
+		int* write_repeat_record(const char* table, int plot_id, int fromYear, int toYear, const char* incrementField = "");
+		// Creates a (year, plot) index on an output table
+		int* index_by_year(const char* table);
+		// True if the input database has the table. Optional tables are checked before querying.
+		bool table_exists(const char* table);
+
 		RVS::DataManagement::DataTable* prep_datatable(const char* sql, sqlite3* db, bool addToActive=true, bool reset=false);
 		
 		/// Base query function. All the public functions only define the selection string.
@@ -96,19 +144,36 @@ namespace DataManagement
 		bool checkDBStatus(sqlite3* db, const char* sql = "", const char* err = "");
 		int* finalizeQueries(void);
 
-		static vector<const char*> queuedWrites;
+		static SqlQueue queuedWrites;
+		static vector<RepeatRecord> queuedRepeats;
+		static vector<SqlQueue> slotWrites;
+		static RVS_THREAD_LOCAL int currentSlot;
+		// Output statements are built in a stream the calling thread reuses, with the default
+		// format. begin_write clears it, queue_write copies the statement to the thread's queue.
+		static std::ostream& begin_write(void);
+		void queue_write(void);
 		
-		static sqlite3* rvsdb;  // SQLite database object
+		// Stage the queries of this DIO are timed under
+		Stage queryStage;
+
+		static RVS_THREAD_LOCAL sqlite3* rvsdb;  // SQLite database object
 		static sqlite3* outdb;  // SQLite output database object
 
 	private:
-		static map<string, shared_ptr<DataTable>> activeQueries;
+		// Prepared statements are stepped in place, so each simulation thread keeps its own
+		static RVS_THREAD_LOCAL map<string, shared_ptr<DataTable>> activeQueries;
+#if USEMULTIT
+		static std::mutex writeMutex;
+		static std::mutex debugMutex;
+#endif
 		static int buildInMemDB(sqlite3 *pInMemory, const char *zFilename, int isSave);
 
 		int* create_output_db();
 		int* create_output_db(char* path);
 
 		bool isQueryActive(string sql);
+		// Expands queued repeat records into the output tables
+		void expand_repeat_records(void);
 		// Opens the database connection. Will remain open until DIO destructs
 		int* open_db_connection(char* pathToDb, sqlite3** db);
 	};
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <map>
+#include <string>
 
 #include <sqlite3.h>
 
@@ -0,0 +1,220 @@
+#include "Instrumentation.h"
+#include "TraceRecorder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <vector>
+#if USEMULTIT
+#include <mutex>
+#endif
+
+using RVS::DataManagement::Counter;
+using RVS::DataManagement::Instrumentation;
+using RVS::DataManagement::Stage;
+
+namespace
+{
+	struct Slot
+	{
+		uint64_t ticks[RVS::DataManagement::NUM_STAGES];
+		uint64_t calls[RVS::DataManagement::NUM_STAGES];
+		long counts[RVS::DataManagement::NUM_COUNTERS];
+	};
+
+	// Slots outlive their threads so the report can still read them
+	std::vector<Slot*> slots;
+#if USEMULTIT
+	std::mutex slotMutex;
+#endif
+	RVS_THREAD_LOCAL Slot* slot = NULL;
+	RVS_THREAD_LOCAL Instrumentation::Timer* activeTimer = NULL;
+
+	uint64_t startTicks = 0;
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	Slot* threadSlot(void)
+	{
+		if (slot == NULL)
+		{
+			slot = new Slot();
+#if USEMULTIT
+			std::lock_guard<std::mutex> lock(slotMutex);
+#endif
+			slots.push_back(slot);
+		}
+		return slot;
+	}
+
+	struct Totals
+	{
+		double seconds;
+		double ticksPerSecond;
+		size_t threads;
+		Slot sum;
+	};
+
+	Totals totals(void)
+	{
+		Totals t = Totals();
+#if USEMULTIT
+		std::lock_guard<std::mutex> lock(slotMutex);
+#endif
+		for (auto &s : slots)
+		{
+			for (int i = 0; i < RVS::DataManagement::NUM_STAGES; i++)
+			{
+				t.sum.ticks[i] += s->ticks[i];
+				t.sum.calls[i] += s->calls[i];
+			}
+			for (int i = 0; i < RVS::DataManagement::NUM_COUNTERS; i++)
+			{
+				t.sum.counts[i] += s->counts[i];
+			}
+		}
+		t.threads = slots.size();
+		t.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		t.ticksPerSecond = t.seconds > 0 ? (Instrumentation::TICKS() - startTicks) / t.seconds : 1;
+		return t;
+	}
+}
+
+void Instrumentation::add(Stage stage, uint64_t ticks)
+{
+	Slot* s = threadSlot();
+	s->ticks[stage] += ticks;
+	s->calls[stage]++;
+}
+
+void Instrumentation::count(Counter counter, long n)
+{
+	threadSlot()->counts[counter] += n;
+}
+
+Instrumentation::Timer::Timer(Stage stage)
+{
+	this->stage = stage;
+	excluded = 0;
+	outer = activeTimer;
+	activeTimer = this;
+	begin = TICKS();
+}
+
+Instrumentation::Timer::~Timer(void)
+{
+	uint64_t end = TICKS();
+	uint64_t elapsed = end - begin;
+#if RVS_INSTRUMENT
+	add(stage, elapsed - excluded);
+#endif
+#if RVS_TRACE
+	if (TraceRecorder::SAMPLED()) { TraceRecorder::span(STAGE_NAME(stage), "stage", begin, end, TraceRecorder::PLOT()); }
+#endif
+	if (outer != NULL) { outer->excluded += elapsed; }
+	activeTimer = outer;
+}
+
+void Instrumentation::start(void)
+{
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(slotMutex);
+#endif
+	for (auto &s : slots)
+	{
+		*s = Slot();
+	}
+	startTicks = TICKS();
+	startTime = std::chrono::steady_clock::now();
+}
+
+void Instrumentation::report(std::ostream& out)
+{
+	Totals t = totals();
+	long plotYears = t.sum.counts[COUNT_PLOT_YEARS];
+
+	out << std::endl << "Stage                 Calls      Seconds   Share  us/plot-year" << std::endl;
+	for (int i = 0; i < NUM_STAGES; i++)
+	{
+		double seconds = t.sum.ticks[i] / t.ticksPerSecond;
+		// Stage times of all threads are compared against all threads' wall time
+		double share = t.seconds > 0 ? seconds / (t.seconds * std::max<size_t>(t.threads, 1)) : 0;
+		out << std::left << std::setw(18) << STAGE_NAME((Stage)i) << std::right << \
+			std::setw(10) << t.sum.calls[i] << \
+			std::setw(13) << std::fixed << std::setprecision(3) << seconds << \
+			std::setw(7) << std::setprecision(1) << share * 100 << "%" << \
+			std::setw(14) << std::setprecision(2) << (plotYears > 0 ? seconds * 1e6 / plotYears : 0) << std::endl;
+	}
+
+	out << std::endl << "Counter               Total   per plot-year" << std::endl;
+	for (int i = 0; i < NUM_COUNTERS; i++)
+	{
+		out << std::left << std::setw(18) << COUNTER_NAME((Counter)i) << std::right << \
+			std::setw(10) << t.sum.counts[i] << \
+			std::setw(16) << std::setprecision(2) << (plotYears > 0 ? (double)t.sum.counts[i] / plotYears : 0) << std::endl;
+	}
+
+	out << std::endl << t.threads << " threads, " << std::setprecision(3) << t.seconds << " s wall" << std::endl;
+	out.unsetf(std::ios::floatfield);
+}
+
+bool Instrumentation::writeJson(const char* path)
+{
+	Totals t = totals();
+	std::ofstream out(path, std::ios::out);
+	if (!out.good()) { return false; }
+
+	out << "{" << std::endl;
+	out << "  \"seconds\": " << t.seconds << "," << std::endl;
+	out << "  \"threads\": " << t.threads << "," << std::endl;
+	out << "  \"stages\": {" << std::endl;
+	for (int i = 0; i < NUM_STAGES; i++)
+	{
+		out << "    \"" << STAGE_NAME((Stage)i) << "\": {\"calls\": " << t.sum.calls[i] << \
+			", \"seconds\": " << t.sum.ticks[i] / t.ticksPerSecond << "}" << (i < NUM_STAGES - 1 ? "," : "") << std::endl;
+	}
+	out << "  }," << std::endl;
+	out << "  \"counters\": {" << std::endl;
+	for (int i = 0; i < NUM_COUNTERS; i++)
+	{
+		out << "    \"" << COUNTER_NAME((Counter)i) << "\": " << t.sum.counts[i] << (i < NUM_COUNTERS - 1 ? "," : "") << std::endl;
+	}
+	out << "  }" << std::endl;
+	out << "}" << std::endl;
+	out.close();
+	return true;
+}
+
+const char* Instrumentation::STAGE_NAME(Stage stage)
+{
+	switch (stage)
+	{
+	case STAGE_SUCCESSION: return "succession";
+	case STAGE_BIOMASS: return "biomass";
+	case STAGE_FUEL_LOADS: return "fuel_loads";
+	case STAGE_FUEL_MODEL: return "fuel_model";
+	case STAGE_DISTURBANCE: return "disturbance";
+	case STAGE_QUERY_INPUT: return "query_input";
+	case STAGE_QUERY_BIOMASS: return "query_biomass";
+	case STAGE_QUERY_FUELS: return "query_fuels";
+	case STAGE_QUERY_SUCCESSION: return "query_succession";
+	case STAGE_QUERY_DISTURBANCE: return "query_disturbance";
+	case STAGE_OUTPUT: return "output";
+	default: return "";
+	}
+}
+
+const char* Instrumentation::COUNTER_NAME(Counter counter)
+{
+	switch (counter)
+	{
+	case COUNT_PLOT_YEARS: return "plot_years";
+	case COUNT_SHRUBS: return "shrubs";
+	case COUNT_EQUATIONS: return "equations";
+	case COUNT_SQL_PREPARED: return "sql_prepared";
+	case COUNT_SQL_EXECUTED: return "sql_executed";
+	case COUNT_OUTPUT_STATEMENTS: return "output_statements";
+	default: return "";
+	}
+}
@@ -0,0 +1,129 @@
+/// ********************************************************** ///
+/// Name: Instrumentation.h                                    ///
+/// Desc: Per-stage timers and event counters. Built with      ///
+/// RVS_INSTRUMENT, each thread adds time stamp counter ticks  ///
+/// and counts to its own slot, and the slots are summed into  ///
+/// a report at the end of the run. RVS_TRACE builds record    ///
+/// each timed stage as a TraceRecorder span as well. Without  ///
+/// either, RVS_TIME and RVS_COUNT expand to nothing.          ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <cstdint>
+#include <ostream>
+
+#include "../RVSDEF.h"
+
+// Timed builds read the time stamp counter, the rest of the tree never sees the intrinsics
+#define RVS_RDTSC 0
+#if RVS_INSTRUMENT || RVS_TRACE
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#undef RVS_RDTSC
+		#define RVS_RDTSC 1
+	#elif defined(__x86_64__) || defined(__i386__)
+		#include <x86intrin.h>
+		#undef RVS_RDTSC
+		#define RVS_RDTSC 1
+	#endif
+#endif
+#if !RVS_RDTSC
+#include <chrono>
+#endif
+
+namespace RVS
+{
+namespace DataManagement
+{
+	// Timed sections. A stage entered inside another is left out of the outer one's time,
+	// so the stage times add up.
+	enum Stage
+	{
+		STAGE_SUCCESSION,
+		STAGE_BIOMASS,
+		// Fuel loads, then the fuel model, output record and fire behavior of the plot-year
+		STAGE_FUEL_LOADS,
+		STAGE_FUEL_MODEL,
+		STAGE_DISTURBANCE,
+		// Preparing and executing queries, by the DIO that runs them
+		STAGE_QUERY_INPUT,
+		STAGE_QUERY_BIOMASS,
+		STAGE_QUERY_FUELS,
+		STAGE_QUERY_SUCCESSION,
+		STAGE_QUERY_DISTURBANCE,
+		// Flushing the queued output statements
+		STAGE_OUTPUT,
+		NUM_STAGES
+	};
+
+	enum Counter
+	{
+		COUNT_PLOT_YEARS,
+		COUNT_SHRUBS,          // Shrub records per plot-year
+		COUNT_EQUATIONS,       // Biomass and fuel equations evaluated
+		COUNT_SQL_PREPARED,
+		COUNT_SQL_EXECUTED,    // Statements stepped from the start, new or reset
+		COUNT_OUTPUT_STATEMENTS,
+		NUM_COUNTERS
+	};
+
+	class Instrumentation
+	{
+	public:
+		static inline uint64_t TICKS(void)
+		{
+#if RVS_RDTSC
+			return __rdtsc();
+#else
+			return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+		}
+
+		static void add(Stage stage, uint64_t ticks);
+		static void count(Counter counter, long n);
+
+		// Clears every thread's slot and starts the clock ticks are converted by
+		static void start(void);
+		// Sums the slots of all threads. Call once the simulation threads are done.
+		static void report(std::ostream& out);
+		static bool writeJson(const char* path);
+
+		static const char* STAGE_NAME(Stage stage);
+		static const char* COUNTER_NAME(Counter counter);
+
+		class Timer
+		{
+		public:
+			Timer(Stage stage);
+			~Timer(void);
+
+		private:
+			Stage stage;
+			uint64_t begin;
+			// Time of the timers nested in this one
+			uint64_t excluded;
+			// Timer this one runs inside of, on the same thread
+			Timer* outer;
+		};
+	};
+}
+}
+
+#if RVS_INSTRUMENT || RVS_TRACE
+	#define RVS_TIME(stage) RVS::DataManagement::Instrumentation::Timer instrumentationTimer(stage)
+#else
+	#define RVS_TIME(stage)
+#endif
+
+#if RVS_INSTRUMENT
+	#define RVS_COUNT(counter, n) RVS::DataManagement::Instrumentation::count(counter, n)
+#else
+	#define RVS_COUNT(counter, n)
+#endif
+
+#endif
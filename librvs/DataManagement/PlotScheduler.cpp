@@ -0,0 +1,330 @@
+#include "PlotScheduler.h"
+
+#include "Instrumentation.h"
+#include "TraceRecorder.h"
+
+using RVS::DataManagement::Instrumentation;
+using RVS::DataManagement::PlotScheduler;
+using RVS::DataManagement::TraceRecorder;
+using RVS::DataManagement::WorkerStats;
+
+PlotScheduler::PlotScheduler(int numWorkers)
+{
+#if USEMULTIT
+	this->numWorkers = numWorkers < 1 ? 1 : numWorkers;
+#else
+	(void)numWorkers;
+	this->numWorkers = 1;
+#endif
+	wallSeconds = 0;
+#if USEMULTIT
+	barrier = new Barrier();
+#endif
+
+	for (int w = 0; w < this->numWorkers; w++)
+	{
+		Worker* worker = new Worker();
+		worker->stats = WorkerStats();
+		workers.push_back(worker);
+	}
+}
+
+PlotScheduler::~PlotScheduler(void)
+{
+	for (auto &w : workers)
+	{
+		delete w;
+	}
+	workers.clear();
+#if USEMULTIT
+	delete barrier;
+#endif
+}
+
+double PlotScheduler::estimateCost(RVS::DataManagement::AnalysisPlot* ap, std::map<std::string, double>* equationWeights)
+{
+	double weight = 0;
+
+	for (auto &s : *ap->SHRUB_RECORDS())
+	{
+		std::map<std::string, double>::iterator it = equationWeights->find(s->SPP_CODE());
+		if (it != equationWeights->end())
+		{
+			weight += it->second;
+		}
+	}
+
+	return estimateCost(ap->SHRUB_RECORDS()->size(), weight, ap->NUM_DISTURBANCES());
+}
+
+double PlotScheduler::estimateCost(size_t numShrubs, double equationWeight, size_t numDisturbances)
+{
+	return 1 + 1.6 * numShrubs + equationWeight + 1.0 * numDisturbances;
+}
+
+void PlotScheduler::run(std::vector<int>* plots, std::vector<double>* costs, std::function<void(int, int)> task)
+{
+	for (auto &w : workers)
+	{
+		w->tasks.clear();
+		w->stats = WorkerStats();
+	}
+
+	partition(costs);
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+#if USEMULTIT
+	std::vector<std::thread> threads;
+	for (int w = 1; w < numWorkers; w++)
+	{
+		threads.push_back(std::thread([this, w, plots, costs, &task]()
+		{
+			RVS::DataManagement::DIO::open_thread_connection();
+			work(w, plots, costs, &task);
+			RVS::DataManagement::DIO::close_thread_connection();
+		}));
+	}
+	// The calling thread is worker 0
+	work(0, plots, costs, &task);
+
+	for (auto &t : threads)
+	{
+		t.join();
+	}
+#else
+	work(0, plots, costs, &task);
+#endif
+
+	wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PlotScheduler::runPhased(std::vector<int>* plots, std::vector<double>* costs, int rounds, int phases,
+	std::function<void(int, int, int, int)> task, std::function<void(int, int)> serial)
+{
+	for (auto &w : workers)
+	{
+		w->tasks.clear();
+		w->stats = WorkerStats();
+	}
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Worker 0 hands out the plots of a phase, then every worker runs them. After the second
+	// barrier all plots of the phase are done and worker 0 runs the serial step alone.
+	auto phaseLoop = [this, plots, costs, rounds, phases, &task, &serial](int worker)
+	{
+		for (int round = 0; round < rounds; round++)
+		{
+			for (int phase = 0; phase < phases; phase++)
+			{
+				if (worker == 0) { partition(costs); }
+#if USEMULTIT
+				{
+					RVS_TRACE_SPAN("barrier", "scheduler", round);
+					barrier->wait();
+				}
+#endif
+				std::function<void(int, int)> phaseTask = [&task, round, phase](int w, int plot) { task(w, plot, round, phase); };
+				work(worker, plots, costs, &phaseTask);
+#if USEMULTIT
+				{
+					RVS_TRACE_SPAN("barrier", "scheduler", round);
+					barrier->wait();
+				}
+#endif
+				if (worker == 0)
+				{
+					RVS_TRACE_SPAN("serial", "scheduler", round);
+					serial(round, phase);
+				}
+			}
+		}
+	};
+
+#if USEMULTIT
+	barrier->count = numWorkers;
+	barrier->waiting = 0;
+	barrier->generation = 0;
+
+	std::vector<std::thread> threads;
+	for (int w = 1; w < numWorkers; w++)
+	{
+		threads.push_back(std::thread([w, &phaseLoop]()
+		{
+			RVS::DataManagement::DIO::open_thread_connection();
+			phaseLoop(w);
+			RVS::DataManagement::DIO::close_thread_connection();
+		}));
+	}
+	phaseLoop(0);
+
+	for (auto &t : threads)
+	{
+		t.join();
+	}
+#else
+	phaseLoop(0);
+#endif
+
+	wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+#if USEMULTIT
+void PlotScheduler::Barrier::wait(void)
+{
+	std::unique_lock<std::mutex> guard(lock);
+	long arrivedIn = generation;
+	if (++waiting == count)
+	{
+		waiting = 0;
+		generation++;
+		released.notify_all();
+		return;
+	}
+	released.wait(guard, [this, arrivedIn]() { return generation != arrivedIn; });
+}
+#endif
+
+void PlotScheduler::partition(std::vector<double>* costs)
+{
+	double total = 0;
+	for (auto &c : *costs)
+	{
+		total += c;
+	}
+
+	// Consecutive plots stay together, a worker's range ends once it holds its share of the cost
+	double share = total / numWorkers;
+	double assigned = 0;
+	int worker = 0;
+	for (size_t i = 0; i < costs->size(); i++)
+	{
+		workers[worker]->tasks.push_back(i);
+		assigned += costs->at(i);
+
+		if (assigned >= share * (worker + 1) && worker < numWorkers - 1)
+		{
+			worker++;
+		}
+	}
+}
+
+void PlotScheduler::work(int worker, std::vector<int>* plots, std::vector<double>* costs, std::function<void(int, int)>* task)
+{
+	WorkerStats* stats = &workers[worker]->stats;
+	size_t index = 0;
+#if RVS_TRACE
+	// Plots taken since the last steal, the worker's own range or a stolen one
+	int chunkPlots = 0;
+	uint64_t chunkBegin = 0;
+#endif
+
+	while (true)
+	{
+		if (!take(worker, &index))
+		{
+#if RVS_TRACE
+			if (chunkPlots > 0) { TraceRecorder::span("chunk", "scheduler", chunkBegin, Instrumentation::TICKS(), chunkPlots); }
+			chunkPlots = 0;
+#endif
+			stats->stealAttempts++;
+			if (!steal(worker)) { break; }
+			continue;
+		}
+
+#if RVS_TRACE
+		if (chunkPlots++ == 0) { chunkBegin = Instrumentation::TICKS(); }
+#endif
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		(*task)(worker, plots->at(index));
+		stats->busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		stats->plots++;
+		stats->cost += costs->at(index);
+	}
+}
+
+bool PlotScheduler::take(int worker, size_t* index)
+{
+	Worker* w = workers[worker];
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(w->lock);
+#endif
+	if (w->tasks.empty()) { return false; }
+
+	// Owners work from the front of their range, thieves take from the back
+	*index = w->tasks.front();
+	w->tasks.pop_front();
+	return true;
+}
+
+bool PlotScheduler::steal(int worker)
+{
+	if (numWorkers < 2) { return false; }
+
+	std::deque<size_t> stolen;
+
+#if USEMULTIT
+	// Sizes are only a hint, the victim may have shrunk by the time it is locked
+	while (stolen.empty())
+	{
+		int victim = -1;
+		size_t most = 0;
+		for (int v = 0; v < numWorkers; v++)
+		{
+			if (v == worker) { continue; }
+			std::lock_guard<std::mutex> lock(workers[v]->lock);
+			if (workers[v]->tasks.size() > most)
+			{
+				most = workers[v]->tasks.size();
+				victim = v;
+			}
+		}
+
+		if (victim < 0) { return false; }
+
+		std::lock_guard<std::mutex> lock(workers[victim]->lock);
+		std::deque<size_t>* tasks = &workers[victim]->tasks;
+		size_t count = (tasks->size() + 1) / 2;
+		for (size_t i = 0; i < count; i++)
+		{
+			stolen.push_front(tasks->back());
+			tasks->pop_back();
+		}
+	}
+
+	Worker* w = workers[worker];
+	std::lock_guard<std::mutex> lock(w->lock);
+	w->tasks.insert(w->tasks.end(), stolen.begin(), stolen.end());
+	w->stats.steals++;
+	w->stats.stolenPlots += (long)stolen.size();
+#else
+	(void)worker;
+#endif
+
+	return !stolen.empty();
+}
+
+std::string PlotScheduler::report(void)
+{
+	std::stringstream ss;
+	ss << "Scheduler: " << numWorkers << " workers, " << wallSeconds << " s" << std::endl;
+
+	double busy = 0;
+	for (int w = 0; w < numWorkers; w++)
+	{
+		WorkerStats* stats = &workers[w]->stats;
+		double utilization = wallSeconds > 0 ? stats->busySeconds / wallSeconds : 0;
+		busy += stats->busySeconds;
+
+		ss << "  worker " << w << ": " << stats->plots << " plots, cost " << stats->cost << \
+			", utilization " << (int)(utilization * 100 + 0.5) << "%, " << \
+			stats->steals << "/" << stats->stealAttempts << " steals (" << stats->stolenPlots << " plots)" << std::endl;
+	}
+
+	double overall = wallSeconds > 0 ? busy / (wallSeconds * numWorkers) : 0;
+	ss << "  overall utilization " << (int)(overall * 100 + 0.5) << "%";
+
+	return ss.str();
+}
@@ -0,0 +1,115 @@
+/// ********************************************************** ///
+/// Name: PlotScheduler.h                                      ///
+/// Desc: Work-stealing scheduler for plot simulation. Plots   ///
+/// are split into contiguous ranges of equal estimated cost,  ///
+/// one per worker. A worker that runs out of plots steals     ///
+/// the far half of the busiest worker's remaining range.      ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef PLOTSCHEDULER_H
+#define PLOTSCHEDULER_H
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#if USEMULTIT
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#include "AnalysisPlot.h"
+
+namespace RVS
+{
+namespace DataManagement
+{
+	// Per worker bookkeeping, reported after a run
+	struct WorkerStats
+	{
+		int plots;             // Plots simulated by the worker
+		double cost;           // Estimated cost of those plots
+		double busySeconds;    // Time spent simulating
+		long stealAttempts;    // Times the worker went looking for work
+		long steals;           // Successful steals
+		long stolenPlots;      // Plots taken by those steals
+	};
+
+	class PlotScheduler
+	{
+	public:
+		// Uses a single worker unless built with USEMULTIT
+		PlotScheduler(int numWorkers);
+		virtual ~PlotScheduler(void);
+
+		// Relative cost of simulating a plot. A plot without shrubs costs 1, every shrub record
+		// adds 1.6 plus the weight of its biomass equation form (equationWeights, keyed by
+		// species code), every disturbance adds 1.
+		static double estimateCost(RVS::DataManagement::AnalysisPlot* ap, std::map<std::string, double>* equationWeights);
+		// Same model from counts, for plots that are not loaded. equationWeight is the sum over
+		// the plot's shrub records.
+		static double estimateCost(size_t numShrubs, double equationWeight, size_t numDisturbances);
+
+		// Calls task(worker, plot) once for every plot. costs holds the estimate for each plot.
+		void run(std::vector<int>* plots, std::vector<double>* costs, std::function<void(int, int)> task);
+		// Runs rounds (years) of phases on one set of threads. In every phase each plot is passed
+		// once to task(worker, plot, round, phase). All workers then wait at a barrier while
+		// serial(round, phase) runs on the calling thread, for work that needs every plot.
+		void runPhased(std::vector<int>* plots, std::vector<double>* costs, int rounds, int phases,
+			std::function<void(int, int, int, int)> task, std::function<void(int, int)> serial);
+
+		// Utilization and stealing statistics of the last run
+		std::string report(void);
+
+		inline int NUM_WORKERS() { return numWorkers; }
+		inline WorkerStats* STATS(int worker) { return &workers[worker]->stats; }
+
+	private:
+		struct Worker
+		{
+			std::deque<size_t> tasks;  // Indices into the plot list
+			WorkerStats stats;
+#if USEMULTIT
+			std::mutex lock;
+#endif
+		};
+
+		int numWorkers;
+		std::vector<Worker*> workers;
+		double wallSeconds;
+
+#if USEMULTIT
+		// Blocks until all workers arrived, reusable
+		struct Barrier
+		{
+			std::mutex lock;
+			std::condition_variable released;
+			int count;
+			int waiting;
+			long generation;
+
+			void wait(void);
+		};
+		Barrier* barrier;
+#endif
+
+		// Splits the plots into numWorkers contiguous ranges of roughly equal cost
+		void partition(std::vector<double>* costs);
+		// Runs one worker until every deque is empty
+		void work(int worker, std::vector<int>* plots, std::vector<double>* costs, std::function<void(int, int)>* task);
+		// Takes the next plot from the worker's own deque
+		bool take(int worker, size_t* index);
+		// Moves the far half of the busiest worker's plots to this worker
+		bool steal(int worker);
+	};
+}
+}
+
+#endif
@@ -0,0 +1,44 @@
+/// ********************************************************** ///
+/// Name: PlotState.h                                          ///
+/// Desc: Snapshot of the values an AnalysisPlot writes out    ///
+/// for a year. Plot age and herb stage time are left out,     ///
+/// they grow every year even on a plot that stopped changing. ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef PLOTSTATE_H
+#define PLOTSTATE_H
+
+#include <vector>
+
+#include "SymbolTable.h"
+
+namespace RVS
+{
+namespace DataManagement
+{
+	struct PlotState
+	{
+		int stage;
+		Symbol stageType;
+		Symbol fbfmName;
+		int fbfm;
+
+		// Plot level values, in the order AnalysisPlot::captureState stores them
+		std::vector<double> values;
+		// Height and cover of every shrub record
+		std::vector<double> shrubValues;
+
+		inline bool operator==(const PlotState& other) const
+		{
+			return stage == other.stage && fbfm == other.fbfm && \
+				stageType == other.stageType && fbfmName == other.fbfmName && \
+				values == other.values && shrubValues == other.shrubValues;
+		}
+	};
+}
+}
+
+#endif
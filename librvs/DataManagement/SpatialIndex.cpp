@@ -0,0 +1,74 @@
+#include "SpatialIndex.h"
+
+#include <algorithm>
+
+using RVS::DataManagement::SpatialIndex;
+
+static const double KM_PER_DEGREE_LAT = 110.574;
+static const double KM_PER_DEGREE_LON = 111.320;
+static const double PI = 3.14159265358979;
+// Grids with many more cells than plots are coarsened, empty cells still cost memory
+static const double MAX_CELLS_PER_PLOT = 4;
+
+SpatialIndex::SpatialIndex(const std::vector<RVS::DataManagement::AnalysisPlot*>& plots, double cellKm)
+{
+	size_t count = plots.size();
+	this->cellKm = cellKm > 0 ? cellKm : 1;
+
+	double meanLat = 0;
+	for (auto &p : plots)
+	{
+		meanLat += p->LATITUDE();
+	}
+	meanLat = count > 0 ? meanLat / count : 0;
+	double kmPerLon = KM_PER_DEGREE_LON * std::cos(meanLat * PI / 180);
+
+	x.resize(count);
+	y.resize(count);
+	double maxX = 0;
+	double maxY = 0;
+	originX = 0;
+	originY = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		x[i] = plots[i]->LONGITUDE() * kmPerLon;
+		y[i] = plots[i]->LATITUDE() * KM_PER_DEGREE_LAT;
+		if (i == 0 || x[i] < originX) { originX = x[i]; }
+		if (i == 0 || y[i] < originY) { originY = y[i]; }
+		if (i == 0 || x[i] > maxX) { maxX = x[i]; }
+		if (i == 0 || y[i] > maxY) { maxY = y[i]; }
+	}
+
+	double maxCells = MAX_CELLS_PER_PLOT * count + 1;
+	while (((maxX - originX) / this->cellKm + 1) * ((maxY - originY) / this->cellKm + 1) > maxCells)
+	{
+		this->cellKm *= 2;
+	}
+	cols = (int)((maxX - originX) / this->cellKm) + 1;
+	rows = (int)((maxY - originY) / this->cellKm) + 1;
+
+	// Counting sort of the plots by cell
+	std::vector<int> cells = std::vector<int>(count);
+	cellStart.assign((size_t)cols * rows + 1, 0);
+	for (size_t i = 0; i < count; i++)
+	{
+		cells[i] = cellOf(y[i], originY, rows) * cols + cellOf(x[i], originX, cols);
+		cellStart[cells[i] + 1]++;
+	}
+	for (size_t c = 1; c < cellStart.size(); c++)
+	{
+		cellStart[c] += cellStart[c - 1];
+	}
+
+	cellPlots.resize(count);
+	std::vector<int> next = std::vector<int>(cellStart.begin(), cellStart.end() - 1);
+	for (size_t i = 0; i < count; i++)
+	{
+		cellPlots[next[cells[i]]++] = (int)i;
+	}
+}
+
+SpatialIndex::~SpatialIndex(void)
+{
+
+}
@@ -0,0 +1,85 @@
+/// ********************************************************** ///
+/// Name: SpatialIndex.h                                       ///
+/// Desc: Uniform grid over plot coordinates for radius        ///
+/// queries. Latitude and longitude are projected to km around ///
+/// the mean latitude, plots are sorted by grid cell, and a    ///
+/// query only visits the cells its circle overlaps.           ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "AnalysisPlot.h"
+
+namespace RVS
+{
+namespace DataManagement
+{
+	class SpatialIndex
+	{
+	public:
+		// cellKm is the grid spacing, best close to the usual query radius. Plots keep their
+		// position in the list as their index.
+		SpatialIndex(const std::vector<RVS::DataManagement::AnalysisPlot*>& plots, double cellKm);
+		virtual ~SpatialIndex(void);
+
+		inline size_t SIZE() const { return x.size(); }
+		inline double CELL_KM() const { return cellKm; }
+
+		// Calls visit(j, distanceKm) for every plot j within radiusKm of plot i, i excluded
+		template<typename Visit>
+		void forEachNeighbor(size_t i, double radiusKm, Visit visit) const
+		{
+			int reach = (int)std::ceil(radiusKm / cellKm);
+			int col = cellOf(x[i], originX, cols);
+			int row = cellOf(y[i], originY, rows);
+			double radius2 = radiusKm * radiusKm;
+
+			for (int r = std::max(row - reach, 0); r <= std::min(row + reach, rows - 1); r++)
+			{
+				for (int c = std::max(col - reach, 0); c <= std::min(col + reach, cols - 1); c++)
+				{
+					size_t cell = (size_t)r * cols + c;
+					for (int k = cellStart[cell]; k < cellStart[cell + 1]; k++)
+					{
+						int j = cellPlots[k];
+						double dx = x[j] - x[i];
+						double dy = y[j] - y[i];
+						double d2 = dx * dx + dy * dy;
+						if (d2 <= radius2 && (size_t)j != i) { visit((size_t)j, std::sqrt(d2)); }
+					}
+				}
+			}
+		}
+
+	private:
+		double cellKm;
+		double originX;
+		double originY;
+		int cols;
+		int rows;
+
+		// Projected positions (km)
+		std::vector<double> x;
+		std::vector<double> y;
+		// Plots of cell c are cellPlots[cellStart[c]] to cellPlots[cellStart[c + 1] - 1]
+		std::vector<int> cellStart;
+		std::vector<int> cellPlots;
+
+		inline int cellOf(double v, double origin, int count) const
+		{
+			int cell = (int)((v - origin) / cellKm);
+			return std::min(std::max(cell, 0), count - 1);
+		}
+	};
+}
+}
+
+#endif
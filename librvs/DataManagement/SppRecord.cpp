@@ -25,8 +25,8 @@ SppRecord::~SppRecord(void)
 
 void SppRecord::initialize_object()
 {
-	dom_spp = "";
-	spp_code = "";
+	dom_spp = SymbolTable::EMPTY;
+	spp_code = SymbolTable::EMPTY;
 	height = 0;
 	cover = 0;
 	width = 0;
@@ -35,6 +35,11 @@ void SppRecord::initialize_object()
 	shrubBiomass = 0;
 	exShrubBiomass = 0;
 	pchEqNum = 0;
+	fuel1hr = 0;
+	fuel10hr = 0;
+	fuel100hr = 0;
+	fuel1000hr = 0;
+	for (int i = 0; i < 4; i++) { fuelEqNums[i] = 0; }
 	batEqNum = 0;
 }
 
@@ -43,10 +48,14 @@ void SppRecord::buildRecord(RVS::DataManagement::DIO* dio, RVS::DataManagement::
 	sqlite3_stmt* stmt = dt->getStmt();
 
 	int column = 0;
+	std::string text = "";
 	column = dt->Columns[DOM_SPP_FIELD];
-	dio->getVal(stmt, dt->Columns[DOM_SPP_FIELD], &dom_spp);
+	dio->getVal(stmt, dt->Columns[DOM_SPP_FIELD], &text);
+	dom_spp = SymbolTable::intern(text);
+	text = "";
 	column = dt->Columns[SPP_CODE_FIELD];
-	dio->getVal(stmt, dt->Columns[SPP_CODE_FIELD], &spp_code);
+	dio->getVal(stmt, dt->Columns[SPP_CODE_FIELD], &text);
+	spp_code = SymbolTable::intern(text);
 	column = dt->Columns[BIOMASS_HEIGHT_FIELD];
 	dio->getVal(stmt, dt->Columns[BIOMASS_HEIGHT_FIELD], &height);
 	column = dt->Columns[BIOMASS_COVER_FIELD];
@@ -56,10 +65,10 @@ void SppRecord::buildRecord(RVS::DataManagement::DIO* dio, RVS::DataManagement::
 
 void SppRecord::buildRecord(string spp_code, double height, double cover, string dom_spp)
 {
-	this->spp_code = spp_code;
+	this->spp_code = SymbolTable::intern(spp_code);
 	this->height = height;
 	this->cover = cover;
-	this->dom_spp = dom_spp;
+	this->dom_spp = SymbolTable::intern(dom_spp);
 }
 
 double SppRecord::requestValue(std::string parameterName)
@@ -12,17 +12,21 @@
 #ifndef SPP_RECORD_H
 #define SPP_RECORD_H
 
+#include <map>
 #include <string>
 #include <vector>
 
 #include "../RVSDBNAMES.h"
 #include "DIO.h"
+#include "SymbolTable.h"
 
 namespace RVS { namespace Biomass { class BiomassDriver; } }
 namespace RVS { namespace Biomass { class BiomassEqDriver; } }
 namespace RVS { namespace Fuels   { class FuelsDriver; } }
 namespace RVS { namespace Succession { class SuccessionDriver; } }
 namespace RVS { namespace Disturbance { class DisturbanceDriver; } }
+namespace RVS { namespace Disturbance { class GrazingEngine; } }
+namespace RVS { namespace Disturbance { class FireEngine; } }
 
 using namespace RVS::DataManagement;
 
@@ -37,18 +41,26 @@ namespace DataManagement
 		friend class RVS::Biomass::BiomassEqDriver;
 		friend class RVS::Succession::SuccessionDriver;
 		friend class RVS::Disturbance::DisturbanceDriver;
+		friend class RVS::Disturbance::GrazingEngine;
+		friend class RVS::Disturbance::FireEngine;
+		friend class AnalysisPlot;
 
 	public:
 		SppRecord(RVS::DataManagement::DIO* dio, RVS::DataManagement::DataTable* dt);
 		SppRecord(string spp_code, double height, double cover, string dom_spp);
 		virtual ~SppRecord(void);
 
+		// Records are kept for the whole run and come out of the record arena
+		static void* operator new(size_t size) { return RVS::DataManagement::Arena::allocateRecord(size); }
+		static void operator delete(void* p) { }
+
 		/// General Record parameters ///
 
 		// Dominant species name
-		inline std::string DOM_SPP() { return dom_spp; }
+		inline const std::string& DOM_SPP() { return SymbolTable::name(dom_spp); }
 		// Dominant species PLANTS code
-		inline std::string SPP_CODE() { return spp_code; }
+		inline const std::string& SPP_CODE() { return SymbolTable::name(spp_code); }
+		inline Symbol SPP_CODE_ID() { return spp_code; }
 		// HT (cm)
 		inline double HEIGHT() { return height; } 
 		// COV (%)
@@ -65,9 +77,15 @@ namespace DataManagement
 		// Biomass result for shrub (individual biomass). coverts internal g/ac to lbs/ac
 		inline double SHRUB_SINGLE_BIOMASS() { return shrubBiomass * GRAMS_TO_POUNDS; }
 		inline double SHRUB_EX_BIOMASS() { return exShrubBiomass * GRAMS_TO_POUNDS; }
-		const float GRAMS_TO_POUNDS = 0.00220462f;
-
-		// Fuels results
+		static constexpr float GRAMS_TO_POUNDS = 0.00220462f;
+
+		// Fuels results, per species fuel mode only (lbs/ac)
+		inline double FUEL_1HR() { return fuel1hr * GRAMS_TO_POUNDS; }
+		inline double FUEL_10HR() { return fuel10hr * GRAMS_TO_POUNDS; }
+		inline double FUEL_100HR() { return fuel100hr * GRAMS_TO_POUNDS; }
+		inline double FUEL_1000HR() { return fuel1000hr * GRAMS_TO_POUNDS; }
+		// Fuel_Equation number used for a fuel class (0: 1 hr ... 3: 1000 hr)
+		inline int FUEL_EQNUM(int pool) { return fuelEqNums[pool]; }
 		
 		// Return a parameter (length, width, height) by name
 		double requestValue(std::string parameterName);
@@ -75,8 +93,8 @@ namespace DataManagement
 	protected:
 		/// General variables ///
 
-		std::string dom_spp;  // Dominant species name
-		std::string spp_code; // Dominant species PLANTS code
+		Symbol dom_spp;  // Dominant species name
+		Symbol spp_code; // Dominant species PLANTS code
 		double height; // Crown height (cm)
 		double cover;  // ABSOLUTE cover (0-100) %
 		double width;  // Average leaf width (cm)
@@ -92,6 +110,7 @@ namespace DataManagement
 		double exShrubBiomass;  // grams
 		int pchEqNum;
 		int batEqNum;
+		std::map<std::string, double> equationParams;  // Reused by the biomass equation every year
 
 		// Fuels collection
 
@@ -99,6 +118,7 @@ namespace DataManagement
 		double fuel10hr;
 		double fuel100hr;
 		double fuel1000hr;
+		int fuelEqNums[4];
 	};
 }
 }
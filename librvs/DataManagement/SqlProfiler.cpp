@@ -0,0 +1,251 @@
+#include "SqlProfiler.h"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <unordered_set>
+#include <vector>
+#if USEMULTIT
+#include <mutex>
+#endif
+
+using RVS::DataManagement::SqlProfiler;
+
+// Characters of a statement shown in the report
+static const size_t REPORT_SQL_WIDTH = 100;
+
+namespace
+{
+	struct StatementStats
+	{
+		const char* db;
+		size_t form;  // Hash of the normalized statement
+		long executions;
+		long rows;
+		long repeatedExecutions;
+		// sqlite's profile time, from the first step to the reset or finalize. A cached
+		// statement is held open while its rows are read, so this is not execution time.
+		double heldNanoseconds;
+	};
+
+	struct DatabaseStats
+	{
+		long executions;
+		std::unordered_set<size_t> texts;  // Hashes of the distinct statement texts
+	};
+
+	// Keyed by database name and normalized statement
+	std::map<std::string, StatementStats> statements;
+	std::map<std::string, DatabaseStats> databases;
+	long plotYears = 0;
+	long simulationQueries = 0;
+	long repeatedQueries = 0;
+#if USEMULTIT
+	std::mutex statsMutex;
+#endif
+	RVS_THREAD_LOCAL int currentYear = -1;
+	// Forms of the input statements the thread ran during the simulation
+	RVS_THREAD_LOCAL std::unordered_set<size_t> simulationForms;
+
+	StatementStats* statementStats(const char* db, const char* sql)
+	{
+		std::string form = SqlProfiler::normalize(sql);
+		std::string key = std::string(db) + "\t" + form;
+		std::map<std::string, StatementStats>::iterator it = statements.find(key);
+		if (it == statements.end())
+		{
+			StatementStats s = StatementStats();
+			s.db = db;
+			s.form = std::hash<std::string>()(form);
+			it = statements.insert(std::make_pair(key, s)).first;
+		}
+		return &it->second;
+	}
+
+	int trace(unsigned int type, void* context, void* p, void* x)
+	{
+		const char* db = (const char*)context;
+		const char* sql = sqlite3_sql((sqlite3_stmt*)p);
+		if (sql == NULL) { return 0; }
+
+#if USEMULTIT
+		std::lock_guard<std::mutex> lock(statsMutex);
+#endif
+		StatementStats* s = statementStats(db, sql);
+		switch (type)
+		{
+		case SQLITE_TRACE_STMT:
+		{
+			size_t text = std::hash<std::string>()(sql);
+			s->executions++;
+			DatabaseStats* d = &databases[db];
+			d->executions++;
+			d->texts.insert(text);
+
+			// Only the input database is budgeted, output statements are queued until the end.
+			// A thread's first run of a statement loads its cache, running it again means
+			// something was not cached. Statements are compared by form, a query run again
+			// for another plot or year is a repeat too.
+			if (std::string(db).compare("rvsdb") == 0 && currentYear >= 0)
+			{
+				simulationQueries++;
+				if (!simulationForms.insert(s->form).second)
+				{
+					repeatedQueries++;
+					s->repeatedExecutions++;
+				}
+			}
+			break;
+		}
+		case SQLITE_TRACE_PROFILE:
+			s->heldNanoseconds += (double)*(sqlite3_int64*)x;
+			break;
+		case SQLITE_TRACE_ROW:
+			s->rows++;
+			break;
+		}
+		return 0;
+	}
+}
+
+void SqlProfiler::attach(sqlite3* db, const char* name)
+{
+	if (db == NULL) { return; }
+	sqlite3_trace_v2(db, SQLITE_TRACE_STMT | SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW, &trace, (void*)name);
+}
+
+std::string SqlProfiler::normalize(const char* sql)
+{
+	std::string out;
+	bool space = false;
+	for (const char* c = sql; *c != '\0'; c++)
+	{
+		if (std::isspace((unsigned char)*c))
+		{
+			space = !out.empty();
+			continue;
+		}
+		if (space)
+		{
+			out += ' ';
+			space = false;
+		}
+
+		if (*c == '?')
+		{
+			// Numbered parameters
+			while (std::isdigit((unsigned char)*(c + 1))) { c++; }
+			out += '?';
+		}
+		else if (*c == '\'' || *c == '"')
+		{
+			// Skip to the closing quote, a doubled quote is an escaped one. The output records
+			// quote their text values with ", so those count as literals too.
+			char quote = *c;
+			c++;
+			while (*c != '\0' && !(*c == quote && *(c + 1) != quote))
+			{
+				if (*c == quote) { c++; }
+				c++;
+			}
+			out += '?';
+			if (*c == '\0') { break; }
+		}
+		else if ((std::isdigit((unsigned char)*c) || (*c == '-' && std::isdigit((unsigned char)*(c + 1)))) &&
+			(out.empty() || !(std::isalnum((unsigned char)out.back()) || out.back() == '_')))
+		{
+			// A number that is not part of a name
+			c++;
+			while (std::isalnum((unsigned char)*c) || *c == '.' || ((*c == '-' || *c == '+') && (*(c - 1) == 'e' || *(c - 1) == 'E')))
+			{
+				c++;
+			}
+			c--;
+			out += '?';
+		}
+		else
+		{
+			out += *c;
+		}
+	}
+	return out;
+}
+
+void SqlProfiler::report(std::ostream& out, size_t top)
+{
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(statsMutex);
+#endif
+	out << std::endl << "SQL profile" << std::endl;
+	for (auto &d : databases)
+	{
+		long forms = 0;
+		for (auto &s : statements)
+		{
+			if (d.first.compare(s.second.db) == 0) { forms++; }
+		}
+		out << "  " << d.first << ": " << d.second.executions << " executions of " << d.second.texts.size() << \
+			" distinct statements (" << forms << " forms)" << std::endl;
+	}
+	out << "  Input queries during simulation: " << simulationQueries << " in " << plotYears << " plot-years (" << \
+		std::setprecision(3) << (plotYears > 0 ? (double)simulationQueries / plotYears : 0) << " per plot-year), " << \
+		repeatedQueries << " repeated by the same thread" << std::endl;
+
+	std::vector<const std::pair<const std::string, StatementStats>*> sorted;
+	for (auto &s : statements)
+	{
+		sorted.push_back(&s);
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const std::pair<const std::string, StatementStats>* a,
+		const std::pair<const std::string, StatementStats>* b)
+	{
+		if (a->second.executions != b->second.executions) { return a->second.executions > b->second.executions; }
+		return a->second.rows > b->second.rows;
+	});
+
+	out << std::endl << "  Held: ms from a statement's first step to its reset, not its execution time" << std::endl;
+	out << "  db      executions      rows   held ms  repeated  statement" << std::endl;
+	for (size_t i = 0; i < sorted.size() && i < top; i++)
+	{
+		const StatementStats& s = sorted[i]->second;
+		std::string sql = sorted[i]->first.substr(sorted[i]->first.find('\t') + 1);
+		if (sql.size() > REPORT_SQL_WIDTH) { sql = sql.substr(0, REPORT_SQL_WIDTH - 3) + "..."; }
+
+		out << "  " << std::left << std::setw(6) << s.db << std::right << \
+			std::setw(12) << s.executions << \
+			std::setw(10) << s.rows << \
+			std::setw(10) << std::fixed << std::setprecision(2) << s.heldNanoseconds / 1e6 << \
+			std::setw(10) << s.repeatedExecutions << "  " << sql << std::endl;
+	}
+	out.unsetf(std::ios::floatfield);
+}
+
+long SqlProfiler::PLOT_YEARS(void)
+{
+	return plotYears;
+}
+
+long SqlProfiler::REPEATED_QUERIES(void)
+{
+	return repeatedQueries;
+}
+
+SqlProfiler::Year::Year(int year, bool countPlotYear)
+{
+	previous = currentYear;
+	currentYear = year;
+	if (countPlotYear)
+	{
+#if USEMULTIT
+		std::lock_guard<std::mutex> lock(statsMutex);
+#endif
+		plotYears++;
+	}
+}
+
+SqlProfiler::Year::~Year(void)
+{
+	currentYear = previous;
+}
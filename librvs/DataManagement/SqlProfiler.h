@@ -0,0 +1,74 @@
+/// ********************************************************** ///
+/// Name: SqlProfiler.h                                        ///
+/// Desc: Statement profile of the input and output databases. ///
+/// Built with RVS_PROFILE_SQL, every connection the DIO opens ///
+/// is traced with sqlite3_trace_v2. Executions and rows are  ///
+/// summed per statement with its literals replaced by ?.      ///
+/// Input queries whose form a thread already ran during the   ///
+/// simulation, which a cache should have saved, count against ///
+/// a budget.                                                  ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef SQLPROFILER_H
+#define SQLPROFILER_H
+
+#include <ostream>
+#include <string>
+
+#include <sqlite3.h>
+
+#include "../RVSDEF.h"
+
+namespace RVS
+{
+namespace DataManagement
+{
+	class SqlProfiler
+	{
+	public:
+		// Traces the statements of db under name ("rvsdb", "outdb")
+		static void attach(sqlite3* db, const char* name);
+
+		// SQL text with quoted and number literals replaced by ? and whitespace collapsed
+		static std::string normalize(const char* sql);
+
+		// Prints the most executed statements, then those with the most rows, and the input
+		// queries per plot-year. Statements also show how long they were held, sqlite's profile
+		// time from the first step to the reset. It includes the time a cached statement was
+		// held open, so it is not used to rank them.
+		static void report(std::ostream& out, size_t top);
+
+		// Plot-years simulated, and input queries whose form the thread that ran them had run
+		// before during the simulation
+		static long PLOT_YEARS(void);
+		static long REPEATED_QUERIES(void);
+
+		// Queries made while a Year is in scope belong to that year of the calling thread's plot
+		class Year
+		{
+		public:
+			// countPlotYear is false for later parts of a plot-year that was already counted
+			Year(int year, bool countPlotYear);
+			~Year(void);
+
+		private:
+			int previous;
+		};
+	};
+}
+}
+
+#if RVS_PROFILE_SQL
+	#define RVS_SQL_ATTACH(db, name) RVS::DataManagement::SqlProfiler::attach(db, name)
+	#define RVS_SQL_PLOT_YEAR(year) RVS::DataManagement::SqlProfiler::Year sqlProfilerYear(year, true)
+	#define RVS_SQL_YEAR(year) RVS::DataManagement::SqlProfiler::Year sqlProfilerYear(year, false)
+#else
+	#define RVS_SQL_ATTACH(db, name)
+	#define RVS_SQL_PLOT_YEAR(year)
+	#define RVS_SQL_YEAR(year)
+#endif
+
+#endif
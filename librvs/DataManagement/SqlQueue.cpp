@@ -0,0 +1,56 @@
+#include "SqlQueue.h"
+
+#include <algorithm>
+#include <cstring>
+
+using RVS::DataManagement::SqlQueue;
+
+// Chunks start small, a write slot only holds one plot's rows, and double up to the largest size
+static const size_t FIRST_CHUNK = 4 * 1024;
+static const size_t LARGEST_CHUNK = 1024 * 1024;
+
+SqlQueue::SqlQueue(void)
+{
+	chunkSize = 0;
+	offset = 0;
+	longest = 0;
+}
+
+void SqlQueue::push(const char* sql, size_t length)
+{
+	if (offset + length + 1 > chunkSize) { addChunk(length + 1); }
+
+	char* text = chunks.back().get() + offset;
+	std::memcpy(text, sql, length);
+	text[length] = '\0';
+	offset += length + 1;
+	longest = std::max(longest, length + 1);
+	statements.push_back(text);
+}
+
+void SqlQueue::reserve(size_t count)
+{
+	if (statements.capacity() - statements.size() < count)
+	{
+		statements.reserve(std::max(statements.size() + count, 2 * statements.capacity()));
+	}
+
+	size_t bytes = count * longest;
+	if (offset + bytes > chunkSize) { addChunk(bytes); }
+}
+
+void SqlQueue::clear(void)
+{
+	chunks.clear();
+	statements.clear();
+	chunkSize = 0;
+	offset = 0;
+}
+
+void SqlQueue::addChunk(size_t size)
+{
+	size_t next = chunkSize == 0 ? FIRST_CHUNK : std::min(2 * chunkSize, LARGEST_CHUNK);
+	chunkSize = std::max(next, size);
+	chunks.push_back(std::unique_ptr<char[]>(new char[chunkSize]));
+	offset = 0;
+}
@@ -0,0 +1,53 @@
+/// ********************************************************** ///
+/// Name: SqlQueue.h                                           ///
+/// Desc: Output statements waiting to be written. The queue   ///
+/// owns their text, kept in chunks that never move, so a      ///
+/// queued statement stays valid until the queue is cleared.   ///
+/// Room for the next statements can be reserved ahead, after  ///
+/// which queuing them does not touch the heap.                ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef SQLQUEUE_H
+#define SQLQUEUE_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace RVS
+{
+namespace DataManagement
+{
+	class SqlQueue
+	{
+	public:
+		SqlQueue(void);
+
+		// Copies length characters of sql to the end of the queue
+		void push(const char* sql, size_t length);
+		// Makes room for count more statements as long as the longest one queued so far
+		void reserve(size_t count);
+		// Frees every statement
+		void clear(void);
+
+		inline size_t SIZE() const { return statements.size(); }
+		// Statement i, NUL terminated
+		inline const char* at(size_t i) const { return statements[i]; }
+
+	private:
+		std::vector<std::unique_ptr<char[]>> chunks;
+		size_t chunkSize;  // Of the last chunk
+		size_t offset;     // Next free character in the last chunk
+		size_t longest;
+		std::vector<const char*> statements;
+
+		// Starts a chunk with at least size characters
+		void addChunk(size_t size);
+	};
+}
+}
+
+#endif
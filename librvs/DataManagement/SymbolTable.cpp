@@ -0,0 +1,91 @@
+#include "SymbolTable.h"
+#include "AllocationCounter.h"
+
+#include <stdexcept>
+#include <unordered_map>
+#if USEMULTIT
+#include <mutex>
+#endif
+
+using RVS::DataManagement::Symbol;
+using RVS::DataManagement::SymbolTable;
+
+std::string* SymbolTable::blocks[SymbolTable::MAX_BLOCKS] = {};
+
+namespace
+{
+	// Lookup side of the table. Built on first use, identifiers are interned while
+	// other translation units are still initializing their statics.
+	struct SymbolIndex
+	{
+		std::unordered_map<std::string, Symbol> ids;
+		size_t count = 0;
+#if USEMULTIT
+		std::mutex mutex;
+#endif
+	};
+
+	SymbolIndex* symbolIndex(void)
+	{
+		static SymbolIndex index;
+		return &index;
+	}
+}
+
+Symbol SymbolTable::intern(const std::string& value)
+{
+	SymbolIndex* index = symbolIndex();
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(index->mutex);
+#endif
+
+	// The empty string always gets id 0
+	if (index->count == 0)
+	{
+		blocks[0] = new std::string[BLOCK_SIZE];
+		index->ids[""] = EMPTY;
+		index->count = 1;
+	}
+
+	std::unordered_map<std::string, Symbol>::iterator it = index->ids.find(value);
+	if (it != index->ids.end()) { return it->second; }
+
+	// Growing the table happens once per distinct string and is not counted as per-year work
+	RVS_ALLOC_PAUSE();
+	size_t id = index->count;
+	size_t block = id / BLOCK_SIZE;
+	if (block >= MAX_BLOCKS)
+	{
+		throw std::length_error("Symbol table full");
+	}
+	if (blocks[block] == NULL)
+	{
+		blocks[block] = new std::string[BLOCK_SIZE];
+	}
+
+	blocks[block][id % BLOCK_SIZE] = value;
+	index->ids[value] = (Symbol)id;
+	index->count++;
+	return (Symbol)id;
+}
+
+Symbol SymbolTable::intern(const char* value)
+{
+	return intern(std::string(value == NULL ? "" : value));
+}
+
+const std::string& SymbolTable::name(Symbol id)
+{
+	static const std::string empty = "";
+	if (id == EMPTY || blocks[id / BLOCK_SIZE] == NULL) { return empty; }
+	return blocks[id / BLOCK_SIZE][id % BLOCK_SIZE];
+}
+
+size_t SymbolTable::SIZE(void)
+{
+	SymbolIndex* index = symbolIndex();
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(index->mutex);
+#endif
+	return index->count;
+}
@@ -0,0 +1,53 @@
+/// ********************************************************** ///
+/// Name: SymbolTable.h                                        ///
+/// Desc: Interned identifiers. Species codes, BPS models,     ///
+/// group ids, fuel model names and cohort types repeat across ///
+/// thousands of plots, so each distinct text is stored once   ///
+/// and plots and records keep a 32 bit id instead.            ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <cstdint>
+#include <string>
+
+#include "../RVSDEF.h"
+
+namespace RVS
+{
+namespace DataManagement
+{
+	// Id of an interned string. Equal ids mean equal text.
+	typedef uint32_t Symbol;
+
+	class SymbolTable
+	{
+	public:
+		// The empty string, interned first
+		static const Symbol EMPTY = 0;
+
+		// Returns the id of value, adding it on first use
+		static Symbol intern(const std::string& value);
+		static Symbol intern(const char* value);
+
+		// Text of an id. The reference stays valid until the program exits.
+		static const std::string& name(Symbol id);
+
+		// Number of interned strings
+		static size_t SIZE(void);
+
+	private:
+		// Strings are kept in fixed size blocks, so reading an id never races a
+		// thread interning a new one
+		static const size_t BLOCK_SIZE = 1024;
+		static const size_t MAX_BLOCKS = 4096;
+		static std::string* blocks[MAX_BLOCKS];
+	};
+}
+}
+
+#endif
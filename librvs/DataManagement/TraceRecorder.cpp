@@ -0,0 +1,175 @@
+#include "TraceRecorder.h"
+
+#include <chrono>
+#include <fstream>
+#include <vector>
+#if USEMULTIT
+#include <mutex>
+#endif
+
+#include "Instrumentation.h"
+
+using RVS::DataManagement::Instrumentation;
+using RVS::DataManagement::TraceRecorder;
+
+// Spans kept per thread
+static const size_t TRACE_CAPACITY = 1 << 17;
+
+namespace
+{
+	struct Event
+	{
+		const char* name;
+		const char* category;
+		uint64_t begin;
+		uint64_t end;
+		int arg;
+	};
+
+	struct Ring
+	{
+		std::vector<Event> events;
+		uint64_t written;  // Spans ever added, the buffer holds the last TRACE_CAPACITY
+		int thread;
+	};
+
+	// Rings outlive their threads so they can be written at the end
+	std::vector<Ring*> rings;
+#if USEMULTIT
+	std::mutex ringMutex;
+#endif
+	RVS_THREAD_LOCAL Ring* ring = NULL;
+	RVS_THREAD_LOCAL int currentPlot = -1;
+	RVS_THREAD_LOCAL bool sampled = true;
+
+	int sampleEvery = 1;
+	uint64_t startTicks = Instrumentation::TICKS();
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+	// Sets the thread's plot and returns the one before
+	int enterPlot(int plotId)
+	{
+		int previous = currentPlot;
+		TraceRecorder::setPlot(plotId);
+		return previous;
+	}
+
+	Ring* threadRing(void)
+	{
+		if (ring == NULL)
+		{
+			ring = new Ring();
+			ring->events.resize(TRACE_CAPACITY);
+			ring->written = 0;
+#if USEMULTIT
+			std::lock_guard<std::mutex> lock(ringMutex);
+#endif
+			ring->thread = (int)rings.size();
+			rings.push_back(ring);
+		}
+		return ring;
+	}
+}
+
+void TraceRecorder::start(int sampleEvery)
+{
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(ringMutex);
+#endif
+	for (auto &r : rings)
+	{
+		r->written = 0;
+	}
+	::sampleEvery = sampleEvery > 1 ? sampleEvery : 1;
+	startTicks = Instrumentation::TICKS();
+	startTime = std::chrono::steady_clock::now();
+}
+
+void TraceRecorder::setPlot(int plotId)
+{
+	currentPlot = plotId;
+	sampled = plotId < 0 || plotId % sampleEvery == 0;
+}
+
+int TraceRecorder::PLOT(void)
+{
+	return currentPlot;
+}
+
+bool TraceRecorder::SAMPLED(void)
+{
+	return sampled;
+}
+
+void TraceRecorder::span(const char* name, const char* category, uint64_t begin, uint64_t end, int arg)
+{
+	Ring* r = threadRing();
+	Event* e = &r->events[r->written % TRACE_CAPACITY];
+	e->name = name;
+	e->category = category;
+	e->begin = begin;
+	e->end = end;
+	e->arg = arg;
+	r->written++;
+}
+
+bool TraceRecorder::writeJson(const char* path)
+{
+	std::ofstream out(path, std::ios::out);
+	if (!out.good()) { return false; }
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	double ticksPerUs = seconds > 0 ? (Instrumentation::TICKS() - startTicks) / (seconds * 1e6) : 1;
+
+#if USEMULTIT
+	std::lock_guard<std::mutex> lock(ringMutex);
+#endif
+	uint64_t dropped = 0;
+	bool first = true;
+	out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << std::endl;
+	for (auto &r : rings)
+	{
+		out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << r->thread << \
+			", \"args\": {\"name\": \"thread " << r->thread << "\"}}";
+		first = false;
+
+		uint64_t kept = r->written < TRACE_CAPACITY ? r->written : TRACE_CAPACITY;
+		dropped += r->written - kept;
+		for (uint64_t i = r->written - kept; i < r->written; i++)
+		{
+			const Event& e = r->events[i % TRACE_CAPACITY];
+			if (e.begin < startTicks) { continue; }
+			out << ",\n{\"name\": \"" << e.name << "\", \"cat\": \"" << e.category << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << \
+				r->thread << ", \"ts\": " << (e.begin - startTicks) / ticksPerUs << ", \"dur\": " << (e.end - e.begin) / ticksPerUs << \
+				", \"args\": {\"id\": " << e.arg << "}}";
+		}
+	}
+	out << std::endl << "], \"otherData\": {\"sampleEvery\": " << sampleEvery << ", \"dropped\": " << dropped << "}}" << std::endl;
+	out.close();
+	return true;
+}
+
+TraceRecorder::Span::Span(const char* name, const char* category, int arg, bool plotLevel)
+{
+	this->name = name;
+	this->category = category;
+	this->arg = arg;
+	keep = !plotLevel || sampled;
+	begin = keep ? Instrumentation::TICKS() : 0;
+}
+
+TraceRecorder::Span::~Span(void)
+{
+	if (keep) { span(name, category, begin, Instrumentation::TICKS(), arg); }
+}
+
+// The plot is set before the span starts, so the span itself is sampled by it
+TraceRecorder::PlotSpan::PlotSpan(const char* name, int plotId)
+	: previous(enterPlot(plotId)), span(name, "plot", plotId, true)
+{
+}
+
+TraceRecorder::PlotSpan::~PlotSpan(void)
+{
+	setPlot(previous);
+}
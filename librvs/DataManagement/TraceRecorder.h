@@ -0,0 +1,84 @@
+/// ********************************************************** ///
+/// Name: TraceRecorder.h                                      ///
+/// Desc: Timeline of a run for chrome://tracing or Perfetto.  ///
+/// Built with RVS_TRACE, spans are kept in a ring buffer per  ///
+/// thread and written as Chrome trace JSON at the end of the  ///
+/// run. Spans of a plot's own work are only kept for every    ///
+/// Nth plot, so long runs stay within the buffers.            ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <cstdint>
+
+#include "../RVSDEF.h"
+
+namespace RVS
+{
+namespace DataManagement
+{
+	class TraceRecorder
+	{
+	public:
+		// Clears the buffers. Plot spans are kept for plots whose PLOT_ID is a multiple of
+		// sampleEvery, 1 keeps all of them.
+		static void start(int sampleEvery);
+
+		// Sets the plot the calling thread works on, -1 for none
+		static void setPlot(int plotId);
+		static int PLOT(void);
+		// The calling thread's plot is traced (always true outside of plots)
+		static bool SAMPLED(void);
+
+		// Adds a span between two Instrumentation::TICKS() readings. name and category
+		// must outlive the recorder (string literals).
+		static void span(const char* name, const char* category, uint64_t begin, uint64_t end, int arg);
+
+		// Writes every thread's spans, oldest first. Threads that filled their buffer keep
+		// their latest spans.
+		static bool writeJson(const char* path);
+
+		// Adds a span for its own scope
+		class Span
+		{
+		public:
+			// Spans of a plot's work (plotLevel) are dropped for plots that are not sampled
+			Span(const char* name, const char* category, int arg, bool plotLevel = false);
+			~Span(void);
+
+		private:
+			const char* name;
+			const char* category;
+			int arg;
+			bool keep;
+			uint64_t begin;
+		};
+
+		// Span of work on one plot. The thread's plot is set for its scope.
+		class PlotSpan
+		{
+		public:
+			PlotSpan(const char* name, int plotId);
+			~PlotSpan(void);
+
+		private:
+			int previous;
+			Span span;
+		};
+	};
+}
+}
+
+#if RVS_TRACE
+	#define RVS_TRACE_SPAN(name, category, arg) RVS::DataManagement::TraceRecorder::Span traceSpan(name, category, arg)
+	#define RVS_TRACE_PLOT_SPAN(name, plotId) RVS::DataManagement::TraceRecorder::PlotSpan tracePlotSpan(name, plotId)
+#else
+	#define RVS_TRACE_SPAN(name, category, arg)
+	#define RVS_TRACE_PLOT_SPAN(name, plotId)
+#endif
+
+#endif
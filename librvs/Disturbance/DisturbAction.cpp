@@ -7,9 +7,37 @@ RVS::Disturbance::DisturbAction::DisturbAction(int actionYear, string actionType
 	this->actionType = actionType;
 	this->actionSubType = actionSubType;
 	this->params = params;
+	values[0] = 0;
+	values[1] = 0;
+	values[2] = 0;
+	resolve();
+}
+
+RVS::Disturbance::DisturbAction::DisturbAction(int actionYear, string actionType, string actionSubType, map<string, double> params, const double* values)
+{
+	this->actionYear = actionYear;
+	this->actionType = actionType;
+	this->actionSubType = actionSubType;
+	this->params = params;
+	this->values[0] = values[0];
+	this->values[1] = values[1];
+	this->values[2] = values[2];
+	resolve();
 }
 
 
 RVS::Disturbance::DisturbAction::~DisturbAction()
 {
 }
+
+void RVS::Disturbance::DisturbAction::resolve(void)
+{
+	kind = KIND_OTHER;
+	if (actionType.compare("FIRE") == 0) { kind = KIND_FIRE; }
+	else if (actionType.compare("GRAZE") == 0) { kind = KIND_GRAZE; }
+
+	subType = RVS::DataManagement::SymbolTable::intern(actionSubType);
+
+	map<string, double>::iterator it = params.find("INTENSITY");
+	intensity = it == params.end() ? 0 : it->second;
+}
@@ -4,6 +4,8 @@
 #include <string>
 #include <map>
 
+#include "../DataManagement/SymbolTable.h"
+
 using namespace std;
 
 namespace RVS
@@ -14,7 +16,12 @@ namespace Disturbance
 	class DisturbAction
 	{
 	public:
+		// Action types the drivers know, resolved once when the action is built
+		enum Kind { KIND_OTHER, KIND_FIRE, KIND_GRAZE };
+
 		DisturbAction(int actionYear, string actionType, string actionSubType, map<string, double> params);
+		// values are P1_VAL, P2_VAL and P3_VAL in input order
+		DisturbAction(int actionYear, string actionType, string actionSubType, map<string, double> params, const double* values);
 		virtual ~DisturbAction();
 
 		inline const int getActionYear() { return actionYear; }
@@ -22,12 +29,26 @@ namespace Disturbance
 		inline const string getActionSubType() { return actionSubType; }
 		inline const map<string, double> getParameters() { return params; }
 
+		inline Kind KIND() const { return kind; }
+		inline RVS::DataManagement::Symbol SUBTYPE_ID() const { return subType; }
+		// Parameter by its position in the disturbance input (0-2)
+		inline double VALUE(int i) const { return values[i]; }
+		// INTENSITY parameter of the action, 0 if it has none
+		inline double INTENSITY() const { return intensity; }
+
 	private:
 		int actionYear;
 		string actionType;
 		string actionSubType;
 
 		map<string, double> params;
+
+		Kind kind;
+		RVS::DataManagement::Symbol subType;
+		double values[3];
+		double intensity;
+
+		void resolve(void);
 	};
 }
 }
\ No newline at end of file
@@ -1,7 +1,11 @@
 #include "DisturbanceDIO.h"
 
+#include <climits>
+#include <set>
+
 RVS::Disturbance::DisturbanceDIO::DisturbanceDIO(void) : RVS::DataManagement::DIO()
 {
+	queryStage = RVS::DataManagement::STAGE_QUERY_DISTURBANCE;
 	query_parameters_table();
 }
 
@@ -32,6 +36,41 @@ int* RVS::Disturbance::DisturbanceDIO::write_intermediate_record(int* year, RVS:
 	return RC;
 }
 
+int* RVS::Disturbance::DisturbanceDIO::create_rotation_table(void)
+{
+	std::ostream& sqlstream = begin_write();
+	sqlstream << "CREATE TABLE " << GRAZING_ROTATION_OUTPUT_TABLE << "(" << \
+		YEAR_OUT_FIELD << " INT NOT NULL, " << \
+		ALLOTMENT_FIELD << " TEXT, " << \
+		PASTURE_FIELD << " TEXT, " << \
+		DIST_SUBTYPE_FIELD << " TEXT, " << \
+		HERD_NUMBER_FIELD << " REAL, " << \
+		ROTATION_DAYS_FIELD << " REAL, " << \
+		ROTATION_FORAGE_FIELD << " REAL, " << \
+		ROTATION_UTILIZATION_FIELD << " REAL); ";
+
+	queue_write();
+	return RC;
+}
+
+int* RVS::Disturbance::DisturbanceDIO::write_rotation_record(int* year, const RVS::Disturbance::PastureAssignment& assignment)
+{
+	std::ostream& sqlstream = begin_write();
+	sqlstream << "INSERT INTO " << GRAZING_ROTATION_OUTPUT_TABLE << \
+		" VALUES (" << \
+		*year << ",\"" << \
+		RVS::DataManagement::SymbolTable::name(assignment.allotment) << "\",\"" << \
+		RVS::DataManagement::SymbolTable::name(assignment.pasture) << "\",\"" << \
+		RVS::DataManagement::SymbolTable::name(assignment.animal) << "\"," << \
+		assignment.number << "," << \
+		assignment.days << "," << \
+		assignment.forage << "," << \
+		assignment.utilization << ");";
+
+	queue_write();
+	return RC;
+}
+
 map<int, vector<RVS::Disturbance::DisturbAction>> RVS::Disturbance::DisturbanceDIO::query_disturbance_input()
 {
 	const char* sql = query_base(DISTURBANCE_PLOT_TABLE);
@@ -75,16 +114,18 @@ map<int, vector<RVS::Disturbance::DisturbAction>> RVS::Disturbance::DisturbanceD
 		params.insert(pair<string, double>(availableActions[actionType][actionSubType][1], p2_val));
 		params.insert(pair<string, double>(availableActions[actionType][actionSubType][2], p3_val));
 
+		double values[3] = { p1_val, p2_val, p3_val };
+
 		if (freq == 0)
 		{
-			DisturbAction d = DisturbAction(startYear, actionType, actionSubType, params);
+			DisturbAction d = DisturbAction(startYear, actionType, actionSubType, params, values);
 			allActions[plot_id].push_back(d);
 		}
 		else
 		{
 			for (int y = startYear; y <= stopYear; y += freq)
 			{
-				DisturbAction d = DisturbAction(y, actionType, actionSubType, params);
+				DisturbAction d = DisturbAction(y, actionType, actionSubType, params, values);
 				allActions[plot_id].push_back(d);
 			}
 		}
@@ -121,4 +162,228 @@ void RVS::Disturbance::DisturbanceDIO::query_parameters_table()
 
 		*RC = sqlite3_step(stmt);
 	}
-}
\ No newline at end of file
+}
+
+void RVS::Disturbance::DisturbanceDIO::query_grazer_classes(std::vector<RVS::Disturbance::GrazerClass>* classes)
+{
+	std::vector<GrazerClass> builtin = GrazingEngine::builtinClasses();
+	// Subtypes warned about, once each
+	std::set<RVS::DataManagement::Symbol> unknown;
+	const char* paramNames[3] = { "NUMBER", "AREA", "LENGTH" };
+	const char* valueNames[3] = { DIST_VAL1_NAME_FIELD, DIST_VAL2_NAME_FIELD, DIST_VAL3_NAME_FIELD };
+	const char* columns[5] = { DIST_INTAKE_FIELD, DIST_HERB_PREFERENCE_FIELD, DIST_SHRUB_PREFERENCE_FIELD, \
+		DIST_HERB_UTILIZATION_FIELD, DIST_SHRUB_UTILIZATION_FIELD };
+
+	const char* sql = query_base(DISTURBANCE_TABLE);
+	RVS::DataManagement::DataTable* dt = prep_datatable(sql, rvsdb, true, true);
+	sqlite3_stmt* stmt = dt->getStmt();
+
+	while (*dt->STATUS() == SQLITE_ROW)
+	{
+		string distType;
+		string distSubtype;
+		getVal(stmt, dt->Columns[DIST_TYPE_FIELD], &distType);
+		getVal(stmt, dt->Columns[DIST_SUBTYPE_FIELD], &distSubtype);
+
+		if (distType.compare("GRAZE") == 0)
+		{
+			RVS::DataManagement::Symbol name = RVS::DataManagement::SymbolTable::intern(distSubtype);
+			GrazerClass c = GrazingEngine::genericClass();
+			bool known = false;
+			for (auto &b : builtin)
+			{
+				if (b.name == name) { c = b; known = true; }
+			}
+			c.name = name;
+
+			double* values[5] = { &c.intake, &c.herbPreference, &c.shrubPreference, &c.herbUtilization, &c.shrubUtilization };
+			for (int i = 0; i < 5; i++)
+			{
+				if (dt->Columns.count(columns[i]) == 0) { continue; }
+				int column = dt->Columns[columns[i]];
+				if (sqlite3_column_type(stmt, column) == SQLITE_NULL) { continue; }
+				*values[i] = sqlite3_column_double(stmt, column);
+				known = true;
+			}
+
+			if (!known && unknown.insert(name).second)
+			{
+				string msg = "Warning: no grazer class for " + distSubtype + ", it grazes herbs and shrubs 50 to 50";
+				write_debug_msg(msg.c_str());
+			}
+
+			// Find the animal count, area and days among the parameter names
+			int* positions[3] = { &c.numberParam, &c.areaParam, &c.lengthParam };
+			for (int v = 0; v < 3; v++)
+			{
+				string p;
+				getVal(stmt, dt->Columns[valueNames[v]], &p);
+				for (int n = 0; n < 3; n++)
+				{
+					if (p.compare(paramNames[n]) == 0) { *positions[n] = v; }
+				}
+			}
+
+			classes->push_back(c);
+		}
+
+		*dt->STATUS() = sqlite3_step(stmt);
+	}
+}
+
+bool RVS::Disturbance::DisturbanceDIO::query_pastures(std::vector<RVS::Disturbance::Pasture>* pastures)
+{
+	if (!table_exists(GRAZING_PASTURE_TABLE)) { return false; }
+
+	std::stringstream ss;
+	ss << "SELECT * FROM " << GRAZING_PASTURE_TABLE << ";";
+	RVS::DataManagement::DataTable* dt = prep_datatable(scratchCharPtr(&ss), rvsdb, true, true);
+	sqlite3_stmt* stmt = dt->getStmt();
+
+	// Rows are plots, collected into their pasture in the order first seen
+	std::map<std::pair<RVS::DataManagement::Symbol, RVS::DataManagement::Symbol>, size_t> index;
+	while (*dt->STATUS() == SQLITE_ROW)
+	{
+		int plotId = 0;
+		string pasture;
+		string allotment;
+		double area = 1;
+
+		getVal(stmt, dt->Columns[PLOT_NUM_FIELD], &plotId);
+		getVal(stmt, dt->Columns[PASTURE_FIELD], &pasture);
+		if (dt->Columns.count(ALLOTMENT_FIELD) > 0) { getVal(stmt, dt->Columns[ALLOTMENT_FIELD], &allotment); }
+		if (dt->Columns.count(PASTURE_AREA_FIELD) > 0 && \
+			sqlite3_column_type(stmt, dt->Columns[PASTURE_AREA_FIELD]) != SQLITE_NULL)
+		{
+			area = sqlite3_column_double(stmt, dt->Columns[PASTURE_AREA_FIELD]);
+		}
+
+		std::pair<RVS::DataManagement::Symbol, RVS::DataManagement::Symbol> key(
+			RVS::DataManagement::SymbolTable::intern(allotment), RVS::DataManagement::SymbolTable::intern(pasture));
+		if (index.count(key) == 0)
+		{
+			Pasture p = Pasture();
+			p.allotment = key.first;
+			p.name = key.second;
+			index[key] = pastures->size();
+			pastures->push_back(p);
+		}
+
+		Pasture& p = pastures->at(index[key]);
+		p.plotIds.push_back(plotId);
+		p.plotAreas.push_back(area);
+
+		*dt->STATUS() = sqlite3_step(stmt);
+	}
+
+	return true;
+}
+
+bool RVS::Disturbance::DisturbanceDIO::query_herds(std::vector<RVS::Disturbance::Herd>* herds)
+{
+	if (!table_exists(GRAZING_HERD_TABLE)) { return false; }
+
+	std::stringstream ss;
+	ss << "SELECT * FROM " << GRAZING_HERD_TABLE << ";";
+	RVS::DataManagement::DataTable* dt = prep_datatable(scratchCharPtr(&ss), rvsdb, true, true);
+	sqlite3_stmt* stmt = dt->getStmt();
+
+	while (*dt->STATUS() == SQLITE_ROW)
+	{
+		string allotment;
+		string animal;
+		Herd h = Herd();
+
+		getVal(stmt, dt->Columns[DIST_SUBTYPE_FIELD], &animal);
+		if (dt->Columns.count(ALLOTMENT_FIELD) > 0) { getVal(stmt, dt->Columns[ALLOTMENT_FIELD], &allotment); }
+		getVal(stmt, dt->Columns[HERD_NUMBER_FIELD], &h.number);
+		getVal(stmt, dt->Columns[HERD_LENGTH_FIELD], &h.length);
+		h.allotment = RVS::DataManagement::SymbolTable::intern(allotment);
+		h.animal = RVS::DataManagement::SymbolTable::intern(animal);
+
+		// Left out, the herd takes what its animal class will utilize of the herbs
+		h.utilLimit = -1;
+		if (dt->Columns.count(HERD_UTIL_LIMIT_FIELD) > 0 && \
+			sqlite3_column_type(stmt, dt->Columns[HERD_UTIL_LIMIT_FIELD]) != SQLITE_NULL)
+		{
+			h.utilLimit = sqlite3_column_double(stmt, dt->Columns[HERD_UTIL_LIMIT_FIELD]);
+		}
+
+		// Without years the herd grazes every year
+		h.startYear = 0;
+		h.stopYear = INT_MAX;
+		if (dt->Columns.count(DIST_BEGIN_FIELD) > 0 && \
+			sqlite3_column_type(stmt, dt->Columns[DIST_BEGIN_FIELD]) != SQLITE_NULL)
+		{
+			h.startYear = sqlite3_column_int(stmt, dt->Columns[DIST_BEGIN_FIELD]);
+		}
+		if (dt->Columns.count(DIST_END_FIELD) > 0 && \
+			sqlite3_column_type(stmt, dt->Columns[DIST_END_FIELD]) != SQLITE_NULL)
+		{
+			h.stopYear = sqlite3_column_int(stmt, dt->Columns[DIST_END_FIELD]);
+		}
+
+		herds->push_back(h);
+		*dt->STATUS() = sqlite3_step(stmt);
+	}
+
+	return true;
+}
+
+void RVS::Disturbance::DisturbanceDIO::query_fire_effects(RVS::Disturbance::FireEffects* effects)
+{
+	if (table_exists(FIRE_CONSUMPTION_TABLE))
+	{
+		const char* fields[NUM_CONSUMED_POOLS] = { FIRE_CONSUMED_HERB_FIELD, FIRE_CONSUMED_1HR_FIELD, \
+			FIRE_CONSUMED_10HR_FIELD, FIRE_CONSUMED_100HR_FIELD, FIRE_CONSUMED_1000HR_FIELD };
+
+		std::stringstream ss;
+		ss << "SELECT * FROM " << FIRE_CONSUMPTION_TABLE << ";";
+		RVS::DataManagement::DataTable* dt = prep_datatable(scratchCharPtr(&ss), rvsdb, true, true);
+		sqlite3_stmt* stmt = dt->getStmt();
+
+		while (*dt->STATUS() == SQLITE_ROW)
+		{
+			double severity = 0;
+			getVal(stmt, dt->Columns[FIRE_SEVERITY_FIELD], &severity);
+			double* consumption = effects->consumption[FireEngine::severityOf(severity)];
+
+			for (int c = 0; c < NUM_CONSUMED_POOLS; c++)
+			{
+				if (dt->Columns.count(fields[c]) == 0) { continue; }
+				int column = dt->Columns[fields[c]];
+				if (sqlite3_column_type(stmt, column) == SQLITE_NULL) { continue; }
+				consumption[c] = sqlite3_column_double(stmt, column);
+			}
+
+			*dt->STATUS() = sqlite3_step(stmt);
+		}
+	}
+
+	if (table_exists(FIRE_MORTALITY_TABLE))
+	{
+		std::stringstream ss;
+		ss << "SELECT * FROM " << FIRE_MORTALITY_TABLE << ";";
+		RVS::DataManagement::DataTable* dt = prep_datatable(scratchCharPtr(&ss), rvsdb, true, true);
+		sqlite3_stmt* stmt = dt->getStmt();
+
+		while (*dt->STATUS() == SQLITE_ROW)
+		{
+			string spp;
+			double severity = 0;
+			getVal(stmt, dt->Columns[SPP_CODE_FIELD], &spp);
+			getVal(stmt, dt->Columns[FIRE_SEVERITY_FIELD], &severity);
+
+			// A species' first row starts from the default of the severities it leaves out
+			RVS::DataManagement::Symbol species = RVS::DataManagement::SymbolTable::intern(spp);
+			if (effects->species.count(species) == 0) { effects->species[species] = effects->defaultMortality; }
+			FireMortality& m = effects->species[species];
+
+			int s = FireEngine::severityOf(severity);
+			getVal(stmt, dt->Columns[FIRE_MORTALITY_FIELD], &m.mortality[s]);
+			if (dt->Columns.count(FIRE_RESPROUT_FIELD) > 0) { getVal(stmt, dt->Columns[FIRE_RESPROUT_FIELD], &m.resprout[s]); }
+
+			*dt->STATUS() = sqlite3_step(stmt);
+		}
+	}
+}
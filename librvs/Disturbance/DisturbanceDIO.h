@@ -15,6 +15,9 @@
 #include "../DataManagement/SppRecord.h"
 #include "../RVSDBNAMES.h"
 #include "../RVSDEF.h"
+#include "FireEngine.h"
+#include "GrazingEngine.h"
+#include "RotationScheduler.h"
 
 
 namespace RVS
@@ -33,11 +36,23 @@ namespace Disturbance
 		int* create_intermediate_table();
 		int* write_output_record(int* year, RVS::DataManagement::AnalysisPlot* ap);
 		int* write_intermediate_record(int* year, RVS::DataManagement::AnalysisPlot* ap, RVS::DataManagement::SppRecord* spp);
+		int* create_rotation_table(void);
+		int* write_rotation_record(int* year, const RVS::Disturbance::PastureAssignment& assignment);
 
 		//## Query functions ##//
 
 		//virtual DataTable* query_equation_table(int equation_number);
 		map<int, vector<DisturbAction>> query_disturbance_input();
+		// Animal classes of the GRAZE rows in the Disturbance table. Columns left out
+		// or NULL keep the built in values of the class, or the generic class's for new
+		// classes. New classes without any values are written to the debug file.
+		void query_grazer_classes(std::vector<RVS::Disturbance::GrazerClass>* classes);
+		// Fire effects from Fire_Consumption and Fire_Mortality. Rows left out keep their
+		// value in effects.
+		void query_fire_effects(RVS::Disturbance::FireEffects* effects);
+		// Pastures and herds of the rotation. False if the table is not in the database.
+		bool query_pastures(std::vector<RVS::Disturbance::Pasture>* pastures);
+		bool query_herds(std::vector<RVS::Disturbance::Herd>* herds);
 		
 	private:
 		void query_parameters_table();
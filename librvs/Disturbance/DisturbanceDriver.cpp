@@ -4,6 +4,14 @@ RVS::Disturbance::DisturbanceDriver::DisturbanceDriver(RVS::Disturbance::Disturb
 {
 	this->ddio = ddio;
 	this->suppress_messages = suppress_messages;
+
+	std::vector<GrazerClass> classes;
+	ddio->query_grazer_classes(&classes);
+	grazing = std::make_shared<GrazingEngine>(classes);
+
+	FireEffects effects = FireEngine::builtinEffects();
+	ddio->query_fire_effects(&effects);
+	fire = std::make_shared<FireEngine>(effects, *STOCHASTIC_FIRE, *ENSEMBLE_SEED);
 }
 
 RVS::Disturbance::DisturbanceDriver::~DisturbanceDriver()
@@ -11,102 +19,100 @@ RVS::Disturbance::DisturbanceDriver::~DisturbanceDriver()
 
 }
 
-int* RVS::Disturbance::DisturbanceDriver::DisturbanceMain(int year, RVS::DataManagement::AnalysisPlot* ap)
+void RVS::Disturbance::DisturbanceDriver::reportUnknownGrazers(const std::set<RVS::DataManagement::Symbol>& subTypes)
 {
-	this->ap = ap;
-
-	if (ap->PLOT_ID() == 36)
+	for (auto &s : subTypes)
 	{
-		int asdas = 0;
+		if (grazing->classIndex(s) != GrazingEngine::UNKNOWN_CLASS) { continue; }
+
+		stringstream msg;
+		msg << "Warning: no grazer class for " << RVS::DataManagement::SymbolTable::name(s) << ", it grazes herbs and shrubs 50 to 50";
+		ddio->write_debug_msg(msg.str().c_str());
 	}
+}
 
-	vector<DisturbAction> disturbances = ap->getDisturbancesForYear(year);
+int* RVS::Disturbance::DisturbanceDriver::DisturbanceMain(int year, RVS::DataManagement::AnalysisPlot* ap)
+{
+	RVS_TIME(RVS::DataManagement::STAGE_DISTURBANCE);
+	this->ap = ap;
 
-	if (disturbances.size() == 0)
-	{
-		ap->disturbed = false;
-		ap->burned = false;
-		ap->biomassReductionTotal = 0;
-	}
-	else
+	ap->disturbed = false;
+	ap->burned = false;
+	ap->biomassReductionTotal = 0;
+
+	// Actions are read in place, a plot's list is only built once
+	for (auto &d : ap->disturbances)
 	{
-		const string fire = "FIRE";
-		const string graze = "GRAZE";
-			
-		ap->disturbed = true;
+		if (d.getActionYear() != year) { continue; }
 
-		for (auto &d : disturbances)
+		ap->disturbed = true;
+		switch (d.KIND())
 		{
-			const string action = d.getActionType();
-
-			if (action.compare(fire) == 0)
-			{
-				burnPlot(d.getActionSubType(), 0.0);
-				ap->burned = true;
-			}
-			else if (action.compare(graze) == 0)
-			{
-				const string grazeStr = d.getActionSubType();
-				map<string, double> params = d.getParameters();
-				GRAZE_TYPE grazeType;
-
-				if (grazeStr.compare("SHEEP") == 0)
-				{
-					grazeType = sheep;
-				}
-				else if (grazeStr.compare("GOAT") == 0)
-				{
-					grazeType = goat;
-				}
-				else
-				{
-					grazeType = cow;
-				}
-
-				// $TODO get the parameter names from the database
-				grazePlot(grazeType, params["NUMBER"], params["AREA"], params["LENGTH"]);
-			}
+		case DisturbAction::KIND_FIRE:
+			burnPlot(year, FireEngine::severityOf(d.INTENSITY()));
+			ap->burned = true;
+			break;
+		case DisturbAction::KIND_GRAZE:
+		{
+			int grazerClass = grazing->classOf(d.SUBTYPE_ID());
+			const GrazerClass& c = grazing->CLASS(grazerClass);
+			grazePlot(grazerClass, d.VALUE(c.numberParam), d.VALUE(c.areaParam), d.VALUE(c.lengthParam));
+			break;
+		}
+		default:
+			break;
 		}
 	}
 	return RC;
 }
 
-void RVS::Disturbance::DisturbanceDriver::burnPlot(const string fireType, float intensity)
+int* RVS::Disturbance::DisturbanceDriver::GrazeMain(void)
 {
-	ap->herbHeight = 1;
-	ap->herbCover = 1;
-	ap->primaryProduction = 0;
-	ap->herbHoldoverBiomass = 0;
-	ap->previousHerbProductions[0] = 0;
-	ap->previousHerbProductions[1] = 0;
-	ap->previousHerbProductions[2] = 0;
-
+	RVS_TIME(RVS::DataManagement::STAGE_DISTURBANCE);
+	grazing->removeForage(grazeRequests);
+	grazeRequests.clear();
+	return RC;
+}
 
-	for (auto &s : *(ap->SHRUB_RECORDS()))
-	{
-		s->height = 0.01;
-		s->cover = 0.01;
-	}
+int* RVS::Disturbance::DisturbanceDriver::FireMain(void)
+{
+	RVS_TIME(RVS::DataManagement::STAGE_DISTURBANCE);
+	fire->burn(fireRequests);
+	fireRequests.clear();
+	return RC;
 }
 
-void RVS::Disturbance::DisturbanceDriver::grazePlot(GRAZE_TYPE grazeType, double numberGrazers, double plotArea, double grazeTime)
+void RVS::Disturbance::DisturbanceDriver::reserveRequests(size_t numPlots)
 {
-	// The removeAmount is calculated in lbs/ac and saved as g/ac
-	double removeAmount;
+	grazeRequests.reserve(numPlots);
+	fireRequests.reserve(numPlots);
+}
 
-	switch (grazeType)
+void RVS::Disturbance::DisturbanceDriver::burnPlot(int year, int severity)
+{
+	// A plot burns once a year, at the highest severity of its fires
+	if (!fireRequests.empty() && fireRequests.back().ap == ap)
 	{
-	case cow:
-		removeAmount = (cow_multiplier * numberGrazers * grazeTime) / plotArea;
-		break;
-	case sheep:
-	case goat:
-		removeAmount = (small_multiplier * numberGrazers * grazeTime) / plotArea;
-		break;
-	default:
-		break;
+		fireRequests.back().severity = std::max(fireRequests.back().severity, severity);
+		return;
 	}
 
-	ap->biomassReductionTotal = removeAmount * ap->POUNDS_TO_GRAMS;
+	FireRequest request = FireRequest();
+	request.ap = ap;
+	request.year = year;
+	request.severity = severity;
+	fireRequests.push_back(request);
 }
 
+void RVS::Disturbance::DisturbanceDriver::grazePlot(int grazerClass, double numberGrazers, double plotArea, double grazeTime)
+{
+	// The removeAmount is calculated in lbs/ac and saved as g/ac
+	double removeAmount = grazing->demand(grazerClass, numberGrazers, plotArea, grazeTime);
+	ap->biomassReductionTotal += removeAmount;
+
+	GrazingRequest request = GrazingRequest();
+	request.ap = ap;
+	request.grazerClass = grazerClass;
+	request.demand = removeAmount;
+	grazeRequests.push_back(request);
+}
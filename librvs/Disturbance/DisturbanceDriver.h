@@ -7,9 +7,13 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
+#include <set>
 
 #include "../DataManagement/AnalysisPlot.h"
 #include "DisturbanceDIO.h"
+#include "FireEngine.h"
+#include "GrazingEngine.h"
 
 using namespace std;
 
@@ -25,25 +29,46 @@ namespace Disturbance
 
 		// Main Disturbance calculation function. Expects an AnalysisPlot object (with biomass information)
 		int* DisturbanceMain(int year, RVS::DataManagement::AnalysisPlot* ap);
+		// Removes the forage of every plot grazed since the last call. Runs after the fuel
+		// loads of those plots are calculated and before their fuels are written.
+		int* GrazeMain(void);
+		// Burns every plot with a fire since the last call. Runs after grazing.
+		int* FireMain(void);
+		// Makes room for the grazing and fire requests of numPlots plots, so a year of them
+		// queues without allocating
+		void reserveRequests(size_t numPlots);
 
-		enum GRAZE_TYPE {cow, sheep, goat};
+		// Writes a debug message for each animal in subTypes without a class of its own. Those
+		// graze like the generic class.
+		void reportUnknownGrazers(const std::set<RVS::DataManagement::Symbol>& subTypes);
+
+		inline const RVS::Disturbance::GrazingEngine* GRAZING() { return grazing.get(); }
+		inline size_t NUM_GRAZE_REQUESTS() { return grazeRequests.size(); }
+		inline const RVS::Disturbance::FireEngine* FIRE() { return fire.get(); }
+		inline size_t NUM_FIRE_REQUESTS() { return fireRequests.size(); }
 
 	private:
 		DataManagement::AnalysisPlot* ap;
 
-		void burnPlot(const string fireType, float intensity);
+		// Burn. Takes the severity class of the fire (FireSeverity)
+		void burnPlot(int year, int severity);
 
 		// Graze. Takes number of grazers, area of plot in acres, and graze time in days
-		void grazePlot(GRAZE_TYPE grazeType, double numberGrazers, double plotArea, double grazeTime);
+		void grazePlot(int grazerClass, double numberGrazers, double plotArea, double grazeTime);
 		
 		// Disturbance Input/Output module
 		RVS::Disturbance::DisturbanceDIO* ddio;
 		// Toggle debugging messages
 		bool suppress_messages;
 
-		double cow_multiplier = 26;
-		double small_multiplier = 5.2;
-
+		// Animal classes. Read only once built, so copies of the driver share it.
+		std::shared_ptr<RVS::Disturbance::GrazingEngine> grazing;
+		// Plots waiting for GrazeMain
+		std::vector<RVS::Disturbance::GrazingRequest> grazeRequests;
+		// Fire effects, shared like the animal classes
+		std::shared_ptr<RVS::Disturbance::FireEngine> fire;
+		// Plots waiting for FireMain
+		std::vector<RVS::Disturbance::FireRequest> fireRequests;
 	};
 }
 }
@@ -0,0 +1,191 @@
+#include "FireEngine.h"
+
+#include <algorithm>
+
+#include "../DataManagement/Arena.h"
+
+using RVS::Disturbance::FireEffects;
+using RVS::Disturbance::FireEngine;
+using RVS::Disturbance::FireMortality;
+using RVS::Disturbance::FireRequest;
+
+// Fuel pools never drop below this (g/ac), they are divided by later
+static const double POOL_FLOOR = 0.1;
+// Cover and height of burned herbs and shrubs. Resprouts start over at the shrub height.
+static const double HERB_FLOOR = 1;
+static const double SHRUB_FLOOR = 0.01;
+
+// Consumed share of each pool by severity: herbs, 1 hr, 10 hr, 100 hr, 1000 hr
+static const double BUILTIN_CONSUMPTION[RVS::Disturbance::NUM_SEVERITIES][RVS::Disturbance::NUM_CONSUMED_POOLS] =
+{
+	{ 0.6, 0.5, 0.25, 0.1, 0.05 },
+	{ 0.85, 0.8, 0.5, 0.3, 0.15 },
+	{ 1.0, 1.0, 0.9, 0.6, 0.4 }
+};
+static const double BUILTIN_MORTALITY[RVS::Disturbance::NUM_SEVERITIES] = { 0.3, 0.7, 1.0 };
+
+// splitmix64 step
+static uint64_t mix(uint64_t z)
+{
+	z += 0x9E3779B97F4A7C15ULL;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+FireEngine::FireEngine(void)
+{
+	effects = builtinEffects();
+	stochastic = false;
+	seed = 0;
+}
+
+FireEngine::FireEngine(FireEffects effects, bool stochastic, uint32_t seed)
+{
+	this->effects = effects;
+	this->stochastic = stochastic;
+	this->seed = seed;
+}
+
+FireEngine::~FireEngine(void)
+{
+
+}
+
+FireEffects FireEngine::builtinEffects(void)
+{
+	FireEffects builtin = FireEffects();
+	for (int s = 0; s < NUM_SEVERITIES; s++)
+	{
+		for (int c = 0; c < NUM_CONSUMED_POOLS; c++)
+		{
+			builtin.consumption[s][c] = BUILTIN_CONSUMPTION[s][c];
+		}
+		builtin.defaultMortality.mortality[s] = BUILTIN_MORTALITY[s];
+		builtin.defaultMortality.resprout[s] = 0;
+	}
+	return builtin;
+}
+
+int FireEngine::severityOf(double intensity)
+{
+	if (intensity <= 0) { return SEVERITY_HIGH; }
+	int severity = (int)(intensity + 0.5) - 1;
+	return std::min(std::max(severity, (int)SEVERITY_LOW), (int)SEVERITY_HIGH);
+}
+
+const FireMortality& FireEngine::mortalityOf(RVS::DataManagement::Symbol species) const
+{
+	std::map<RVS::DataManagement::Symbol, FireMortality>::const_iterator it = effects.species.find(species);
+	return it == effects.species.end() ? effects.defaultMortality : it->second;
+}
+
+double FireEngine::draw(int plotId, int year, size_t record) const
+{
+	uint64_t z = mix(seed);
+	z = mix(z ^ (uint32_t)plotId);
+	z = mix(z ^ (uint32_t)year);
+	z = mix(z ^ record);
+	return (z >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void FireEngine::burn(const std::vector<FireRequest>& requests) const
+{
+	size_t count = requests.size();
+	if (count == 0) { return; }
+
+	RVS::DataManagement::Arena* scratch = RVS::DataManagement::Arena::scratch();
+
+	// What is left of each pool, one lane per plot
+	double* left[NUM_CONSUMED_POOLS];
+	for (int c = 0; c < NUM_CONSUMED_POOLS; c++)
+	{
+		left[c] = scratch->allocateArray<double>(count);
+	}
+
+	size_t numRecords = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const double* consumption = effects.consumption[requests[i].severity];
+		for (int c = 0; c < NUM_CONSUMED_POOLS; c++)
+		{
+			left[c][i] = 1 - consumption[c];
+		}
+		numRecords += requests[i].ap->shrubRecords.size();
+	}
+
+	for (size_t i = 0; i < count; i++)
+	{
+		RVS::DataManagement::AnalysisPlot* ap = requests[i].ap;
+		double herbLeft = left[CONSUME_HERB][i];
+
+		ap->herbFuel = std::max(ap->herbFuel * herbLeft, POOL_FLOOR);
+		ap->shrub1HourFoliage = std::max(ap->shrub1HourFoliage * left[CONSUME_1HR][i], POOL_FLOOR);
+		ap->shrub1HourWB = std::max(ap->shrub1HourWB * left[CONSUME_1HR][i], POOL_FLOOR);
+		ap->shrub10Hour = std::max(ap->shrub10Hour * left[CONSUME_10HR][i], POOL_FLOOR);
+		ap->shrub100Hour = std::max(ap->shrub100Hour * left[CONSUME_100HR][i], POOL_FLOOR);
+		ap->shrub1000Hour = std::max(ap->shrub1000Hour * left[CONSUME_1000HR][i], POOL_FLOOR);
+		ap->total1HrFuel = ap->herbFuel + ap->shrub1HourWB + ap->shrub1HourFoliage;
+
+		// Burned herbs carry less into the following years
+		ap->herbCover = std::max(ap->herbCover * herbLeft, std::min(ap->herbCover, HERB_FLOOR));
+		ap->herbHeight = std::max(ap->herbHeight * herbLeft, std::min(ap->herbHeight, HERB_FLOOR));
+		ap->primaryProduction *= herbLeft;
+		ap->herbHoldoverBiomass *= herbLeft;
+		ap->previousHerbProductions[0] *= herbLeft;
+		ap->previousHerbProductions[1] *= herbLeft;
+		ap->previousHerbProductions[2] *= herbLeft;
+		ap->herbBiomass = ap->herbFuel * ap->GRAMS_TO_POUNDS;
+	}
+
+	if (numRecords == 0) { return; }
+
+	// Shrub records of all plots, one lane per record
+	double* cover = scratch->allocateArray<double>(numRecords);
+	double* height = scratch->allocateArray<double>(numRecords);
+	double* mortality = scratch->allocateArray<double>(numRecords);
+	double* resprout = scratch->allocateArray<double>(numRecords);
+
+	size_t r = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		const FireRequest& request = requests[i];
+		for (size_t k = 0; k < request.ap->shrubRecords.size(); k++)
+		{
+			RVS::DataManagement::SppRecord* s = request.ap->shrubRecords[k];
+			const FireMortality& m = mortalityOf(s->spp_code);
+			cover[r] = s->cover;
+			height[r] = s->height;
+			mortality[r] = m.mortality[request.severity];
+			resprout[r] = m.resprout[request.severity];
+			if (stochastic)
+			{
+				mortality[r] = draw(request.ap->PLOT_ID(), request.year, k) < mortality[r] ? 1 : 0;
+			}
+			r++;
+		}
+	}
+
+	// Survivors keep their height, resprouts start over
+	for (r = 0; r < numRecords; r++)
+	{
+		double survivors = cover[r] * (1 - mortality[r]);
+		double sprouts = cover[r] * mortality[r] * resprout[r];
+		double newCover = survivors + sprouts;
+		height[r] = newCover > 0 ? (survivors * height[r] + sprouts * SHRUB_FLOOR) / newCover : SHRUB_FLOOR;
+		cover[r] = newCover;
+	}
+
+	r = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		RVS::DataManagement::AnalysisPlot* ap = requests[i].ap;
+		for (auto &s : ap->shrubRecords)
+		{
+			s->cover = std::max(cover[r], SHRUB_FLOOR);
+			s->height = std::max(height[r], SHRUB_FLOOR);
+			r++;
+		}
+		ap->update_shrubvalues();
+	}
+}
@@ -0,0 +1,103 @@
+/// ********************************************************** ///
+/// Name: FireEngine.h                                         ///
+/// Desc: Fire effects by severity class. A fire consumes a    ///
+/// share of each of the year's fuel pools, kills a share of   ///
+/// each shrub species' cover and lets part of the killed      ///
+/// cover resprout. All plots burned in a year are evaluated   ///
+/// in one pass, with the species parameters loaded once.      ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef FIREENGINE_H
+#define FIREENGINE_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "../DataManagement/AnalysisPlot.h"
+#include "../DataManagement/SymbolTable.h"
+
+namespace RVS
+{
+namespace Disturbance
+{
+	// INTENSITY 1-3 of a FIRE action
+	enum FireSeverity
+	{
+		SEVERITY_LOW = 0,
+		SEVERITY_MODERATE,
+		SEVERITY_HIGH,
+		NUM_SEVERITIES
+	};
+
+	// Fuel pools a fire consumes a share of
+	enum ConsumedPool
+	{
+		CONSUME_HERB = 0,
+		CONSUME_1HR,      // Shrub foliage and 1 hr wood and bark
+		CONSUME_10HR,
+		CONSUME_100HR,
+		CONSUME_1000HR,
+		NUM_CONSUMED_POOLS
+	};
+
+	// Share of a species' cover killed, and share of the killed cover that resprouts (0-1)
+	struct FireMortality
+	{
+		double mortality[NUM_SEVERITIES];
+		double resprout[NUM_SEVERITIES];
+	};
+
+	struct FireEffects
+	{
+		double consumption[NUM_SEVERITIES][NUM_CONSUMED_POOLS];
+		FireMortality defaultMortality;  // Species without their own row
+		std::map<RVS::DataManagement::Symbol, FireMortality> species;
+	};
+
+	// One plot burned in a year
+	struct FireRequest
+	{
+		RVS::DataManagement::AnalysisPlot* ap;
+		int year;
+		int severity;
+	};
+
+	class FireEngine
+	{
+	public:
+		FireEngine(void);
+		// In stochastic runs every shrub record either dies or survives whole, with its
+		// species' mortality as the chance. Draws depend only on seed, plot, year and record,
+		// so an ensemble member gives the same result on any number of threads.
+		FireEngine(FireEffects effects, bool stochastic, uint32_t seed);
+		virtual ~FireEngine(void);
+
+		// Non-sprouting shrubs. High severity kills all shrubs and consumes all fine fuels,
+		// as fires did before severity classes.
+		static FireEffects builtinEffects(void);
+		// Severity class of a FIRE action's INTENSITY. Fires without one are high severity.
+		static int severityOf(double intensity);
+
+		inline bool STOCHASTIC() const { return stochastic; }
+
+		// Consumes fuels and kills shrubs on every requested plot. Runs after the fuel loads of
+		// those plots are calculated and before their fuels are written.
+		void burn(const std::vector<FireRequest>& requests) const;
+
+	private:
+		FireEffects effects;
+		bool stochastic;
+		uint32_t seed;
+
+		const FireMortality& mortalityOf(RVS::DataManagement::Symbol species) const;
+		// Uniform draw in [0, 1)
+		double draw(int plotId, int year, size_t record) const;
+	};
+}
+}
+
+#endif
@@ -0,0 +1,165 @@
+#include "GrazingEngine.h"
+
+#include <algorithm>
+
+#include "../DataManagement/Arena.h"
+
+using RVS::Disturbance::GrazerClass;
+using RVS::Disturbance::GrazingEngine;
+using RVS::Disturbance::GrazingRequest;
+
+// Pools never drop below this (g/ac), they are divided by later
+static const double POOL_FLOOR = 0.1;
+
+static GrazerClass makeClass(const char* name, double intake, double herbPreference, double shrubPreference)
+{
+	GrazerClass c = GrazerClass();
+	c.name = RVS::DataManagement::SymbolTable::intern(name);
+	c.intake = intake;
+	c.herbPreference = herbPreference;
+	c.shrubPreference = shrubPreference;
+	c.herbUtilization = 1;
+	c.shrubUtilization = 1;
+	c.numberParam = 0;
+	c.areaParam = 1;
+	c.lengthParam = 2;
+	return c;
+}
+
+GrazingEngine::GrazingEngine(void)
+{
+	classes = builtinClasses();
+	genericIndex = (int)classes.size();
+	classes.push_back(genericClass());
+}
+
+GrazingEngine::GrazingEngine(std::vector<GrazerClass> classes)
+{
+	this->classes = classes;
+	if (this->classes.empty()) { this->classes = builtinClasses(); }
+	genericIndex = (int)this->classes.size();
+	this->classes.push_back(genericClass());
+}
+
+GrazingEngine::~GrazingEngine(void)
+{
+
+}
+
+std::vector<GrazerClass> GrazingEngine::builtinClasses(void)
+{
+	std::vector<GrazerClass> builtin;
+	builtin.push_back(makeClass("COW", 26, 99, 1));
+	builtin.push_back(makeClass("SHEEP", 5.2, 50, 50));
+	builtin.push_back(makeClass("GOAT", 5.2, 50, 50));
+	return builtin;
+}
+
+GrazerClass GrazingEngine::genericClass(void)
+{
+	return makeClass("", 26, 50, 50);
+}
+
+int GrazingEngine::classIndex(RVS::DataManagement::Symbol subType) const
+{
+	for (int i = 0; i < genericIndex; i++)
+	{
+		if (classes[i].name == subType) { return i; }
+	}
+	return UNKNOWN_CLASS;
+}
+
+double GrazingEngine::demand(int grazerClass, double numberGrazers, double plotArea, double grazeTime) const
+{
+	if (plotArea <= 0) { return 0; }
+	// lbs/ac, kept as g/ac like the fuel pools
+	double removeAmount = classes[grazerClass].intake * numberGrazers * grazeTime / plotArea;
+	return removeAmount * RVS::DataManagement::AnalysisPlot::POUNDS_TO_GRAMS;
+}
+
+void GrazingEngine::removeForage(const std::vector<GrazingRequest>& requests) const
+{
+	size_t count = requests.size();
+	if (count == 0) { return; }
+
+	RVS::DataManagement::Arena* scratch = RVS::DataManagement::Arena::scratch();
+	double* herbShare = scratch->allocateArray<double>(count);
+	double* shrubShare = scratch->allocateArray<double>(count);
+	double* herbAvailable = scratch->allocateArray<double>(count);
+	double* shrubAvailable = scratch->allocateArray<double>(count);
+	double* demands = scratch->allocateArray<double>(count);
+	double* herbRemoved = scratch->allocateArray<double>(count);
+	double* shrubRemoved = scratch->allocateArray<double>(count);
+
+	// Gather each request's class and the plot's pools at the start of the year
+	for (size_t i = 0; i < count; i++)
+	{
+		const GrazingRequest& r = requests[i];
+		const GrazerClass& c = classes[r.grazerClass];
+		RVS::DataManagement::AnalysisPlot* ap = r.ap;
+
+		double totalCover = std::max(ap->herbCover + ap->shrubCover, 1e-9);
+		herbShare[i] = c.herbPreference * ap->herbCover / totalCover;
+		shrubShare[i] = c.shrubPreference * ap->shrubCover / totalCover;
+		herbAvailable[i] = c.herbUtilization * ap->herbFuel;
+		shrubAvailable[i] = c.shrubUtilization * (ap->shrub1HourFoliage + ap->shrub1HourWB + ap->shrub10Hour);
+		demands[i] = r.demand;
+	}
+
+	// Split every request between herbs and shrubs. Preferences are weighted by each pool's
+	// share of the cover, and what herbs can't give comes from shrubs.
+	for (size_t i = 0; i < count; i++)
+	{
+		double herbsPerShrub = std::max(herbShare[i] / std::max(shrubShare[i], 1e-9), 1.0);
+		double herbTaken = std::min((1 - 1 / herbsPerShrub) * demands[i], herbAvailable[i]);
+		herbRemoved[i] = herbTaken;
+		shrubRemoved[i] = std::min(demands[i] - herbTaken, shrubAvailable[i]);
+	}
+
+	// Apply the removals, summed over the classes grazing a plot
+	size_t first = 0;
+	while (first < count)
+	{
+		RVS::DataManagement::AnalysisPlot* ap = requests[first].ap;
+		double herb = 0;
+		double shrub = 0;
+		size_t next = first;
+		for (; next < count && requests[next].ap == ap; next++)
+		{
+			herb += herbRemoved[next];
+			shrub += shrubRemoved[next];
+		}
+		first = next;
+
+		double oldHerb = ap->herbFuel;
+		double oldShrub = ap->shrub1HourFoliage + ap->shrub1HourWB + ap->shrub10Hour + ap->shrub100Hour + ap->shrub1000Hour;
+
+		ap->herbFuel = std::max(ap->herbFuel - herb, POOL_FLOOR);
+
+		// Foliage goes first, then 1 hr wood and bark, then 10 hr
+		double fromFoliage = std::min(shrub, ap->shrub1HourFoliage);
+		double fromWoodBark = std::min(shrub - fromFoliage, ap->shrub1HourWB);
+		double from10Hour = std::min(shrub - fromFoliage - fromWoodBark, ap->shrub10Hour);
+		ap->shrub1HourFoliage = std::max(ap->shrub1HourFoliage - fromFoliage, POOL_FLOOR);
+		ap->shrub1HourWB = std::max(ap->shrub1HourWB - fromWoodBark, POOL_FLOOR);
+		ap->shrub10Hour = std::max(ap->shrub10Hour - from10Hour, POOL_FLOOR);
+
+		if (ap->herbCover > 0 && oldHerb > 0)
+		{
+			double herbReductionRatio = ap->herbFuel / oldHerb;
+			ap->herbCover = std::max(ap->herbCover * herbReductionRatio, POOL_FLOOR);
+			ap->herbHeight = std::max(ap->herbHeight * herbReductionRatio, POOL_FLOOR);
+		}
+
+		double newShrub = ap->shrub1HourFoliage + ap->shrub1HourWB + ap->shrub10Hour + ap->shrub100Hour + ap->shrub1000Hour;
+		double shrubReductionRatio = oldShrub > 0 ? newShrub / oldShrub : 1;
+		for (auto &s : ap->shrubRecords)
+		{
+			s->cover = std::max(s->cover * shrubReductionRatio, POOL_FLOOR);
+		}
+
+		ap->herbBiomass = ap->herbFuel * ap->GRAMS_TO_POUNDS;
+		ap->shrubBiomass = ap->shrubBiomass * shrubReductionRatio;
+		ap->total1HrFuel = ap->herbFuel + ap->shrub1HourWB + ap->shrub1HourFoliage;
+	}
+}
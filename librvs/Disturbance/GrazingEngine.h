@@ -0,0 +1,89 @@
+/// ********************************************************** ///
+/// Name: GrazingEngine.h                                      ///
+/// Desc: Forage removal by grazing animals. Each animal class ///
+/// has a daily intake, herb and shrub preferences and the     ///
+/// largest share of each pool it will utilize. Requests of    ///
+/// all grazed plots are removed in one pass per year.         ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef GRAZINGENGINE_H
+#define GRAZINGENGINE_H
+
+#include <vector>
+
+#include "../DataManagement/AnalysisPlot.h"
+#include "../DataManagement/SymbolTable.h"
+
+namespace RVS
+{
+namespace Disturbance
+{
+	struct GrazerClass
+	{
+		RVS::DataManagement::Symbol name;  // DIST_SUBTYPE of the GRAZE actions
+		double intake;            // Forage per animal and day (lbs)
+		double herbPreference;    // Relative preference, weighted by the pool's share of cover
+		double shrubPreference;
+		double herbUtilization;   // Largest share of the pool removed in a year (0-1)
+		double shrubUtilization;
+		// Positions of the animal count, pasture area (ac) and days grazed in the action values
+		int numberParam;
+		int areaParam;
+		int lengthParam;
+	};
+
+	// One animal class grazing one plot for the year
+	struct GrazingRequest
+	{
+		RVS::DataManagement::AnalysisPlot* ap;
+		int grazerClass;
+		double demand;  // g/ac
+	};
+
+	class GrazingEngine
+	{
+	public:
+		GrazingEngine(void);
+		// Classes replace the built in ones. An empty list keeps the built in classes.
+		GrazingEngine(std::vector<GrazerClass> classes);
+		virtual ~GrazingEngine(void);
+
+		// Cows eat herbs 99 to 1, sheep and goats 50 to 50, as the fuels module used to
+		static std::vector<GrazerClass> builtinClasses(void);
+		// Herbs 50 to 50 with the intake of cows, as unknown animals used to graze: the
+		// disturbance module took every animal but sheep and goats for a cow, the fuels
+		// module split every animal but cows 50 to 50
+		static GrazerClass genericClass(void);
+
+		// Class of a DIST_SUBTYPE, UNKNOWN_CLASS if there is none
+		int classIndex(RVS::DataManagement::Symbol subType) const;
+		// Class of a DIST_SUBTYPE. Unknown subtypes graze like the generic class.
+		inline int classOf(RVS::DataManagement::Symbol subType) const
+		{
+			int i = classIndex(subType);
+			return i == UNKNOWN_CLASS ? genericIndex : i;
+		}
+		inline const GrazerClass& CLASS(int i) const { return classes[i]; }
+		inline size_t NUM_CLASSES() const { return classes.size(); }
+
+		// Forage demand (g/ac) of numberGrazers animals on plotArea acres for grazeTime days
+		double demand(int grazerClass, double numberGrazers, double plotArea, double grazeTime) const;
+
+		// Removes the requested forage from the herb and shrub fuel pools of every plot. Requests
+		// of one plot must be next to each other, they share the plot's pools.
+		void removeForage(const std::vector<GrazingRequest>& requests) const;
+
+		static const int UNKNOWN_CLASS = -1;
+
+	private:
+		std::vector<GrazerClass> classes;
+		// The generic class, appended after the given classes. It has no DIST_SUBTYPE of its own.
+		int genericIndex;
+	};
+}
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "RotationScheduler.h"
+
+#include <algorithm>
+
+using RVS::Disturbance::GrazingRequest;
+using RVS::Disturbance::Herd;
+using RVS::Disturbance::Pasture;
+using RVS::Disturbance::PastureAssignment;
+using RVS::Disturbance::RotationScheduler;
+
+RotationScheduler::RotationScheduler(std::vector<Pasture> pastures, std::vector<Herd> herds, const RVS::Disturbance::GrazingEngine* grazing)
+{
+	this->pastures = pastures;
+	this->herds = herds;
+	this->grazing = grazing;
+
+	for (size_t i = 0; i < this->pastures.size(); i++)
+	{
+		allotments[this->pastures[i].allotment].push_back(i);
+	}
+}
+
+RotationScheduler::~RotationScheduler(void)
+{
+
+}
+
+void RotationScheduler::bind(std::map<int, RVS::DataManagement::AnalysisPlot*>* aps)
+{
+	for (auto &p : pastures)
+	{
+		p.plots.clear();
+		p.areas.clear();
+		p.area = 0;
+		for (size_t i = 0; i < p.plotIds.size(); i++)
+		{
+			std::map<int, RVS::DataManagement::AnalysisPlot*>::iterator it = aps->find(p.plotIds[i]);
+			if (it == aps->end()) { continue; }
+
+			it->second->setInRotation(true);
+			p.plots.push_back(it->second);
+			p.areas.push_back(p.plotAreas[i]);
+			p.area += p.plotAreas[i];
+		}
+	}
+}
+
+void RotationScheduler::schedule(int year, std::vector<GrazingRequest>* requests, std::vector<PastureAssignment>* assignments)
+{
+	size_t firstRequest = requests->size();
+
+	// Herb forage of each pasture (lbs) and what earlier herds of the year already took
+	std::vector<double> forage = std::vector<double>(pastures.size(), 0);
+	std::vector<double> taken = std::vector<double>(pastures.size(), 0);
+	for (size_t i = 0; i < pastures.size(); i++)
+	{
+		for (size_t j = 0; j < pastures[i].plots.size(); j++)
+		{
+			forage[i] += pastures[i].plots[j]->HERB_FUEL() * pastures[i].areas[j];
+		}
+	}
+
+	for (auto &h : herds)
+	{
+		if (year < h.startYear || year > h.stopYear) { continue; }
+
+		std::map<RVS::DataManagement::Symbol, std::vector<size_t>>::iterator allotment = allotments.find(h.allotment);
+		if (allotment == allotments.end()) { continue; }
+
+		int grazerClass = grazing->classOf(h.animal);
+		double dailyIntake = grazing->CLASS(grazerClass).intake * h.number;
+		double utilLimit = h.utilLimit < 0 ? grazing->CLASS(grazerClass).herbUtilization : h.utilLimit;
+		if (dailyIntake <= 0 || h.length <= 0) { continue; }
+
+		// Most forage left first. Ties keep the input order.
+		std::vector<size_t> order = allotment->second;
+		std::stable_sort(order.begin(), order.end(), [&forage, &taken](size_t a, size_t b)
+		{
+			return forage[a] - taken[a] > forage[b] - taken[b];
+		});
+
+		double remaining = h.length;
+		for (auto &i : order)
+		{
+			if (remaining <= 0) { break; }
+
+			Pasture& p = pastures[i];
+			double available = utilLimit * forage[i] - taken[i];
+			if (available <= 0 || p.area <= 0) { continue; }
+
+			double days = std::min(remaining, available / dailyIntake);
+			remaining -= days;
+			taken[i] += days * dailyIntake;
+
+			// The herd spreads over the whole pasture, every plot gives the same amount per acre
+			double demand = grazing->demand(grazerClass, h.number, p.area, days);
+			for (auto &ap : p.plots)
+			{
+				ap->biomassReductionTotal += demand;
+
+				GrazingRequest request = GrazingRequest();
+				request.ap = ap;
+				request.grazerClass = grazerClass;
+				request.demand = demand;
+				requests->push_back(request);
+			}
+
+			PastureAssignment a = PastureAssignment();
+			a.allotment = h.allotment;
+			a.pasture = p.name;
+			a.animal = h.animal;
+			a.number = h.number;
+			a.days = days;
+			a.forage = forage[i];
+			a.utilization = forage[i] > 0 ? days * dailyIntake / forage[i] : 0;
+			assignments->push_back(a);
+		}
+	}
+
+	// removeForage needs the requests of a plot next to each other
+	std::stable_sort(requests->begin() + firstRequest, requests->end(), [](const GrazingRequest& a, const GrazingRequest& b)
+	{
+		return a.ap->PLOT_ID() < b.ap->PLOT_ID();
+	});
+}
@@ -0,0 +1,89 @@
+/// ********************************************************** ///
+/// Name: RotationScheduler.h                                  ///
+/// Desc: Pasture rotation of grazing herds. Plots are grouped ///
+/// into pastures and pastures into allotments. Every year a   ///
+/// herd moves through the pastures of its allotment, most     ///
+/// forage first, staying in each until the herd's utilization ///
+/// limit of the pasture's herbs is reached.                   ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef ROTATIONSCHEDULER_H
+#define ROTATIONSCHEDULER_H
+
+#include <map>
+#include <vector>
+
+#include "../DataManagement/AnalysisPlot.h"
+#include "../DataManagement/SymbolTable.h"
+#include "GrazingEngine.h"
+
+namespace RVS
+{
+namespace Disturbance
+{
+	struct Pasture
+	{
+		RVS::DataManagement::Symbol name;
+		RVS::DataManagement::Symbol allotment;
+		std::vector<int> plotIds;
+		std::vector<double> plotAreas;  // ac
+		// Filled by bind. Plots missing from the run are left out.
+		std::vector<RVS::DataManagement::AnalysisPlot*> plots;
+		std::vector<double> areas;
+		double area;
+	};
+
+	struct Herd
+	{
+		RVS::DataManagement::Symbol allotment;
+		RVS::DataManagement::Symbol animal;  // DIST_SUBTYPE of the animal class
+		double number;
+		double length;       // Days on the allotment each year
+		double utilLimit;    // Largest share of a pasture's herb forage the herd takes (0-1). Below 0 uses the class's herb utilization.
+		int startYear;
+		int stopYear;
+	};
+
+	// One herd's stay in one pasture
+	struct PastureAssignment
+	{
+		RVS::DataManagement::Symbol allotment;
+		RVS::DataManagement::Symbol pasture;
+		RVS::DataManagement::Symbol animal;
+		double number;
+		double days;
+		double forage;       // Herb forage of the pasture at the start of the stay (lbs)
+		double utilization;  // Share of that forage the stay takes
+	};
+
+	class RotationScheduler
+	{
+	public:
+		RotationScheduler(std::vector<Pasture> pastures, std::vector<Herd> herds, const RVS::Disturbance::GrazingEngine* grazing);
+		virtual ~RotationScheduler(void);
+
+		// Finds the plots of every pasture and marks them as in rotation
+		void bind(std::map<int, RVS::DataManagement::AnalysisPlot*>* aps);
+
+		// Places the herds of a year. Needs the fuel loads of every plot in a pasture, so it runs
+		// once all plots of the year reached them. Requests are added for GrazingEngine::removeForage.
+		void schedule(int year, std::vector<RVS::Disturbance::GrazingRequest>* requests, std::vector<RVS::Disturbance::PastureAssignment>* assignments);
+
+		inline size_t NUM_PASTURES() { return pastures.size(); }
+		inline size_t NUM_HERDS() { return herds.size(); }
+
+	private:
+		std::vector<Pasture> pastures;
+		std::vector<Herd> herds;
+		const RVS::Disturbance::GrazingEngine* grazing;
+
+		// Pastures of each allotment
+		std::map<RVS::DataManagement::Symbol, std::vector<size_t>> allotments;
+	};
+}
+}
+
+#endif
@@ -0,0 +1,36 @@
+/// ********************************************************** ///
+/// Name: FBFM.h                                               ///
+/// Desc: Fire behavior fuel models RVS assigns to a plot.     ///
+/// The names are the Scott and Burgan (2005) grass, grass-    ///
+/// shrub and shrub codes, plus the codes RVS writes when a    ///
+/// plot has too little fuel (NB) or fits no rule (Unk*).      ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef FBFM_H
+#define FBFM_H
+
+namespace RVS
+{
+namespace Fuels
+{
+	enum FBFM
+	{
+		FBFM_NONE = 0,  // Not classified yet
+		FBFM_NB,
+
+		FBFM_GR1, FBFM_GR2, FBFM_GR3, FBFM_GR4, FBFM_GR5, FBFM_GR6, FBFM_GR7, FBFM_GR8, FBFM_GR9,
+		FBFM_GS1, FBFM_GS2, FBFM_GS3, FBFM_GS4,
+		FBFM_SH1, FBFM_SH2, FBFM_SH3, FBFM_SH4, FBFM_SH5, FBFM_SH6, FBFM_SH7, FBFM_SH8, FBFM_SH9,
+
+		// Fall through codes of the built in rules. The number tells which branch failed.
+		FBFM_UNK1, FBFM_UNK2, FBFM_UNK3, FBFM_UNK7, FBFM_UNK8,
+
+		NUM_FBFM
+	};
+}
+}
+
+#endif
@@ -0,0 +1,253 @@
+#include "FBFMClassifier.h"
+
+#include <algorithm>
+
+using RVS::Fuels::FBFM;
+using RVS::Fuels::FBFMClassifier;
+using RVS::Fuels::FBFMCondition;
+using RVS::Fuels::FBFMRule;
+using RVS::Fuels::FuelTotals;
+
+static const char* FBFM_NAMES[RVS::Fuels::NUM_FBFM] = {
+	"",
+	"NB",
+	"GR1", "GR2", "GR3", "GR4", "GR5", "GR6", "GR7", "GR8", "GR9",
+	"GS1", "GS2", "GS3", "GS4",
+	"SH1", "SH2", "SH3", "SH4", "SH5", "SH6", "SH7", "SH8", "SH9",
+	"Unk1", "Unk2", "Unk3", "Unk7", "Unk8"
+};
+
+static std::vector<RVS::DataManagement::Symbol> internNames(void)
+{
+	std::vector<RVS::DataManagement::Symbol> symbols;
+	for (int f = 0; f < RVS::Fuels::NUM_FBFM; f++)
+	{
+		symbols.push_back(RVS::DataManagement::SymbolTable::intern(FBFM_NAMES[f]));
+	}
+	return symbols;
+}
+
+FBFMRule::FBFMRule(void)
+{
+	priority = 0;
+	climate = ANY;
+	fbfm = FBFM_NONE;
+	numConditions = 0;
+}
+
+FBFMRule::FBFMRule(int priority, Climate climate, FBFM fbfm)
+{
+	this->priority = priority;
+	this->climate = climate;
+	this->fbfm = fbfm;
+	numConditions = 0;
+}
+
+FBFMRule& FBFMRule::when(int feature, FBFMCondition::Op op, double bound)
+{
+	if (numConditions < MAX_CONDITIONS)
+	{
+		FBFMCondition* c = &conditions[numConditions++];
+		c->feature = feature;
+		c->op = op;
+		c->bound = bound;
+	}
+	return *this;
+}
+
+FBFMClassifier::FBFMClassifier(void)
+{
+	compile(builtinRules());
+}
+
+FBFMClassifier::FBFMClassifier(std::vector<FBFMRule> rules)
+{
+	compile(rules);
+}
+
+FBFMClassifier::~FBFMClassifier(void)
+{
+}
+
+std::vector<FBFMRule> FBFMClassifier::builtinRules(void)
+{
+	typedef FBFMCondition C;
+	std::vector<FBFMRule> rules;
+
+	// Too little fuel to carry a fire
+	rules.push_back(FBFMRule(0, FBFMRule::ANY, FBFM_NB).when(FEATURE_TOTAL_FUEL, C::LESS, 200));
+
+	// Dry. Shrub type, then grass type, mixed for the rest.
+	int p = 100;
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_SH1).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_SHRUB_1HR, C::LESS_EQUAL, 1500));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_SH2).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_SHRUB_1HR, C::LESS, 5000));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_SH5).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_SHRUB_FINE, C::LESS_EQUAL, 12000));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_SH7).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_SHRUB_FINE, C::GREATER, 12000));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_UNK1).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_GR1).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_HERB_FUEL, C::LESS_EQUAL, 1000));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_GR2).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_HERB_FUEL, C::LESS_EQUAL, 2500));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_GR4).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_HERB_FUEL, C::LESS_EQUAL, 7500));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_GR7).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_HERB_FUEL, C::GREATER, 7500));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_UNK3).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_GS1).when(FEATURE_HERB_FUEL, C::LESS_EQUAL, 1000));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_GS2).when(FEATURE_HERB_FUEL, C::GREATER, 1000));
+	rules.push_back(FBFMRule(p++, FBFMRule::DRY, FBFM_UNK2));
+
+	// Humid
+	p = 200;
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_SH3).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_SHRUB_1HR, C::LESS_EQUAL, 1000));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_SH4).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_SHRUB_FINE, C::LESS, 5000));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_SH6).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_SHRUB_FINE, C::LESS_EQUAL, 9000));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_SH8).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_SHRUB_FINE, C::LESS_EQUAL, 5000));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_SH9).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_SHRUB_1HR, C::GREATER, 5000));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_UNK1).when(FEATURE_SHRUB_PROPORTION, C::GREATER_EQUAL, .8));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_GR3).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_HERB_FUEL, C::LESS_EQUAL, 4500));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_GR5).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_HERB_FUEL, C::LESS_EQUAL, 6000));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_GR6).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_HERB_FUEL, C::LESS_EQUAL, 8000));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_GR8).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_HERB_FUEL, C::LESS_EQUAL, 20000));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_GR9).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8).when(FEATURE_HERB_FUEL, C::GREATER, 20000));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_UNK3).when(FEATURE_HERB_PROPORTION, C::GREATER_EQUAL, .8));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_GS3).when(FEATURE_TOTAL_FUEL, C::LESS, 5500));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_GS4).when(FEATURE_TOTAL_FUEL, C::GREATER, 3000));
+	rules.push_back(FBFMRule(p++, FBFMRule::HUMID, FBFM_UNK2));
+
+	return rules;
+}
+
+FuelTotals FBFMClassifier::totals(RVS::DataManagement::AnalysisPlot* ap)
+{
+	FuelTotals t = FuelTotals();
+
+	// Same arithmetic as the accessors, so the rules see exactly the values the old
+	// hard coded classification compared
+	double shrub1Hr = ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB();
+	double total1Hr = ap->FUEL_TOTAL_1HR();
+
+	t.values[FEATURE_SHRUB_PROPORTION] = shrub1Hr / total1Hr;
+	t.values[FEATURE_HERB_PROPORTION] = ap->HERB_FUEL() / total1Hr;
+	t.values[FEATURE_SHRUB_1HR] = shrub1Hr;
+	t.values[FEATURE_SHRUB_FINE] = shrub1Hr + ap->SHRUB_10HR() + ap->SHRUB_100HR();
+	t.values[FEATURE_HERB_FUEL] = ap->HERB_FUEL();
+	t.values[FEATURE_TOTAL_FUEL] = ap->FUEL_TOTAL();
+	t.values[FEATURE_SHRUB_HEIGHT] = ap->SHRUBHEIGHT();
+	t.values[FEATURE_SHRUB_COVER] = ap->SHRUBCOVER();
+	t.values[FEATURE_HERB_PRODUCTION] = ap->PRIMARYPRODUCTION();
+	t.isDry = ap->ISDRY();
+
+	return t;
+}
+
+FBFM FBFMClassifier::classify(const FuelTotals& totals) const
+{
+	const std::vector<FBFMRule>* rules = totals.isDry ? &dryRules : &humidRules;
+	for (const FBFMRule& rule : *rules)
+	{
+		if (matches(rule, totals.values)) { return rule.fbfm; }
+	}
+	return fallback(totals.isDry);
+}
+
+void FBFMClassifier::classify(const std::vector<FuelTotals>& totals, std::vector<FBFM>* fbfms) const
+{
+	fbfms->assign(totals.size(), FBFM_NONE);
+
+	for (int climate = 0; climate < 2; climate++)
+	{
+		bool isDry = climate == 0;
+		const std::vector<FBFMRule>* rules = isDry ? &dryRules : &humidRules;
+
+		// Plots of this climate that no rule matched yet
+		std::vector<size_t> pending;
+		for (size_t i = 0; i < totals.size(); i++)
+		{
+			if (totals[i].isDry == isDry) { pending.push_back(i); }
+		}
+
+		for (const FBFMRule& rule : *rules)
+		{
+			if (pending.empty()) { break; }
+
+			size_t kept = 0;
+			for (size_t k = 0; k < pending.size(); k++)
+			{
+				size_t i = pending[k];
+				if (matches(rule, totals[i].values)) { (*fbfms)[i] = rule.fbfm; }
+				else { pending[kept++] = i; }
+			}
+			pending.resize(kept);
+		}
+
+		for (size_t i : pending)
+		{
+			(*fbfms)[i] = fallback(isDry);
+		}
+	}
+}
+
+const char* FBFMClassifier::NAME(FBFM fbfm)
+{
+	if (fbfm < FBFM_NONE || fbfm >= NUM_FBFM) { return ""; }
+	return FBFM_NAMES[fbfm];
+}
+
+RVS::DataManagement::Symbol FBFMClassifier::SYMBOL(FBFM fbfm)
+{
+	// Interned once, the classification runs every plot-year
+	static const std::vector<RVS::DataManagement::Symbol> symbols = internNames();
+
+	if (fbfm < FBFM_NONE || fbfm >= NUM_FBFM) { return RVS::DataManagement::SymbolTable::EMPTY; }
+	return symbols[fbfm];
+}
+
+FBFM FBFMClassifier::parse(const std::string& name)
+{
+	for (int f = FBFM_NB; f < NUM_FBFM; f++)
+	{
+		if (name.compare(FBFM_NAMES[f]) == 0) { return (FBFM)f; }
+	}
+	return FBFM_NONE;
+}
+
+void FBFMClassifier::compile(std::vector<FBFMRule> rules)
+{
+	// Stable, rules of equal priority keep their table order
+	std::stable_sort(rules.begin(), rules.end(), [](const FBFMRule& a, const FBFMRule& b)
+	{
+		return a.priority < b.priority;
+	});
+
+	dryRules.clear();
+	humidRules.clear();
+	for (const FBFMRule& rule : rules)
+	{
+		if (rule.fbfm == FBFM_NONE) { continue; }
+		if (rule.climate != FBFMRule::HUMID) { dryRules.push_back(rule); }
+		if (rule.climate != FBFMRule::DRY) { humidRules.push_back(rule); }
+	}
+}
+
+bool FBFMClassifier::matches(const FBFMRule& rule, const double* values)
+{
+	// Comparisons with NaN (plots without any 1 hr fuel) fail, as they did in the
+	// hard coded classification
+	for (int c = 0; c < rule.numConditions; c++)
+	{
+		const FBFMCondition* cond = &rule.conditions[c];
+		double v = values[cond->feature];
+		bool ok = false;
+		switch (cond->op)
+		{
+		case FBFMCondition::LESS: ok = v < cond->bound; break;
+		case FBFMCondition::LESS_EQUAL: ok = v <= cond->bound; break;
+		case FBFMCondition::GREATER: ok = v > cond->bound; break;
+		case FBFMCondition::GREATER_EQUAL: ok = v >= cond->bound; break;
+		}
+		if (!ok) { return false; }
+	}
+	return true;
+}
+
+FBFM FBFMClassifier::fallback(bool isDry)
+{
+	return isDry ? FBFM_UNK7 : FBFM_UNK8;
+}
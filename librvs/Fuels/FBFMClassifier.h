@@ -0,0 +1,118 @@
+/// ********************************************************** ///
+/// Name: FBFMClassifier.h                                     ///
+/// Desc: Rule table for fuel model assignment. Rules are read ///
+/// from Fuel_ClassRules when the input database has it, or    ///
+/// taken from the built in dry and humid rules. Either way    ///
+/// they are compiled into one flat list per climate that is   ///
+/// checked top down against a plot's precomputed fuel totals. ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef FBFMCLASSIFIER_H
+#define FBFMCLASSIFIER_H
+
+#include <string>
+#include <vector>
+
+#include "FBFM.h"
+#include "../DataManagement/AnalysisPlot.h"
+#include "../DataManagement/SymbolTable.h"
+
+namespace RVS
+{
+namespace Fuels
+{
+	// Plot values the rules can test. All fuel amounts in lbs/ac.
+	enum FuelFeature
+	{
+		FEATURE_SHRUB_PROPORTION = 0,  // Shrub share of the 1 hr fuel
+		FEATURE_HERB_PROPORTION,       // Herb share of the 1 hr fuel
+		FEATURE_SHRUB_1HR,             // Shrub 1 hr foliage + wood and bark
+		FEATURE_SHRUB_FINE,            // Shrub 1, 10 and 100 hr fuel
+		FEATURE_HERB_FUEL,
+		FEATURE_TOTAL_FUEL,
+		FEATURE_SHRUB_HEIGHT,          // cm
+		FEATURE_SHRUB_COVER,           // %
+		FEATURE_HERB_PRODUCTION,       // lbs/ac
+		NUM_FUEL_FEATURES
+	};
+
+	// Everything a rule looks at for one plot
+	struct FuelTotals
+	{
+		double values[NUM_FUEL_FEATURES];
+		bool isDry;
+	};
+
+	// Single test of a rule: values[feature] op bound
+	struct FBFMCondition
+	{
+		enum Op { LESS, LESS_EQUAL, GREATER, GREATER_EQUAL };
+
+		int feature;
+		Op op;
+		double bound;
+	};
+
+	// A rule matches when all its conditions hold. Rules are checked by ascending priority.
+	struct FBFMRule
+	{
+		enum Climate { ANY, DRY, HUMID };
+
+		static const int MAX_CONDITIONS = 2 * NUM_FUEL_FEATURES;
+
+		int priority;
+		Climate climate;
+		FBFM fbfm;
+		int numConditions;
+		FBFMCondition conditions[MAX_CONDITIONS];
+
+		FBFMRule(void);
+		FBFMRule(int priority, Climate climate, FBFM fbfm);
+		// Adds a condition, returns the rule so calls can be chained
+		FBFMRule& when(int feature, FBFMCondition::Op op, double bound);
+	};
+
+	class FBFMClassifier
+	{
+	public:
+		FBFMClassifier(void);
+		// Compiles rules. Rules with FBFM_NONE are dropped.
+		FBFMClassifier(std::vector<FBFMRule> rules);
+		virtual ~FBFMClassifier(void);
+
+		// Rules equal to the original hard coded dry and humid classification
+		static std::vector<FBFMRule> builtinRules(void);
+
+		// Fuel totals of a plot whose fuels were calculated for the year
+		static FuelTotals totals(RVS::DataManagement::AnalysisPlot* ap);
+
+		FBFM classify(const FuelTotals& totals) const;
+		// Classifies a whole array of plots. Each rule is tested against all plots still
+		// unassigned before the next rule, so the inner loop runs over plots.
+		void classify(const std::vector<FuelTotals>& totals, std::vector<FBFM>* fbfms) const;
+
+		inline size_t NUM_DRY_RULES() const { return dryRules.size(); }
+		inline size_t NUM_HUMID_RULES() const { return humidRules.size(); }
+
+		// FBFM code as written to the output ("GR2"), and its interned symbol
+		static const char* NAME(FBFM fbfm);
+		static RVS::DataManagement::Symbol SYMBOL(FBFM fbfm);
+		// FBFM_NONE if the name is not a known code
+		static FBFM parse(const std::string& name);
+
+	private:
+		std::vector<FBFMRule> dryRules;
+		std::vector<FBFMRule> humidRules;
+
+		void compile(std::vector<FBFMRule> rules);
+		static bool matches(const FBFMRule& rule, const double* values);
+		// Returned when no rule matches
+		static FBFM fallback(bool isDry);
+	};
+}
+}
+
+#endif
@@ -0,0 +1,297 @@
+#include "FireBehavior.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "../DataManagement/Arena.h"
+
+using RVS::Fuels::FBFM;
+using RVS::Fuels::FireBehavior;
+using RVS::Fuels::FireResults;
+using RVS::Fuels::FireScenario;
+using RVS::Fuels::FuelBeds;
+using RVS::Fuels::FuelModelParams;
+
+static const double PARTICLE_DENSITY = 32.0;       // lb/ft3
+static const double TOTAL_MINERAL = 0.0555;
+static const double EFFECTIVE_MINERAL = 0.010;
+static const double SAV_10HR = 109.0;
+static const double SAV_100HR = 30.0;
+static const double FEET_PER_MINUTE_PER_MPH = 88.0;
+static const double SQFT_PER_ACRE = 43560.0;
+// Keeps empty beds at zero instead of dividing by zero
+static const double TINY = 1e-12;
+
+// Scott and Burgan (2005) fuel bed parameters, in FBFM order. Classes a standard model has
+// no load in get a typical SAV (herb 1800, woody 1500), since a plot can still carry them.
+// Non burnable codes keep a placeholder bed and never get any load.
+static const FuelModelParams MODEL_PARAMS[RVS::Fuels::NUM_FBFM] = {
+	//  burnable, dynamic, 1 hr, herb, woody, depth, dead Mx, heat
+	{ false, false, 2000, 1800, 1500, 1.0, 0.15, 8000 },  // None
+	{ false, false, 2000, 1800, 1500, 1.0, 0.15, 8000 },  // NB
+	{ true, true, 2200, 2000, 1500, 0.4, 0.15, 8000 },    // GR1
+	{ true, true, 2000, 1800, 1500, 1.0, 0.15, 8000 },    // GR2
+	{ true, true, 1500, 1300, 1500, 2.0, 0.30, 8000 },    // GR3
+	{ true, true, 2000, 1800, 1500, 2.0, 0.15, 8000 },    // GR4
+	{ true, true, 1800, 1600, 1500, 1.5, 0.40, 8000 },    // GR5
+	{ true, true, 2200, 2000, 1500, 1.5, 0.40, 9000 },    // GR6
+	{ true, true, 2000, 1800, 1500, 3.0, 0.15, 8000 },    // GR7
+	{ true, true, 1500, 1300, 1500, 4.0, 0.30, 8000 },    // GR8
+	{ true, true, 1800, 1600, 1500, 5.0, 0.40, 8000 },    // GR9
+	{ true, true, 2000, 1800, 1800, 0.9, 0.15, 8000 },    // GS1
+	{ true, true, 2000, 1800, 1800, 1.5, 0.15, 8000 },    // GS2
+	{ true, true, 1800, 1600, 1600, 1.8, 0.40, 8000 },    // GS3
+	{ true, true, 1800, 1600, 1600, 2.1, 0.40, 8000 },    // GS4
+	{ true, true, 2000, 1800, 1600, 1.0, 0.15, 8000 },    // SH1
+	{ true, false, 2000, 1800, 1600, 1.0, 0.15, 8000 },   // SH2
+	{ true, false, 1600, 1800, 1400, 2.4, 0.40, 8000 },   // SH3
+	{ true, false, 2000, 1800, 1600, 3.0, 0.30, 8000 },   // SH4
+	{ true, false, 750, 1800, 1600, 6.0, 0.15, 8000 },    // SH5
+	{ true, false, 750, 1800, 1600, 2.0, 0.30, 8000 },    // SH6
+	{ true, false, 750, 1800, 1600, 6.0, 0.15, 8000 },    // SH7
+	{ true, false, 750, 1800, 1600, 3.0, 0.40, 8000 },    // SH8
+	{ true, true, 750, 1800, 1500, 4.4, 0.40, 8000 },     // SH9
+	{ false, false, 2000, 1800, 1500, 1.0, 0.15, 8000 },  // Unk1
+	{ false, false, 2000, 1800, 1500, 1.0, 0.15, 8000 },  // Unk2
+	{ false, false, 2000, 1800, 1500, 1.0, 0.15, 8000 },  // Unk3
+	{ false, false, 2000, 1800, 1500, 1.0, 0.15, 8000 },  // Unk7
+	{ false, false, 2000, 1800, 1500, 1.0, 0.15, 8000 }   // Unk8
+};
+
+FireBehavior::FireBehavior(void)
+{
+	scenarios.push_back(builtinScenario());
+}
+
+FireBehavior::FireBehavior(std::vector<FireScenario> scenarios)
+{
+	this->scenarios = scenarios;
+	if (this->scenarios.empty()) { this->scenarios.push_back(builtinScenario()); }
+}
+
+FireBehavior::~FireBehavior(void)
+{
+
+}
+
+FireScenario FireBehavior::builtinScenario(void)
+{
+	FireScenario s = FireScenario();
+	s.name = RVS::DataManagement::SymbolTable::intern("D2L2");
+	s.windSpeed = 5;
+	s.slope = 0;
+	s.moisture1Hr = 6;
+	s.moisture10Hr = 7;
+	s.moisture100Hr = 8;
+	s.moistureHerb = 60;
+	s.moistureWoody = 90;
+	return s;
+}
+
+const FuelModelParams& FireBehavior::PARAMS(FBFM fbfm)
+{
+	if (fbfm < 0 || fbfm >= RVS::Fuels::NUM_FBFM) { return MODEL_PARAMS[RVS::Fuels::FBFM_NONE]; }
+	return MODEL_PARAMS[fbfm];
+}
+
+void FireBehavior::allocate(size_t count, FuelBeds* beds, FireResults* results)
+{
+	RVS::DataManagement::Arena* scratch = RVS::DataManagement::Arena::scratch();
+	bind(scratch->allocateArray<double>(LANE_DOUBLES * count), count, beds, results);
+}
+
+// The next count doubles of storage
+static inline double* take(double** storage, size_t count)
+{
+	double* lanes = *storage;
+	*storage += count;
+	return lanes;
+}
+
+void FireBehavior::bind(double* storage, size_t count, FuelBeds* beds, FireResults* results)
+{
+	beds->count = count;
+	for (int c = 0; c < NUM_FUEL_CLASSES; c++)
+	{
+		beds->load[c] = take(&storage, count);
+		beds->sav[c] = take(&storage, count);
+		beds->moisture[c] = take(&storage, count);
+	}
+	beds->depth = take(&storage, count);
+	beds->deadMext = take(&storage, count);
+	beds->heat = take(&storage, count);
+	beds->windSpeed = take(&storage, count);
+	beds->slope = take(&storage, count);
+
+	results->reactionIntensity = take(&storage, count);
+	results->spreadRate = take(&storage, count);
+	results->firelineIntensity = take(&storage, count);
+	results->flameLength = take(&storage, count);
+	results->heatPerArea = take(&storage, count);
+}
+
+void FireBehavior::setBed(FuelBeds* beds, size_t lane, RVS::DataManagement::AnalysisPlot* ap, const FireScenario& scenario)
+{
+	const FuelModelParams& params = PARAMS(ap->FBFM_CLASS());
+	double toBed = params.burnable ? 1.0 / SQFT_PER_ACRE : 0;
+
+	// Shrub wood and bark, 10 and 100 hr are taken as dead, foliage as live woody. 1000 hr
+	// fuels don't carry a surface fire.
+	double herb = ap->HERB_FUEL() * toBed;
+	double cured = 0;
+	if (params.dynamic)
+	{
+		// Scott and Burgan load transfer: fully cured at 30% herb moisture, green at 120%
+		cured = std::min(std::max(1.333 - 0.0111 * scenario.moistureHerb, 0.0), 1.0);
+	}
+
+	beds->load[CLASS_DEAD_1HR][lane] = ap->SHRUB_1HR_WB() * toBed;
+	beds->load[CLASS_DEAD_10HR][lane] = ap->SHRUB_10HR() * toBed;
+	beds->load[CLASS_DEAD_100HR][lane] = ap->SHRUB_100HR() * toBed;
+	beds->load[CLASS_DEAD_HERB][lane] = herb * cured;
+	beds->load[CLASS_LIVE_HERB][lane] = herb * (1 - cured);
+	beds->load[CLASS_LIVE_WOODY][lane] = ap->SHRUB_1HR_FOLIAGE() * toBed;
+
+	beds->sav[CLASS_DEAD_1HR][lane] = params.sav1Hr;
+	beds->sav[CLASS_DEAD_10HR][lane] = SAV_10HR;
+	beds->sav[CLASS_DEAD_100HR][lane] = SAV_100HR;
+	beds->sav[CLASS_DEAD_HERB][lane] = params.savHerb;
+	beds->sav[CLASS_LIVE_HERB][lane] = params.savHerb;
+	beds->sav[CLASS_LIVE_WOODY][lane] = params.savWoody;
+
+	beds->moisture[CLASS_DEAD_1HR][lane] = scenario.moisture1Hr / 100;
+	beds->moisture[CLASS_DEAD_10HR][lane] = scenario.moisture10Hr / 100;
+	beds->moisture[CLASS_DEAD_100HR][lane] = scenario.moisture100Hr / 100;
+	beds->moisture[CLASS_DEAD_HERB][lane] = scenario.moisture1Hr / 100;
+	beds->moisture[CLASS_LIVE_HERB][lane] = scenario.moistureHerb / 100;
+	beds->moisture[CLASS_LIVE_WOODY][lane] = scenario.moistureWoody / 100;
+
+	beds->depth[lane] = params.depth;
+	beds->deadMext[lane] = params.deadMext;
+	beds->heat[lane] = params.heat;
+	beds->windSpeed[lane] = scenario.windSpeed * FEET_PER_MINUTE_PER_MPH;
+	beds->slope[lane] = scenario.slope / 100;
+}
+
+void FireBehavior::setBeds(FuelBeds* beds, RVS::DataManagement::AnalysisPlot* ap) const
+{
+	setBeds(beds, 0, ap);
+}
+
+void FireBehavior::setBeds(FuelBeds* beds, size_t firstLane, RVS::DataManagement::AnalysisPlot* ap) const
+{
+	for (size_t s = 0; s < scenarios.size(); s++)
+	{
+		setBed(beds, firstLane + s, ap, scenarios[s]);
+	}
+}
+
+// Rothermel moisture damping coefficient
+static inline double moistureDamping(double moisture, double extinction)
+{
+	double r = std::min(moisture / extinction, 1.0);
+	return 1 - 2.59 * r + 5.11 * r * r - 3.52 * r * r * r;
+}
+
+void FireBehavior::spread(const FuelBeds& beds, FireResults* results)
+{
+	const double mineralDamping = 0.174 * std::pow(EFFECTIVE_MINERAL, -0.19);
+
+	for (size_t i = 0; i < beds.count; i++)
+	{
+		double load[NUM_FUEL_CLASSES];
+		double sav[NUM_FUEL_CLASSES];
+		double moisture[NUM_FUEL_CLASSES];
+		double area[NUM_FUEL_CLASSES];
+		for (int c = 0; c < NUM_FUEL_CLASSES; c++)
+		{
+			load[c] = beds.load[c][i];
+			sav[c] = beds.sav[c][i];
+			moisture[c] = beds.moisture[c][i];
+			area[c] = sav[c] * load[c] / PARTICLE_DENSITY;
+		}
+
+		// Surface area weights within the dead and live categories
+		double deadArea = 0;
+		double liveArea = 0;
+		for (int c = 0; c < NUM_DEAD_CLASSES; c++) { deadArea += area[c]; }
+		for (int c = NUM_DEAD_CLASSES; c < NUM_FUEL_CLASSES; c++) { liveArea += area[c]; }
+		double totalArea = std::max(deadArea + liveArea, TINY);
+		double deadWeight = deadArea / totalArea;
+		double liveWeight = liveArea / totalArea;
+
+		double deadSav = 0, liveSav = 0;
+		double deadNetLoad = 0, liveNetLoad = 0;
+		double deadMoisture = 0, liveMoisture = 0;
+		double deadSink = 0, liveSink = 0;
+		double fineDead = 0, fineDeadWater = 0, fineLive = 0;
+		double totalLoad = 0;
+		for (int c = 0; c < NUM_DEAD_CLASSES; c++)
+		{
+			double f = area[c] / std::max(deadArea, TINY);
+			double heating = std::exp(-138.0 / sav[c]);
+			deadSav += f * sav[c];
+			deadNetLoad += f * load[c] * (1 - TOTAL_MINERAL);
+			deadMoisture += f * moisture[c];
+			deadSink += f * heating * (250 + 1116 * moisture[c]);
+			// Fine fuel loads for the live moisture of extinction
+			fineDead += load[c] * heating;
+			fineDeadWater += load[c] * heating * moisture[c];
+			totalLoad += load[c];
+		}
+		for (int c = NUM_DEAD_CLASSES; c < NUM_FUEL_CLASSES; c++)
+		{
+			double f = area[c] / std::max(liveArea, TINY);
+			double heating = std::exp(-138.0 / sav[c]);
+			liveSav += f * sav[c];
+			liveNetLoad += f * load[c] * (1 - TOTAL_MINERAL);
+			liveMoisture += f * moisture[c];
+			liveSink += f * heating * (250 + 1116 * moisture[c]);
+			fineLive += load[c] * std::exp(-500.0 / sav[c]);
+			totalLoad += load[c];
+		}
+
+		double deadMext = beds.deadMext[i];
+		double fineDeadMoisture = fineDeadWater / std::max(fineDead, TINY);
+		double liveMext = 2.9 * (fineDead / std::max(fineLive, TINY)) * (1 - fineDeadMoisture / deadMext) - 0.226;
+		liveMext = std::max(liveMext, deadMext);
+
+		double sigma = std::max(deadWeight * deadSav + liveWeight * liveSav, 1.0);
+		double bulkDensity = totalLoad / beds.depth[i];
+		double packing = std::max(bulkDensity / PARTICLE_DENSITY, TINY);
+		double optimumPacking = 3.348 * std::pow(sigma, -0.8189);
+		double packingRatio = packing / optimumPacking;
+
+		double sigma15 = std::pow(sigma, 1.5);
+		double maxReactionVelocity = sigma15 / (495 + 0.0594 * sigma15);
+		double a = 133 * std::pow(sigma, -0.7913);
+		double reactionVelocity = maxReactionVelocity * std::pow(packingRatio, a) * std::exp(a * (1 - packingRatio));
+
+		double heat = beds.heat[i];
+		double reaction = reactionVelocity * heat * mineralDamping * \
+			(deadNetLoad * moistureDamping(deadMoisture, deadMext) + liveNetLoad * moistureDamping(liveMoisture, liveMext));
+
+		double propagatingFlux = std::exp((0.792 + 0.681 * std::sqrt(sigma)) * (packing + 0.1)) / (192 + 0.2595 * sigma);
+
+		// Wind is capped at the Rothermel wind limit
+		double wind = std::min(beds.windSpeed[i], 0.9 * reaction);
+		double c = 7.47 * std::exp(-0.133 * std::pow(sigma, 0.55));
+		double b = 0.02526 * std::pow(sigma, 0.54);
+		double e = 0.715 * std::exp(-3.59e-4 * sigma);
+		double windFactor = c * std::pow(wind, b) * std::pow(packingRatio, -e);
+		double slopeFactor = 5.275 * std::pow(packing, -0.3) * beds.slope[i] * beds.slope[i];
+
+		double heatSink = bulkDensity * (deadWeight * deadSink + liveWeight * liveSink);
+		double rate = reaction * propagatingFlux * (1 + windFactor + slopeFactor) / std::max(heatSink, TINY);
+
+		double residence = 384 / sigma;
+		double heatPerArea = reaction * residence;
+		double intensity = heatPerArea * rate / 60;
+
+		results->reactionIntensity[i] = reaction;
+		results->spreadRate[i] = rate;
+		results->firelineIntensity[i] = intensity;
+		results->flameLength[i] = 0.45 * std::pow(intensity, 0.46);
+		results->heatPerArea[i] = heatPerArea;
+	}
+}
@@ -0,0 +1,128 @@
+/// ********************************************************** ///
+/// Name: FireBehavior.h                                       ///
+/// Desc: Rothermel (1972) surface fire spread for the fuel    ///
+/// model and fuel loads of a plot. Fuel bed geometry comes    ///
+/// from the Scott and Burgan (2005) parameter table, loads    ///
+/// from the plot. Beds are evaluated in batches, one lane per ///
+/// plot and scenario, so the kernel loop has no branches.     ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef FIREBEHAVIOR_H
+#define FIREBEHAVIOR_H
+
+#include <string>
+#include <vector>
+
+#include "FBFM.h"
+#include "../DataManagement/AnalysisPlot.h"
+#include "../DataManagement/SymbolTable.h"
+
+namespace RVS
+{
+namespace Fuels
+{
+	// Fuel particle classes of the spread model. Dead classes first.
+	enum FuelClass
+	{
+		CLASS_DEAD_1HR = 0,
+		CLASS_DEAD_10HR,
+		CLASS_DEAD_100HR,
+		CLASS_DEAD_HERB,   // Cured share of the herb load in dynamic models
+		CLASS_LIVE_HERB,
+		CLASS_LIVE_WOODY,
+		NUM_FUEL_CLASSES
+	};
+
+	static const int NUM_DEAD_CLASSES = CLASS_LIVE_HERB;
+
+	// Scott and Burgan fuel bed parameters. Loads are not kept, the plot supplies them.
+	struct FuelModelParams
+	{
+		bool burnable;
+		bool dynamic;        // Herb load cures with herb moisture
+		double sav1Hr;       // Surface area to volume ratio (1/ft)
+		double savHerb;
+		double savWoody;
+		double depth;        // Fuel bed depth (ft)
+		double deadMext;     // Dead fuel moisture of extinction (fraction)
+		double heat;         // Heat content (BTU/lb)
+	};
+
+	// Wind, slope and fuel moistures a fire is run under. Moistures in %, wind in mph at midflame.
+	struct FireScenario
+	{
+		RVS::DataManagement::Symbol name;
+		double windSpeed;
+		double slope;        // %
+		double moisture1Hr;
+		double moisture10Hr;
+		double moisture100Hr;
+		double moistureHerb;
+		double moistureWoody;
+	};
+
+	// Structure of arrays over count lanes. Loads in lb/ft2, SAV in 1/ft, moisture as a fraction.
+	struct FuelBeds
+	{
+		size_t count;
+		double* load[NUM_FUEL_CLASSES];
+		double* sav[NUM_FUEL_CLASSES];
+		double* moisture[NUM_FUEL_CLASSES];
+		double* depth;
+		double* deadMext;
+		double* heat;
+		double* windSpeed;   // ft/min
+		double* slope;       // Rise over run
+	};
+
+	struct FireResults
+	{
+		double* reactionIntensity;   // BTU/ft2/min
+		double* spreadRate;          // ft/min
+		double* firelineIntensity;   // BTU/ft/s
+		double* flameLength;         // ft
+		double* heatPerArea;         // BTU/ft2
+	};
+
+	class FireBehavior
+	{
+	public:
+		FireBehavior(void);
+		// Scenarios replace the built in one. An empty list keeps the built in scenario.
+		FireBehavior(std::vector<FireScenario> scenarios);
+		virtual ~FireBehavior(void);
+
+		// Scott and Burgan moisture scenario D2L2 (dry, moderate live moisture) at 5 mph
+		static FireScenario builtinScenario(void);
+		static const FuelModelParams& PARAMS(FBFM fbfm);
+
+		inline size_t NUM_SCENARIOS() const { return scenarios.size(); }
+		inline const FireScenario& SCENARIO(size_t i) const { return scenarios[i]; }
+
+		// Doubles a lane of beds and results takes
+		static const size_t LANE_DOUBLES = 3 * NUM_FUEL_CLASSES + 5 + 5;
+
+		// Allocates beds and results for count lanes from the thread's scratch arena
+		static void allocate(size_t count, FuelBeds* beds, FireResults* results);
+		// Lays beds and results for count lanes out over storage of LANE_DOUBLES * count doubles
+		static void bind(double* storage, size_t count, FuelBeds* beds, FireResults* results);
+		// Fills lane with the plot's fuels under a scenario
+		static void setBed(FuelBeds* beds, size_t lane, RVS::DataManagement::AnalysisPlot* ap, const FireScenario& scenario);
+		// Fills one lane per scenario, starting at lane 0. beds needs NUM_SCENARIOS lanes.
+		void setBeds(FuelBeds* beds, RVS::DataManagement::AnalysisPlot* ap) const;
+		// Same, starting at firstLane, so the scenarios of many plots share one batch
+		void setBeds(FuelBeds* beds, size_t firstLane, RVS::DataManagement::AnalysisPlot* ap) const;
+
+		// Rothermel spread rate, intensity and flame length for every lane
+		static void spread(const FuelBeds& beds, FireResults* results);
+
+	private:
+		std::vector<FireScenario> scenarios;
+	};
+}
+}
+
+#endif
@@ -2,8 +2,11 @@
 
 RVS::Fuels::FuelsDIO::FuelsDIO(void) : RVS::DataManagement::DIO()
 {
+	queryStage = RVS::DataManagement::STAGE_QUERY_FUELS;
+	speciesFuels = *SPECIES_FUELS && has_species_fuel_tables();
 	this->create_output_table();
 	this->create_intermediate_table();
+	if (*FIRE_BEHAVIOR) { this->create_fire_behavior_table(); }
 }
 
 RVS::Fuels::FuelsDIO::~FuelsDIO(void)
@@ -13,7 +16,7 @@ RVS::Fuels::FuelsDIO::~FuelsDIO(void)
 
 int* RVS::Fuels::FuelsDIO::create_output_table()
 {
-	std::stringstream sqlstream;
+	std::ostream& sqlstream = begin_write();
 	sqlstream << "CREATE TABLE " << FUELS_OUTPUT_TABLE << "(" << \
 		PLOT_NUM_FIELD << " INT NOT NULL," << \
 		PLOT_NAME_FIELD << " TEXT, " << \
@@ -35,16 +38,15 @@ int* RVS::Fuels::FuelsDIO::create_output_table()
 		FUEL_TOTAL_FIELD << " REAL, " << \
 		FC_FBFM_FIELD << " TEXT); ";
 
-	char* sql = new char;
-	sql = streamToCharPtr(&sqlstream);
-	queuedWrites.push_back(sql);
+	queue_write();
 
 	return RC;
 }
 
 int* RVS::Fuels::FuelsDIO::write_output_record(int* year, RVS::DataManagement::AnalysisPlot* ap)
 {
-	std::stringstream sqlstream;
+	if (WRITES_DISCARDED()) { return RC; }
+	std::ostream& sqlstream = begin_write();
 	
 	sqlstream << "INSERT INTO " << FUELS_OUTPUT_TABLE << " (" << \
 		PLOT_NUM_FIELD << ", " << \
@@ -87,9 +89,7 @@ int* RVS::Fuels::FuelsDIO::write_output_record(int* year, RVS::DataManagement::A
 		ap->FUEL_TOTAL() << ", \"" << \
 		ap->FBFM_NAME() << "\");";
 
-	char* sql = new char;
-	sql = streamToCharPtr(&sqlstream);
-	queuedWrites.push_back(sql);
+	queue_write();
 	
 	return RC;
 	
@@ -97,7 +97,6 @@ int* RVS::Fuels::FuelsDIO::write_output_record(int* year, RVS::DataManagement::A
 
 int* RVS::Fuels::FuelsDIO::create_intermediate_table()
 {
-	std::stringstream sqlstream;
 	/*
 	sqlstream << "CREATE TABLE " << FUELS_INTERMEDIATE_TABLE << "(" << \
 		PLOT_NUM_FIELD << " INT NOT NULL, " << \
@@ -126,16 +125,37 @@ int* RVS::Fuels::FuelsDIO::create_intermediate_table()
 		FUEL_100HRDEAD_OUT_FIELD << "_EQ INT, " << \
 		FUEL_100HRDEAD_OUT_FIELD << " REAL); ";
 
-	char* sql = new char;
-	sql = streamToCharPtr(&sqlstream);
-	queuedWrites.push_back(sql);
+	queue_write();
 	*/
+	if (!speciesFuels) { return RC; }
+
+	// Per species fuels, only written when the fuels come from each species' equations
+	std::ostream& sqlstream = begin_write();
+	sqlstream << "CREATE TABLE " << FUELS_INTERMEDIATE_TABLE << "(" << \
+		PLOT_NUM_FIELD << " INT NOT NULL, " << \
+		PLOT_NAME_FIELD << " TEXT, " << \
+		YEAR_OUT_FIELD << " INT NOT NULL, " << \
+		BPS_NUM_FIELD << " INT NOT NULL, " << \
+		FC_ISDRY_FIELD << " BOOLEAN, " << \
+		DOM_SPP_FIELD << " TEXT, " << \
+		SPP_CODE_FIELD << " TEXT, " << \
+		FUEL_1HR_TOTAL << "_EQ INT, " << \
+		FUEL_1HR_TOTAL << " REAL, " << \
+		FUEL_10HR_FIELD << "_EQ INT, " << \
+		FUEL_10HR_FIELD << " REAL, " << \
+		FUEL_100HR_FIELD << "_EQ INT, " << \
+		FUEL_100HR_FIELD << " REAL, " << \
+		FUEL_1000HR_FIELD << "_EQ INT, " << \
+		FUEL_1000HR_FIELD << " REAL); ";
+
+	queue_write();
 	return RC;
 }
 
 
 int* RVS::Fuels::FuelsDIO::write_intermediate_record(int* year, RVS::DataManagement::AnalysisPlot* ap, RVS::DataManagement::SppRecord* spp)
 {
+	if (WRITES_DISCARDED()) { return RC; }
 	/*
 	std::map<std::string, int> fuelsEqs = spp->FUEL_EQUS();
 	std::map<std::string, double> fuelsVals = spp->FUEL_VALUES();
@@ -169,10 +189,102 @@ int* RVS::Fuels::FuelsDIO::write_intermediate_record(int* year, RVS::DataManagem
 		fuelsEqs[FUEL_100HRDEAD_OUT_FIELD] << "," << \
 		fuelsVals[FUEL_100HRDEAD_OUT_FIELD] / 2000 << ");";
 
-	char* sql = new char;
-	sql = streamToCharPtr(&sqlstream);
-	queuedWrites.push_back(sql);
+	queue_write();
 	*/
+	if (!speciesFuels) { return RC; }
+
+	std::ostream& sqlstream = begin_write();
+	sqlstream << "INSERT INTO " << FUELS_INTERMEDIATE_TABLE << \
+		" VALUES (" << \
+		ap->PLOT_ID() << ",\"" << \
+		ap->PLOT_NAME() << "\"," << \
+		*year << "," << \
+		ap->BPS_NUM() << "," << \
+		ap->ISDRY() << ",\"" << \
+		spp->DOM_SPP() << "\", \"" << \
+		spp->SPP_CODE() << "\"," << \
+		spp->FUEL_EQNUM(0) << "," << \
+		spp->FUEL_1HR() << "," << \
+		spp->FUEL_EQNUM(1) << "," << \
+		spp->FUEL_10HR() << "," << \
+		spp->FUEL_EQNUM(2) << "," << \
+		spp->FUEL_100HR() << "," << \
+		spp->FUEL_EQNUM(3) << "," << \
+		spp->FUEL_1000HR() << ");";
+
+	queue_write();
+	return RC;
+}
+
+int* RVS::Fuels::FuelsDIO::write_repeat_records(int* year, int* lastYear, RVS::DataManagement::AnalysisPlot* ap)
+{
+	write_repeat_record(FUELS_OUTPUT_TABLE, ap->PLOT_ID(), *year, *lastYear);
+	if (speciesFuels)
+	{
+		write_repeat_record(FUELS_INTERMEDIATE_TABLE, ap->PLOT_ID(), *year, *lastYear);
+	}
+	if (*FIRE_BEHAVIOR)
+	{
+		write_repeat_record(FIRE_BEHAVIOR_OUTPUT_TABLE, ap->PLOT_ID(), *year, *lastYear);
+	}
+	return RC;
+}
+
+int* RVS::Fuels::FuelsDIO::create_year_index(void)
+{
+	if (speciesFuels)
+	{
+		index_by_year(FUELS_INTERMEDIATE_TABLE);
+	}
+	if (*FIRE_BEHAVIOR)
+	{
+		index_by_year(FIRE_BEHAVIOR_OUTPUT_TABLE);
+	}
+	return index_by_year(FUELS_OUTPUT_TABLE);
+}
+
+int* RVS::Fuels::FuelsDIO::create_fire_behavior_table(void)
+{
+	std::ostream& sqlstream = begin_write();
+	sqlstream << "CREATE TABLE " << FIRE_BEHAVIOR_OUTPUT_TABLE << "(" << \
+		PLOT_NUM_FIELD << " INT NOT NULL, " << \
+		PLOT_NAME_FIELD << " TEXT, " << \
+		YEAR_OUT_FIELD << " INT NOT NULL, " << \
+		FS_NAME_FIELD << " TEXT, " << \
+		FC_FBFM_FIELD << " TEXT, " << \
+		FS_WIND_FIELD << " REAL, " << \
+		FB_REACTION_INTENSITY_FIELD << " REAL, " << \
+		FB_SPREAD_RATE_FIELD << " REAL, " << \
+		FB_FIRELINE_INTENSITY_FIELD << " REAL, " << \
+		FB_FLAME_LENGTH_FIELD << " REAL, " << \
+		FB_HEAT_PER_AREA_FIELD << " REAL); ";
+
+	queue_write();
+	return RC;
+}
+
+int* RVS::Fuels::FuelsDIO::write_fire_behavior_record(int* year, RVS::DataManagement::AnalysisPlot* ap, RVS::DataManagement::Symbol fbfm, const RVS::Fuels::FireScenario& scenario, const RVS::Fuels::FireResults& results, size_t lane)
+{
+	if (WRITES_DISCARDED()) { return RC; }
+	// Spread rate is written in chains per hour
+	const double chainsPerHour = 60.0 / 66.0;
+
+	std::ostream& sqlstream = begin_write();
+	sqlstream << "INSERT INTO " << FIRE_BEHAVIOR_OUTPUT_TABLE << \
+		" VALUES (" << \
+		ap->PLOT_ID() << ",\"" << \
+		ap->PLOT_NAME() << "\"," << \
+		*year << ",\"" << \
+		RVS::DataManagement::SymbolTable::name(scenario.name) << "\",\"" << \
+		RVS::DataManagement::SymbolTable::name(fbfm) << "\"," << \
+		scenario.windSpeed << "," << \
+		results.reactionIntensity[lane] << "," << \
+		results.spreadRate[lane] * chainsPerHour << "," << \
+		results.firelineIntensity[lane] << "," << \
+		results.flameLength[lane] << "," << \
+		results.heatPerArea[lane] << ");";
+
+	queue_write();
 	return RC;
 }
 
@@ -206,7 +318,7 @@ RVS::DataManagement::DataTable* RVS::Fuels::FuelsDIO::query_equation_table(std::
 	std::stringstream sqlstream;
 	sqlstream << "SELECT * FROM " << FUEL_EQUATION_TABLE << " WHERE " << EQUATION_NUMBER_FIELD << " IN (";
 
-	int count = 0;
+	size_t count = 0;
 	for (auto eq : equationNumbers)
 	{
 		sqlstream << eq.second;
@@ -221,8 +333,7 @@ RVS::DataManagement::DataTable* RVS::Fuels::FuelsDIO::query_equation_table(std::
 		count++;
 	}
 
-	char* sql = streamToCharPtr(&sqlstream);
-	RVS::DataManagement::DataTable* dt = prep_datatable(sql, rvsdb);
+	RVS::DataManagement::DataTable* dt = prep_datatable(sqlstream.str().c_str(), rvsdb);
 	return dt;
 }
 
@@ -237,8 +348,7 @@ RVS::DataManagement::DataTable* RVS::Fuels::FuelsDIO::query_fbfm_rules_selector(
 {
 	std::stringstream ss;
 	ss << "SELECT * FROM " << FUEL_CLASSRULES_TABLE << ";";
-	char* sql = streamToCharPtr(&ss);
-	RVS::DataManagement::DataTable* dt = prep_datatable(sql, rvsdb);
+	RVS::DataManagement::DataTable* dt = prep_datatable(ss.str().c_str(), rvsdb);
 	return dt;
 }
 
@@ -246,7 +356,177 @@ RVS::DataManagement::DataTable* RVS::Fuels::FuelsDIO::query_fbfm_rules(std::stri
 {
 	std::stringstream ss;
 	ss << "SELECT * FROM " << classTable << ";";
-	char* sql = streamToCharPtr(&ss);
-	RVS::DataManagement::DataTable* dt = prep_datatable(sql, rvsdb);
+	RVS::DataManagement::DataTable* dt = prep_datatable(ss.str().c_str(), rvsdb);
 	return dt;
-}
\ No newline at end of file
+}
+bool RVS::Fuels::FuelsDIO::query_fbfm_rule_table(std::vector<RVS::Fuels::FBFMRule>* rules)
+{
+	if (!table_exists(FUEL_CLASSRULES_TABLE)) { return false; }
+
+	// Lower bounds are inclusive, upper bounds exclusive, unless the bound's _op column says
+	// otherwise. Missing or NULL bounds are open.
+	const char* bounds[NUM_FUEL_FEATURES][2] = {
+		{ FC_PROPORTION_LOWER, FC_PROPORTION_UPPER },
+		{ FC_HERB_PROPORTION_LOWER, FC_HERB_PROPORTION_UPPER },
+		{ FC_SHRUB_FUEL_LOWER, FC_SHRUB_FUEL_UPPER },
+		{ FC_SHRUB_FINE_FUEL_LOWER, FC_SHRUB_FINE_FUEL_UPPER },
+		{ FC_HERB_1HR_LOWER, FC_HERB_1HR_UPPER },
+		{ FC_TOTAL_FUEL_LOWER, FC_TOTAL_FUEL_UPPER },
+		{ FC_HT_LOWER, FC_HT_UPPER },
+		{ FC_SHRUB_COV_LOWER, FC_SHRUB_COV_UPPER },
+		{ FC_HERB_PROD_LOWER, FC_HERB_PROD_UPPER }
+	};
+
+	std::stringstream ss;
+	ss << "SELECT * FROM " << FUEL_CLASSRULES_TABLE << ";";
+	RVS::DataManagement::DataTable* dt = prep_datatable(scratchCharPtr(&ss), rvsdb, true, true);
+	sqlite3_stmt* stmt = dt->getStmt();
+
+	int row = 0;
+	while (*dt->STATUS() == SQLITE_ROW)
+	{
+		FBFMRule rule = FBFMRule();
+		rule.priority = row;
+
+		std::string name = "";
+		if (dt->Columns.count(FC_FBFM_FIELD) > 0) { getVal(stmt, dt->Columns[FC_FBFM_FIELD], &name); }
+		rule.fbfm = FBFMClassifier::parse(name);
+
+		if (dt->Columns.count(FC_PRIORITY_FIELD) > 0 && \
+			sqlite3_column_type(stmt, dt->Columns[FC_PRIORITY_FIELD]) != SQLITE_NULL)
+		{
+			rule.priority = sqlite3_column_int(stmt, dt->Columns[FC_PRIORITY_FIELD]);
+		}
+
+		rule.climate = FBFMRule::ANY;
+		if (dt->Columns.count(FC_ISDRY_FIELD) > 0 && \
+			sqlite3_column_type(stmt, dt->Columns[FC_ISDRY_FIELD]) != SQLITE_NULL)
+		{
+			rule.climate = sqlite3_column_int(stmt, dt->Columns[FC_ISDRY_FIELD]) != 0 ? FBFMRule::DRY : FBFMRule::HUMID;
+		}
+
+		bool knownOps = true;
+		for (int f = 0; f < NUM_FUEL_FEATURES; f++)
+		{
+			for (int b = 0; b < 2; b++)
+			{
+				if (dt->Columns.count(bounds[f][b]) == 0) { continue; }
+				int column = dt->Columns[bounds[f][b]];
+				if (sqlite3_column_type(stmt, column) == SQLITE_NULL) { continue; }
+
+				double value = sqlite3_column_double(stmt, column);
+				FBFMCondition::Op op = b == 0 ? FBFMCondition::GREATER_EQUAL : FBFMCondition::LESS;
+
+				std::string opColumn = std::string(bounds[f][b]) + FC_BOUND_OP_SUFFIX;
+				if (dt->Columns.count(opColumn) > 0 && \
+					sqlite3_column_type(stmt, dt->Columns[opColumn]) != SQLITE_NULL)
+				{
+					std::string text = "";
+					getVal(stmt, dt->Columns[opColumn], &text);
+					if (b == 0 && text == ">") { op = FBFMCondition::GREATER; }
+					else if (b == 1 && text == "<=") { op = FBFMCondition::LESS_EQUAL; }
+					else if (text != (b == 0 ? ">=" : "<"))
+					{
+						std::stringstream msg;
+						msg << FUEL_CLASSRULES_TABLE << " row " << row << ". Unknown " << opColumn << " \"" << text << \
+							"\", rule skipped.";
+						write_debug_msg(msg.str().c_str());
+						knownOps = false;
+					}
+				}
+
+				rule.when(f, op, value);
+			}
+		}
+
+		if (!knownOps)
+		{
+			// Already reported
+		}
+		else if (rule.fbfm == FBFM_NONE)
+		{
+			std::stringstream msg;
+			msg << FUEL_CLASSRULES_TABLE << " row " << row << ". Unknown FBFM \"" << name << "\", rule skipped.";
+			write_debug_msg(msg.str().c_str());
+		}
+		else
+		{
+			rules->push_back(rule);
+		}
+
+		*dt->STATUS() = sqlite3_step(stmt);
+		row++;
+	}
+
+	return true;
+}
+
+bool RVS::Fuels::FuelsDIO::has_species_fuel_tables(void)
+{
+	return table_exists(FUEL_CROSSWALK_TABLE) && table_exists(FUEL_EQUATION_TABLE);
+}
+
+bool RVS::Fuels::FuelsDIO::query_species_fuel_equations(std::string spp, int* equationNumbers)
+{
+	const char* fields[4] = { FUEL_CROSSWALK_1HR_FIELD, FUEL_CROSSWALK_10HR_FIELD, \
+		FUEL_CROSSWALK_100HR_FIELD, FUEL_CROSSWALK_1000HR_FIELD };
+
+	const char* sql = query_base(FUEL_CROSSWALK_TABLE, SPP_CODE_FIELD, spp);
+	RVS::DataManagement::DataTable* dt = prep_datatable(sql, rvsdb, true, true);
+	if (*dt->STATUS() != SQLITE_ROW) { return false; }
+
+	for (int i = 0; i < 4; i++)
+	{
+		equationNumbers[i] = 0;
+		if (dt->Columns.count(fields[i]) == 0) { continue; }
+		equationNumbers[i] = sqlite3_column_int(dt->getStmt(), dt->Columns[fields[i]]);
+	}
+
+	return true;
+}
+
+bool RVS::Fuels::FuelsDIO::query_fire_scenarios(std::vector<RVS::Fuels::FireScenario>* scenarios)
+{
+	if (!table_exists(FIRE_SCENARIO_TABLE)) { return false; }
+
+	// Values left out fall back to the built in scenario
+	const char* fields[7] = { FS_WIND_FIELD, FS_SLOPE_FIELD, FS_MOISTURE_1HR_FIELD, FS_MOISTURE_10HR_FIELD, \
+		FS_MOISTURE_100HR_FIELD, FS_MOISTURE_HERB_FIELD, FS_MOISTURE_WOODY_FIELD };
+
+	std::stringstream ss;
+	ss << "SELECT * FROM " << FIRE_SCENARIO_TABLE << ";";
+	RVS::DataManagement::DataTable* dt = prep_datatable(scratchCharPtr(&ss), rvsdb, true, true);
+	sqlite3_stmt* stmt = dt->getStmt();
+
+	int row = 0;
+	while (*dt->STATUS() == SQLITE_ROW)
+	{
+		FireScenario scenario = FireBehavior::builtinScenario();
+		double* values[7] = { &scenario.windSpeed, &scenario.slope, &scenario.moisture1Hr, &scenario.moisture10Hr, \
+			&scenario.moisture100Hr, &scenario.moistureHerb, &scenario.moistureWoody };
+
+		std::stringstream name;
+		name << "S" << row;
+		if (dt->Columns.count(FS_NAME_FIELD) > 0 && \
+			sqlite3_column_type(stmt, dt->Columns[FS_NAME_FIELD]) != SQLITE_NULL)
+		{
+			name.str("");
+			name << sqlite3_column_text(stmt, dt->Columns[FS_NAME_FIELD]);
+		}
+		scenario.name = RVS::DataManagement::SymbolTable::intern(name.str());
+
+		for (int f = 0; f < 7; f++)
+		{
+			if (dt->Columns.count(fields[f]) == 0) { continue; }
+			int column = dt->Columns[fields[f]];
+			if (sqlite3_column_type(stmt, column) == SQLITE_NULL) { continue; }
+			*values[f] = sqlite3_column_double(stmt, column);
+		}
+
+		scenarios->push_back(scenario);
+		*dt->STATUS() = sqlite3_step(stmt);
+		row++;
+	}
+
+	return true;
+}
@@ -15,6 +15,8 @@
 #include "../DataManagement/DataTable.h"
 #include "../DataManagement/DIO.h"
 #include "../DataManagement/SppRecord.h"
+#include "FBFMClassifier.h"
+#include "FireBehavior.h"
 #include "../RVSDBNAMES.h"
 #include "../RVSDEF.h"
 
@@ -35,6 +37,11 @@ namespace Fuels
 		int* create_intermediate_table();
 		int* write_output_record(int* year, RVS::DataManagement::AnalysisPlot* ap);
 		int* write_intermediate_record(int* year, RVS::DataManagement::AnalysisPlot* ap, RVS::DataManagement::SppRecord* spp);
+		int* write_repeat_records(int* year, int* lastYear, RVS::DataManagement::AnalysisPlot* ap);
+		int* create_year_index(void);
+		int* create_fire_behavior_table(void);
+		// Writes the fire behavior of a plot with fuel model fbfm for one scenario, found in lane of results
+		int* write_fire_behavior_record(int* year, RVS::DataManagement::AnalysisPlot* ap, RVS::DataManagement::Symbol fbfm, const RVS::Fuels::FireScenario& scenario, const RVS::Fuels::FireResults& results, size_t lane);
 
 		//## Query functions ##//
 
@@ -44,7 +51,24 @@ namespace Fuels
 		RVS::DataManagement::DataTable* query_equation_table(int equationNumber);
 		RVS::DataManagement::DataTable* query_fbfm_rules_selector(void);
 		RVS::DataManagement::DataTable* query_fbfm_rules(std::string classTable);
-		
+		// Reads the classification rules in Fuel_ClassRules, one rule per row. Returns false
+		// if the input database has no such table.
+		bool query_fbfm_rule_table(std::vector<RVS::Fuels::FBFMRule>* rules);
+		// True if the input database has the Fuel_Crosswalk and Fuel_Equation tables
+		bool has_species_fuel_tables(void);
+		// Reads the 1, 10, 100 and 1000 hr equation numbers of a species from Fuel_Crosswalk.
+		// Missing columns or NULL values give 0. Returns false if the species has no row.
+		bool query_species_fuel_equations(std::string spp, int* equationNumbers);
+		// Reads the wind and moisture scenarios in Fire_Scenarios. Returns false if the input
+		// database has no such table.
+		bool query_fire_scenarios(std::vector<RVS::Fuels::FireScenario>* scenarios);
+
+		// SPECIES_FUELS, unless the input database lacks the species fuel tables. The driver
+		// and the intermediate table both follow this.
+		inline bool USES_SPECIES_FUELS() const { return speciesFuels; }
+
+	private:
+		bool speciesFuels;
 	};
 }
 }
@@ -1,9 +1,35 @@
 #include "FuelsDriver.h"
 
+
 RVS::Fuels::FuelsDriver::FuelsDriver(RVS::Fuels::FuelsDIO* fdio, bool suppress_messages)
 {
 	this->fdio = fdio;
 	this->suppress_messages = suppress_messages;
+
+	// Rules from the input database replace the built in ones
+	std::vector<FBFMRule> rules;
+	if (fdio->query_fbfm_rule_table(&rules) && !rules.empty())
+	{
+		classifier = std::make_shared<FBFMClassifier>(rules);
+	}
+	else
+	{
+		classifier = std::make_shared<FBFMClassifier>();
+	}
+
+	speciesFuels = fdio->USES_SPECIES_FUELS();
+	if (*SPECIES_FUELS && !speciesFuels)
+	{
+		fdio->write_debug_msg("Fuel_Crosswalk or Fuel_Equation not found, shrub fuels are partitioned from plot biomass");
+	}
+
+	fireBatchPlots = 0;
+	if (*FIRE_BEHAVIOR)
+	{
+		std::vector<FireScenario> scenarios;
+		fdio->query_fire_scenarios(&scenarios);
+		fireBehavior = std::make_shared<FireBehavior>(scenarios);
+	}
 }
 
 RVS::Fuels::FuelsDriver::~FuelsDriver()
@@ -13,6 +39,13 @@ RVS::Fuels::FuelsDriver::~FuelsDriver()
 
 int* RVS::Fuels::FuelsDriver::FuelsMain(int year, RVS::DataManagement::AnalysisPlot* ap)
 {
+	calcFuelLoads(year, ap);
+	return finishFuels(year, ap);
+}
+
+int* RVS::Fuels::FuelsDriver::calcFuelLoads(int year, RVS::DataManagement::AnalysisPlot* ap)
+{
+	RVS_TIME(RVS::DataManagement::STAGE_FUEL_LOADS);
 	this->ap = ap;
 
 	vector<RVS::DataManagement::SppRecord*>* shrubs = ap->SHRUB_RECORDS();
@@ -49,134 +82,212 @@ int* RVS::Fuels::FuelsDriver::FuelsMain(int year, RVS::DataManagement::AnalysisP
 
 	ap->total1HrFuel = ap->herbFuel + ap->shrub1HourWB + ap->shrub1HourFoliage;
 
-	if (ap->disturbed)
+	double pools[NUM_FUEL_POOLS];
+	if (speciesFuels && calcSpeciesFuels(pools))
 	{
-		applyDisturbance(year);
+		// The equations give 1 hr fuels as a whole, foliage keeps its partitioned share
+		double fine = prop1HrWB + prop1HrFol;
+		double foliageShare = fine > 0 ? prop1HrFol / fine : 0;
+		ap->shrub1HourFoliage = pools[POOL_1HR] * foliageShare;
+		ap->shrub1HourWB = pools[POOL_1HR] - ap->shrub1HourFoliage;
+		ap->shrub10Hour = pools[POOL_10HR];
+		ap->shrub100Hour = pools[POOL_100HR];
+		ap->shrub1000Hour = pools[POOL_1000HR];
+		ap->total1HrFuel = ap->herbFuel + ap->shrub1HourWB + ap->shrub1HourFoliage;
+
+		for (auto &s : *shrubs)
+		{
+			fdio->write_intermediate_record(&year, ap, s);
+		}
 	}
 
-	if (ap->FUEL_TOTAL() < 200)
+	return RC;
+}
+
+int* RVS::Fuels::FuelsDriver::finishFuels(int year, RVS::DataManagement::AnalysisPlot* ap)
+{
+	RVS_TIME(RVS::DataManagement::STAGE_FUEL_MODEL);
+	this->ap = ap;
+
+	ap->fbfmClass = classifier->classify(FBFMClassifier::totals(ap));
+	ap->fbfmName = FBFMClassifier::SYMBOL(ap->fbfmClass);
+
+	// Write out the total fuels record
+	RC = fdio->write_output_record(&year, ap);
+
+	if (fireBehavior && fireBatchPlots > 0)
 	{
-		ap->fbfmName = "NB";
+		queueFireBehavior(year);
 	}
-	else
+	else if (fireBehavior)
 	{
-		if (ap->ISDRY()) { ap->fbfmName = calcFBFMDry(); }
-		else { ap->fbfmName = calcFBFMHumid(); }
+		calcFireBehavior(year);
 	}
-
-	// Write out the total fuels record
-	RC = fdio->write_output_record(&year, ap);
 	return RC;
 }
 
 
 
-double RVS::Fuels::FuelsDriver::calcShrubFuel(int equationNumber, RVS::DataManagement::SppRecord* spp)
+double RVS::Fuels::FuelsDriver::calcShrubFuel(const RVS::Fuels::FuelEquation* equation, RVS::DataManagement::SppRecord* spp)
 {
-	// Declare return objects
-	string* paramNames = new string[3];
-	double* coefs = new double[4];
-	int* equationType = new int;
-	// Populate the equation parameters
-	fdio->query_equation_parameters(equationNumber, paramNames, coefs, equationType);
+	if (equation->number == 0) { return 0; }
+
+	double coefs[4] = { equation->coefs[0], equation->coefs[1], equation->coefs[2], equation->coefs[3] };
 	// Get the values of the parameters from the shrub record
-	double* params = new double[3];
-	for (int i = 0; i < paramNames->size(); i++)
+	double params[3] = { 0, 0, 0 };
+	for (int i = 0; i < 3; i++)
 	{
-		params[i] = spp->requestValue(paramNames[i]);
+		if (equation->params[i].empty()) { continue; }
+		params[i] = spp->requestValue(equation->params[i]);
 	}
 	// Calculate fuels
-	double fuel = RVS::Fuels::FuelsEquations::calcFuels(*equationType, coefs, params);
+	double fuel = RVS::Fuels::FuelsEquations::calcFuels(equation->type, coefs, params);
+	RVS_COUNT(RVS::DataManagement::COUNT_EQUATIONS, 1);
 	fuel = fuel * spp->stemsPerAcre;
 	return fuel;
 }
 
-string RVS::Fuels::FuelsDriver::calcFBFMDry()
+const RVS::Fuels::SpeciesFuels* RVS::Fuels::FuelsDriver::lookupSpeciesFuels(RVS::DataManagement::Symbol spp)
 {
-	double shrubRelativeFuel = (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB()) / ap->FUEL_TOTAL_1HR();
-	double herbRelativeFuel = ap->HERB_FUEL() / ap->FUEL_TOTAL_1HR();
+	map<RVS::DataManagement::Symbol, SpeciesFuels>::iterator it = speciesEquations.find(spp);
+	if (it != speciesEquations.end()) { return &it->second; }
 
-	string FBFM = "";
+	RVS_ALLOC_PAUSE();
+	SpeciesFuels fuels = SpeciesFuels();
+	int numbers[NUM_FUEL_POOLS] = { 0, 0, 0, 0 };
+	fuels.found = fdio->query_species_fuel_equations(RVS::DataManagement::SymbolTable::name(spp), numbers);
 
-	// First determine stand type
-	// SHRUB TYPE
-	if (shrubRelativeFuel >= .8)
-	{
-		if (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB() <= 1500) { FBFM = "SH1"; }
-		else if (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB() < 5000) { FBFM = "SH2"; }
-		else if (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB() + ap->SHRUB_10HR() + ap->SHRUB_100HR() <= 12000) { FBFM = "SH5"; }
-		else if (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB() + ap->SHRUB_10HR() + ap->SHRUB_100HR() > 12000) { FBFM = "SH7"; }
-		else { FBFM = "Unk1"; }
-	}
-	// GRASS TYPE
-	else if (herbRelativeFuel >= .8)
+	if (!fuels.found && spp != RVS::DataManagement::SymbolTable::intern(FUELS_BACKUP_SPP_CODE))
 	{
-		if (ap->HERB_FUEL() <= 1000) { FBFM = "GR1"; }
-		else if (ap->HERB_FUEL() <= 2500) { FBFM = "GR2"; }
-		else if (ap->HERB_FUEL() <= 7500) { FBFM = "GR4"; }
-		else if (ap->HERB_FUEL() > 7500) { FBFM = "GR7"; }
-		else { FBFM = "Unk3"; }
+		stringstream s;
+		s << "Fuel equations not found for " << RVS::DataManagement::SymbolTable::name(spp) << ", using " << FUELS_BACKUP_SPP_CODE;
+		fdio->write_debug_msg(s.str().c_str());
+
+		fuels = *lookupSpeciesFuels(RVS::DataManagement::SymbolTable::intern(FUELS_BACKUP_SPP_CODE));
 	}
-	// MIXED TYPE
 	else
 	{
-		//if (ap->FUEL_TOTAL() < 3000) { FBFM = "GS1"; }
-		//else if (ap->FUEL_TOTAL() > 3000) {	FBFM = "GS2"; }
-		if (ap->HERB_FUEL() <= 1000) { FBFM = "GS1"; }
-		else if (ap->HERB_FUEL() > 1000) { FBFM = "GS2"; }
-		else { FBFM = "Unk2"; }
-	}
-	
-	if (FBFM.compare("") == 0)
-	{
-		FBFM = "Unk7";
+		for (int p = 0; p < NUM_FUEL_POOLS; p++)
+		{
+			FuelEquation* equation = &fuels.pools[p];
+			equation->number = numbers[p];
+			if (equation->number == 0) { continue; }
+			fdio->query_equation_parameters(equation->number, equation->params, equation->coefs, &equation->type);
+		}
 	}
 
-	return FBFM;
+	return &speciesEquations.insert(pair<RVS::DataManagement::Symbol, SpeciesFuels>(spp, fuels)).first->second;
 }
 
-string RVS::Fuels::FuelsDriver::calcFBFMHumid()
+bool RVS::Fuels::FuelsDriver::calcSpeciesFuels(double* pools)
 {
-	double shrubRelativeFuel = (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB()) / ap->FUEL_TOTAL_1HR();
-	double herbRelativeFuel = ap->HERB_FUEL() / ap->FUEL_TOTAL_1HR();
-
-	string FBFM = "";
+	vector<RVS::DataManagement::SppRecord*>* shrubs = ap->SHRUB_RECORDS();
+	size_t count = shrubs->size();
+	if (count == 0) { return false; }
 
-	// First determine stand type
-	// SHRUB TYPE
-	if (shrubRelativeFuel >= .8)
+	// Resolve all the species first, then run each fuel class over every shrub
+	const SpeciesFuels** species = RVS::DataManagement::Arena::scratch()->allocateArray<const SpeciesFuels*>(count);
+	for (size_t i = 0; i < count; i++)
 	{
-		if (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB() <= 1000) { FBFM = "SH3"; }
-		else if (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB() + ap->SHRUB_10HR() + ap->SHRUB_100HR() < 5000) { FBFM = "SH4"; }
-		else if (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB() + ap->SHRUB_10HR() + ap->SHRUB_100HR() <= 9000) { FBFM = "SH6"; }
-		else if (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB() + ap->SHRUB_10HR() + ap->SHRUB_100HR() <= 5000) { FBFM = "SH8"; }
-		else if (ap->SHRUB_1HR_FOLIAGE() + ap->SHRUB_1HR_WB() > 5000) { FBFM = "SH9"; }
-		else { FBFM = "Unk1"; }
+		species[i] = lookupSpeciesFuels(shrubs->at(i)->SPP_CODE_ID());
+		if (!species[i]->found) { return false; }
 	}
-	// GRASS TYPE
-	else if (herbRelativeFuel >= .8)
+
+	double* fuels = RVS::DataManagement::Arena::scratch()->allocateArray<double>(count);
+	for (int p = 0; p < NUM_FUEL_POOLS; p++)
 	{
-		if (ap->HERB_FUEL() <= 4500) { FBFM = "GR3"; }
-		else if (ap->HERB_FUEL() <= 6000) { FBFM = "GR5"; }
-		else if (ap->HERB_FUEL() <= 8000) { FBFM = "GR6"; }
-		else if (ap->HERB_FUEL() <= 20000) { FBFM = "GR8"; }
-		else if (ap->HERB_FUEL() > 20000) { FBFM = "GR9"; }
-		else { FBFM = "Unk3"; }
+		pools[p] = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			fuels[i] = calcShrubFuel(&species[i]->pools[p], shrubs->at(i));
+			pools[p] += fuels[i];
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			RVS::DataManagement::SppRecord* s = shrubs->at(i);
+			s->fuelEqNums[p] = species[i]->pools[p].number;
+			switch (p)
+			{
+			case POOL_1HR: s->fuel1hr = fuels[i]; break;
+			case POOL_10HR: s->fuel10hr = fuels[i]; break;
+			case POOL_100HR: s->fuel100hr = fuels[i]; break;
+			default: s->fuel1000hr = fuels[i]; break;
+			}
+		}
 	}
-	// MIXED TYPE
-	else
+
+	return true;
+}
+
+void RVS::Fuels::FuelsDriver::calcFireBehavior(int year)
+{
+	// One lane per scenario, all run through the spread kernel together
+	size_t count = fireBehavior->NUM_SCENARIOS();
+	FuelBeds beds;
+	FireResults results;
+	FireBehavior::allocate(count, &beds, &results);
+	fireBehavior->setBeds(&beds, ap);
+	FireBehavior::spread(beds, &results);
+
+	for (size_t s = 0; s < count; s++)
 	{
-		if (ap->FUEL_TOTAL() < 5500) { FBFM = "GS3"; }
-		else if (ap->FUEL_TOTAL() > 3000) { FBFM = "GS4"; }
-		else { FBFM = "Unk2"; }
+		RC = fdio->write_fire_behavior_record(&year, ap, ap->FBFM_ID(), fireBehavior->SCENARIO(s), results, s);
 	}
+}
 
-	
-	if (FBFM.compare("") == 0)
+void RVS::Fuels::FuelsDriver::batchFireBehavior(size_t plots)
+{
+	flushFireBehavior();
+	fireBatchPlots = fireBehavior ? plots : 0;
+	pendingFires.clear();
+	pendingFires.reserve(fireBatchPlots);
+	fireLanes.assign(FireBehavior::LANE_DOUBLES * fireBatchPlots * (fireBehavior ? fireBehavior->NUM_SCENARIOS() : 0), 0);
+}
+
+void RVS::Fuels::FuelsDriver::queueFireBehavior(int year)
+{
+	if (pendingFires.size() == fireBatchPlots) { flushFireBehavior(); }
+
+	size_t scenarios = fireBehavior->NUM_SCENARIOS();
+	FuelBeds beds;
+	FireResults results;
+	FireBehavior::bind(fireLanes.data(), fireBatchPlots * scenarios, &beds, &results);
+	fireBehavior->setBeds(&beds, pendingFires.size() * scenarios, ap);
+
+	PendingFire pending = PendingFire();
+	pending.ap = ap;
+	pending.year = year;
+	pending.fbfm = ap->FBFM_ID();
+	pending.slot = RVS::DataManagement::DIO::WRITE_SLOT();
+	pendingFires.push_back(pending);
+}
+
+void RVS::Fuels::FuelsDriver::flushFireBehavior(void)
+{
+	if (pendingFires.empty()) { return; }
+
+	// Every scenario of every plot-year in the batch through the kernel at once
+	size_t scenarios = fireBehavior->NUM_SCENARIOS();
+	FuelBeds beds;
+	FireResults results;
+	FireBehavior::bind(fireLanes.data(), fireBatchPlots * scenarios, &beds, &results);
+	beds.count = pendingFires.size() * scenarios;
+	FireBehavior::spread(beds, &results);
+
+	// Rows go to the output slot each plot-year was running in
+	int slot = RVS::DataManagement::DIO::WRITE_SLOT();
+	for (size_t i = 0; i < pendingFires.size(); i++)
 	{
-		FBFM = "Unk8";
+		PendingFire* pending = &pendingFires[i];
+		RVS::DataManagement::DIO::begin_write_slot(pending->slot);
+		for (size_t s = 0; s < scenarios; s++)
+		{
+			RC = fdio->write_fire_behavior_record(&pending->year, pending->ap, pending->fbfm, fireBehavior->SCENARIO(s), results, i * scenarios + s);
+		}
 	}
-	return FBFM;
+	RVS::DataManagement::DIO::begin_write_slot(slot);
+	pendingFires.clear();
 }
 
 int RVS::Fuels::FuelsDriver::switchClimateFBFM(RVS::DataManagement::DataTable* dt, RVS::DataManagement::AnalysisPlot* ap)
@@ -250,87 +361,3 @@ double RVS::Fuels::FuelsDriver::calc1000HrFuel(double ht)
 	
 	return fs4;
 }
-
-void RVS::Fuels::FuelsDriver::applyDisturbance(int year)
-{
-	vector<RVS::Disturbance::DisturbAction> disturbances = ap->getDisturbancesForYear(year);
-	if (disturbances.empty()) { return; }
-
-	// Fire is handled in the DisturbanceDriver, so skip if fire
-	// $TODO this assumes fire is the only action (or first action) for the year
-	if (disturbances[0].getActionType().compare("FIRE") == 0) { return; }
-
-	// If it's a graze, go ahead and set up reduction ratios and priorities
-	double herbPreference = 0;
-	double shrubPreference = 0;
-
-	double totalCover = ap->HERBCOVER() + ap->SHRUBCOVER();
-	double herbAbundance = ap->HERBCOVER() / totalCover * 100;
-	double shrubAbundance = ap->SHRUBCOVER() / totalCover * 100;
-
-	// $TODO make the preferences dynamic
-	for (auto &d : disturbances)
-	{
-		if (d.getActionSubType().compare("COW") == 0)
-		{
-			herbPreference = 99;
-			shrubPreference = 1;
-		}
-		else
-		{
-			herbPreference = 50;
-			shrubPreference = 50;
-		}
-
-		double oldHerbBiomass = ap->herbFuel;
-		double oldShrubBiomass = ap->shrubBiomass;
-
-		double herbRatio = herbPreference * herbAbundance;
-		double shrubRatio = shrubPreference * shrubAbundance;
-		double herbsPerShrub = herbRatio / shrubRatio;
-
-		if (herbsPerShrub < 1)	{ herbsPerShrub = 1; }
-		double herbReduction = (1 - 1 / herbsPerShrub) * ap->biomassReductionTotal;
-		ap->herbFuel = ap->herbFuel - herbReduction;
-
-		double shrubBiomassReduction = (1 / herbsPerShrub) * ap->biomassReductionTotal;
-		if (ap->herbFuel < 0)
-		{
-			shrubBiomassReduction += ap->herbFuel * -1;
-			ap->herbFuel = 0.1;
-		}
-		ap->shrub1HourFoliage -= shrubBiomassReduction;
-		if (ap->shrub1HourFoliage < 0)
-		{
-			ap->shrub1HourWB += ap->shrub1HourFoliage;
-			ap->shrub1HourFoliage = 0.1;
-		}
-		if (ap->shrub1HourWB < 0)
-		{
-			ap->shrub10Hour += ap->shrub1HourWB;
-			ap->shrub1HourWB = 0.1;
-		}
-
-		if (ap->herbCover > 0)
-		{
-			double herbReductionRatio = ap->herbFuel / oldHerbBiomass;
-			ap->herbCover = ap->herbCover * herbReductionRatio;
-			if (ap->herbCover < 0) { ap->herbCover = 0.1; }
-			ap->herbHeight = ap->herbHeight * herbReductionRatio;
-			if (ap->herbHeight < 0) { ap->herbHeight = 0.1; }
-		}
-
-		double newShrubBiomass = ap->shrub1HourFoliage + ap->shrub1HourWB + ap->shrub10Hour + ap->shrub100Hour + ap->shrub1000Hour;
-		double shrubReductionRatio = newShrubBiomass / oldShrubBiomass;
-		double numShrubs = (double)ap->shrubRecords.size();
-		for (auto &s : ap->shrubRecords)
-		{
-			s->cover = s->cover * shrubReductionRatio;
-			if (s->cover < 0) { s->cover = 0.1; }
-		}
-
-		ap->herbBiomass = ap->herbFuel * ap->GRAMS_TO_POUNDS;
-		ap->shrubBiomass = newShrubBiomass;
-		ap->total1HrFuel = ap->herbFuel + ap->shrub1HourWB + ap->shrub1HourFoliage;
-	}
-}
\ No newline at end of file
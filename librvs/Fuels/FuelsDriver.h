@@ -10,26 +10,66 @@
 
 #include <iostream>
 #include <map>
+#include <memory>
 
 #include "../DataManagement/AnalysisPlot.h"
 #include "../Disturbance/DisturbAction.h"
+#include "FBFMClassifier.h"
+#include "FireBehavior.h"
 #include "FuelsDIO.h"
 #include "FuelsEquations.h"
 
 using namespace std;
 
+namespace RVS { namespace Tools { class Microbenchmarks; } }
+
 namespace RVS
 {
 namespace Fuels
 {
+	// Shrub fuel classes of the per species fuel mode, in Fuel_Crosswalk column order
+	enum FuelPool { POOL_1HR, POOL_10HR, POOL_100HR, POOL_1000HR, NUM_FUEL_POOLS };
+
+	// A Fuel_Equation record. Number 0 means the species has no equation for the class.
+	struct FuelEquation
+	{
+		int number;
+		int type;
+		double coefs[4];
+		std::string params[3];
+	};
+
+	// The fuel equations of one species, resolved the first time the species is seen
+	struct SpeciesFuels
+	{
+		bool found;
+		FuelEquation pools[NUM_FUEL_POOLS];
+	};
+
 	class FuelsDriver
 	{
+		friend class RVS::Tools::Microbenchmarks;
+
 	public:
 		FuelsDriver(RVS::Fuels::FuelsDIO* fdio, bool suppress_messages = false);
 		virtual ~FuelsDriver(void);
 
 		// Main fuels calculation function. Expects an AnalysisPlot object (with biomass information)
 		int* FuelsMain(int year, RVS::DataManagement::AnalysisPlot* ap);
+		// FuelsMain in two steps, so disturbances can change the fuel loads before the fuel
+		// model is assigned and the fuels are written
+		int* calcFuelLoads(int year, RVS::DataManagement::AnalysisPlot* ap);
+		int* finishFuels(int year, RVS::DataManagement::AnalysisPlot* ap);
+
+		// Gathers the fire behavior of up to plots plot-years into one batch of lanes, run
+		// through the spread kernel when it is full or flushed. 0 runs every plot-year on its own.
+		void batchFireBehavior(size_t plots);
+		// Runs and writes the batch. Call at the end of a year or of a worker's plots.
+		void flushFireBehavior(void);
+
+		inline const RVS::Fuels::FBFMClassifier* CLASSIFIER() { return classifier.get(); }
+		// NULL unless FIRE_BEHAVIOR is on
+		inline const RVS::Fuels::FireBehavior* FIRE_MODEL() { return fireBehavior.get(); }
 
 	private:
 		// Fuel Input/Output module
@@ -40,11 +80,40 @@ namespace Fuels
 		DataManagement::AnalysisPlot* ap;
 		
 		// Processes a record in the equation table to calculate a fuel value
-		double calcShrubFuel(int equationNumber, RVS::DataManagement::SppRecord* spp);
+		double calcShrubFuel(const RVS::Fuels::FuelEquation* equation, RVS::DataManagement::SppRecord* spp);
+
+		// Sum shrub fuels from the species equations. Off if the tables are missing.
+		bool speciesFuels;
+		std::map<RVS::DataManagement::Symbol, RVS::Fuels::SpeciesFuels> speciesEquations;
+		const RVS::Fuels::SpeciesFuels* lookupSpeciesFuels(RVS::DataManagement::Symbol spp);
+		// Evaluates every shrub's fuel equations and sums the pools (g/ac) of the plot.
+		// False if a species has no equations, the plot then keeps the partitioned fuels.
+		bool calcSpeciesFuels(double* pools);
 
-		// Current FBFM
-		string calcFBFMDry();
-		string calcFBFMHumid();
+		// Assigns the FBFM. Read only once built, so copies of the driver share it.
+		std::shared_ptr<RVS::Fuels::FBFMClassifier> classifier;
+		// Scenarios and the fuel model table, shared the same way
+		std::shared_ptr<RVS::Fuels::FireBehavior> fireBehavior;
+
+		// Runs every fire scenario on the plot's fuels and writes the results
+		void calcFireBehavior(int year);
+
+		// A plot-year in the fire batch. Its beds are filled when it is added, the plot may
+		// have moved on by the time the batch runs.
+		struct PendingFire
+		{
+			RVS::DataManagement::AnalysisPlot* ap;
+			int year;
+			RVS::DataManagement::Symbol fbfm;
+			int slot;
+		};
+		size_t fireBatchPlots;
+		std::vector<PendingFire> pendingFires;
+		// FireBehavior::LANE_DOUBLES per lane, laid out again by each user so copies of the
+		// driver don't point into each other's batch
+		std::vector<double> fireLanes;
+		// Adds the plot-year to the batch, running it first if it is full
+		void queueFireBehavior(int year);
 
 		int switchClimateFBFM(RVS::DataManagement::DataTable* dt, RVS::DataManagement::AnalysisPlot* ap);
 
@@ -55,8 +124,6 @@ namespace Fuels
 		double calc10HrFuel(double biomass);
 		double calc100HrFuel(double biomass);
 		double calc1000HrFuel(double height);
-
-		void applyDisturbance(int year);
 	};
 }
 }
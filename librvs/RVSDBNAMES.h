@@ -22,11 +22,21 @@ namespace RVS
 	static const char* FUEL_EQUATION_TABLE = "Fuel_Equation";
 	static const char* FUEL_BPS_ATTR_TABLE = "BPS_Fuelmodels";
 	static const char* FUEL_CLASSRULES_TABLE = "Fuel_ClassRules";
+	static const char* FUEL_CROSSWALK_1HR_FIELD = "F1HR_EQ";
+	static const char* FUEL_CROSSWALK_10HR_FIELD = "F10HR_EQ";
+	static const char* FUEL_CROSSWALK_100HR_FIELD = "F100HR_EQ";
+	static const char* FUEL_CROSSWALK_1000HR_FIELD = "F1000HR_EQ";
+	static const char* FIRE_SCENARIO_TABLE = "Fire_Scenarios";
 	static const char* SUCCESSION_TABLE = "BPS_Combined_Growthrates";
 	static const char* PLANTS_TABLE = "Plants";
 	static const char* HERB_GROWTH_TABLE = "Herb_Growth";
 	static const char* DISTURBANCE_PLOT_TABLE = "Dist_year7fire";
 	static const char* DISTURBANCE_TABLE = "Disturbance";
+	static const char* GRAZING_PASTURE_TABLE = "Grazing_Pastures";
+	static const char* FIRE_MORTALITY_TABLE = "Fire_Mortality";
+	static const char* FIRE_CONSUMPTION_TABLE = "Fire_Consumption";
+	static const char* GRAZING_HERD_TABLE = "Grazing_Herds";
+	static const char* OBSERVATION_TABLE = "Plot_Observations";
 	// ********************
 
 	// Field names (primarily from input)
@@ -80,6 +90,34 @@ namespace RVS
 	static const char* DIST_VAL1_NAME_FIELD = "P1_NAME";
 	static const char* DIST_VAL2_NAME_FIELD = "P2_NAME";
 	static const char* DIST_VAL3_NAME_FIELD = "P3_NAME";
+	// Optional animal class columns of the Disturbance table, read for GRAZE rows
+	static const char* DIST_INTAKE_FIELD = "INTAKE";
+	static const char* DIST_HERB_PREFERENCE_FIELD = "HERB_PREF";
+	static const char* DIST_SHRUB_PREFERENCE_FIELD = "SHRUB_PREF";
+	static const char* DIST_HERB_UTILIZATION_FIELD = "HERB_UTIL";
+	static const char* DIST_SHRUB_UTILIZATION_FIELD = "SHRUB_UTIL";
+	// Pasture rotation. Plot AREA in acres, herd LENGTH in days a year, UTIL_LIMIT 0-1.
+	static const char* PASTURE_FIELD = "PASTURE";
+	static const char* ALLOTMENT_FIELD = "ALLOTMENT";
+	static const char* PASTURE_AREA_FIELD = "AREA";
+	static const char* HERD_NUMBER_FIELD = "NUMBER";
+	static const char* HERD_LENGTH_FIELD = "LENGTH";
+	static const char* HERD_UTIL_LIMIT_FIELD = "UTIL_LIMIT";
+	// Fire effects by severity (1-3). Shares 0-1.
+	static const char* FIRE_SEVERITY_FIELD = "severity";
+	static const char* FIRE_MORTALITY_FIELD = "mortality";
+	static const char* FIRE_RESPROUT_FIELD = "resprout";
+	static const char* FIRE_CONSUMED_HERB_FIELD = "c_herb";
+	static const char* FIRE_CONSUMED_1HR_FIELD = "c_1hr";
+	static const char* FIRE_CONSUMED_10HR_FIELD = "c_10hr";
+	static const char* FIRE_CONSUMED_100HR_FIELD = "c_100hr";
+	static const char* FIRE_CONSUMED_1000HR_FIELD = "c_1000hr";
+	// Remeasured plots, one row per plot and simulation year. Values as in the output tables,
+	// NULL when not measured.
+	static const char* OBS_YEAR_FIELD = "year";
+	static const char* OBS_SHRUB_COVER_FIELD = "obs_shrub_cov";
+	static const char* OBS_SHRUB_HEIGHT_FIELD = "obs_shrub_ht";
+	static const char* OBS_SHRUB_BIOMASS_FIELD = "obs_shrub_bio";
 
 
 	// ********************
@@ -107,6 +145,23 @@ namespace RVS
 	static const char* FC_PROPORTION_UPPER = "proportion_upper";
 	static const char* FC_TOTAL_FUEL_LOWER = "total_fuel_lower";
 	static const char* FC_TOTAL_FUEL_UPPER = "total_fuel_upper";
+	static const char* FC_HERB_PROPORTION_LOWER = "herb_proportion_lower";
+	static const char* FC_HERB_PROPORTION_UPPER = "herb_proportion_upper";
+	static const char* FC_SHRUB_FINE_FUEL_LOWER = "shrub_fine_fuel_lower";
+	static const char* FC_SHRUB_FINE_FUEL_UPPER = "shrub_fine_fuel_upper";
+	// Optional comparison of a bound, in the bound's column name + suffix ("HT_upper_op").
+	// ">=" or ">" for lower bounds, "<" or "<=" for upper bounds.
+	static const char* FC_BOUND_OP_SUFFIX = "_op";
+
+	// Fire behavior scenarios. Wind in mph at midflame, slope and moistures in %
+	static const char* FS_NAME_FIELD = "scenario";
+	static const char* FS_WIND_FIELD = "wind_speed";
+	static const char* FS_SLOPE_FIELD = "slope";
+	static const char* FS_MOISTURE_1HR_FIELD = "m_1hr";
+	static const char* FS_MOISTURE_10HR_FIELD = "m_10hr";
+	static const char* FS_MOISTURE_100HR_FIELD = "m_100hr";
+	static const char* FS_MOISTURE_HERB_FIELD = "m_herb";
+	static const char* FS_MOISTURE_WOODY_FIELD = "m_woody";
 
 	// ********************
 
@@ -122,6 +177,8 @@ namespace RVS
 	static const char* SUCCESSION_SPECIES_3_FIELD = "Species3";
 	static const char* SUCCESSION_SPECIES_4_FIELD = "Species4";
 	static const char* SUCCESSION_CLASS_FIELD = "sclass";
+	static const char* SUCCESSION_GR_HT_FIELD = "GR_HT";
+	static const char* SUCCESSION_GR_COV_FIELD = "GR_COV";
 
 	// ********************
 
@@ -130,8 +187,11 @@ namespace RVS
 	static const char* BIOMASS_INTERMEDIATE_TABLE = "Biomass_Output_Spp";
 	static const char* FUELS_OUTPUT_TABLE = "Fuels_Output";
 	static const char* FUELS_INTERMEDIATE_TABLE = "Fuels_Output_Spp";
+	static const char* FIRE_BEHAVIOR_OUTPUT_TABLE = "Fire_Behavior_Output";
 	static const char* DISTURBANCE_OUTPUT_TABLE = "Disturbance_Output";
 	static const char* DISTURBANCE_INTERMEDIATE_TABLE = "Disturbance_Output_Spp";
+	static const char* GRAZING_ROTATION_OUTPUT_TABLE = "Grazing_Rotation_Output";
+	static const char* CALIBRATION_OUTPUT_TABLE = "Calibrated_Growthrates";
 	// ********************
 
 	// Output table fields
@@ -151,6 +211,11 @@ namespace RVS
 	static const char* FUEL_100HR_FIELD = "fuel_100hr";
 	static const char* FUEL_1000HR_FIELD = "fuel_1000hr";
 	static const char* FUEL_TOTAL_FIELD = "total_fuels";
+	static const char* FB_REACTION_INTENSITY_FIELD = "reaction_intensity";  // BTU/ft2/min
+	static const char* FB_SPREAD_RATE_FIELD = "spread_rate";  // ch/h
+	static const char* FB_FIRELINE_INTENSITY_FIELD = "fireline_intensity";  // BTU/ft/s
+	static const char* FB_FLAME_LENGTH_FIELD = "flame_length";  // ft
+	static const char* FB_HEAT_PER_AREA_FIELD = "heat_per_area";  // BTU/ft2
 	static const char* UPPER_BOUND_FIELD = "upper_bound";
 	static const char* LOWER_BOUND_FIELD = "lower_bound";
 	static const char* S2Y_FIELD = "s2y";
@@ -166,6 +231,9 @@ namespace RVS
 	static const char* DISTURBANCE_HERB_FIELD = "herb_disturbance";
 	static const char* DISTURBANCE_SHRUB_FIELD = "shrub_disturbance";
 	static const char* DISTURBANCE_AMOUNT_FIELD = "disturbance_amount";
+	static const char* ROTATION_DAYS_FIELD = "days";
+	static const char* ROTATION_FORAGE_FIELD = "forage";  // lbs
+	static const char* ROTATION_UTILIZATION_FIELD = "utilization";
 
 	// ********************
 }
@@ -4,7 +4,44 @@
 
 #pragma once
 
-extern int* RC;
+#include <string>
+
+#ifndef USEMULTIT
+	#define USEMULTIT 0
+#endif
+
+// Count heap allocations per thread and check the yearly loop of fast forwarded
+// plots for them (see DataManagement/AllocationCounter.h). Test builds only.
+#ifndef RVS_COUNT_ALLOCS
+	#define RVS_COUNT_ALLOCS 0
+#endif
+
+// Time the simulation stages and count plot-years, equations and SQL statements, and
+// report them at the end of the run (see DataManagement/Instrumentation.h)
+#ifndef RVS_INSTRUMENT
+	#define RVS_INSTRUMENT 0
+#endif
+
+// Record a timeline of years, plot chunks, stages and output writing and save it as a
+// Chrome trace at the end of the run (see DataManagement/TraceRecorder.h)
+#ifndef RVS_TRACE
+	#define RVS_TRACE 0
+#endif
+
+// Profile the SQL statements of the input and output databases and check the input
+// queries a simulation thread repeats against a budget (see DataManagement/SqlProfiler.h)
+#ifndef RVS_PROFILE_SQL
+	#define RVS_PROFILE_SQL 0
+#endif
+
+// Globals that every simulation thread keeps its own copy of
+#if USEMULTIT
+	#define RVS_THREAD_LOCAL thread_local
+#else
+	#define RVS_THREAD_LOCAL
+#endif
+
+extern RVS_THREAD_LOCAL int* RC;
 extern int* YEARS;
 extern std::string* CLIMATE;
 extern bool* SUPPRESS_MSG;
@@ -13,6 +50,11 @@ extern char* OUT_DB_PATH;
 extern const int* runmode;
 extern const char* DEBUG_FILE;
 extern bool* USE_MEM;
+extern bool* FAST_FORWARD;
+extern bool* SPECIES_FUELS;
+extern bool* FIRE_BEHAVIOR;
+extern bool* STOCHASTIC_FIRE;
+extern unsigned int* ENSEMBLE_SEED;
 
 // OS-specific includes
 #define WIN 0
@@ -25,8 +67,3 @@ extern bool* USE_MEM;
 	#define WIN 1
 #elif __linux
 #endif
-
-
-#ifndef USEMULTIT
-	#define USEMULTIT 0
-#endif
@@ -0,0 +1,90 @@
+#include "Recolonization.h"
+
+#include <algorithm>
+
+using RVS::DataManagement::AnalysisPlot;
+using RVS::DataManagement::SeedSource;
+using RVS::Succession::Recolonization;
+
+// Plots below this shrub cover (%) look for seed sources and are not seed sources themselves
+static const double RECOLONIZE_COVER = 1;
+// Species kept per plot, as many as a succession stage lists
+static const size_t MAX_SOURCES = 4;
+
+Recolonization::Recolonization(std::vector<AnalysisPlot*> plots, double radiusKm)
+	: plots(plots), index(plots, radiusKm)
+{
+	this->radiusKm = radiusKm;
+	searched = 0;
+}
+
+Recolonization::~Recolonization(void)
+{
+
+}
+
+bool Recolonization::recolonizing(size_t i)
+{
+	AnalysisPlot* ap = plots[i];
+	if (ap->shrubCover >= RECOLONIZE_COVER) { return false; }
+	// A plot that had sources keeps looking until its cover recovered, fires leave the burned
+	// flag for one year only
+	return ap->burned || ap->shrubRecords.empty() || !ap->seedSources.empty();
+}
+
+void Recolonization::update(void)
+{
+	// Plots to search this year
+	std::vector<size_t> targets;
+	for (size_t i = 0; i < plots.size(); i++)
+	{
+		if (recolonizing(i)) { targets.push_back(i); }
+		else if (!plots[i]->seedSources.empty()) { plots[i]->seedSources.clear(); }
+	}
+	searched = targets.size();
+
+	std::vector<SeedSource> sources;
+	for (auto &i : targets)
+	{
+		sources.clear();
+		double weights = 0;
+
+		index.forEachNeighbor(i, radiusKm, [this, &sources, &weights](size_t j, double distance)
+		{
+			// Seed falls off with distance, to nothing at the edge of the radius
+			double weight = 1 - distance / radiusKm;
+			weights += weight;
+			AnalysisPlot* neighbor = plots[j];
+			if (neighbor->shrubCover < RECOLONIZE_COVER) { return; }
+
+			for (auto &s : neighbor->shrubRecords)
+			{
+				RVS::DataManagement::Symbol species = s->SPP_CODE_ID();
+				std::vector<SeedSource>::iterator it = std::find_if(sources.begin(), sources.end(),
+					[species](const SeedSource& source) { return source.species == species; });
+				if (it == sources.end())
+				{
+					SeedSource source = SeedSource();
+					source.species = species;
+					source.cover = 0;
+					sources.push_back(source);
+					it = sources.end() - 1;
+				}
+				it->cover += weight * s->COVER();
+			}
+		});
+
+		if (weights <= 0) { sources.clear(); }
+		for (auto &s : sources)
+		{
+			s.cover /= weights;
+		}
+		std::stable_sort(sources.begin(), sources.end(), [](const SeedSource& a, const SeedSource& b)
+		{
+			return a.cover > b.cover;
+		});
+		if (sources.size() > MAX_SOURCES) { sources.resize(MAX_SOURCES); }
+
+		plots[i]->seedSources = sources;
+	}
+}
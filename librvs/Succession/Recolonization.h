@@ -0,0 +1,53 @@
+/// ********************************************************** ///
+/// Name: Recolonization.h                                     ///
+/// Desc: Seed sources of plots that lost their shrubs. Once a ///
+/// year, every burned or shrubless plot looks up the shrub    ///
+/// cover surviving on plots within a radius, through a        ///
+/// SpatialIndex built once over the plot coordinates. Nearer  ///
+/// plots weigh more. A plot keeps its sources until its own   ///
+/// cover recovered.                                           ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef RECOLONIZATION_H
+#define RECOLONIZATION_H
+
+#include <vector>
+
+#include "../DataManagement/AnalysisPlot.h"
+#include "../DataManagement/SpatialIndex.h"
+
+namespace RVS
+{
+namespace Succession
+{
+	class Recolonization
+	{
+	public:
+		Recolonization(std::vector<RVS::DataManagement::AnalysisPlot*> plots, double radiusKm);
+		virtual ~Recolonization(void);
+
+		// Sets the seed sources of every plot for the coming year. Reads the shrubs of the
+		// neighbors, so it runs once all plots finished the year.
+		void update(void);
+
+		inline double RADIUS_KM() { return radiusKm; }
+		// Plots searched by the last update
+		inline size_t NUM_SEARCHED() { return searched; }
+
+	private:
+		std::vector<RVS::DataManagement::AnalysisPlot*> plots;
+		RVS::DataManagement::SpatialIndex index;
+		double radiusKm;
+		size_t searched;
+
+		// Plot at index i needs seed sources: it burned or lost its shrubs, or had sources the
+		// year before, and is still below the recolonization cover
+		bool recolonizing(size_t i);
+	};
+}
+}
+
+#endif
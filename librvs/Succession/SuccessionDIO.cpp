@@ -1,7 +1,11 @@
 #include "SuccessionDIO.h"
 
+#include <algorithm>
+#include <cmath>
+
 RVS::Succession::SuccessionDIO::SuccessionDIO(void) : RVS::DataManagement::DIO()
 {
+	queryStage = RVS::DataManagement::STAGE_QUERY_SUCCESSION;
 	this->create_output_table();
 	this->create_intermediate_table();
 }
@@ -13,7 +17,7 @@ RVS::Succession::SuccessionDIO::~SuccessionDIO(void)
 
 int* RVS::Succession::SuccessionDIO::create_output_table()
 {
-	std::stringstream sqlstream;
+	std::ostream& sqlstream = begin_write();
 	sqlstream << "CREATE TABLE " << "Succession_Output" << "(" << \
 		PLOT_NUM_FIELD << " INTEGER NOT NULL, " << \
 		PLOT_NAME_FIELD << " TEXT, " << \
@@ -23,16 +27,15 @@ int* RVS::Succession::SuccessionDIO::create_output_table()
 		"COHORT_TYPE" << " TEXT, " << \
 		"PLOT_AGE" << " REAL);";
 
-	char* sql = new char;
-	sql = streamToCharPtr(&sqlstream);
-	queuedWrites.push_back(sql);
+	queue_write();
 
 	return RC;
 }
 
 int* RVS::Succession::SuccessionDIO::write_output_record(int* year, RVS::DataManagement::AnalysisPlot* ap)
 {
-	std::stringstream sqlstream;
+	if (WRITES_DISCARDED()) { return RC; }
+	std::ostream& sqlstream = begin_write();
 	sqlstream << "INSERT INTO " << "Succession_Output" << " (" << \
 		PLOT_NUM_FIELD << ", " << \
 		PLOT_NAME_FIELD << ", " << \
@@ -50,9 +53,7 @@ int* RVS::Succession::SuccessionDIO::write_output_record(int* year, RVS::DataMan
 		ap->CURRENT_STAGE_TYPE() << "\"," << \
 		ap->PLOT_AGE() << ");";
 
-	char* sql = new char;
-	sql = streamToCharPtr(&sqlstream);
-	queuedWrites.push_back(sql);
+	queue_write();
 
 	return RC;
 }
@@ -70,18 +71,29 @@ int* RVS::Succession::SuccessionDIO::write_intermediate_record(int* year, RVS::D
 	return RC;
 }
 
-RVS::DataManagement::DataTable* RVS::Succession::SuccessionDIO::query_succession_table(string bps_model_code)
+int* RVS::Succession::SuccessionDIO::write_repeat_records(int* year, int* lastYear, RVS::DataManagement::AnalysisPlot* ap)
+{
+	write_repeat_record("Succession_Output", ap->PLOT_ID(), *year, *lastYear, "PLOT_AGE");
+	return RC;
+}
+
+int* RVS::Succession::SuccessionDIO::create_year_index(void)
+{
+	return index_by_year("Succession_Output");
+}
+
+RVS::DataManagement::DataTable* RVS::Succession::SuccessionDIO::query_succession_table(string bps_model_code, bool firstCohort)
 {
 	const char* sql = query_base(SUCCESSION_TABLE, "BPS_MODEL", bps_model_code, "COHORT");
-	RVS::DataManagement::DataTable* dt = prep_datatable(sql, rvsdb);
+	RVS::DataManagement::DataTable* dt = prep_datatable(sql, rvsdb, true, firstCohort);
 	return dt;
 }
 
-bool RVS::Succession::SuccessionDIO::get_succession_data(string bps_model_code, std::map<string, string>* stringVals, std::map<string, double>* numVals, bool* doNotModel)
+bool RVS::Succession::SuccessionDIO::get_succession_data(string bps_model_code, std::map<string, string>* stringVals, std::map<string, double>* numVals, bool* doNotModel, bool firstCohort)
 {
 	RVS::DataManagement::DataTable* succDt;
 
-	succDt = query_succession_table(bps_model_code);
+	succDt = query_succession_table(bps_model_code, firstCohort);
 
 	double cohort;
 	getVal(succDt->getStmt(), succDt->Columns["COHORT"], &cohort);
@@ -154,13 +166,16 @@ bool RVS::Succession::SuccessionDIO::get_succession_data(string bps_model_code,
 
 	bool last_stage = false;
 
+	// The driver caches a model's cohorts, so the query is not stepped again after the last one
 	if (strcmp(cover_type.c_str(), "Late") == 0)
 	{
 		last_stage = true;
 		*RC = sqlite3_reset(succDt->getStmt());
 	}
-
-	*RC = sqlite3_step(succDt->getStmt());
+	else
+	{
+		*RC = sqlite3_step(succDt->getStmt());
+	}
 
 	return last_stage;
 }
@@ -220,16 +235,50 @@ void RVS::Succession::SuccessionDIO::query_herb_growth_coefs(string bps_model, d
 	}
 	else
 	{
-		stringstream* s = new stringstream();
-		*s << "Herb growth not found for BPS " << bps_model << ", using defaults";
-		const char* c = streamToCharPtr(s);
-		write_debug_msg(c);
+		stringstream s;
+		s << "Herb growth not found for BPS " << bps_model << ", using defaults";
+		write_debug_msg(s.str().c_str());
 
 		*cov_rate = 0.020334387;
 		*ht_rate = 0.000419084;
 	}
 }
 
+bool RVS::Succession::SuccessionDIO::query_observations(std::map<int, std::vector<PlotObservation>>* observations)
+{
+	if (!table_exists(OBSERVATION_TABLE)) { return false; }
+
+	std::stringstream ss;
+	ss << "SELECT * FROM " << OBSERVATION_TABLE << " ORDER BY " << PLOT_NUM_FIELD << ", " << OBS_YEAR_FIELD << ";";
+	RVS::DataManagement::DataTable* dt = prep_datatable(scratchCharPtr(&ss), rvsdb, true, true);
+	sqlite3_stmt* stmt = dt->getStmt();
+
+	// Measurements a table leaves out, or leaves NULL, are not compared
+	const char* fields[] = { OBS_SHRUB_COVER_FIELD, OBS_SHRUB_HEIGHT_FIELD, OBS_SHRUB_BIOMASS_FIELD };
+	while (*dt->STATUS() == SQLITE_ROW)
+	{
+		int plotId = 0;
+		PlotObservation o = PlotObservation();
+		getVal(stmt, dt->Columns[PLOT_NUM_FIELD], &plotId);
+		getVal(stmt, dt->Columns[OBS_YEAR_FIELD], &o.year);
+
+		double* values[] = { &o.shrubCover, &o.shrubHeight, &o.shrubBiomass };
+		for (int f = 0; f < 3; f++)
+		{
+			*values[f] = NAN;
+			if (dt->Columns.count(fields[f]) > 0 && sqlite3_column_type(stmt, dt->Columns[fields[f]]) != SQLITE_NULL)
+			{
+				*values[f] = sqlite3_column_double(stmt, dt->Columns[fields[f]]);
+			}
+		}
+
+		(*observations)[plotId].push_back(o);
+		*dt->STATUS() = sqlite3_step(stmt);
+	}
+
+	return true;
+}
+
 double** RVS::Succession::SuccessionDIO::query_covariance_matrix()
 {
 	const char* sql = query_base(COVARIANCE_TABLE);
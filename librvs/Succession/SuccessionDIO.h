@@ -7,7 +7,9 @@
 #ifndef SUCCESSIONDIO_H
 #define SUCCESSIONDIO_H
 
+#include <map>
 #include <string>
+#include <vector>
 
 #include <boost/any.hpp>
 
@@ -23,6 +25,15 @@ namespace RVS
 {
 namespace Succession
 {
+	// Remeasured values of a plot after a simulation year, NAN where not measured
+	struct PlotObservation
+	{
+		int year;
+		double shrubCover;
+		double shrubHeight;
+		double shrubBiomass;
+	};
+
 	class SuccessionDIO :
 		public RVS::DataManagement::DIO
 	{
@@ -35,9 +46,12 @@ namespace Succession
 		int* create_intermediate_table();
 		int* write_output_record(int* year, RVS::DataManagement::AnalysisPlot* ap);
 		int* write_intermediate_record(int* year, RVS::DataManagement::AnalysisPlot* ap, RVS::DataManagement::SppRecord* record);
+		int* write_repeat_records(int* year, int* lastYear, RVS::DataManagement::AnalysisPlot* ap);
+		int* create_year_index(void);
 
 		//## Query functions ##//
-		bool get_succession_data(string bps_model_code, std::map<string, string>* stringVals, std::map<string, double>* numVals, bool* doNotModel);
+		// Reads the next cohort of the model, firstCohort starts over from its first one
+		bool get_succession_data(string bps_model_code, std::map<string, string>* stringVals, std::map<string, double>* numVals, bool* doNotModel, bool firstCohort);
 
 		bool check_shrub_data_exists(string spp_code);
 		bool check_code_is_shrub(string spp_code);
@@ -46,8 +60,12 @@ namespace Succession
 		double** query_covariance_matrix();
 
 		void query_herb_growth_coefs(string bps_model, double* cov_rate, double* ht_rate);
+
+		// Observations of every remeasured plot by PLOT_ID, ordered by year. False if the
+		// table is not in the database.
+		bool query_observations(std::map<int, std::vector<PlotObservation>>* observations);
 	private:
-		RVS::DataManagement::DataTable* query_succession_table(string bps_model_code);
+		RVS::DataManagement::DataTable* query_succession_table(string bps_model_code, bool firstCohort);
 	};
 }
 }
@@ -1,12 +1,20 @@
 #include "SuccessionDriver.h"
 
+#include <cmath>
+
 using RVS::Succession::SuccessionDriver;
 double** RVS::Succession::SuccessionDriver::covariance_matrix = 0;
 
+// Cohort types the driver compares against
+static const RVS::DataManagement::Symbol COHORT_SHRUB = RVS::DataManagement::SymbolTable::intern("S");
+static const RVS::DataManagement::Symbol COHORT_HERB = RVS::DataManagement::SymbolTable::intern("H");
+static const RVS::DataManagement::Symbol COHORT_UNKNOWN = RVS::DataManagement::SymbolTable::intern("U");
+
 SuccessionDriver::SuccessionDriver(RVS::Succession::SuccessionDIO* sdio, bool suppress_messages)
 {
 	this->sdio = sdio;
 	this->suppress_messages = suppress_messages;
+	this->scales = DEFAULT_SCALES;
 
 	SuccessionDriver::covariance_matrix = sdio->query_covariance_matrix();
 }
@@ -18,6 +26,8 @@ SuccessionDriver::~SuccessionDriver(void)
 
 int* SuccessionDriver::SuccessionMain(int year, string* climate, RVS::DataManagement::AnalysisPlot* ap)
 {
+	RVS_TIME(RVS::DataManagement::STAGE_SUCCESSION);
+	RVS_COUNT(RVS::DataManagement::COUNT_PLOT_YEARS, 1);
 	this->ap = ap;
 	this->shrubs = ap->SHRUB_RECORDS();
 	this->climate = climate;
@@ -27,26 +37,37 @@ int* SuccessionDriver::SuccessionMain(int year, string* climate, RVS::DataManage
 	//const char* c = sdio->streamToCharPtr(s);
 	//sdio->write_debug_msg(c);
 	
+	// Plots with a planned trajectory skip the stage logic entirely
+	if (ap->trajectory != NULL && ap->trajectory->covers(year))
+	{
+		return fastForwardMain(year);
+	}
+
 	// TRUE: Do not model // FALSE: Model
-	bool* doNotModel = new bool(false);
+	bool doNotModel = false;
 
 	// Load the (up to) 3 succession stages' values
-	loadSuccessionVals(doNotModel);
+	loadSuccessionVals(&doNotModel);
+
+	if (*FAST_FORWARD && ap->trajectory == NULL && canFastForward() && planFastForward(year))
+	{
+		return fastForwardMain(year);
+	}
 	
 	// Calculate herbaceous production
-	double* yhat = new double;
-	double* lower = new double;
-	double* upper = new double;
+	double yhat = 0;
+	double lower = 0;
+	double upper = 0;
 	double production = 0;
 
 	
-	*yhat = calcProduction(year);
-	calcConfidence(year, *yhat, lower, upper, 0);
-	production = exp(*yhat) * SMEAR;
+	yhat = calcProduction(year);
+	calcConfidence(year, yhat, &lower, &upper, 0);
+	production = exp(yhat) * SMEAR;
 	
 	ap->primaryProduction = production;
-	ap->lower_confidence = *lower;
-	ap->upper_confidence = *upper;
+	ap->lower_confidence = lower;
+	ap->upper_confidence = upper;
 	
 	// Get the current succession stage. Values are 0-3, with 0 indicating not yet classified
 	// and -1 indicating uncharacteristic (unclassifiable) plot
@@ -74,32 +95,31 @@ int* SuccessionDriver::SuccessionMain(int year, string* climate, RVS::DataManage
 
 	if (sclass == -1 || sclass == -99)
 	{
-		if (*doNotModel)
+		if (doNotModel)
 		{
-			stringstream* s = new stringstream();
-			*s << "PLOT_ID: " << ap->PLOT_ID() << ". RVS does not model this BPS.";
-			const char* c = sdio->streamToCharPtr(s);
-			sdio->write_debug_msg(c);
+			stringstream s;
+			s << "PLOT_ID: " << ap->PLOT_ID() << ". RVS does not model this BPS.";
+			sdio->write_debug_msg(s.str().c_str());
 			ap->currentStage = -99;
 		}
 
 		ap->plotAge += 1;
-		ap->currentStageType = "U";
+		ap->currentStageType = COHORT_UNKNOWN;
 
 		sdio->write_output_record(&year, ap);
 		return RC;
 	}
 
-	// When using sclass to get parameters, remember stages are (1-3) but array is (0-2)
-	ap->currentStageType = successionStrParameters[sclass - 1]["cohort_type"];
+	// When using sclass to get parameters, remember stages are (1-3) but array is (0-2).
+	// The cohort type was interned when the model's cohorts were cached.
+	ap->currentStageType = successionStages[sclass - 1].cohortType;
 
 	// Check if this type of succession stage is even supported
-	if (ap->currentStageType.compare("S") != 0 && ap->currentStageType.compare("H") != 0)
+	if (ap->currentStageType != COHORT_SHRUB && ap->currentStageType != COHORT_HERB)
 	{
-		stringstream* s = new stringstream();
-		*s << "PLOT_ID: " << ap->PLOT_ID() << ". Not a S or H plot. RVS does not model (grow shrubs).";
-		const char* c = sdio->streamToCharPtr(s);
-		sdio->write_debug_msg(c);
+		stringstream s;
+		s << "PLOT_ID: " << ap->PLOT_ID() << ". Not a S or H plot. RVS does not model (grow shrubs).";
+		sdio->write_debug_msg(s.str().c_str());
 	}
 
 	// get rounded midpoint year for stage
@@ -144,13 +164,7 @@ int* SuccessionDriver::SuccessionMain(int year, string* climate, RVS::DataManage
 	growHerbs(&(ap->herbCover), &(ap->herbHeight), &(ap->primaryProduction));
 	
 	// attenuate shrubs and herbs(if sum(cover) > 100, find ratio and reduce)
-	if (ap->herbCover + ap->shrubCover > 100)
-	{
-		double total = ap->herbCover + ap->shrubCover;
-		ap->herbCover = (ap->herbCover / total) * 100;
-		ap->shrubCover = (ap->shrubCover / total) * 100;
-	}
-
+	attenuateCover();
 	
 	ap->currentStage = sclass;
 
@@ -169,8 +183,16 @@ int* SuccessionDriver::SuccessionMain(int year, string* climate, RVS::DataManage
 
 void SuccessionDriver::loadSuccessionVals(bool* doNotModel)
 {
-	successionStrParameters = vector<map<string, string>>();
-	successionNumParameters = vector<map<string, double>>();
+	map<RVS::DataManagement::Symbol, Cohorts>::iterator cached = cachedCohorts.find(ap->BPS_MODEL_ID());
+	if (cached != cachedCohorts.end())
+	{
+		useCohorts(cached->second, doNotModel);
+		return;
+	}
+
+	Cohorts cohorts = Cohorts();
+	cohorts.strParameters = vector<map<string, string>>();
+	cohorts.numParameters = vector<map<string, double>>();
 
 	// Declare 3 cohort value maps. Not all may be used.
 	map<string, string> strVals_primary = map<string, string>();
@@ -185,25 +207,60 @@ void SuccessionDriver::loadSuccessionVals(bool* doNotModel)
 	bool lastCohort = false;
 
 	// Populate the first succession stage
-	lastCohort = sdio->get_succession_data(ap->BPS_MODEL_NUM(), &strVals_primary, &numVals_primary, doNotModel);
+	lastCohort = sdio->get_succession_data(ap->BPS_MODEL_NUM(), &strVals_primary, &numVals_primary, doNotModel, true);
 	// If there's another stage, populate secondary cohort
 	if (!lastCohort)
 	{
-		lastCohort = sdio->get_succession_data(ap->BPS_MODEL_NUM(), &strVals_secondary, &numVals_secondary, doNotModel);
+		lastCohort = sdio->get_succession_data(ap->BPS_MODEL_NUM(), &strVals_secondary, &numVals_secondary, doNotModel, false);
 	}
 	// If there's a final stage, populate the tertiary cohort
 	if (!lastCohort)
 	{
-		lastCohort = sdio->get_succession_data(ap->BPS_MODEL_NUM(), &strVals_tertiary, &numVals_tertiary, doNotModel);
+		lastCohort = sdio->get_succession_data(ap->BPS_MODEL_NUM(), &strVals_tertiary, &numVals_tertiary, doNotModel, false);
 	}
 
-	successionNumParameters.push_back(numVals_primary);
-	successionNumParameters.push_back(numVals_secondary);
-	successionNumParameters.push_back(numVals_tertiary);
+	cohorts.numParameters.push_back(numVals_primary);
+	cohorts.numParameters.push_back(numVals_secondary);
+	cohorts.numParameters.push_back(numVals_tertiary);
 	
-	successionStrParameters.push_back(strVals_primary);
-	successionStrParameters.push_back(strVals_secondary);
-	successionStrParameters.push_back(strVals_tertiary);
+	cohorts.strParameters.push_back(strVals_primary);
+	cohorts.strParameters.push_back(strVals_secondary);
+	cohorts.strParameters.push_back(strVals_tertiary);
+
+	for (int i = 0; i < 3; i++)
+	{
+		cohorts.stages[i] = SuccessionFastForward::flatten(cohorts.strParameters[i], cohorts.numParameters[i]);
+	}
+	sdio->query_herb_growth_coefs(ap->BPS_MODEL_NUM(), &cohorts.herbCoverRate, &cohorts.herbHeightRate);
+
+	cohorts.doNotModel = *doNotModel;
+	cachedCohorts[ap->BPS_MODEL_ID()] = cohorts;
+	useCohorts(cohorts, doNotModel);
+}
+
+void SuccessionDriver::useCohorts(const Cohorts& cohorts, bool* doNotModel)
+{
+	// Work on copies, lookups of missing keys add them to the maps. The cache keeps the
+	// rates as read.
+	successionStrParameters = cohorts.strParameters;
+	successionNumParameters = cohorts.numParameters;
+	*doNotModel = cohorts.doNotModel;
+
+	for (int i = 0; i < 3; i++)
+	{
+		map<string, double>& numVals = successionNumParameters[i];
+		map<string, double>::iterator rate = numVals.find("gr_cov");
+		if (rate != numVals.end()) { rate->second *= scales.grCov; }
+		rate = numVals.find("gr_ht");
+		if (rate != numVals.end()) { rate->second *= scales.grHt; }
+
+		successionStages[i] = cohorts.stages[i];
+		successionStages[i].gr_cov *= scales.grCov;
+		successionStages[i].gr_ht *= scales.grHt;
+	}
+
+	herbCoverRate = cohorts.herbCoverRate * scales.herbCover;
+	herbHeightRate = cohorts.herbHeightRate * scales.herbHeight;
 }
 
 int SuccessionDriver::determineCurrentClass()
@@ -270,10 +327,9 @@ int SuccessionDriver::determineCurrentClass()
 
 	if (sclass == 0)
 	{
-		stringstream* s = new stringstream();
-		*s << "PLOT_ID: " << ap->PLOT_ID() << ". Plot uncharacteristic for succession.";
-		const char* c = sdio->streamToCharPtr(s);
-		sdio->write_debug_msg(c);
+		stringstream s;
+		s << "PLOT_ID: " << ap->PLOT_ID() << ". Plot uncharacteristic for succession.";
+		sdio->write_debug_msg(s.str().c_str());
 
 		sclass = -1;
 	}
@@ -296,18 +352,20 @@ int SuccessionDriver::plotAge(int sclass)
 	return adjust;
 }
 
-int SuccessionDriver::plotAgeCalculation(double cover, map<string, string> strVals, map<string, double> numVals)
+int SuccessionDriver::plotAgeCalculation(double cover, map<string, string>& strVals, map<string, double>& numVals)
 {
 	// At this point the stage has been classified, so just need to determine how many years it's been in this stage
 	double stageStartingCover = numVals["min_cov"];
 	double coverGrowthRate = numVals["gr_cov"];
+	// Herb cohorts don't grow cover, so the cover can't date them. The plot just entered the stage.
+	if (coverGrowthRate <= 0) { return (int)numVals["startAge"]; }
 
 	int ageOfPlot = int((cover - stageStartingCover) / coverGrowthRate) + numVals["startAge"];
 
 	return ageOfPlot;
 }
 
-void SuccessionDriver::growStage(map<string, string> strVals, map<string, double> numVals)
+void SuccessionDriver::growStage(map<string, string>& strVals, map<string, double>& numVals)
 {
 	RVS::DataManagement::SppRecord* record = NULL;
 
@@ -323,16 +381,21 @@ void SuccessionDriver::growStage(map<string, string> strVals, map<string, double
 
 	if (growthStage.compare("H") != 0)
 	{
+		// Plots that lost their shrubs take up the species growing around them, and seed from
+		// dense neighbors speeds up their cover growth
+		if (!ap->SEED_SOURCES().empty())
+		{
+			cov_growth *= recolonize(max_cover);
+		}
+
 		if (shrubs->empty())  
 		{
 			list<string> newspecies = makeSpeciesList(strVals);
 			for (string s : newspecies)
 			{
-				bool modelSpp = sdio->check_shrub_data_exists(s);
-				bool isShrub = sdio->check_code_is_shrub(s);
-				if (modelSpp && isShrub)
+				string spp_name;
+				if (shrubName(s, &spp_name))
 				{ 
-					string spp_name = sdio->get_scientific_name(s);
 					SppRecord* shrub = new SppRecord(s, 0, 0, spp_name);
 					shrubs->push_back(shrub);
 				}
@@ -373,15 +436,15 @@ void SuccessionDriver::growStage(map<string, string> strVals, map<string, double
 
 void SuccessionDriver::growHerbs(double* herbCover, double* herbHeight, double* production)
 {
-	double newProduction = *production;
-
-	double* coverRate = new double;
-	double* herbRate = new double;
+	growHerbs(herbCover, herbHeight, production, herbCoverRate, herbHeightRate);
+}
 
-	sdio->query_herb_growth_coefs(ap->BPS_MODEL_NUM(), coverRate, herbRate);
+void SuccessionDriver::growHerbs(double* herbCover, double* herbHeight, double* production, double coverRate, double herbRate)
+{
+	double newProduction = *production;
 
-	double cover = *coverRate * newProduction;
-	double height = *herbRate * newProduction * 100;  
+	double cover = coverRate * newProduction;
+	double height = herbRate * newProduction * 100;  
 
 	if (cover + ap->SHRUBCOVER() > 98)
 	{
@@ -396,6 +459,122 @@ void SuccessionDriver::growHerbs(double* herbCover, double* herbHeight, double*
 	*herbHeight = height;
 }
 
+void SuccessionDriver::attenuateCover()
+{
+	if (ap->herbCover + ap->shrubCover > 100)
+	{
+		double total = ap->herbCover + ap->shrubCover;
+		ap->herbCover = (ap->herbCover / total) * 100;
+		ap->shrubCover = (ap->shrubCover / total) * 100;
+	}
+}
+
+bool SuccessionDriver::canFastForward()
+{
+	// Disturbances change shrubs outside of succession, so those plots grow year by year
+	if (!ap->disturbances.empty() || ap->burned || ap->inRotation) { return false; }
+
+	int sclass = ap->CURRENT_SUCCESSION_STAGE();
+	if (sclass > 3 && sclass < 100) { sclass = 3; }
+
+	// Unclassified plots are classified by the regular path first. Plots without shrubs
+	// may have species added from the succession table, so they are left alone as well.
+	return sclass >= 1 && sclass <= 3 && !shrubs->empty();
+}
+
+bool SuccessionDriver::planFastForward(int year)
+{
+	// A plot that was reset keeps its last trajectory to plan into
+	ap->trajectory = SuccessionFastForward::plan(ap, ap->timeInHerbStage, successionStages, 3, year, *YEARS,
+		herbCoverRate, herbHeightRate, ap->spareTrajectory);
+	if (ap->trajectory == ap->spareTrajectory) { ap->spareTrajectory = NULL; }
+
+	return ap->trajectory != NULL && ap->trajectory->covers(year);
+}
+
+int* SuccessionDriver::fastForwardMain(int year)
+{
+	RVS::Succession::ShrubTrajectory* trajectory = ap->trajectory;
+	RVS::Succession::TrajectoryYear* planned = trajectory->at(year);
+
+	// Herbaceous production still depends on the year's climate
+	double yhat = calcProduction(year);
+	double lower = 0;
+	double upper = 0;
+	calcConfidence(year, yhat, &lower, &upper, 0);
+
+	ap->primaryProduction = exp(yhat) * SMEAR;
+	ap->lower_confidence = lower;
+	ap->upper_confidence = upper;
+
+	ap->currentStageType = trajectory->STAGE_TYPE(year);
+	ap->timeInHerbStage = planned->timeInHerbStage;
+
+	for (size_t r = 0; r < shrubs->size(); r++)
+	{
+		RVS::DataManagement::SppRecord* record = shrubs->at(r);
+		record->cover = trajectory->BASE_COVER(r) + planned->coverOffset;
+		record->height = trajectory->BASE_HEIGHT(r) + planned->heightOffset;
+	}
+
+	growHerbs(&(ap->herbCover), &(ap->herbHeight), &(ap->primaryProduction), trajectory->HERB_COVER_RATE(), trajectory->HERB_HEIGHT_RATE());
+	attenuateCover();
+
+	ap->currentStage = planned->stage;
+
+	sdio->write_output_record(&year, ap);
+
+	ap->plotAge = planned->plotAge + 1;
+	if (planned->advanceStage)
+	{
+		ap->currentStage += 1;
+	}
+
+	return RC;
+}
+
+bool SuccessionDriver::shrubName(const string& sppCode, string* name)
+{
+	RVS::DataManagement::Symbol code = RVS::DataManagement::SymbolTable::intern(sppCode);
+	map<RVS::DataManagement::Symbol, pair<bool, string>>::iterator it = shrubNames.find(code);
+	if (it == shrubNames.end())
+	{
+		bool modelSpp = sdio->check_shrub_data_exists(sppCode);
+		bool isShrub = sdio->check_code_is_shrub(sppCode);
+		string sppName = modelSpp && isShrub ? sdio->get_scientific_name(sppCode) : "";
+		it = shrubNames.insert(make_pair(code, make_pair(modelSpp && isShrub, sppName))).first;
+	}
+
+	*name = it->second.second;
+	return it->second.first;
+}
+
+double SuccessionDriver::recolonize(double maxCover)
+{
+	double sourceCover = 0;
+	for (auto &source : ap->SEED_SOURCES())
+	{
+		sourceCover += source.cover;
+
+		bool present = false;
+		for (auto &s : *shrubs)
+		{
+			if (s->SPP_CODE_ID() == source.species) { present = true; }
+		}
+		if (present) { continue; }
+
+		const string& code = RVS::DataManagement::SymbolTable::name(source.species);
+		string sppName;
+		if (shrubName(code, &sppName))
+		{
+			shrubs->push_back(new SppRecord(code, 0, 0, sppName));
+		}
+	}
+
+	if (maxCover <= 0) { return 1; }
+	return 1 + std::min(sourceCover / maxCover, 1.0);
+}
+
 list<string> SuccessionDriver::makeSpeciesList(map<string, string> strVals)
 {
 	list<string> species = list<string>();
@@ -416,7 +595,11 @@ double SuccessionDriver::calcProduction(int year)
 	double ln_ndvi = log(ndvi);
 	double ln_ppt = log(ppt);
 
-	double rawProduction = -5.2058235 + (ln_ppt * 0.1088213) + (ln_ndvi * 1.386304);
+	double intercept = -5.2058235 * scales.productionIntercept;
+	double pptCoef = 0.1088213 * scales.productionPpt;
+	double ndviCoef = 1.386304 * scales.productionNdvi;
+
+	double rawProduction = intercept + (ln_ppt * pptCoef) + (ln_ndvi * ndviCoef);
 	ap->rawProduction = exp(rawProduction) * SMEAR;
 
 	// Modify NDVI and PPT as a function of NOT SHRUB cover
@@ -428,7 +611,7 @@ double SuccessionDriver::calcProduction(int year)
 	ln_ndvi = log(ndvi);
 	ln_ppt = log(ppt);
 
-	double biomass = -5.2058235 + (ln_ppt * 0.1088213) + (ln_ndvi * 1.386304);
+	double biomass = intercept + (ln_ppt * pptCoef) + (ln_ndvi * ndviCoef);
 	return biomass;
 }
 
@@ -470,8 +653,9 @@ void SuccessionDriver::calcConfidence(int year, double biomass, double* lower, d
 
 double SuccessionDriver::calc_s2b(double* lnNDVI, double* lnPPT)
 {
-	double** dummy = new double*[1];
-	dummy[0] = new double[3];
+	// Matrices are plot-year temporaries and come from the scratch arena
+	double** dummy = RVS::DataManagement::Arena::scratch()->allocateArray<double*>(1);
+	dummy[0] = RVS::DataManagement::Arena::scratch()->allocateArray<double>(3);
 
 	dummy[0][0] = 1.0;
 	dummy[0][1] = *lnPPT;
@@ -512,11 +696,12 @@ double** SuccessionDriver::matrix_mult(double** A, int aRow, int aCol, double**
 	const int INNER = aCol;
 	const int COL = bCol;
 
-	double** C = new double*[ROW];
+	RVS::DataManagement::Arena* scratch = RVS::DataManagement::Arena::scratch();
+	double** C = scratch->allocateArray<double*>(ROW);
 
 	for (int row = 0; row != ROW; ++row)
 	{
-		C[row] = new double[COL];
+		C[row] = scratch->allocateArray<double>(COL);
 		for (int col = 0; col != COL; ++col)
 		{
 			double sum = 0;
@@ -536,11 +721,12 @@ double** SuccessionDriver::matrix_trans(double** A, int aRow, int aCol)
 	const int ROW = aRow;
 	const int COL = aCol;
 
-	double** B = new double*[aCol];
+	RVS::DataManagement::Arena* scratch = RVS::DataManagement::Arena::scratch();
+	double** B = scratch->allocateArray<double*>(aCol);
 
 	for (int col = 0; col != COL; ++col)
 	{
-		B[col] = new double[ROW];
+		B[col] = scratch->allocateArray<double>(ROW);
 
 		for (int row = 0; row != ROW; ++row)
 		{
@@ -552,8 +738,8 @@ double** SuccessionDriver::matrix_trans(double** A, int aRow, int aCol)
 
 double** SuccessionDriver::generate_dummy_variables(int index, double* lnPPT, double* lnNDVI)
 {
-	double** dummy = new double*[1];
-	dummy[0] = new double[102];
+	double** dummy = RVS::DataManagement::Arena::scratch()->allocateArray<double*>(1);
+	dummy[0] = RVS::DataManagement::Arena::scratch()->allocateArray<double>(102);
 
 	dummy[0][0] = 1.0;
 	dummy[0][1] = *lnPPT;
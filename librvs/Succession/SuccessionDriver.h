@@ -13,15 +13,34 @@
 #include <list>
 
 #include "SuccessionDIO.h"
+#include "SuccessionFastForward.h"
 #include "../DataManagement/AnalysisPlot.h"
 #include "../DataManagement/SppRecord.h"
 
+namespace RVS { namespace Tools { class Microbenchmarks; } }
+
 namespace RVS
 {
 namespace Succession
 {
+	// Multipliers of the reference growth and production parameters, for sensitivity runs.
+	// DEFAULT_SCALES (all 1) leaves the parameters as read.
+	struct GrowthScales
+	{
+		double grCov;                 // GR_COV of every stage
+		double grHt;                  // GR_HT of every stage
+		double herbCover;             // Herb cover growth slope (CC_Slope)
+		double herbHeight;            // Herb height growth slope (HT_Slope)
+		double productionIntercept;   // Coefficients of the production model
+		double productionPpt;
+		double productionNdvi;
+	};
+	static const GrowthScales DEFAULT_SCALES = { 1, 1, 1, 1, 1, 1, 1 };
+
 	class SuccessionDriver
 	{
+		friend class RVS::Tools::Microbenchmarks;
+
 	public:
 		
 		SuccessionDriver(RVS::Succession::SuccessionDIO* sdio, bool suppress_messages = false);
@@ -29,12 +48,17 @@ namespace Succession
 
         int* SuccessionMain(int year, string* climate, RVS::DataManagement::AnalysisPlot* ap);
 
+		// Applies to plots simulated from here on. Plans made before are kept.
+		inline void setScales(const GrowthScales& scales) { this->scales = scales; }
+		inline const GrowthScales& SCALES() { return scales; }
+
 	private:
 		RVS::Succession::SuccessionDIO* sdio;
 		RVS::DataManagement::AnalysisPlot* ap;
 		vector<RVS::DataManagement::SppRecord*>* shrubs;
 		bool suppress_messages;
 		string* climate;
+		GrowthScales scales;
 
 		const float MSE = 0.1276825f;
 		const float SMEAR = 1.06431775f;
@@ -42,19 +66,53 @@ namespace Succession
 
 		vector<map<string, string>> successionStrParameters;
 		vector<map<string, double>> successionNumParameters;
+		// The same stages flattened for planning, and the herb growth rates of the plot's model
+		StageParams successionStages[3];
+		double herbCoverRate;
+		double herbHeightRate;
+
+		// Cohorts of every BPS model loaded, so a model is only read once per driver however
+		// the plots are ordered or stolen between workers
+		struct Cohorts
+		{
+			bool doNotModel;
+			vector<map<string, string>> strParameters;
+			vector<map<string, double>> numParameters;
+			StageParams stages[3];
+			double herbCoverRate;
+			double herbHeightRate;
+		};
+		map<RVS::DataManagement::Symbol, Cohorts> cachedCohorts;
 
 		void loadSuccessionVals(bool* doNotModel);
+		// Copies the cached values of the plot's model and applies the scales to the copies
+		void useCohorts(const Cohorts& cohorts, bool* doNotModel);
 
 		int determineCurrentClass();
 		
 		int plotAge(int sclass);
-		int plotAgeCalculation(double cover, map<string, string> strVals, map<string, double> numVals);
+		// The stage maps are the working copies, which a lookup of a missing key adds to
+		int plotAgeCalculation(double cover, map<string, string>& strVals, map<string, double>& numVals);
 
-		void growStage(map<string, string> strVals, map<string, double> numVals);
+		void growStage(map<string, string>& strVals, map<string, double>& numVals);
 
 		void growHerbs(double* herbCover, double* herbHeight, double* production);
+		void growHerbs(double* herbCover, double* herbHeight, double* production, double coverRate, double herbRate);
+		void attenuateCover();
+
+		// Fast forward of undisturbed plots (see SuccessionFastForward)
+		bool canFastForward();
+		bool planFastForward(int year);
+		int* fastForwardMain(int year);
 
 		list<string> makeSpeciesList(map<string, string> strVals);
+		// Species checked for new shrub records: whether RVS models them as shrubs, and their
+		// scientific name. Saves the three Plants queries per species and plot.
+		map<RVS::DataManagement::Symbol, pair<bool, string>> shrubNames;
+		bool shrubName(const string& sppCode, string* name);
+		// Adds the seed source species the plot does not have yet. Returns the factor (1-2) the
+		// cover growth is raised by: 1 plus the sources' cover relative to the stage's maximum.
+		double recolonize(double maxCover);
 		void addNewSpecies(vector<string> sClassSppCodes);
 
 		double calcProduction(int year);
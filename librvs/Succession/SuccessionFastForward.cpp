@@ -0,0 +1,243 @@
+#include "SuccessionFastForward.h"
+
+#include <cmath>
+
+using RVS::Succession::ShrubTrajectory;
+using RVS::Succession::StageParams;
+using RVS::Succession::SuccessionFastForward;
+using RVS::DataManagement::SymbolTable;
+
+static const RVS::DataManagement::Symbol COHORT_SHRUB = SymbolTable::intern("S");
+static const RVS::DataManagement::Symbol COHORT_HERB = SymbolTable::intern("H");
+
+ShrubTrajectory::ShrubTrajectory(int firstYear, size_t numShrubs)
+{
+	this->firstYear = firstYear;
+	herbCoverRate = 0;
+	herbHeightRate = 0;
+	baseCover = std::vector<double>(numShrubs, 0.0);
+	baseHeight = std::vector<double>(numShrubs, 0.0);
+	years = std::vector<TrajectoryYear>();
+	stageTypes = std::vector<RVS::DataManagement::Symbol>();
+}
+
+ShrubTrajectory::~ShrubTrajectory(void)
+{
+}
+
+void ShrubTrajectory::reset(int firstYear, size_t numShrubs)
+{
+	this->firstYear = firstYear;
+	herbCoverRate = 0;
+	herbHeightRate = 0;
+	baseCover.assign(numShrubs, 0.0);
+	baseHeight.assign(numShrubs, 0.0);
+	years.clear();
+	stageTypes.clear();
+}
+
+bool ShrubTrajectory::constantFrom(int year, int endYear)
+{
+	if (!covers(year) || LAST_YEAR() < endYear) { return false; }
+
+	TrajectoryYear* first = at(year);
+	for (int y = year; y < LAST_YEAR(); y++)
+	{
+		TrajectoryYear* t = at(y);
+		if (t->advanceStage || t->stage != first->stage || \
+			t->coverOffset != first->coverOffset || t->heightOffset != first->heightOffset)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+StageParams SuccessionFastForward::flatten(std::map<string, string> strVals, std::map<string, double> numVals)
+{
+	StageParams p = StageParams();
+
+	p.exists = numVals.size() > 0;
+	p.cohortType = SymbolTable::intern(strVals["cohort_type"]);
+	p.herbCohort = p.cohortType == COHORT_HERB;
+	p.modeled = p.cohortType == COHORT_SHRUB || p.herbCohort;
+	p.herbCover = strVals["cover_type"].compare("H") == 0;
+	p.isLate = strVals["cover_type"].compare("L") == 0;
+
+	p.startAge = numVals["startAge"];
+	p.endAge = numVals["endAge"];
+	p.midpoint = numVals["midpoint"];
+	p.gr_ht = numVals["gr_ht"];
+	p.gr_cov = numVals["gr_cov"];
+	p.max_ht = numVals["max_ht"];
+	p.max_cov = numVals["max_cov"];
+
+	return p;
+}
+
+ShrubTrajectory* SuccessionFastForward::plan(RVS::DataManagement::AnalysisPlot* ap, int timeInHerbStage,
+	const StageParams* stages, int numStages, int startYear, int endYear,
+	double herbCoverRate, double herbHeightRate, ShrubTrajectory* reuse)
+{
+	std::vector<RVS::DataManagement::SppRecord*>* shrubs = ap->SHRUB_RECORDS();
+	if (shrubs->empty()) { return NULL; }
+
+	ShrubTrajectory* trajectory = reuse;
+	if (trajectory == NULL)
+	{
+		trajectory = new ShrubTrajectory(startYear, shrubs->size());
+	}
+	else
+	{
+		trajectory->reset(startYear, shrubs->size());
+	}
+	trajectory->herbCoverRate = herbCoverRate;
+	trajectory->herbHeightRate = herbHeightRate;
+
+	// Every record receives the same cover and height increment each year, so the records
+	// only need their starting values plus two running offsets. The sums below rebuild the
+	// cover weighted height BiomassDriver reports without touching the records.
+	double numShrubs = (double)shrubs->size();
+	double startCover = 0;
+	double sumHeight = 0;
+	double sumHeightCover = 0;
+	for (size_t r = 0; r < shrubs->size(); r++)
+	{
+		RVS::DataManagement::SppRecord* record = shrubs->at(r);
+		trajectory->baseCover[r] = record->COVER();
+		trajectory->baseHeight[r] = record->HEIGHT();
+		startCover += record->COVER();
+		sumHeight += record->HEIGHT();
+		sumHeightCover += record->HEIGHT() * record->COVER();
+	}
+
+	int sclass = ap->CURRENT_SUCCESSION_STAGE();
+	int age = ap->PLOT_AGE();
+	int herbTime = timeInHerbStage;
+
+	double coverOffset = 0;
+	double heightOffset = 0;
+	// The first year grows from whatever height is on the plot (a plain average when the plot
+	// was just loaded), after that from the cover weighted height of the grown records
+	double height = ap->SHRUBHEIGHT();
+
+	// Segment bookkeeping. Within a segment the growth parameters are fixed and total cover
+	// follows coverAfter from the segment's starting cover.
+	const StageParams* segmentParams = NULL;
+	int segmentStart = startYear;
+	double segmentCover = startCover;
+
+	for (int year = startYear; year < endYear; year++)
+	{
+		if (sclass > 3 && sclass < 100) { sclass = 3; }
+		if (sclass < 1 || sclass > numStages) { break; }
+
+		const StageParams* current = &stages[sclass - 1];
+		if (!current->modeled) { break; }
+
+		int midpoint = (int)current->midpoint + (int)current->startAge;
+		int useAge = current->herbCover ? herbTime : age;
+		if (current->herbCover) { herbTime += 1; }
+
+		// Growth for the next stage begins halfway through the current one
+		const StageParams* growth = current;
+		if (!(useAge < midpoint || current->isLate) && sclass < numStages)
+		{
+			growth = &stages[sclass];
+		}
+
+		if (!growth->herbCohort)
+		{
+			if (growth != segmentParams)
+			{
+				segmentParams = growth;
+				segmentStart = year;
+				segmentCover = startCover + coverOffset * numShrubs;
+			}
+
+			double cover = coverAfter(segmentCover, growth->gr_cov, growth->max_cov, year - segmentStart + 1);
+			// Height may grow beyond max height, it only has to start below it
+			if (height < growth->max_ht)
+			{
+				heightOffset += growth->gr_ht / numShrubs;
+			}
+			coverOffset = (cover - startCover) / numShrubs;
+		}
+		else
+		{
+			segmentParams = NULL;
+		}
+
+		TrajectoryYear t = TrajectoryYear();
+		t.stage = sclass;
+		t.plotAge = age;
+		t.timeInHerbStage = herbTime;
+		t.advanceStage = age == current->endAge;
+		t.coverOffset = coverOffset;
+		t.heightOffset = heightOffset;
+
+		trajectory->years.push_back(t);
+		trajectory->stageTypes.push_back(current->cohortType);
+
+		double totalCover = startCover + coverOffset * numShrubs;
+		height = (sumHeightCover + coverOffset * sumHeight) / totalCover + heightOffset;
+
+		age += 1;
+		if (t.advanceStage) { sclass += 1; }
+	}
+
+	if (trajectory->years.empty())
+	{
+		if (trajectory != reuse) { delete trajectory; }
+		trajectory = NULL;
+	}
+
+	return trajectory;
+}
+
+double SuccessionFastForward::coverAfter(double cover, double gr_cov, double max_cov, int k)
+{
+	if (k <= 0) { return cover; }
+
+	int linear = 0;
+	if (gr_cov > 0)
+	{
+		// Cover grows by gr_cov until it would reach max cover (or 100), then it is set to
+		// the cap. Count the plain growth years directly instead of stepping through them.
+		double cap = max_cov < 100 ? max_cov : 100;
+		double steps = std::ceil((cap - cover) / gr_cov) - 1;
+		linear = steps < 0 ? 0 : (steps > k ? k : (int)steps);
+		while (linear > 0 && cover + gr_cov * linear >= cap) { linear--; }
+		while (linear < k && cover + gr_cov * (linear + 1) < cap) { linear++; }
+	}
+
+	double result = cover + gr_cov * linear;
+
+	// Capped (or shrinking) cover settles in a step or two, so finish by stepping
+	for (int i = linear; i < k; i++)
+	{
+		double next = coverStep(result, gr_cov, max_cov);
+		if (next == result) { break; }
+		result = next;
+	}
+
+	return result;
+}
+
+double SuccessionFastForward::coverStep(double cover, double gr_cov, double max_cov)
+{
+	double next = 0;
+	if (cover + gr_cov >= 100)
+	{
+		next = 99;
+	}
+	else if (cover + gr_cov < max_cov)
+	{
+		next = cover + gr_cov;
+	}
+	else
+	{
+		next = max_cov;
+	}
+	return next;
+}
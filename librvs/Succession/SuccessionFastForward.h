@@ -0,0 +1,126 @@
+/// ********************************************************** ///
+/// Name: SuccessionFastForward.h                              ///
+/// Desc: Closed form shrub growth for undisturbed plots.      ///
+/// Stage transitions (midpoint, endAge) are known ahead of    ///
+/// time, so a plot's shrub trajectory is planned once,        ///
+/// segment by segment, rather than grown year by year.        ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef SUCCESSIONFASTFORWARD_H
+#define SUCCESSIONFASTFORWARD_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "../DataManagement/AnalysisPlot.h"
+#include "../DataManagement/SppRecord.h"
+
+namespace RVS
+{
+namespace Succession
+{
+	// Flattened copy of one cohort's succession parameters. Cohorts missing from
+	// BPS_Combined_Growthrates are left zeroed, which is what the map lookups in
+	// SuccessionDriver produce for them.
+	struct StageParams
+	{
+		bool exists;       // Cohort was found for the BPS model
+		bool herbCohort;   // cohort_type == "H"
+		bool modeled;      // cohort_type is "S" or "H"
+		bool herbCover;    // cover_type == "H"
+		bool isLate;       // cover_type == "L"
+		RVS::DataManagement::Symbol cohortType;
+
+		double startAge;
+		double endAge;
+		double midpoint;
+		double gr_ht;
+		double gr_cov;
+		double max_ht;
+		double max_cov;
+	};
+
+	// State of a fast forwarded plot for a single simulation year
+	struct TrajectoryYear
+	{
+		int stage;            // Succession stage written for the year
+		int plotAge;          // Plot age written for the year
+		int timeInHerbStage;  // Herb stage counter after the year
+		bool advanceStage;    // Stage moves up after the year (endAge reached)
+		double coverOffset;   // Cover added to every shrub record since planning (%)
+		double heightOffset;  // Height added to every shrub record since planning (cm)
+	};
+
+	// Planned shrub trajectory for one plot, valid for [FIRST_YEAR, LAST_YEAR)
+	class ShrubTrajectory
+	{
+		friend class SuccessionFastForward;
+
+	public:
+		ShrubTrajectory(int firstYear, size_t numShrubs);
+		virtual ~ShrubTrajectory(void);
+
+		// Empties the trajectory to be planned again, keeping its storage
+		void reset(int firstYear, size_t numShrubs);
+
+		inline int FIRST_YEAR() { return firstYear; }
+		inline int LAST_YEAR() { return firstYear + (int)years.size(); }
+		inline bool covers(int year) { return year >= firstYear && year < LAST_YEAR(); }
+
+		inline TrajectoryYear* at(int year) { return &years[year - firstYear]; }
+		inline RVS::DataManagement::Symbol STAGE_TYPE(int year) { return stageTypes[year - firstYear]; }
+
+		// True if the plan reaches endYear and stage, cover and height no longer change from year on
+		bool constantFrom(int year, int endYear);
+
+		// Shrub record values the trajectory was planned from
+		inline double BASE_COVER(size_t record) { return baseCover[record]; }
+		inline double BASE_HEIGHT(size_t record) { return baseHeight[record]; }
+		inline size_t NUM_SHRUBS() { return baseCover.size(); }
+
+		// Herb growth coefficients for the plot's BPS model, queried once at planning time
+		inline double HERB_COVER_RATE() { return herbCoverRate; }
+		inline double HERB_HEIGHT_RATE() { return herbHeightRate; }
+
+	private:
+		int firstYear;
+		double herbCoverRate;
+		double herbHeightRate;
+
+		std::vector<double> baseCover;   // Record cover when the trajectory was planned
+		std::vector<double> baseHeight;  // Record height when the trajectory was planned
+		std::vector<TrajectoryYear> years;
+		std::vector<RVS::DataManagement::Symbol> stageTypes;
+	};
+
+	class SuccessionFastForward
+	{
+	public:
+		// Converts the parameter maps loaded by SuccessionDriver into a StageParams
+		static StageParams flatten(std::map<string, string> strVals, std::map<string, double> numVals);
+
+		// Plans the trajectory of a plot from startYear up to (not including) endYear. The plan
+		// stops early at the first year the regular path would have to handle (unmodeled
+		// stage, unclassified plot). Returns NULL if not even the first year can be planned.
+		// A trajectory passed as reuse is planned into instead of a new one, and stays with
+		// the caller when NULL is returned.
+		static ShrubTrajectory* plan(RVS::DataManagement::AnalysisPlot* ap, int timeInHerbStage,
+			const StageParams* stages, int numStages, int startYear, int endYear,
+			double herbCoverRate, double herbHeightRate, ShrubTrajectory* reuse = NULL);
+
+		// Total plot cover after k years of growth starting from cover, following the
+		// cover rules of SuccessionDriver::growStage
+		static double coverAfter(double cover, double gr_cov, double max_cov, int k);
+
+	private:
+		// One year of SuccessionDriver::growStage cover growth applied to total cover
+		static double coverStep(double cover, double gr_cov, double max_cov);
+	};
+}
+}
+
+#endif
@@ -0,0 +1,187 @@
+#include "BenchmarkTools.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <sqlite3.h>
+
+#include "LandscapeGenerator.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+using RVS::Tools::BenchmarkPlan;
+using RVS::Tools::RunStats;
+
+// Years fiveYearHerbTest steps through its climate levels
+static const int HERB_TEST_YEARS = 5;
+
+static long fileBytes(const std::string& path)
+{
+	std::ifstream in(path.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	return in.good() ? (long)in.tellg() : 0;
+}
+
+// Value of a number field of a flat JSON object written by writeRunStats
+static bool jsonNumber(const std::string& json, const char* key, double* value)
+{
+	std::string field = std::string("\"") + key + "\": ";
+	size_t at = json.find(field);
+	if (at == std::string::npos) { return false; }
+	*value = strtod(json.c_str() + at + field.size(), NULL);
+	return true;
+}
+
+static std::string configName(const std::string& prefix, const std::string& mode, int plots, int threads)
+{
+	std::stringstream ss;
+	ss << prefix << "_" << mode << "_" << plots << "_" << threads;
+	return ss.str();
+}
+
+double RVS::Tools::secondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+long RVS::Tools::peakRssKb(void)
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) { return 0; }
+	return (long)(counters.PeakWorkingSetSize / 1024);
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+#if defined(__APPLE__)
+	return (long)(usage.ru_maxrss / 1024);
+#else
+	return (long)usage.ru_maxrss;
+#endif
+#endif
+}
+
+bool RVS::Tools::writeRunStats(const char* path, const RunStats& stats)
+{
+	std::ofstream out(path, std::ios::out);
+	if (!out.good()) { return false; }
+	out << std::setprecision(9) << "{\"load_s\": " << stats.loadSeconds << ", \"simulate_s\": " << stats.simulateSeconds << \
+		", \"first_output_s\": " << stats.firstOutputSeconds << ", \"total_s\": " << stats.totalSeconds << \
+		", \"plot_years\": " << stats.plotYears << ", \"peak_rss_kb\": " << stats.peakRssKb << "}" << std::endl;
+	out.close();
+	return true;
+}
+
+bool RVS::Tools::readRunStats(const char* path, RunStats* stats)
+{
+	std::ifstream in(path, std::ios::in);
+	if (!in.good()) { return false; }
+	std::stringstream ss;
+	ss << in.rdbuf();
+	std::string json = ss.str();
+
+	*stats = RunStats();
+	double plotYears = 0;
+	double peak = 0;
+	bool ok = jsonNumber(json, "load_s", &stats->loadSeconds) && jsonNumber(json, "simulate_s", &stats->simulateSeconds) && \
+		jsonNumber(json, "first_output_s", &stats->firstOutputSeconds) && jsonNumber(json, "total_s", &stats->totalSeconds) && \
+		jsonNumber(json, "plot_years", &plotYears) && jsonNumber(json, "peak_rss_kb", &peak);
+	stats->plotYears = (long)plotYears;
+	stats->peakRssKb = (long)peak;
+	return ok;
+}
+
+int RVS::Tools::runBenchmarks(const char* exe, const char* resultsPath, const BenchmarkPlan& plan)
+{
+	std::string prefix = std::string(resultsPath);
+	size_t ext = prefix.rfind(".json");
+	if (ext != std::string::npos && ext == prefix.size() - 5) { prefix.erase(ext); }
+
+	std::ofstream results(resultsPath, std::ios::out);
+	if (!results.good())
+	{
+		std::cerr << "Can't write " << resultsPath << std::endl;
+		return 1;
+	}
+	time_t t = time(NULL);
+	char started[32];
+	strftime(started, sizeof(started), "%Y-%m-%dT%H:%M:%S", localtime(&t));
+	results << "{\"label\": \"" << plan.label << "\", \"started\": \"" << started << "\", \"sqlite\": \"" << SQLITE_VERSION << \
+		"\", \"runs\": [";
+
+	std::cout << std::left << std::setw(10) << "mode" << std::right << std::setw(9) << "plots" << std::setw(8) << "threads" << \
+		std::setw(10) << "load s" << std::setw(12) << "plot-yr/s" << std::setw(12) << "first out s" << \
+		std::setw(12) << "peak MB" << std::setw(12) << "output MB" << std::endl;
+
+	int failures = 0;
+	bool first = true;
+	for (auto &plots : plan.sizes)
+	{
+		std::stringstream landscape;
+		landscape << prefix << "_" << plots << ".db";
+		int rc = generateLandscape(landscape.str().c_str(), defaultLandscape(plots));
+		if (rc != SQLITE_OK) { return rc; }
+
+		for (auto &mode : plan.modes)
+		{
+			int years = mode == "herb" ? HERB_TEST_YEARS : plan.years;
+			// The equation test evaluates each equation once per plot, on one thread
+			if (mode == "equations") { years = 1; }
+			std::vector<int> threads = mode == "equations" ? std::vector<int>(1, 1) : plan.threads;
+			for (auto &n : threads)
+			{
+				std::string name = configName(prefix, mode, plots, n);
+				std::string out = name + "_out.db";
+				std::string statsPath = name + "_stats.json";
+				std::remove(out.c_str());
+				std::remove(statsPath.c_str());
+
+				std::stringstream ss;
+				ss << "\"" << exe << "\" benchrun " << mode << " \"" << landscape.str() << "\" \"" << out << "\" " << \
+					years << " " << n << " \"" << statsPath << "\" > \"" << name << ".log\" 2>&1";
+				int code = std::system(ss.str().c_str());
+
+				RunStats stats;
+				if (code != 0 || !readRunStats(statsPath.c_str(), &stats))
+				{
+					std::cerr << "Benchmark failed: " << ss.str() << std::endl;
+					failures++;
+					continue;
+				}
+				stats.outputBytes = fileBytes(out);
+				std::remove(out.c_str());
+				std::remove(statsPath.c_str());
+
+				double throughput = stats.simulateSeconds > 0 ? stats.plotYears / stats.simulateSeconds : 0;
+				results << (first ? "" : ",") << "\n  {\"mode\": \"" << mode << "\", \"plots\": " << plots << ", \"threads\": " << n << \
+					", \"years\": " << years << std::setprecision(9) << ", \"load_s\": " << stats.loadSeconds << \
+					", \"simulate_s\": " << stats.simulateSeconds << ", \"first_output_s\": " << stats.firstOutputSeconds << \
+					", \"total_s\": " << stats.totalSeconds << ", \"plot_years\": " << stats.plotYears << \
+					", \"plot_years_per_s\": " << throughput << ", \"peak_rss_kb\": " << stats.peakRssKb << \
+					", \"output_bytes\": " << stats.outputBytes << "}";
+				first = false;
+
+				std::cout << std::left << std::setw(10) << mode << std::right << std::setw(9) << plots << std::setw(8) << n << \
+					std::fixed << std::setprecision(2) << std::setw(10) << stats.loadSeconds << std::setprecision(0) << \
+					std::setw(12) << throughput << std::setprecision(2) << std::setw(12) << stats.firstOutputSeconds << \
+					std::setw(12) << stats.peakRssKb / 1024.0 << std::setw(12) << stats.outputBytes / 1048576.0 << std::endl;
+				std::cout.unsetf(std::ios::floatfield);
+			}
+		}
+	}
+
+	results << "\n]}" << std::endl;
+	results.close();
+	return failures;
+}
@@ -0,0 +1,61 @@
+/// ********************************************************** ///
+/// Name: BenchmarkTools.h                                     ///
+/// Desc: End to end benchmarks. Each configuration of run     ///
+/// mode, landscape size and thread count runs as its own RVS  ///
+/// process on a generated landscape and reports its phase     ///
+/// times, throughput, peak memory and output size. Results    ///
+/// are written as JSON so they can be compared across         ///
+/// versions.                                                  ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef BENCHMARKTOOLS_H
+#define BENCHMARKTOOLS_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace RVS
+{
+namespace Tools
+{
+	// Measurements of one run, in seconds from its start. The output is written in a single
+	// transaction at the end, so the first output is there once it commits.
+	struct RunStats
+	{
+		double loadSeconds;
+		double simulateSeconds;
+		double firstOutputSeconds;
+		double totalSeconds;
+		long plotYears;        // Plot-years simulated, or plot-equations evaluated
+		long peakRssKb;
+		long outputBytes;      // Filled in by the benchmark, from the output file
+	};
+
+	struct BenchmarkPlan
+	{
+		std::vector<std::string> modes;   // "simulate", "herb" (fiveYearHerbTest), "equations" (shrubEquationTest)
+		std::vector<int> sizes;           // Plots
+		std::vector<int> threads;
+		int years;
+		std::string label;                // Recorded with the results, e.g. a version
+	};
+
+	double secondsSince(std::chrono::steady_clock::time_point start);
+	// Peak resident memory of this process
+	long peakRssKb(void);
+
+	bool writeRunStats(const char* path, const RunStats& stats);
+	bool readRunStats(const char* path, RunStats* stats);
+
+	// Runs every configuration of the plan with exe and writes the results to resultsPath.
+	// Landscapes and run logs are kept next to the results file, outputs are removed once
+	// measured.
+	int runBenchmarks(const char* exe, const char* resultsPath, const BenchmarkPlan& plan);
+}
+}
+
+#endif
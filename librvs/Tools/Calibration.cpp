@@ -0,0 +1,461 @@
+#include "Calibration.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+
+#if USEMULTIT
+#include <thread>
+#endif
+
+#include <sqlite3.h>
+
+#include "../RVSDBNAMES.h"
+#include "../DataManagement/AllocationCounter.h"
+#include "../DataManagement/Arena.h"
+#include "../DataManagement/PlotScheduler.h"
+
+using RVS::Succession::GrowthScales;
+using RVS::Succession::PlotObservation;
+using RVS::Tools::Calibration;
+using RVS::Tools::CalibrationOptions;
+using RVS::Tools::CalibrationResult;
+
+// Scales are kept within a factor of 10 of the rates as read
+static const double MAX_LOG_SCALE = std::log(10.0);
+
+namespace
+{
+	// Nelder-Mead over the two log scales. simplex holds 3 points and values[0] the loss of
+	// the first, which counts as an evaluation. Returns the evaluations made, the best point
+	// ends up first.
+	template <typename Loss>
+	int nelderMead(Loss& loss, double simplex[3][2], double values[3], const CalibrationOptions& options, bool* converged)
+	{
+		int evaluations = 1;
+		auto evaluate = [&](double* x) -> double
+		{
+			for (int d = 0; d < 2; d++)
+			{
+				x[d] = std::max(-MAX_LOG_SCALE, std::min(MAX_LOG_SCALE, x[d]));
+			}
+			evaluations++;
+			return loss(x);
+		};
+
+		for (int p = 1; p < 3; p++)
+		{
+			values[p] = evaluate(simplex[p]);
+		}
+
+		*converged = false;
+		int order[3] = { 0, 1, 2 };
+		while (true)
+		{
+			std::sort(order, order + 3, [&](int a, int b) { return values[a] < values[b]; });
+			int best = order[0];
+			int next = order[1];
+			int worst = order[2];
+			if (values[worst] - values[best] <= options.tolerance * std::max(std::fabs(values[best]), options.tolerance))
+			{
+				*converged = true;
+				break;
+			}
+			if (evaluations >= options.maxEvaluations) { break; }
+
+			double centroid[2];
+			double reflected[2];
+			for (int d = 0; d < 2; d++)
+			{
+				centroid[d] = (simplex[best][d] + simplex[next][d]) / 2;
+				reflected[d] = centroid[d] + (centroid[d] - simplex[worst][d]);
+			}
+			double reflectedValue = evaluate(reflected);
+
+			if (reflectedValue < values[best])
+			{
+				double expanded[2];
+				for (int d = 0; d < 2; d++)
+				{
+					expanded[d] = centroid[d] + 2 * (reflected[d] - centroid[d]);
+				}
+				double expandedValue = evaluate(expanded);
+				bool expand = expandedValue < reflectedValue;
+				std::copy(expand ? expanded : reflected, (expand ? expanded : reflected) + 2, simplex[worst]);
+				values[worst] = expand ? expandedValue : reflectedValue;
+				continue;
+			}
+			if (reflectedValue < values[next])
+			{
+				std::copy(reflected, reflected + 2, simplex[worst]);
+				values[worst] = reflectedValue;
+				continue;
+			}
+
+			// Contract towards the better of the worst and the reflected point
+			bool outside = reflectedValue < values[worst];
+			double contracted[2];
+			for (int d = 0; d < 2; d++)
+			{
+				double from = outside ? reflected[d] : simplex[worst][d];
+				contracted[d] = centroid[d] + (from - centroid[d]) / 2;
+			}
+			double contractedValue = evaluate(contracted);
+			if (contractedValue < std::min(reflectedValue, values[worst]))
+			{
+				std::copy(contracted, contracted + 2, simplex[worst]);
+				values[worst] = contractedValue;
+				continue;
+			}
+
+			// Shrink everything towards the best point
+			for (int p = 0; p < 3; p++)
+			{
+				if (p == best) { continue; }
+				for (int d = 0; d < 2; d++)
+				{
+					simplex[p][d] = simplex[best][d] + (simplex[p][d] - simplex[best][d]) / 2;
+				}
+				values[p] = evaluate(simplex[p]);
+			}
+		}
+
+		std::sort(order, order + 3, [&](int a, int b) { return values[a] < values[b]; });
+		if (order[0] != 0)
+		{
+			std::swap(simplex[0][0], simplex[order[0]][0]);
+			std::swap(simplex[0][1], simplex[order[0]][1]);
+			std::swap(values[0], values[order[0]]);
+		}
+		return evaluations;
+	}
+
+	// Weighted mean squared error of a model's plots, simulated with the scales at log scale x.
+	// Errors are relative to the model's mean observed value.
+	struct ModelLoss
+	{
+		const std::vector<RVS::DataManagement::AnalysisPlot*>* plots;
+		const std::vector<const std::vector<PlotObservation>*>* observations;
+		const double* means;
+		double weights[3];
+		std::vector<RVS::DataManagement::AnalysisPlot*>* scratch;
+		RVS::Biomass::BiomassDriver* bd;
+		RVS::Succession::SuccessionDriver* sd;
+		long allocations;
+
+		double operator()(const double* x)
+		{
+#if RVS_COUNT_ALLOCS
+			RVS::DataManagement::AllocationCounter::reset();
+#endif
+			GrowthScales scales = RVS::Succession::DEFAULT_SCALES;
+			scales.grCov = std::exp(x[0]);
+			scales.grHt = std::exp(x[1]);
+			sd->setScales(scales);
+
+			double sums[3] = { 0, 0, 0 };
+			int counts[3] = { 0, 0, 0 };
+			for (size_t i = 0; i < plots->size(); i++)
+			{
+				const std::vector<PlotObservation>& observed = *observations->at(i);
+				int lastYear = observed.back().year;
+				size_t next = 0;
+
+				RVS::DataManagement::AnalysisPlot* plot = scratch->at(i);
+				plot->resetTo(*plots->at(i));
+				for (int year = 0; year <= lastYear; year++)
+				{
+					RC = sd->SuccessionMain(year, CLIMATE, plot);
+					RC = bd->BioMain(year, CLIMATE, plot);
+					RVS::DataManagement::Arena::scratch()->reset();
+
+					// A steady plot has the same values at every later observation
+					bool steady = year < lastYear && plot->checkSteadyState(year);
+					double simulated[3] = { plot->SHRUBCOVER(), plot->SHRUBHEIGHT(), plot->SHRUBBIOMASS() };
+					for (; next < observed.size() && (observed[next].year <= year || steady); next++)
+					{
+						if (observed[next].year < year) { continue; }
+						const PlotObservation& o = observed[next];
+						double values[3] = { o.shrubCover, o.shrubHeight, o.shrubBiomass };
+						for (int v = 0; v < 3; v++)
+						{
+							if (std::isnan(values[v])) { continue; }
+							double error = (simulated[v] - values[v]) / means[v];
+							sums[v] += error * error;
+							counts[v]++;
+						}
+					}
+
+					if (steady) { break; }
+				}
+			}
+
+			double loss = 0;
+			for (int v = 0; v < 3; v++)
+			{
+				if (counts[v] > 0) { loss += weights[v] * sums[v] / counts[v]; }
+			}
+#if RVS_COUNT_ALLOCS
+			allocations = RVS::DataManagement::AllocationCounter::COUNT();
+#endif
+			return loss;
+		}
+	};
+
+	int exec(sqlite3* db, const char* sql)
+	{
+		char* err = NULL;
+		int rc = sqlite3_exec(db, sql, NULL, NULL, &err);
+		if (rc != SQLITE_OK)
+		{
+			std::cerr << "SQL error: " << (err != NULL ? err : sqlite3_errmsg(db)) << std::endl << sql << std::endl;
+			sqlite3_free(err);
+		}
+		return rc;
+	}
+}
+
+CalibrationOptions RVS::Tools::defaultCalibrationOptions(void)
+{
+	CalibrationOptions options = CalibrationOptions();
+	options.maxEvaluations = 200;
+	options.tolerance = 1e-4;
+	options.initialStep = 0.2;
+	options.threads = 0;
+	options.coverWeight = 1;
+	options.heightWeight = 1;
+	options.biomassWeight = 1;
+	return options;
+}
+
+Calibration::Calibration(std::vector<RVS::DataManagement::AnalysisPlot*> plots,
+	const std::map<int, std::vector<PlotObservation>>& observations,
+	const RVS::Biomass::BiomassDriver& bd, const RVS::Succession::SuccessionDriver& sd) : bd(bd), sd(sd)
+{
+	std::map<std::string, size_t> index;
+	for (auto &p : plots)
+	{
+		std::map<int, std::vector<PlotObservation>>::const_iterator found = observations.find(p->PLOT_ID());
+		if (found == observations.end() || found->second.empty()) { continue; }
+
+		if (index.count(p->BPS_MODEL_NUM()) == 0)
+		{
+			index[p->BPS_MODEL_NUM()] = models.size();
+			ModelPlots m = ModelPlots();
+			m.model = p->BPS_MODEL_NUM();
+			models.push_back(m);
+		}
+		ModelPlots& m = models[index[p->BPS_MODEL_NUM()]];
+		m.plots.push_back(p);
+		m.observations.push_back(&found->second);
+		m.cost += found->second.back().year + 1;
+	}
+
+	for (auto &m : models)
+	{
+		double sums[3] = { 0, 0, 0 };
+		int counts[3] = { 0, 0, 0 };
+		for (auto &observed : m.observations)
+		{
+			for (auto &o : *observed)
+			{
+				double values[3] = { o.shrubCover, o.shrubHeight, o.shrubBiomass };
+				for (int v = 0; v < 3; v++)
+				{
+					if (std::isnan(values[v])) { continue; }
+					sums[v] += std::fabs(values[v]);
+					counts[v]++;
+				}
+			}
+			m.numObservations += (int)observed->size();
+		}
+		// A value that was only ever observed as 0 is compared unnormalized
+		for (int v = 0; v < 3; v++)
+		{
+			m.means[v] = counts[v] > 0 && sums[v] > 0 ? sums[v] / counts[v] : 1;
+		}
+	}
+
+	std::sort(models.begin(), models.end(), [](const ModelPlots& a, const ModelPlots& b) { return a.model < b.model; });
+}
+
+std::vector<CalibrationResult> Calibration::run(const CalibrationOptions& options)
+{
+	std::vector<CalibrationResult> results = std::vector<CalibrationResult>(models.size());
+	if (models.empty()) { return results; }
+
+	int numWorkers = 1;
+#if USEMULTIT
+	numWorkers = options.threads > 0 ? options.threads : (int)std::thread::hardware_concurrency();
+#endif
+	RVS::DataManagement::PlotScheduler scheduler = RVS::DataManagement::PlotScheduler(numWorkers);
+	numWorkers = scheduler.NUM_WORKERS();
+
+	// Drivers keep the current plot and their scales as state, every worker needs its own
+	std::vector<RVS::Biomass::BiomassDriver> bds = std::vector<RVS::Biomass::BiomassDriver>(numWorkers, bd);
+	std::vector<RVS::Succession::SuccessionDriver> sds = std::vector<RVS::Succession::SuccessionDriver>(numWorkers, sd);
+
+	std::vector<int> ids = std::vector<int>(models.size());
+	std::iota(ids.begin(), ids.end(), 0);
+	std::vector<double> costs;
+	for (auto &m : models)
+	{
+		costs.push_back(m.cost);
+	}
+
+	scheduler.run(&ids, &costs, [&](int worker, int id)
+	{
+		RVS::DataManagement::DIO::begin_write_slot(RVS::DataManagement::DIO::DISCARD_WRITES);
+		const ModelPlots& m = models[id];
+		// A scratch plot for every plot, so each reset finds the records, trajectory and equation
+		// parameters the plot used in the last evaluation
+		std::vector<RVS::DataManagement::AnalysisPlot*> scratch;
+		for (auto &p : m.plots)
+		{
+			scratch.push_back(p->clone());
+		}
+
+		ModelLoss loss = ModelLoss();
+		loss.plots = &m.plots;
+		loss.observations = &m.observations;
+		loss.means = m.means;
+		loss.weights[0] = options.coverWeight;
+		loss.weights[1] = options.heightWeight;
+		loss.weights[2] = options.biomassWeight;
+		loss.scratch = &scratch;
+		loss.bd = &bds[worker];
+		loss.sd = &sds[worker];
+
+		double simplex[3][2] = { { 0, 0 }, { options.initialStep, 0 }, { 0, options.initialStep } };
+		double values[3];
+		CalibrationResult& r = results[id];
+		// The rates as read are the first point
+		values[0] = loss(simplex[0]);
+		r.initialLoss = values[0];
+		r.evaluations = nelderMead(loss, simplex, values, options, &r.converged);
+		r.model = m.model;
+		r.plots = (int)m.plots.size();
+		r.observations = m.numObservations;
+		r.grCovScale = std::exp(simplex[0][0]);
+		r.grHtScale = std::exp(simplex[0][1]);
+		r.loss = values[0];
+		r.allocations = loss.allocations;
+
+		for (auto &p : scratch)
+		{
+			delete p;
+		}
+		sds[worker].setScales(RVS::Succession::DEFAULT_SCALES);
+		RVS::DataManagement::DIO::begin_write_slot(-1);
+	});
+
+	return results;
+}
+
+void Calibration::report(std::ostream& out, const std::vector<CalibrationResult>& results)
+{
+	out << std::left << std::setw(12) << "BPS model" << std::right << std::setw(7) << "plots" << std::setw(8) << "obs" << \
+		std::setw(10) << "gr_cov" << std::setw(10) << "gr_ht" << std::setw(14) << "initial loss" << std::setw(12) << "loss" << \
+		std::setw(7) << "evals" << std::endl;
+	for (auto &r : results)
+	{
+		out << std::left << std::setw(12) << r.model << std::right << std::setw(7) << r.plots << std::setw(8) << r.observations << \
+			std::fixed << std::setprecision(4) << std::setw(10) << r.grCovScale << std::setw(10) << r.grHtScale << \
+			std::setprecision(6) << std::setw(14) << r.initialLoss << std::setw(12) << r.loss;
+		out.unsetf(std::ios::floatfield);
+		out << std::setw(7) << r.evaluations << (r.converged ? "" : "  not converged");
+#if RVS_COUNT_ALLOCS
+		out << "  " << r.allocations << " allocations";
+#endif
+		out << std::endl;
+	}
+}
+
+int Calibration::writeCalibrated(const char* inPath, const char* outPath, const std::vector<CalibrationResult>& results)
+{
+	std::remove(outPath);
+
+	sqlite3* in;
+	int rc = sqlite3_open_v2(inPath, &in, SQLITE_OPEN_READONLY, NULL);
+	if (rc != SQLITE_OK)
+	{
+		std::cerr << "Can't open database: " << sqlite3_errmsg(in) << std::endl;
+		sqlite3_close(in);
+		return rc;
+	}
+	sqlite3* db;
+	rc = sqlite3_open(outPath, &db);
+	if (rc != SQLITE_OK)
+	{
+		std::cerr << "Can't open database: " << sqlite3_errmsg(db) << std::endl;
+		sqlite3_close(db);
+		sqlite3_close(in);
+		return rc;
+	}
+
+	// The copy keeps every input table, only the growth rates change
+	sqlite3_backup* backup = sqlite3_backup_init(db, "main", in, "main");
+	if (backup != NULL)
+	{
+		sqlite3_backup_step(backup, -1);
+		rc = sqlite3_backup_finish(backup);
+	}
+	else
+	{
+		rc = sqlite3_errcode(db);
+	}
+	sqlite3_close(in);
+	if (rc != SQLITE_OK) { std::cerr << "Can't copy " << inPath << ": " << sqlite3_errmsg(db) << std::endl; }
+
+	std::stringstream ss;
+	ss << "BEGIN; DROP TABLE IF EXISTS " << CALIBRATION_OUTPUT_TABLE << "; CREATE TABLE " << CALIBRATION_OUTPUT_TABLE << \
+		" (" << BPS_MODEL_FIELD << " TEXT, plots INTEGER, observations INTEGER, gr_cov_scale REAL, gr_ht_scale REAL, " << \
+		"initial_loss REAL, loss REAL, evaluations INTEGER, converged INTEGER);";
+	if (rc == SQLITE_OK) { rc = exec(db, ss.str().c_str()); }
+
+	if (rc == SQLITE_OK)
+	{
+		std::stringstream update;
+		update << "UPDATE " << SUCCESSION_TABLE << " SET " << SUCCESSION_GR_COV_FIELD << " = " << SUCCESSION_GR_COV_FIELD << \
+			" * ?, " << SUCCESSION_GR_HT_FIELD << " = " << SUCCESSION_GR_HT_FIELD << " * ? WHERE " << BPS_MODEL_FIELD << " = ?;";
+		std::stringstream insert;
+		insert << "INSERT INTO " << CALIBRATION_OUTPUT_TABLE << " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);";
+
+		sqlite3_stmt* updateStmt = NULL;
+		sqlite3_stmt* insertStmt = NULL;
+		rc = sqlite3_prepare_v2(db, update.str().c_str(), -1, &updateStmt, NULL);
+		if (rc == SQLITE_OK) { rc = sqlite3_prepare_v2(db, insert.str().c_str(), -1, &insertStmt, NULL); }
+		for (size_t i = 0; i < results.size() && rc == SQLITE_OK; i++)
+		{
+			const CalibrationResult& r = results[i];
+			sqlite3_bind_double(updateStmt, 1, r.grCovScale);
+			sqlite3_bind_double(updateStmt, 2, r.grHtScale);
+			sqlite3_bind_text(updateStmt, 3, r.model.c_str(), -1, SQLITE_TRANSIENT);
+			rc = sqlite3_step(updateStmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(db);
+			sqlite3_reset(updateStmt);
+
+			sqlite3_bind_text(insertStmt, 1, r.model.c_str(), -1, SQLITE_TRANSIENT);
+			sqlite3_bind_int(insertStmt, 2, r.plots);
+			sqlite3_bind_int(insertStmt, 3, r.observations);
+			sqlite3_bind_double(insertStmt, 4, r.grCovScale);
+			sqlite3_bind_double(insertStmt, 5, r.grHtScale);
+			sqlite3_bind_double(insertStmt, 6, r.initialLoss);
+			sqlite3_bind_double(insertStmt, 7, r.loss);
+			sqlite3_bind_int(insertStmt, 8, r.evaluations);
+			sqlite3_bind_int(insertStmt, 9, r.converged ? 1 : 0);
+			if (rc == SQLITE_OK) { rc = sqlite3_step(insertStmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(db); }
+			sqlite3_reset(insertStmt);
+		}
+		sqlite3_finalize(updateStmt);
+		sqlite3_finalize(insertStmt);
+		if (rc != SQLITE_OK) { std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl; }
+	}
+
+	if (rc == SQLITE_OK) { rc = exec(db, "COMMIT;"); }
+	sqlite3_close(db);
+	return rc;
+}
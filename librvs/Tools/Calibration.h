@@ -0,0 +1,102 @@
+/// ********************************************************** ///
+/// Name: Calibration.h                                        ///
+/// Desc: Fits the shrub growth rates of each BPS model to the ///
+/// plots of Plot_Observations. A model's gr_cov and gr_ht are ///
+/// scaled for all its cohorts at once, and the scales are     ///
+/// searched with Nelder-Mead on a log scale. Every loss       ///
+/// evaluation simulates succession and biomass of the model's ///
+/// plots from their starting values with the output           ///
+/// discarded, on scratch copies of the plots that are reset   ///
+/// each time. After the first evaluation only plot-years that ///
+/// add shrub records allocate. Models are fitted on separate  ///
+/// threads.                                                   ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../DataManagement/AnalysisPlot.h"
+#include "../Biomass/BiomassDriver.h"
+#include "../Succession/SuccessionDIO.h"
+#include "../Succession/SuccessionDriver.h"
+
+namespace RVS
+{
+namespace Tools
+{
+	struct CalibrationOptions
+	{
+		int maxEvaluations;    // Loss evaluations per model
+		// Stops once the losses of the simplex are within tolerance of each other, relative to the best
+		double tolerance;
+		double initialStep;    // Of the log scales, 0.2 is about 20%
+		int threads;           // 0 uses every core
+		// Weights of the normalized cover, height and biomass errors
+		double coverWeight;
+		double heightWeight;
+		double biomassWeight;
+	};
+
+	struct CalibrationResult
+	{
+		std::string model;
+		int plots;
+		int observations;
+		double grCovScale;     // Fitted scales of the model's GR_COV and GR_HT
+		double grHtScale;
+		double initialLoss;    // Loss with the rates as read
+		double loss;
+		int evaluations;
+		bool converged;
+		long allocations;      // Heap allocations of the last evaluation, RVS_COUNT_ALLOCS builds only
+	};
+
+	// 200 evaluations, tolerance 1e-4, steps of 0.2, every core, all errors weighted 1
+	CalibrationOptions defaultCalibrationOptions(void);
+
+	class Calibration
+	{
+	public:
+		// Plots as loaded, which are left untouched. Only plots with observations are fitted,
+		// grouped by BPS model.
+		Calibration(std::vector<RVS::DataManagement::AnalysisPlot*> plots,
+			const std::map<int, std::vector<RVS::Succession::PlotObservation>>& observations,
+			const RVS::Biomass::BiomassDriver& bd, const RVS::Succession::SuccessionDriver& sd);
+
+		// Fits every model, results ordered by model
+		std::vector<CalibrationResult> run(const CalibrationOptions& options);
+
+		inline size_t NUM_MODELS() { return models.size(); }
+
+		static void report(std::ostream& out, const std::vector<CalibrationResult>& results);
+		// Copies the input database at inPath to outPath with the fitted rates, and lists the
+		// fits in Calibrated_Growthrates. Returns SQLITE_OK or the first sqlite error.
+		static int writeCalibrated(const char* inPath, const char* outPath, const std::vector<CalibrationResult>& results);
+
+	private:
+		struct ModelPlots
+		{
+			std::string model;
+			std::vector<RVS::DataManagement::AnalysisPlot*> plots;
+			std::vector<const std::vector<RVS::Succession::PlotObservation>*> observations;
+			int numObservations;
+			double cost;           // Plot-years to simulate per evaluation
+			double means[3];       // Mean observed cover, height and biomass, to normalize the errors
+		};
+
+		std::vector<ModelPlots> models;
+		RVS::Biomass::BiomassDriver bd;
+		RVS::Succession::SuccessionDriver sd;
+	};
+}
+}
+
+#endif
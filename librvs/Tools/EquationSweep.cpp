@@ -0,0 +1,331 @@
+#include "EquationSweep.h"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <sqlite3.h>
+
+#include "../RVSDEF.h"
+#include "../RVSDBNAMES.h"
+#include "../Biomass/BiomassEquations.h"
+
+#if USEMULTIT
+#include <atomic>
+#include <thread>
+#endif
+
+using RVS::Tools::SweepGrid;
+using RVS::Tools::SweepResult;
+
+// Relative drop between neighboring grid points that counts as decreasing, so rounding
+// in flat equations isn't flagged
+static const double DECREASE_TOLERANCE = 1e-9;
+// Flagged equations printed, the rest are only in the results file
+static const int PRINTED_FLAGS = 50;
+
+namespace
+{
+	struct Equation
+	{
+		int number;
+		bool stemsPerAcre;
+		double coefs[4];
+		std::string params[3];
+	};
+
+	const char* FLAG_NAMES[] = { "nan", "infinite", "negative", "height_decreasing", "cover_decreasing",
+		"width_decreasing", "missing_parameter", "all_zero" };
+	const int NUM_FLAGS = sizeof(FLAG_NAMES) / sizeof(FLAG_NAMES[0]);
+
+	std::string text(sqlite3_stmt* stmt, int column)
+	{
+		const unsigned char* value = sqlite3_column_text(stmt, column);
+		return value == NULL ? "" : std::string((const char*)value);
+	}
+
+	// A parameter at a grid point, as SppRecord::requestValue gives it for a shrub
+	double parameter(const std::string& name, double height, double cover, double width)
+	{
+		if (name == "WID" || name == "LEN") { return width; }
+		if (name == "HT") { return height; }
+		if (name == "COV") { return cover; }
+		if (name == "VOL") { return width * width * height; }
+		return 0.0;
+	}
+
+	void sweep(const Equation& equation, const SweepGrid& grid, SweepResult* result)
+	{
+		const size_t nh = grid.heights.size();
+		const size_t nc = grid.covers.size();
+		const size_t nw = grid.widths.size();
+		std::vector<double> values(nh * nc * nw, 0.0);
+		std::vector<char> evaluated(values.size(), 1);
+		std::map<std::string, double> params;
+
+		result->number = equation.number;
+		result->stemsPerAcre = equation.stemsPerAcre;
+		result->minimum = std::numeric_limits<double>::infinity();
+		result->maximum = -std::numeric_limits<double>::infinity();
+		result->flags = 0;
+		result->height = 0;
+		result->cover = 0;
+		result->width = 0;
+
+		bool allZero = true;
+		for (size_t h = 0; h < nh; h++)
+		{
+			for (size_t c = 0; c < nc; c++)
+			{
+				for (size_t w = 0; w < nw; w++)
+				{
+					size_t i = (h * nc + c) * nw + w;
+					double height = grid.heights[h];
+					double cover = grid.covers[c];
+					double width = grid.widths[w];
+					double value = 0;
+					if (equation.stemsPerAcre)
+					{
+						value = RVS::Biomass::BiomassEquations::eq_PCH(equation.coefs[0], equation.coefs[1], height);
+					}
+					else
+					{
+						params.clear();
+						for (int p = 0; p < 3; p++)
+						{
+							if (!equation.params[p].empty())
+							{
+								params[equation.params[p]] = parameter(equation.params[p], height, cover, width);
+							}
+						}
+						// As BiomassDriver::calcShrubBiomass picks the form of 1160
+						int number = equation.number;
+						if (number == 1160 && width * width * height <= 20000) { number = 1161; }
+						double coefs[4] = { equation.coefs[0], equation.coefs[1], equation.coefs[2], equation.coefs[3] };
+						try
+						{
+							value = RVS::Biomass::BiomassEquations::eq_BAT(number, coefs, &params);
+						}
+						catch (std::exception&)
+						{
+							result->flags |= RVS::Tools::SWEEP_MISSING_PARAMETER;
+							evaluated[i] = 0;
+							continue;
+						}
+					}
+					values[i] = value;
+
+					unsigned int flag = std::isnan(value) ? RVS::Tools::SWEEP_NAN : std::isinf(value) ? RVS::Tools::SWEEP_INFINITE : \
+						value < 0 ? RVS::Tools::SWEEP_NEGATIVE : 0;
+					if (flag != 0 && (result->flags & (RVS::Tools::SWEEP_NAN | RVS::Tools::SWEEP_INFINITE | RVS::Tools::SWEEP_NEGATIVE)) == 0)
+					{
+						result->height = height;
+						result->cover = cover;
+						result->width = width;
+					}
+					result->flags |= flag;
+					if (std::isfinite(value))
+					{
+						result->minimum = std::min(result->minimum, value);
+						result->maximum = std::max(result->maximum, value);
+					}
+					allZero = allZero && value == 0;
+				}
+			}
+		}
+
+		// Walk each axis with the other two fixed
+		const size_t strides[3] = { nc * nw, nw, 1 };
+		const size_t sizes[3] = { nh, nc, nw };
+		const unsigned int flags[3] = { RVS::Tools::SWEEP_HEIGHT_DECREASING, RVS::Tools::SWEEP_COVER_DECREASING,
+			RVS::Tools::SWEEP_WIDTH_DECREASING };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (size_t i = 0; i < values.size() && (result->flags & flags[axis]) == 0; i++)
+			{
+				// Only from the first point of each line along the axis
+				if ((i / strides[axis]) % sizes[axis] != 0) { continue; }
+				for (size_t k = 1; k < sizes[axis]; k++)
+				{
+					size_t previous = i + (k - 1) * strides[axis];
+					size_t next = i + k * strides[axis];
+					if (!evaluated[previous] || !evaluated[next]) { continue; }
+					if (!std::isfinite(values[previous]) || !std::isfinite(values[next])) { continue; }
+					if (values[next] < values[previous] - DECREASE_TOLERANCE * std::fabs(values[previous]))
+					{
+						result->flags |= flags[axis];
+						break;
+					}
+				}
+			}
+		}
+
+		bool anyEvaluated = std::find(evaluated.begin(), evaluated.end(), 1) != evaluated.end();
+		if (allZero && anyEvaluated) { result->flags |= RVS::Tools::SWEEP_ALL_ZERO; }
+	}
+
+	int queryEquations(sqlite3* db, std::vector<Equation>* equations)
+	{
+		std::set<int> stemsPerAcre;
+		std::string sql = std::string("SELECT DISTINCT ") + RVS::STEMS_PER_ACRE_EQUATION_FIELD + " FROM " + \
+			RVS::BIOMASS_CROSSWALK_TABLE + ";";
+		sqlite3_stmt* stmt;
+		int rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+		if (rc != SQLITE_OK) { return rc; }
+		while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+		{
+			stemsPerAcre.insert(sqlite3_column_int(stmt, 0));
+		}
+		sqlite3_finalize(stmt);
+		if (rc != SQLITE_DONE) { return rc; }
+
+		sql = std::string("SELECT ") + RVS::EQUATION_NUMBER_FIELD + ", " + RVS::EQN_COEF_1_FIELD + ", " + RVS::EQN_COEF_2_FIELD + \
+			", " + RVS::EQN_COEF_3_FIELD + ", " + RVS::EQN_COEF_4_FIELD + ", " + RVS::EQN_P1_FIELD + ", " + RVS::EQN_P2_FIELD + \
+			", " + RVS::EQN_P3_FIELD + " FROM " + RVS::BIOMASS_EQUATION_TABLE + " ORDER BY " + RVS::EQUATION_NUMBER_FIELD + ";";
+		rc = sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL);
+		if (rc != SQLITE_OK) { return rc; }
+		while ((rc = sqlite3_step(stmt)) == SQLITE_ROW)
+		{
+			Equation equation;
+			equation.number = sqlite3_column_int(stmt, 0);
+			equation.stemsPerAcre = stemsPerAcre.count(equation.number) > 0;
+			for (int c = 0; c < 4; c++)
+			{
+				equation.coefs[c] = sqlite3_column_double(stmt, 1 + c);
+			}
+			for (int p = 0; p < 3; p++)
+			{
+				equation.params[p] = text(stmt, 5 + p);
+			}
+			equations->push_back(equation);
+		}
+		sqlite3_finalize(stmt);
+		return rc == SQLITE_DONE ? SQLITE_OK : rc;
+	}
+
+	void writeList(std::ostream& out, const std::vector<double>& values)
+	{
+		out << "[";
+		for (size_t i = 0; i < values.size(); i++)
+		{
+			out << (i == 0 ? "" : ", ") << values[i];
+		}
+		out << "]";
+	}
+}
+
+SweepGrid RVS::Tools::defaultSweepGrid(void)
+{
+	const double heights[] = { 5, 10, 20, 30, 45, 60, 80, 100, 150, 200 };
+	const double covers[] = { 0.5, 1, 2, 5, 10, 15, 20, 30, 45, 60 };
+	const double widths[] = { 5, 10, 20, 35, 50, 75, 100, 150, 200, 300 };
+	SweepGrid grid;
+	grid.heights = std::vector<double>(heights, heights + sizeof(heights) / sizeof(heights[0]));
+	grid.covers = std::vector<double>(covers, covers + sizeof(covers) / sizeof(covers[0]));
+	grid.widths = std::vector<double>(widths, widths + sizeof(widths) / sizeof(widths[0]));
+	return grid;
+}
+
+int RVS::Tools::sweepEquations(const char* inPath, const SweepGrid& grid, int threads, std::vector<SweepResult>* results)
+{
+	sqlite3* db = NULL;
+	int rc = sqlite3_open_v2(inPath, &db, SQLITE_OPEN_READONLY, NULL);
+	std::vector<Equation> equations;
+	if (rc == SQLITE_OK) { rc = queryEquations(db, &equations); }
+	if (rc != SQLITE_OK) { std::cerr << "Can't read the equations of " << inPath << ": " << sqlite3_errmsg(db) << std::endl; }
+	sqlite3_close(db);
+	if (rc != SQLITE_OK) { return rc; }
+
+	results->assign(equations.size(), SweepResult());
+#if USEMULTIT
+	int workers = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+	workers = std::max(1, std::min(workers, (int)equations.size()));
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> pool;
+	for (int k = 0; k < workers; k++)
+	{
+		pool.push_back(std::thread([&]()
+		{
+			for (size_t e = next++; e < equations.size(); e = next++)
+			{
+				sweep(equations[e], grid, &(*results)[e]);
+			}
+		}));
+	}
+	for (auto &t : pool)
+	{
+		t.join();
+	}
+#else
+	(void)threads;
+	for (size_t e = 0; e < equations.size(); e++)
+	{
+		sweep(equations[e], grid, &(*results)[e]);
+	}
+#endif
+	return SQLITE_OK;
+}
+
+int RVS::Tools::writeSweepResults(const char* path, const SweepGrid& grid, const std::vector<SweepResult>& results, double seconds)
+{
+	std::ofstream out(path, std::ios::out);
+	if (!out.good()) { return -1; }
+
+	out << std::setprecision(9) << "{\"seconds\": " << seconds << ", \"heights\": ";
+	writeList(out, grid.heights);
+	out << ", \"covers\": ";
+	writeList(out, grid.covers);
+	out << ", \"widths\": ";
+	writeList(out, grid.widths);
+	out << ", \"equations\": [";
+
+	int flagged = 0;
+	for (size_t e = 0; e < results.size(); e++)
+	{
+		const SweepResult& r = results[e];
+		out << (e == 0 ? "" : ",") << "\n  {\"eq\": " << r.number << ", \"pch\": " << (r.stemsPerAcre ? "true" : "false");
+		if (r.minimum <= r.maximum) { out << ", \"min\": " << r.minimum << ", \"max\": " << r.maximum; }
+		out << ", \"flags\": \"" << sweepFlagNames(r.flags) << "\"";
+		if ((r.flags & (SWEEP_NAN | SWEEP_INFINITE | SWEEP_NEGATIVE)) != 0)
+		{
+			out << ", \"at\": [" << r.height << ", " << r.cover << ", " << r.width << "]";
+		}
+		out << "}";
+
+		if (r.flags == 0) { continue; }
+		if (flagged++ < PRINTED_FLAGS)
+		{
+			std::cout << "EQUATION " << r.number << (r.stemsPerAcre ? " (PCH): " : " (BAT): ") << sweepFlagNames(r.flags);
+			if ((r.flags & (SWEEP_NAN | SWEEP_INFINITE | SWEEP_NEGATIVE)) != 0)
+			{
+				std::cout << ", first at height " << r.height << " cover " << r.cover << " width " << r.width;
+			}
+			std::cout << std::endl;
+		}
+	}
+	out << "\n]}" << std::endl;
+	out.close();
+
+	if (flagged > PRINTED_FLAGS) { std::cout << "... and " << flagged - PRINTED_FLAGS << " more, see " << path << std::endl; }
+	std::cout << results.size() << " equations swept over " << grid.heights.size() * grid.covers.size() * grid.widths.size() << \
+		" grid points in " << seconds << " s, " << flagged << " flagged" << std::endl;
+	return flagged;
+}
+
+std::string RVS::Tools::sweepFlagNames(unsigned int flags)
+{
+	std::stringstream ss;
+	for (int f = 0; f < NUM_FLAGS; f++)
+	{
+		if ((flags & (1u << f)) == 0) { continue; }
+		ss << (ss.tellp() > 0 ? "," : "") << FLAG_NAMES[f];
+	}
+	return ss.str();
+}
@@ -0,0 +1,75 @@
+/// ********************************************************** ///
+/// Name: EquationSweep.h                                      ///
+/// Desc: Checks every equation of Bio_Equation over a grid of ///
+/// shrub heights, covers and widths instead of over the       ///
+/// plots of a landscape. Equations the crosswalk uses for     ///
+/// stems per acre go through eq_PCH, the rest through eq_BAT. ///
+/// Outputs that are NaN, infinite or negative, or that drop   ///
+/// as a shrub grows, are flagged. Equations are split over    ///
+/// threads in USEMULTIT builds.                               ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef EQUATIONSWEEP_H
+#define EQUATIONSWEEP_H
+
+#include <string>
+#include <vector>
+
+namespace RVS
+{
+namespace Tools
+{
+	// Grid values, sorted ascending. Widths are used for both LEN and WID, as SppRecord
+	// assumes round shrubs, and VOL is width * width * height.
+	struct SweepGrid
+	{
+		std::vector<double> heights;   // cm
+		std::vector<double> covers;    // %
+		std::vector<double> widths;    // cm
+	};
+
+	enum SweepFlag
+	{
+		SWEEP_NAN = 1,
+		SWEEP_INFINITE = 2,
+		SWEEP_NEGATIVE = 4,
+		SWEEP_HEIGHT_DECREASING = 8,    // Output drops as height grows, other values fixed
+		SWEEP_COVER_DECREASING = 16,
+		SWEEP_WIDTH_DECREASING = 32,
+		SWEEP_MISSING_PARAMETER = 64,   // The equation form reads a parameter the record doesn't list
+		SWEEP_ALL_ZERO = 128            // Usually a form eq_BAT doesn't handle
+	};
+
+	struct SweepResult
+	{
+		int number;
+		bool stemsPerAcre;
+		double minimum;      // Of the finite outputs
+		double maximum;
+		unsigned int flags;
+		// Grid point of the first NaN, infinite or negative output
+		double height;
+		double cover;
+		double width;
+	};
+
+	// Grid of typical sagebrush steppe shrub sizes
+	SweepGrid defaultSweepGrid(void);
+
+	// Sweeps every equation of the input database at inPath. threads 0 uses every core.
+	// Returns SQLITE_OK or the sqlite error that stopped it.
+	int sweepEquations(const char* inPath, const SweepGrid& grid, int threads, std::vector<SweepResult>* results);
+
+	// Writes one line per equation, and prints the flagged equations. Returns the number of
+	// flagged equations, or -1 if the file can't be written.
+	int writeSweepResults(const char* path, const SweepGrid& grid, const std::vector<SweepResult>& results, double seconds);
+
+	// Names of the flags that are set, separated by commas
+	std::string sweepFlagNames(unsigned int flags);
+}
+}
+
+#endif
@@ -0,0 +1,527 @@
+#include "LandscapeGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "../RVSDBNAMES.h"
+
+using RVS::Tools::LandscapeSpec;
+
+// Region the plots are spread over, the northern Great Basin
+static const double MIN_LATITUDE = 39.0;
+static const double MAX_LATITUDE = 44.0;
+static const double MIN_LONGITUDE = -120.0;
+static const double MAX_LONGITUDE = -113.0;
+
+// Climate levels the simulation reads by position: Dry, Mid-Dry, Normal, Mid-Wet, Wet
+static const int CLIMATE_LEVELS = 5;
+static const double NDVI_LEVELS[CLIMATE_LEVELS] = { 0.7, 0.85, 1.0, 1.1, 1.25 };
+static const double PPT_LEVELS[CLIMATE_LEVELS] = { 0.6, 0.8, 1.0, 1.2, 1.4 };
+
+// Share of a plot's shrubs that are its model's dominant species
+static const double DOMINANT_SHARE = 0.6;
+// Total shrub cover of a plot, in %
+static const double MAX_PLOT_COVER = 25.0;
+// Share of the disturbance rules that are grazing, the rest are fires
+static const double GRAZING_SHARE = 0.7;
+
+// First equation number of the per species stems per acre equations
+static const int PCH_EQUATION_BASE = 2000;
+
+namespace
+{
+	struct Species
+	{
+		const char* code;
+		const char* name;
+	};
+
+	// Common shrubs of the region. Species past these get made up codes.
+	const Species KNOWN_SPECIES[] = {
+		{ "ARTR2", "Artemisia tridentata" },
+		{ "CHVI8", "Chrysothamnus viscidiflorus" },
+		{ "PUTR2", "Purshia tridentata" },
+		{ "ARAR8", "Artemisia arbuscula" },
+		{ "ERNA10", "Ericameria nauseosa" },
+		{ "ARNO4", "Artemisia nova" },
+		{ "ATCO", "Atriplex confertifolia" },
+		{ "GRSP", "Grayia spinosa" },
+		{ "TEGL", "Tetradymia glabrata" },
+		{ "SAVE4", "Sarcobatus vermiculatus" },
+		{ "ATCA2", "Atriplex canescens" },
+		{ "EPNE", "Ephedra nevadensis" }
+	};
+	const int NUM_KNOWN_SPECIES = sizeof(KNOWN_SPECIES) / sizeof(KNOWN_SPECIES[0]);
+
+	struct BiomassEquation
+	{
+		int number;
+		double coefs[4];
+		const char* params[3];
+	};
+
+	// Biomass equation forms species are given in turn (see BiomassEquations::eq_BAT)
+	const BiomassEquation BIOMASS_EQUATIONS[] = {
+		{ 1008, { -2.1, 0.9, 0.8, 0.7 }, { "LEN", "WID", "HT" } },
+		{ 743, { 5.0, 0.02, 0.0, 0.0 }, { "COV", "HT", "" } },
+		{ 165, { 2.0, 8.5, 0.0, 0.0 }, { "COV", "", "" } },
+		{ 1153, { -0.9, 0.75, 0.6, 0.0 }, { "LEN", "WID", "HT" } },
+		{ 202, { 3.0, 0.9, 0.0, 0.0 }, { "COV", "", "" } }
+	};
+	const int NUM_BIOMASS_EQUATIONS = sizeof(BIOMASS_EQUATIONS) / sizeof(BIOMASS_EQUATIONS[0]);
+
+	const int FUEL_MODELS[] = { 102, 121, 122, 141, 142 };
+
+	// Draws are made from the engine's raw output, so a seed writes the same database
+	// whichever standard library the tool is built with
+	class Draw
+	{
+	public:
+		Draw(unsigned int seed) : engine(seed) {}
+
+		double uniform(double low, double high)
+		{
+			return low + (high - low) * (engine() / 4294967296.0);
+		}
+
+		int integer(int low, int high)
+		{
+			return low + (int)(uniform(0, 1) * (high - low + 1));
+		}
+
+		double normal(double mean, double sd)
+		{
+			double u = 1.0 - uniform(0, 1);
+			double v = uniform(0, 1);
+			return mean + sd * std::sqrt(-2.0 * std::log(u)) * std::cos(2.0 * 3.14159265358979 * v);
+		}
+
+		double lognormal(double median, double sd)
+		{
+			return median * std::exp(normal(0, sd));
+		}
+
+		int poisson(double mean)
+		{
+			double limit = std::exp(-mean);
+			double product = uniform(0, 1);
+			int count = 0;
+			while (product > limit)
+			{
+				product *= uniform(0, 1);
+				count++;
+			}
+			return count;
+		}
+
+		// Index 0..n-1 with weight 1/(i+1), a few common and many rare
+		int zipf(int n)
+		{
+			double total = 0;
+			for (int i = 0; i < n; i++) { total += 1.0 / (i + 1); }
+			double r = uniform(0, total);
+			for (int i = 0; i < n; i++)
+			{
+				r -= 1.0 / (i + 1);
+				if (r < 0) { return i; }
+			}
+			return n - 1;
+		}
+
+	private:
+		std::mt19937 engine;
+	};
+
+	struct Model
+	{
+		std::string name;
+		int bpsCode;
+		int dominant;      // Species index
+		int secondary;
+		double ndvi;       // Normal year NDVI and precipitation
+		double ppt;
+	};
+
+	int exec(sqlite3* db, const std::string& sql)
+	{
+		char* err = NULL;
+		int rc = sqlite3_exec(db, sql.c_str(), NULL, NULL, &err);
+		if (rc != SQLITE_OK)
+		{
+			std::cerr << "SQL error: " << (err != NULL ? err : sqlite3_errmsg(db)) << std::endl << sql << std::endl;
+			sqlite3_free(err);
+		}
+		return rc;
+	}
+
+	// Prepared insert of one row at a time. Values are bound in column order.
+	class Insert
+	{
+	public:
+		Insert(sqlite3* db, const char* table, int columns)
+		{
+			std::stringstream ss;
+			ss << "INSERT INTO " << table << " VALUES (";
+			for (int i = 0; i < columns; i++)
+			{
+				ss << (i == 0 ? "?" : ", ?");
+			}
+			ss << ");";
+			this->db = db;
+			rc = sqlite3_prepare_v2(db, ss.str().c_str(), -1, &stmt, NULL);
+			column = 0;
+		}
+
+		~Insert(void)
+		{
+			sqlite3_finalize(stmt);
+		}
+
+		Insert& operator<<(int value)
+		{
+			sqlite3_bind_int(stmt, ++column, value);
+			return *this;
+		}
+
+		Insert& operator<<(double value)
+		{
+			sqlite3_bind_double(stmt, ++column, value);
+			return *this;
+		}
+
+		Insert& operator<<(const std::string& value)
+		{
+			sqlite3_bind_text(stmt, ++column, value.c_str(), -1, SQLITE_TRANSIENT);
+			return *this;
+		}
+
+		Insert& operator<<(const char* value)
+		{
+			return *this << std::string(value);
+		}
+
+		// Writes the bound row
+		int row(void)
+		{
+			if (rc != SQLITE_OK) { return rc; }
+			if (sqlite3_step(stmt) != SQLITE_DONE)
+			{
+				rc = sqlite3_errcode(db);
+				std::cerr << "SQL error: " << sqlite3_errmsg(db) << std::endl;
+			}
+			sqlite3_reset(stmt);
+			column = 0;
+			return rc;
+		}
+
+		int STATUS(void) { return rc; }
+
+	private:
+		sqlite3* db;
+		sqlite3_stmt* stmt;
+		int rc;
+		int column;
+	};
+
+	std::string speciesCode(int i)
+	{
+		if (i < NUM_KNOWN_SPECIES) { return KNOWN_SPECIES[i].code; }
+		std::stringstream ss;
+		ss << "SYN" << i;
+		return ss.str();
+	}
+
+	std::string speciesName(int i)
+	{
+		if (i < NUM_KNOWN_SPECIES) { return KNOWN_SPECIES[i].name; }
+		std::stringstream ss;
+		ss << "Synthetic shrub " << i;
+		return ss.str();
+	}
+}
+
+LandscapeSpec RVS::Tools::defaultLandscape(int plots)
+{
+	LandscapeSpec spec = LandscapeSpec();
+	spec.plots = plots;
+	spec.shrubsPerPlot = 1.6;
+	spec.models = 12;
+	spec.species = 12;
+	spec.disturbanceRules = plots / 10;
+	spec.climateColumns = CLIMATE_LEVELS;
+	spec.seed = 1;
+	return spec;
+}
+
+int RVS::Tools::generateLandscape(const char* path, const LandscapeSpec& spec)
+{
+	int numPlots = std::max(spec.plots, 1);
+	int numModels = std::max(spec.models, 1);
+	int numSpecies = std::max(spec.species, 1);
+	int numClimate = std::max(spec.climateColumns, CLIMATE_LEVELS);
+	Draw draw(spec.seed);
+
+	std::remove(path);
+	sqlite3* db;
+	int rc = sqlite3_open(path, &db);
+	if (rc != SQLITE_OK)
+	{
+		std::cerr << "Can't open database: " << sqlite3_errmsg(db) << std::endl;
+		sqlite3_close(db);
+		return rc;
+	}
+	rc = exec(db, "PRAGMA journal_mode = OFF; PRAGMA synchronous = OFF; BEGIN;");
+
+	// Typical height of each species
+	std::vector<double> speciesHeights;
+	for (int s = 0; s < numSpecies; s++)
+	{
+		speciesHeights.push_back(std::min(std::max(draw.lognormal(50, 0.4), 15.0), 150.0));
+	}
+
+	std::vector<Model> models;
+	for (int m = 0; m < numModels; m++)
+	{
+		Model model = Model();
+		std::stringstream ss;
+		ss << 10800 + 10 * m;
+		model.name = ss.str();
+		model.bpsCode = 100 + m;
+		model.dominant = draw.zipf(numSpecies);
+		model.secondary = draw.integer(0, numSpecies - 1);
+		model.ndvi = draw.lognormal(3000, 0.25);
+		model.ppt = draw.lognormal(300, 0.3);
+		models.push_back(model);
+	}
+
+	// Plots sit on a jittered grid, numbered row by row. Models cover square patches of it,
+	// a few models most of the landscape.
+	int side = (int)std::ceil(std::sqrt((double)numPlots));
+	int patchSide = std::max(side / std::max((int)std::ceil(2 * std::sqrt((double)numModels)), 1), 1);
+	int patches = (side + patchSide - 1) / patchSide;
+	std::vector<int> patchModels;
+	for (int p = 0; p < patches * patches; p++)
+	{
+		patchModels.push_back(draw.zipf(numModels));
+	}
+
+	if (rc == SQLITE_OK)
+	{
+		std::stringstream ss;
+		ss << "CREATE TABLE " << RVS_INPUT_TABLE << " (PLOT_ID INTEGER, PLOT_NAME TEXT, evt_num INTEGER, BPS_CODE INTEGER, " << \
+			"BPS_MODEL TEXT, herb_cover REAL, herb_height REAL, sclass INTEGER, latitude REAL, longitude REAL";
+		for (int c = 1; c <= numClimate; c++)
+		{
+			ss << ", NDVI_" << c << " REAL";
+		}
+		for (int c = 1; c <= numClimate; c++)
+		{
+			ss << ", PPT_" << c << " REAL";
+		}
+		ss << ");";
+		rc = exec(db, ss.str());
+	}
+	if (rc == SQLITE_OK)
+	{
+		rc = exec(db, std::string("CREATE TABLE ") + SHRUB_INPUT_TABLE + " (PLOT_ID INTEGER, dom_spp TEXT, spp_code TEXT, height REAL, cover REAL);");
+	}
+
+	if (rc == SQLITE_OK)
+	{
+		Insert plot(db, RVS_INPUT_TABLE, 10 + 2 * numClimate);
+		Insert shrub(db, SHRUB_INPUT_TABLE, 5);
+		for (int p = 1; p <= numPlots && plot.STATUS() == SQLITE_OK && shrub.STATUS() == SQLITE_OK; p++)
+		{
+			int col = (p - 1) % side;
+			int row = (p - 1) / side;
+			const Model& model = models[patchModels[(row / patchSide) * patches + col / patchSide]];
+
+			// Draws are made one per statement, the order operands are evaluated in is up to
+			// the compiler
+			std::stringstream name;
+			name << "P" << p;
+			double herbCover = draw.uniform(5, 40);
+			double herbHeight = draw.uniform(5, 40);
+			int sclass = draw.integer(0, 3);
+			double latitude = MIN_LATITUDE + (MAX_LATITUDE - MIN_LATITUDE) * (row + draw.uniform(0.1, 0.9)) / side;
+			double longitude = MIN_LONGITUDE + (MAX_LONGITUDE - MIN_LONGITUDE) * (col + draw.uniform(0.1, 0.9)) / side;
+			plot << p << name.str() << 3080 << model.bpsCode << model.name << herbCover << herbHeight << sclass << latitude << longitude;
+
+			// Climate columns past the 5 levels hold more years around normal
+			double ndvi = model.ndvi * draw.lognormal(1, 0.1);
+			double ppt = model.ppt * draw.lognormal(1, 0.15);
+			for (int c = 0; c < numClimate; c++)
+			{
+				plot << ndvi * (c < CLIMATE_LEVELS ? NDVI_LEVELS[c] : std::max(draw.normal(1, 0.15), 0.3));
+			}
+			for (int c = 0; c < numClimate; c++)
+			{
+				plot << ppt * (c < CLIMATE_LEVELS ? PPT_LEVELS[c] : std::max(draw.normal(1, 0.25), 0.2));
+			}
+			rc = plot.row();
+
+			// Shrub covers are scaled down where they add up to more than the cohorts allow
+			int shrubs = spec.shrubsPerPlot > 0 ? draw.poisson(spec.shrubsPerPlot) : 0;
+			std::vector<int> species;
+			std::vector<double> heights;
+			std::vector<double> covers;
+			double totalCover = 0;
+			for (int s = 0; s < shrubs; s++)
+			{
+				species.push_back(draw.uniform(0, 1) < DOMINANT_SHARE ? model.dominant : draw.zipf(numSpecies));
+				heights.push_back(speciesHeights[species.back()] * draw.lognormal(1, 0.35));
+				covers.push_back(std::max(draw.lognormal(6, 0.6), 0.5));
+				totalCover += covers.back();
+			}
+			double coverScale = totalCover > MAX_PLOT_COVER ? MAX_PLOT_COVER / totalCover : 1;
+			for (int s = 0; s < shrubs && rc == SQLITE_OK; s++)
+			{
+				shrub << p << speciesName(species[s]) << speciesCode(species[s]) << heights[s] << covers[s] * coverScale;
+				rc = shrub.row();
+			}
+		}
+		if (rc == SQLITE_OK) { rc = plot.STATUS() != SQLITE_OK ? plot.STATUS() : shrub.STATUS(); }
+	}
+
+	// Species lookups and their equations
+	if (rc == SQLITE_OK)
+	{
+		rc = exec(db, std::string("CREATE TABLE ") + BIOMASS_CROSSWALK_TABLE + " (spp_code TEXT, BAT2 INTEGER, PCH INTEGER); " + \
+			"CREATE TABLE " + BIOMASS_EQUATION_TABLE + " (EQN_NUM INTEGER, CF1 REAL, CF2 REAL, CF3 REAL, CF4 REAL, " + \
+			"PA1_CODE TEXT, PA2_CODE TEXT, PA3_CODE TEXT, eqn_type INTEGER); " + \
+			"CREATE TABLE " + PLANTS_TABLE + " (Plants_Code TEXT, Lifeform2 TEXT, dom_spp TEXT);");
+	}
+	if (rc == SQLITE_OK)
+	{
+		Insert crosswalk(db, BIOMASS_CROSSWALK_TABLE, 3);
+		Insert equation(db, BIOMASS_EQUATION_TABLE, 9);
+		Insert plant(db, PLANTS_TABLE, 3);
+		for (int s = 0; s < numSpecies && rc == SQLITE_OK; s++)
+		{
+			crosswalk << speciesCode(s) << BIOMASS_EQUATIONS[s % NUM_BIOMASS_EQUATIONS].number << PCH_EQUATION_BASE + s;
+			rc = crosswalk.row();
+			if (rc == SQLITE_OK)
+			{
+				double intercept = draw.uniform(0.55, 0.95);
+				double slope = draw.uniform(1.3, 1.4);
+				equation << PCH_EQUATION_BASE + s << intercept << slope << 0.0 << 0.0 << "HT" << "" << "" << 1;
+				rc = equation.row();
+			}
+			if (rc == SQLITE_OK)
+			{
+				plant << speciesCode(s) << "shrub" << speciesName(s);
+				rc = plant.row();
+			}
+		}
+		for (int e = 0; e < NUM_BIOMASS_EQUATIONS && e < numSpecies && rc == SQLITE_OK; e++)
+		{
+			const BiomassEquation& eq = BIOMASS_EQUATIONS[e];
+			equation << eq.number << eq.coefs[0] << eq.coefs[1] << eq.coefs[2] << eq.coefs[3] << \
+				eq.params[0] << eq.params[1] << eq.params[2] << 1;
+			rc = equation.row();
+		}
+	}
+
+	// Succession cohorts, herb growth and fuel models of each BPS model
+	if (rc == SQLITE_OK)
+	{
+		rc = exec(db, std::string("CREATE TABLE ") + SUCCESSION_TABLE + " (BPS_MODEL TEXT, COHORT REAL, StartAge REAL, EndAge REAL, " + \
+			"MIDPOINT REAL, GR_HT REAL, GR_COV REAL, MAX_HT REAL, MAX_CC REAL, MIN_HT REAL, MIN_CC REAL, COHORT_TYPE TEXT, " + \
+			"Species_1 TEXT, Species_2 TEXT, Species_3 TEXT, Species_4 TEXT, COVER_TYPE TEXT, GoNoGo INTEGER); " + \
+			"CREATE TABLE " + HERB_GROWTH_TABLE + " (BPS_MODEL TEXT, CC_Slope REAL, HT_Slope REAL); " + \
+			"CREATE TABLE " + FUEL_BPS_ATTR_TABLE + " (BPS_CODE INTEGER, FBFM INTEGER, isDry INTEGER);");
+	}
+	if (rc == SQLITE_OK)
+	{
+		Insert cohort(db, SUCCESSION_TABLE, 18);
+		Insert herb(db, HERB_GROWTH_TABLE, 3);
+		Insert fuel(db, FUEL_BPS_ATTR_TABLE, 3);
+		for (auto &m : models)
+		{
+			double rate = draw.uniform(0.8, 1.2);
+			std::string dominant = speciesCode(m.dominant);
+			std::string secondary = speciesCode(m.secondary);
+			cohort << m.name << 1.0 << 0.0 << 5.0 << 2.0 << 0.5 * rate << 3.0 * rate << 30.0 << 15.0 << 0.0 << 0.0 << \
+				"H" << secondary << "" << "" << "" << "Early" << 1;
+			if (cohort.row() != SQLITE_OK) { break; }
+			cohort << m.name << 2.0 << 6.0 << 20.0 << 7.0 << 3.0 * rate << 1.5 * rate << 80.0 << 30.0 << 10.0 << 5.0 << \
+				"S" << dominant << secondary << "" << "" << "Mid" << 1;
+			if (cohort.row() != SQLITE_OK) { break; }
+			double maxCover = draw.uniform(35, 60);
+			cohort << m.name << 3.0 << 21.0 << 999.0 << 50.0 << 2.0 * rate << 0.9 * rate << \
+				std::max(speciesHeights[m.dominant] * 2, 60.0) << maxCover << 30.0 << 20.0 << \
+				"S" << dominant << "" << "" << "" << "Late" << 1;
+			if (cohort.row() != SQLITE_OK) { break; }
+
+			double coverSlope = 0.0203 * draw.uniform(0.8, 1.2);
+			double heightSlope = 0.000419 * draw.uniform(0.8, 1.2);
+			herb << m.name << coverSlope << heightSlope;
+			if (herb.row() != SQLITE_OK) { break; }
+
+			int fbfm = FUEL_MODELS[draw.integer(0, (int)(sizeof(FUEL_MODELS) / sizeof(FUEL_MODELS[0])) - 1)];
+			int isDry = draw.uniform(0, 1) < 0.8 ? 1 : 0;
+			fuel << m.bpsCode << fbfm << isDry;
+			if (fuel.row() != SQLITE_OK) { break; }
+		}
+		rc = cohort.STATUS() != SQLITE_OK ? cohort.STATUS() : herb.STATUS() != SQLITE_OK ? herb.STATUS() : fuel.STATUS();
+	}
+
+	if (rc == SQLITE_OK)
+	{
+		rc = exec(db, std::string("CREATE TABLE ") + COVARIANCE_TABLE + " (c1 REAL, c2 REAL, c3 REAL); " + \
+			"INSERT INTO " + COVARIANCE_TABLE + " VALUES (0.05, -0.004, 0.006); " + \
+			"INSERT INTO " + COVARIANCE_TABLE + " VALUES (-0.004, 0.0009, -0.0002); " + \
+			"INSERT INTO " + COVARIANCE_TABLE + " VALUES (0.006, -0.0002, 0.004);");
+	}
+
+	// Disturbance kinds, and the rules placing them on plots. Grazing repeats over a span of
+	// years, fires are single years with a severity of 1 to 3.
+	if (rc == SQLITE_OK)
+	{
+		rc = exec(db, std::string("CREATE TABLE ") + DISTURBANCE_TABLE + " (DIST_TYPE TEXT, DIST_SUBTYPE TEXT, " + \
+			"P1_NAME TEXT, P2_NAME TEXT, P3_NAME TEXT); " + \
+			"INSERT INTO " + DISTURBANCE_TABLE + " VALUES ('GRAZE', 'COW', 'NUMBER', 'AREA', 'LENGTH'); " + \
+			"INSERT INTO " + DISTURBANCE_TABLE + " VALUES ('GRAZE', 'SHEEP', 'NUMBER', 'AREA', 'LENGTH'); " + \
+			"INSERT INTO " + DISTURBANCE_TABLE + " VALUES ('FIRE', 'WILD', 'INTENSITY', '', ''); " + \
+			"CREATE TABLE " + DISTURBANCE_PLOT_TABLE + " (PLOT_ID INTEGER, DIST_TYPE TEXT, DIST_SUBTYPE TEXT, " + \
+			"START_YEAR INTEGER, STOP_YEAR INTEGER, FREQ INTEGER, P1_VAL REAL, P2_VAL REAL, P3_VAL REAL);");
+	}
+	if (rc == SQLITE_OK)
+	{
+		Insert rule(db, DISTURBANCE_PLOT_TABLE, 9);
+		for (int r = 0; r < spec.disturbanceRules && rc == SQLITE_OK; r++)
+		{
+			int p = draw.integer(1, numPlots);
+			if (draw.uniform(0, 1) < GRAZING_SHARE)
+			{
+				const char* animal = draw.uniform(0, 1) < 0.75 ? "COW" : "SHEEP";
+				int start = draw.integer(1, 5);
+				int stop = start + draw.integer(3, 15);
+				int freq = draw.integer(1, 3);
+				double number = draw.uniform(10, 80);
+				double area = draw.uniform(50, 500);
+				double length = draw.uniform(20, 90);
+				rule << p << "GRAZE" << animal << start << stop << freq << number << area << length;
+			}
+			else
+			{
+				int year = draw.integer(1, 20);
+				double severity = draw.integer(1, 3);
+				rule << p << "FIRE" << "WILD" << year << year << 0 << severity << 0.0 << 0.0;
+			}
+			rc = rule.row();
+		}
+	}
+
+	if (rc == SQLITE_OK) { rc = exec(db, "COMMIT;"); }
+	sqlite3_close(db);
+	return rc;
+}
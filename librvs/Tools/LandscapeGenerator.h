@@ -0,0 +1,41 @@
+/// ********************************************************** ///
+/// Name: LandscapeGenerator.h                                 ///
+/// Desc: Writes a synthetic input database with every table a ///
+/// run reads, for benchmarks and for sharing results without  ///
+/// the source data. Plots are spread over a sagebrush region, ///
+/// BPS models cover it in patches, and shrub counts, sizes    ///
+/// and climate are drawn from skewed distributions. The same  ///
+/// spec and seed always write the same database.              ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef LANDSCAPEGENERATOR_H
+#define LANDSCAPEGENERATOR_H
+
+namespace RVS
+{
+namespace Tools
+{
+	struct LandscapeSpec
+	{
+		int plots;
+		double shrubsPerPlot;   // Mean shrub records per plot, counts are Poisson
+		int models;             // BPS models
+		int species;            // Shrub species, ARTR2 is always one of them
+		int disturbanceRules;   // Rows of the plot disturbance table
+		int climateColumns;     // NDVI_ and PPT_ columns each, at least the 5 climate levels
+		unsigned int seed;
+	};
+
+	// Spec with typical proportions for a landscape of the given size
+	LandscapeSpec defaultLandscape(int plots);
+
+	// Writes the landscape to path, replacing any file there. Returns SQLITE_OK or the first
+	// sqlite error.
+	int generateLandscape(const char* path, const LandscapeSpec& spec);
+}
+}
+
+#endif
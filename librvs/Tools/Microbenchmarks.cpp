@@ -0,0 +1,298 @@
+#include "Microbenchmarks.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+
+#include "../Biomass/BiomassEquations.h"
+#include "../DataManagement/Arena.h"
+#include "../Fuels/FuelsEquations.h"
+#include "BenchmarkTools.h"
+
+using RVS::Tools::KernelTiming;
+using RVS::Tools::Microbenchmarks;
+
+// Best of this many timed batches counts
+static const int REPEATS = 5;
+// Calls between resets of the scratch arena, for kernels that allocate from it
+static const size_t ARENA_CALLS = 1024;
+
+namespace
+{
+	// One branch of BiomassEquations::eq_BAT, with coefficients that keep it finite for
+	// typical shrub sizes
+	struct BiomassForm
+	{
+		int number;
+		double coefs[4];
+	};
+
+	const BiomassForm BIOMASS_FORMS[] = {
+		{ 165, { 2.0, 8.5, 0.0, 0.0 } },
+		{ 201, { 0.5, 0.1, 0.0, 0.0 } },
+		{ 202, { 3.0, 0.9, 0.0, 0.0 } },
+		{ 500, { -1.0, 1.5, 0.0, 0.0 } },
+		{ 636, { -0.5, 0.9, 0.0, 0.0 } },
+		{ 743, { 5.0, 0.02, 0.0, 0.0 } },
+		{ 998, { 0.2, 1.2, 0.0, 0.0 } },
+		{ 999, { -0.5, 0.8, 0.9, 0.0 } },
+		{ 1000, { -1.2, 0.7, 0.7, 0.6 } },
+		{ 1001, { -0.5, 0.8, 0.9, 0.0 } },
+		{ 1002, { 1.0, 0.05, 0.0, 0.0 } },
+		{ 1008, { -2.1, 0.9, 0.8, 0.7 } },
+		{ 1012, { -1.0, 0.8, 0.7, 0.0 } },
+		{ 1025, { -1.0, 0.8, 0.7, 0.0 } },
+		{ 1058, { 1.0, 2.0, 3.0, 0.0 } },
+		{ 1067, { 3.0, 0.9, 0.0, 0.0 } },
+		{ 1136, { -0.5, 0.8, 0.9, 0.0 } },
+		{ 1153, { -0.9, 0.75, 0.6, 0.0 } },
+		{ 1160, { 1.0, 0.05, 0.0, 0.0 } },
+		{ 1161, { 1.0, 1000.0, 0.0, 0.0 } }
+	};
+	const int NUM_BIOMASS_FORMS = sizeof(BIOMASS_FORMS) / sizeof(BIOMASS_FORMS[0]);
+
+	// The equation types of FuelsEquations::calcFuels
+	const BiomassForm FUEL_FORMS[] = {
+		{ 1, { 10.0, 2.0, 0.0, 0.0 } },
+		{ 2, { 0.5, 0.9, 0.0, 0.0 } },
+		{ 13, { 1.0, 0.05, 0.0, 0.0 } },
+		{ 15, { 5.0, 0.1, 0.0, 0.0 } },
+		{ 17, { -1.0, 0.6, 0.5, 0.0 } },
+		{ 42, { -1.0, 0.5, 0.4, 0.3 } },
+		{ 46, { 2.0, 1.5, 0.3, 0.0 } }
+	};
+	const int NUM_FUEL_FORMS = sizeof(FUEL_FORMS) / sizeof(FUEL_FORMS[0]);
+
+	const double PCH_COEFS[2] = { 0.75, 1.35 };
+
+	// Wall time per evaluation of kernel(i), with i cycling through the inputs. The batch
+	// doubles until it runs for a fifth of the time given, then the best of REPEATS batches
+	// counts. Results go to a volatile so the calls can't be optimized away.
+	template <typename Kernel>
+	double nsPerEval(Kernel kernel, double seconds, size_t evalsPerCall = 1)
+	{
+		volatile double sink = 0;
+		size_t calls = 1;
+		double best = 0;
+		for (int r = 0; r < REPEATS; r++)
+		{
+			double elapsed = 0;
+			for (;;)
+			{
+				std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+				double sum = 0;
+				for (size_t n = 0; n < calls; n++)
+				{
+					sum += kernel(n & (Microbenchmarks::INPUTS - 1));
+				}
+				sink = sink + sum;
+				elapsed = RVS::Tools::secondsSince(start);
+				// Only the first repeat sizes the batch
+				if (r > 0 || elapsed >= seconds / REPEATS || calls >= ((size_t)1 << 30)) { break; }
+				calls *= 2;
+			}
+			best = r == 0 ? elapsed : std::min(best, elapsed);
+		}
+		return best * 1e9 / ((double)calls * evalsPerCall);
+	}
+
+	KernelTiming timing(const char* group, const std::string& kernel, double ns)
+	{
+		KernelTiming t;
+		t.group = group;
+		t.kernel = kernel;
+		t.nsPerEval = ns;
+		t.lanes = 1;
+		return t;
+	}
+
+	std::string numbered(const char* name, int number)
+	{
+		std::stringstream ss;
+		ss << name << " " << number;
+		return ss.str();
+	}
+}
+
+Microbenchmarks::Microbenchmarks(std::vector<RVS::DataManagement::AnalysisPlot*> plots, RVS::Fuels::FuelsDriver* fd,
+	RVS::Succession::SuccessionDriver* sd, unsigned int seed)
+	: fd(fd), sd(sd), classifier(RVS::Fuels::FBFMClassifier::builtinRules()), climate("Normal")
+{
+	std::vector<RVS::DataManagement::SppRecord*> records;
+	for (auto &p : plots)
+	{
+		records.insert(records.end(), p->SHRUB_RECORDS()->begin(), p->SHRUB_RECORDS()->end());
+	}
+
+	std::mt19937 engine(seed);
+	const char* names[] = { "LEN", "WID", "HT", "COV", "VOL" };
+	for (size_t i = 0; i < INPUTS && !records.empty(); i++)
+	{
+		RVS::DataManagement::SppRecord* record = records[engine() % records.size()];
+		std::map<std::string, double> params;
+		for (auto &name : names)
+		{
+			params[name] = record->requestValue(name);
+		}
+		shrubParams.push_back(params);
+		fuelParams.push_back(record->requestValue("COV"));
+		fuelParams.push_back(record->requestValue("HT"));
+		fuelParams.push_back(record->requestValue("BIO"));
+	}
+
+	for (size_t i = 0; i < INPUTS && !plots.empty(); i++)
+	{
+		RVS::DataManagement::AnalysisPlot* plot = plots[engine() % plots.size()];
+		samplePlots.push_back(plot);
+		plotBiomass.push_back(plot->SHRUBBIOMASS() * plot->POUNDS_TO_GRAMS);
+		// As SuccessionDriver::calcConfidence adjusts them
+		double adjust = 1 - (plot->SHRUBCOVER() / 100);
+		lnNDVI.push_back(log(plot->getNDVI(climate, false) * adjust));
+		lnPPT.push_back(log(plot->getPPT(climate, false) * adjust));
+		totals.push_back(RVS::Fuels::FBFMClassifier::totals(plot));
+	}
+}
+
+std::vector<KernelTiming> Microbenchmarks::run(double secondsPerKernel)
+{
+	std::vector<KernelTiming> timings;
+	if (shrubParams.empty() || samplePlots.empty()) { return timings; }
+
+	for (int f = 0; f < NUM_BIOMASS_FORMS; f++)
+	{
+		const BiomassForm* form = &BIOMASS_FORMS[f];
+		double ns = nsPerEval([this, form](size_t i)
+		{
+			double coefs[4] = { form->coefs[0], form->coefs[1], form->coefs[2], form->coefs[3] };
+			return RVS::Biomass::BiomassEquations::eq_BAT(form->number, coefs, &shrubParams[i]);
+		}, secondsPerKernel);
+		timings.push_back(timing("biomass", numbered("eq_BAT", form->number), ns));
+	}
+	timings.push_back(timing("biomass", "eq_PCH", nsPerEval([this](size_t i)
+	{
+		return RVS::Biomass::BiomassEquations::eq_PCH(PCH_COEFS[0], PCH_COEFS[1], fuelParams[3 * i + 1]);
+	}, secondsPerKernel)));
+
+	for (int f = 0; f < NUM_FUEL_FORMS; f++)
+	{
+		const BiomassForm* form = &FUEL_FORMS[f];
+		double ns = nsPerEval([this, form](size_t i)
+		{
+			double coefs[4] = { form->coefs[0], form->coefs[1], form->coefs[2], form->coefs[3] };
+			return RVS::Fuels::FuelsEquations::calcFuels(form->number, coefs, &fuelParams[3 * i]);
+		}, secondsPerKernel);
+		timings.push_back(timing("fuels", numbered("calcFuels", form->number), ns));
+	}
+
+	// The pools read the driver's plot, the production kernels write to theirs
+	RVS::DataManagement::AnalysisPlot* fuelsPlot = fd->ap;
+	RVS::DataManagement::AnalysisPlot* successionPlot = sd->ap;
+	std::string* successionClimate = sd->climate;
+
+	timings.push_back(timing("pools", "calc1HrWoodBark", nsPerEval([this](size_t i)
+	{
+		return fd->calc1HrWoodBark(plotBiomass[i]);
+	}, secondsPerKernel)));
+	timings.push_back(timing("pools", "calc1HrFoliage", nsPerEval([this](size_t i)
+	{
+		return fd->calc1HrFoliage(plotBiomass[i]);
+	}, secondsPerKernel)));
+	timings.push_back(timing("pools", "calc1HrFuel", nsPerEval([this](size_t i)
+	{
+		return fd->calc1HrFuel(plotBiomass[i]);
+	}, secondsPerKernel)));
+	timings.push_back(timing("pools", "calc10HrFuel", nsPerEval([this](size_t i)
+	{
+		fd->ap = samplePlots[i];
+		return fd->calc10HrFuel(plotBiomass[i]);
+	}, secondsPerKernel)));
+	timings.push_back(timing("pools", "calc100HrFuel", nsPerEval([this](size_t i)
+	{
+		return fd->calc100HrFuel(plotBiomass[i]);
+	}, secondsPerKernel)));
+	timings.push_back(timing("pools", "calc1000HrFuel", nsPerEval([this](size_t i)
+	{
+		return fd->calc1000HrFuel(samplePlots[i]->SHRUBHEIGHT());
+	}, secondsPerKernel)));
+
+	sd->climate = &climate;
+	timings.push_back(timing("production", "calcProduction", nsPerEval([this](size_t i)
+	{
+		sd->ap = samplePlots[i];
+		return sd->calcProduction(0);
+	}, secondsPerKernel)));
+	RVS::DataManagement::Arena* scratch = RVS::DataManagement::Arena::scratch();
+	timings.push_back(timing("production", "calc_s2b", nsPerEval([this, scratch](size_t i)
+	{
+		if (i % ARENA_CALLS == 0) { scratch->reset(); }
+		sd->ap = samplePlots[i];
+		return sd->calc_s2b(&lnNDVI[i], &lnPPT[i]);
+	}, secondsPerKernel)));
+	scratch->reset();
+
+	fd->ap = fuelsPlot;
+	sd->ap = successionPlot;
+	sd->climate = successionClimate;
+
+	timings.push_back(timing("fbfm", "classify", nsPerEval([this](size_t i)
+	{
+		return (double)classifier.classify(totals[i]);
+	}, secondsPerKernel)));
+	// Each call classifies every input, so it is timed per plot
+	std::vector<RVS::Fuels::FBFM> fbfms;
+	timings.push_back(timing("fbfm", "classify batch", nsPerEval([this, &fbfms](size_t i)
+	{
+		classifier.classify(totals, &fbfms);
+		return (double)fbfms[i];
+	}, secondsPerKernel, INPUTS)));
+
+	return timings;
+}
+
+int Microbenchmarks::SIMD_DOUBLES(void)
+{
+#if defined(__AVX512F__)
+	return 8;
+#elif defined(__AVX__)
+	return 4;
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	return 2;
+#else
+	return 1;
+#endif
+}
+
+void Microbenchmarks::report(std::ostream& out, const std::vector<KernelTiming>& timings)
+{
+	out << std::left << std::setw(12) << "group" << std::setw(20) << "kernel" << std::right << std::setw(12) << "ns/eval" << \
+		std::setw(14) << "Meval/s" << std::setw(8) << "lanes" << std::setw(12) << "vector use" << std::endl;
+	for (auto &t : timings)
+	{
+		out << std::left << std::setw(12) << t.group << std::setw(20) << t.kernel << std::right << std::fixed << \
+			std::setprecision(2) << std::setw(12) << t.nsPerEval << std::setw(14) << 1e3 / t.nsPerEval << \
+			std::setw(8) << t.lanes << std::setprecision(0) << std::setw(11) << 100.0 * t.lanes / SIMD_DOUBLES() << "%" << std::endl;
+	}
+	out.unsetf(std::ios::floatfield);
+	out << "Vector width of this build: " << SIMD_DOUBLES() << " doubles" << std::endl;
+}
+
+bool Microbenchmarks::writeJson(const char* path, const std::vector<KernelTiming>& timings)
+{
+	std::ofstream out(path, std::ios::out);
+	if (!out.good()) { return false; }
+	out << std::setprecision(9) << "{\"simd_doubles\": " << SIMD_DOUBLES() << ", \"inputs\": " << INPUTS << ", \"kernels\": [";
+	for (size_t k = 0; k < timings.size(); k++)
+	{
+		const KernelTiming& t = timings[k];
+		out << (k == 0 ? "" : ",") << "\n  {\"group\": \"" << t.group << "\", \"kernel\": \"" << t.kernel << \
+			"\", \"ns_per_eval\": " << t.nsPerEval << ", \"evals_per_s\": " << 1e9 / t.nsPerEval << \
+			", \"lanes\": " << t.lanes << ", \"vector_efficiency\": " << (double)t.lanes / SIMD_DOUBLES() << "}";
+	}
+	out << "\n]}" << std::endl;
+	out.close();
+	return true;
+}
@@ -0,0 +1,81 @@
+/// ********************************************************** ///
+/// Name: Microbenchmarks.h                                    ///
+/// Desc: Times the kernels of a plot-year one at a time: the  ///
+/// biomass and fuel equations, the shrub fuel pools, herb     ///
+/// production and its variance, and the fuel model rules.     ///
+/// Inputs are drawn at random from the plots and shrubs of a  ///
+/// landscape after a simulated year. Each kernel reports ns   ///
+/// per evaluation and how much of the build's vector width    ///
+/// it uses, so batch kernels can be compared against these.   ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef MICROBENCHMARKS_H
+#define MICROBENCHMARKS_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../DataManagement/AnalysisPlot.h"
+#include "../Fuels/FBFMClassifier.h"
+#include "../Fuels/FuelsDriver.h"
+#include "../Succession/SuccessionDriver.h"
+
+namespace RVS
+{
+namespace Tools
+{
+	struct KernelTiming
+	{
+		std::string group;     // "biomass", "fuels", "pools", "production", "fbfm"
+		std::string kernel;
+		double nsPerEval;
+		int lanes;             // Values one pass of the kernel's arithmetic computes, 1 for scalar code
+	};
+
+	class Microbenchmarks
+	{
+	public:
+		// Plots the drivers have simulated for a year. Their values are read, and the production
+		// kernels overwrite the plots' raw production and s2y.
+		Microbenchmarks(std::vector<RVS::DataManagement::AnalysisPlot*> plots, RVS::Fuels::FuelsDriver* fd,
+			RVS::Succession::SuccessionDriver* sd, unsigned int seed = 1);
+
+		// Times every kernel for about secondsPerKernel
+		std::vector<KernelTiming> run(double secondsPerKernel);
+
+		// Doubles in one vector register of this build (SSE2 2, AVX 4, AVX-512 8)
+		static int SIMD_DOUBLES(void);
+
+		static void report(std::ostream& out, const std::vector<KernelTiming>& timings);
+		static bool writeJson(const char* path, const std::vector<KernelTiming>& timings);
+
+		// Inputs per kernel. A power of two, so the loop can wrap with a mask.
+		static const size_t INPUTS = 4096;
+
+	private:
+		RVS::Fuels::FuelsDriver* fd;
+		RVS::Succession::SuccessionDriver* sd;
+		RVS::Fuels::FBFMClassifier classifier;
+		std::string climate;
+
+		// Parameter maps of random shrub records, as the biomass drivers fill them
+		std::vector<std::map<std::string, double>> shrubParams;
+		// Fuel equation parameters (COV, HT, BIO) of the same records
+		std::vector<double> fuelParams;
+		// Random plots, with their shrub biomass (g/ac), the log climate the variance uses and
+		// their fuel totals
+		std::vector<RVS::DataManagement::AnalysisPlot*> samplePlots;
+		std::vector<double> plotBiomass;
+		std::vector<double> lnNDVI;
+		std::vector<double> lnPPT;
+		std::vector<RVS::Fuels::FuelTotals> totals;
+	};
+}
+}
+
+#endif
@@ -0,0 +1,432 @@
+#include "OutputComparator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+
+#include <sqlite3.h>
+
+#include "../RVSDBNAMES.h"
+
+using RVS::Tools::CompareOptions;
+using RVS::Tools::Tolerance;
+
+// Columns rows are matched on, in sort order. Tables use the ones they have.
+static const char* KEY_COLUMNS[] = { RVS::PLOT_NUM_FIELD, RVS::YEAR_OUT_FIELD, RVS::SPP_CODE_FIELD };
+static const int NUM_KEY_COLUMNS = 3;
+
+namespace
+{
+	struct ColumnStats
+	{
+		long diffs;
+		double maxAbsolute;
+		double maxRelative;
+	};
+
+	// Where a plot first differs
+	struct Divergence
+	{
+		sqlite3_int64 year;
+		std::string table;
+		std::string column;
+		std::string reference;
+		std::string candidate;
+	};
+
+	struct TableResult
+	{
+		long rows;
+		long onlyReference;
+		long onlyCandidate;
+		long differingRows;
+		std::vector<std::string> missingColumns;   // Columns only one side has, with the side
+		std::map<std::string, ColumnStats> columns;
+	};
+
+	std::string text(sqlite3_stmt* stmt, int column)
+	{
+		const unsigned char* value = sqlite3_column_text(stmt, column);
+		return value == NULL ? "NULL" : std::string((const char*)value);
+	}
+
+	std::vector<std::string> tableNames(sqlite3* db)
+	{
+		std::vector<std::string> names;
+		sqlite3_stmt* stmt;
+		if (sqlite3_prepare_v2(db, "SELECT name FROM sqlite_master WHERE type = 'table' AND name NOT LIKE 'sqlite_%' ORDER BY name;",
+			-1, &stmt, NULL) != SQLITE_OK) { return names; }
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			names.push_back(text(stmt, 0));
+		}
+		sqlite3_finalize(stmt);
+		return names;
+	}
+
+	std::vector<std::string> columnNames(sqlite3* db, const std::string& table)
+	{
+		std::vector<std::string> names;
+		std::string sql = "PRAGMA table_info(\"" + table + "\");";
+		sqlite3_stmt* stmt;
+		if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) { return names; }
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			names.push_back(text(stmt, 1));
+		}
+		sqlite3_finalize(stmt);
+		return names;
+	}
+
+	bool contains(const std::vector<std::string>& names, const std::string& name)
+	{
+		return std::find(names.begin(), names.end(), name) != names.end();
+	}
+
+	// The value as a number, if it is one or is text that is all number
+	bool number(sqlite3_stmt* stmt, int column, int type, double* value)
+	{
+		if (type == SQLITE_INTEGER || type == SQLITE_FLOAT)
+		{
+			*value = sqlite3_column_double(stmt, column);
+			return true;
+		}
+		if (type != SQLITE_TEXT) { return false; }
+		const char* s = (const char*)sqlite3_column_text(stmt, column);
+		char* end = NULL;
+		*value = strtod(s, &end);
+		return end != s && *end == '\0';
+	}
+
+	// Compares column c of the current rows. Differences of numbers are returned for the
+	// column statistics.
+	bool valuesMatch(sqlite3_stmt* a, sqlite3_stmt* b, int c, bool exact, const Tolerance& tolerance,
+		double* absolute, double* relative)
+	{
+		*absolute = 0;
+		*relative = 0;
+		int typeA = sqlite3_column_type(a, c);
+		int typeB = sqlite3_column_type(b, c);
+		if (typeA == SQLITE_NULL || typeB == SQLITE_NULL) { return typeA == typeB; }
+		if (typeA == SQLITE_INTEGER && typeB == SQLITE_INTEGER)
+		{
+			return sqlite3_column_int64(a, c) == sqlite3_column_int64(b, c);
+		}
+
+		double x = 0;
+		double y = 0;
+		if (!exact && number(a, c, typeA, &x) && number(b, c, typeB, &y))
+		{
+			if (x == y) { return true; }
+			*absolute = std::fabs(x - y);
+			double scale = std::max(std::fabs(x), std::fabs(y));
+			*relative = scale > 0 ? *absolute / scale : 0;
+			return *absolute <= tolerance.absolute || *absolute <= tolerance.relative * scale;
+		}
+		return text(a, c) == text(b, c);
+	}
+
+	// Orders the key columns of the current rows as the ORDER BY does
+	int compareKeys(sqlite3_stmt* a, sqlite3_stmt* b, const std::vector<int>& keys)
+	{
+		for (auto &k : keys)
+		{
+			if (sqlite3_column_type(a, k) == SQLITE_TEXT || sqlite3_column_type(b, k) == SQLITE_TEXT)
+			{
+				int order = text(a, k).compare(text(b, k));
+				if (order != 0) { return order < 0 ? -1 : 1; }
+			}
+			else
+			{
+				sqlite3_int64 x = sqlite3_column_int64(a, k);
+				sqlite3_int64 y = sqlite3_column_int64(b, k);
+				if (x != y) { return x < y ? -1 : 1; }
+			}
+		}
+		return 0;
+	}
+
+	const Tolerance& columnTolerance(const CompareOptions& options, const std::string& table, const std::string& column)
+	{
+		std::map<std::string, Tolerance>::const_iterator it = options.columns.find(table + "." + column);
+		if (it != options.columns.end()) { return it->second; }
+		it = options.columns.find(column);
+		return it != options.columns.end() ? it->second : options.defaults;
+	}
+
+	// Keeps the earliest divergence of the plot
+	void diverged(std::map<sqlite3_int64, Divergence>* plots, sqlite3_int64 plot, const Divergence& divergence)
+	{
+		std::map<sqlite3_int64, Divergence>::iterator it = plots->find(plot);
+		if (it == plots->end() || divergence.year < it->second.year) { (*plots)[plot] = divergence; }
+	}
+
+	int compareTable(sqlite3* reference, sqlite3* candidate, const std::string& table, const CompareOptions& options,
+		TableResult* result, std::map<sqlite3_int64, Divergence>* plots, std::set<sqlite3_int64>* plotIds)
+	{
+		std::vector<std::string> referenceColumns = columnNames(reference, table);
+		std::vector<std::string> candidateColumns = columnNames(candidate, table);
+
+		std::vector<std::string> shared;
+		for (auto &c : referenceColumns)
+		{
+			if (options.ignored.count(c) > 0 || options.ignored.count(table + "." + c) > 0) { continue; }
+			if (contains(candidateColumns, c)) { shared.push_back(c); }
+			else { result->missingColumns.push_back(c + " (reference only)"); }
+		}
+		for (auto &c : candidateColumns)
+		{
+			if (options.ignored.count(c) > 0 || options.ignored.count(table + "." + c) > 0) { continue; }
+			if (!contains(referenceColumns, c)) { result->missingColumns.push_back(c + " (candidate only)"); }
+		}
+
+		std::vector<int> keys;
+		std::string order;
+		for (int k = 0; k < NUM_KEY_COLUMNS; k++)
+		{
+			std::vector<std::string>::iterator it = std::find(shared.begin(), shared.end(), KEY_COLUMNS[k]);
+			if (it == shared.end()) { continue; }
+			keys.push_back((int)(it - shared.begin()));
+			order += "\"" + *it + "\", ";
+		}
+		int plotColumn = !keys.empty() && shared[keys[0]] == RVS::PLOT_NUM_FIELD ? keys[0] : -1;
+		std::vector<std::string>::iterator yearIt = std::find(shared.begin(), shared.end(), RVS::YEAR_OUT_FIELD);
+		int yearColumn = yearIt == shared.end() ? -1 : (int)(yearIt - shared.begin());
+
+		std::vector<bool> exact;
+		std::vector<Tolerance> tolerances;
+		std::string select;
+		for (auto &c : shared)
+		{
+			select += (select.empty() ? "\"" : ", \"") + c + "\"";
+			exact.push_back(options.categorical.count(c) > 0 || options.categorical.count(table + "." + c) > 0);
+			tolerances.push_back(columnTolerance(options, table, c));
+		}
+		if (shared.empty()) { return SQLITE_OK; }
+
+		// Rows with equal keys pair up in the order they were written
+		std::string sql = "SELECT " + select + " FROM \"" + table + "\" ORDER BY " + order + "rowid;";
+		sqlite3_stmt* a = NULL;
+		sqlite3_stmt* b = NULL;
+		int rc = sqlite3_prepare_v2(reference, sql.c_str(), -1, &a, NULL);
+		if (rc == SQLITE_OK) { rc = sqlite3_prepare_v2(candidate, sql.c_str(), -1, &b, NULL); }
+		if (rc != SQLITE_OK)
+		{
+			sqlite3_finalize(a);
+			return rc;
+		}
+
+		int rcA = sqlite3_step(a);
+		int rcB = sqlite3_step(b);
+		while (rcA == SQLITE_ROW || rcB == SQLITE_ROW)
+		{
+			int order = rcA != SQLITE_ROW ? 1 : rcB != SQLITE_ROW ? -1 : compareKeys(a, b, keys);
+			sqlite3_stmt* row = order <= 0 ? a : b;
+			sqlite3_int64 plot = plotColumn >= 0 ? sqlite3_column_int64(row, plotColumn) : 0;
+			Divergence divergence;
+			divergence.year = yearColumn >= 0 ? sqlite3_column_int64(row, yearColumn) : 0;
+			divergence.table = table;
+			if (plotColumn >= 0) { plotIds->insert(plot); }
+
+			if (order != 0)
+			{
+				divergence.column = "(row)";
+				divergence.reference = order < 0 ? "present" : "missing";
+				divergence.candidate = order < 0 ? "missing" : "present";
+				if (plotColumn >= 0) { diverged(plots, plot, divergence); }
+				if (order < 0)
+				{
+					result->onlyReference++;
+					rcA = sqlite3_step(a);
+				}
+				else
+				{
+					result->onlyCandidate++;
+					rcB = sqlite3_step(b);
+				}
+				continue;
+			}
+
+			result->rows++;
+			bool differs = false;
+			for (size_t c = 0; c < shared.size(); c++)
+			{
+				double absolute = 0;
+				double relative = 0;
+				if (valuesMatch(a, b, (int)c, exact[c], tolerances[c], &absolute, &relative)) { continue; }
+
+				ColumnStats& stats = result->columns[shared[c]];
+				stats.diffs++;
+				stats.maxAbsolute = std::max(stats.maxAbsolute, absolute);
+				stats.maxRelative = std::max(stats.maxRelative, relative);
+				if (!differs && plotColumn >= 0)
+				{
+					divergence.column = shared[c];
+					divergence.reference = text(a, (int)c);
+					divergence.candidate = text(b, (int)c);
+					diverged(plots, plot, divergence);
+				}
+				differs = true;
+			}
+			if (differs) { result->differingRows++; }
+			rcA = sqlite3_step(a);
+			rcB = sqlite3_step(b);
+		}
+
+		rc = rcA != SQLITE_DONE ? rcA : rcB != SQLITE_DONE ? rcB : SQLITE_OK;
+		sqlite3_finalize(a);
+		sqlite3_finalize(b);
+		return rc;
+	}
+}
+
+CompareOptions RVS::Tools::defaultCompareOptions(void)
+{
+	CompareOptions options = CompareOptions();
+	options.defaults.absolute = 0;
+	options.defaults.relative = 0;
+	options.categorical.insert(FC_FBFM_FIELD);
+	options.categorical.insert("STAGE");
+	options.categorical.insert(COHORT_TYPE_FIELD);
+	options.reportPlots = 20;
+	return options;
+}
+
+bool RVS::Tools::parseTolerances(const std::vector<std::string>& entries, CompareOptions* options)
+{
+	for (auto &entry : entries)
+	{
+		size_t first = entry.find(':');
+		size_t second = first == std::string::npos ? std::string::npos : entry.find(':', first + 1);
+		if (first == 0 || second == std::string::npos) { return false; }
+
+		const char* absolute = entry.c_str() + first + 1;
+		const char* relative = entry.c_str() + second + 1;
+		char* end = NULL;
+		Tolerance tolerance;
+		tolerance.absolute = strtod(absolute, &end);
+		if (end != entry.c_str() + second) { return false; }
+		tolerance.relative = strtod(relative, &end);
+		if (end == relative || *end != '\0') { return false; }
+
+		std::string column = entry.substr(0, first);
+		if (column == "*") { options->defaults = tolerance; }
+		else { options->columns[column] = tolerance; }
+	}
+	return true;
+}
+
+int RVS::Tools::compareOutputs(const char* referencePath, const char* candidatePath, const CompareOptions& options,
+	std::ostream& out)
+{
+	sqlite3* reference = NULL;
+	sqlite3* candidate = NULL;
+	const char* failed = referencePath;
+	int rc = sqlite3_open_v2(referencePath, &reference, SQLITE_OPEN_READONLY, NULL);
+	if (rc == SQLITE_OK)
+	{
+		failed = candidatePath;
+		rc = sqlite3_open_v2(candidatePath, &candidate, SQLITE_OPEN_READONLY, NULL);
+	}
+	if (rc != SQLITE_OK)
+	{
+		out << "Can't open " << failed << ": " << sqlite3_errstr(rc) << std::endl;
+		sqlite3_close(reference);
+		sqlite3_close(candidate);
+		return rc;
+	}
+
+	out << "Comparing " << candidatePath << " against " << referencePath << std::endl;
+
+	std::vector<std::string> referenceTables = tableNames(reference);
+	std::vector<std::string> candidateTables = tableNames(candidate);
+	std::map<sqlite3_int64, Divergence> plots;
+	std::set<sqlite3_int64> plotIds;
+	bool diverges = false;
+
+	for (auto &t : candidateTables)
+	{
+		if (!contains(referenceTables, t))
+		{
+			out << t << ": candidate only" << std::endl;
+			diverges = true;
+		}
+	}
+	for (auto &t : referenceTables)
+	{
+		if (!contains(candidateTables, t))
+		{
+			out << t << ": reference only" << std::endl;
+			diverges = true;
+			continue;
+		}
+
+		TableResult result = TableResult();
+		rc = compareTable(reference, candidate, t, options, &result, &plots, &plotIds);
+		if (rc != SQLITE_OK)
+		{
+			out << t << ": " << sqlite3_errstr(rc) << std::endl;
+			break;
+		}
+
+		bool tableMatches = result.onlyReference == 0 && result.onlyCandidate == 0 && result.differingRows == 0 && \
+			result.missingColumns.empty();
+		diverges = diverges || !tableMatches;
+		out << t << ": " << result.rows << " rows";
+		if (tableMatches)
+		{
+			out << " match" << std::endl;
+			continue;
+		}
+		out << ", " << result.differingRows << " differ, " << result.onlyReference << " reference only, " << \
+			result.onlyCandidate << " candidate only" << std::endl;
+		for (auto &c : result.missingColumns)
+		{
+			out << "    column " << c << std::endl;
+		}
+		for (auto &c : result.columns)
+		{
+			out << "    " << std::left << std::setw(24) << c.first << std::right << std::setw(10) << c.second.diffs << \
+				" values  max abs " << std::setw(12) << c.second.maxAbsolute << "  max rel " << std::setw(12) << \
+				c.second.maxRelative << std::endl;
+		}
+	}
+
+	if (rc == SQLITE_OK && !plots.empty())
+	{
+		std::map<sqlite3_int64, int> firstYears;
+		for (auto &p : plots)
+		{
+			firstYears[p.second.year]++;
+		}
+		out << std::endl << plots.size() << " of " << plotIds.size() << " plots diverge. First diverging year: ";
+		for (auto &y : firstYears)
+		{
+			out << (y.first == firstYears.begin()->first ? "" : ", ") << y.first << " (" << y.second << " plots)";
+		}
+		out << std::endl;
+
+		out << std::left << std::setw(10) << "PLOT_ID" << std::setw(6) << "year" << std::setw(25) << "table" << \
+			std::setw(24) << "column" << std::setw(20) << "reference" << " candidate" << std::endl;
+		size_t listed = 0;
+		for (auto &p : plots)
+		{
+			if (listed++ == options.reportPlots) { break; }
+			out << std::setw(10) << p.first << std::setw(6) << p.second.year << std::setw(25) << p.second.table << \
+				std::setw(24) << p.second.column << std::setw(20) << p.second.reference << " " << p.second.candidate << std::endl;
+		}
+		if (plots.size() > options.reportPlots)
+		{
+			out << "... and " << plots.size() - options.reportPlots << " more plots" << std::endl;
+		}
+		out << std::right;
+	}
+
+	sqlite3_close(reference);
+	sqlite3_close(candidate);
+	if (rc != SQLITE_OK) { return rc; }
+
+	out << std::endl << (diverges ? "Outputs diverge" : "Outputs match") << std::endl;
+	return diverges ? 1 : 0;
+}
@@ -0,0 +1,63 @@
+/// ********************************************************** ///
+/// Name: OutputComparator.h                                   ///
+/// Desc: Compares a run's output database against a reference ///
+/// run, for signing off on changes that should not change     ///
+/// results. Tables are walked in (PLOT_ID, year, spp_code)    ///
+/// order and matched on those keys. Numbers pass within the   ///
+/// absolute or relative tolerance of their column, integers,  ///
+/// text and categorical columns have to match exactly. The    ///
+/// report gives the first diverging year of each plot.        ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef OUTPUTCOMPARATOR_H
+#define OUTPUTCOMPARATOR_H
+
+#include <map>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace RVS
+{
+namespace Tools
+{
+	// Two values match when |a - b| <= absolute or |a - b| <= relative * max(|a|, |b|)
+	struct Tolerance
+	{
+		double absolute;
+		double relative;
+	};
+
+	struct CompareOptions
+	{
+		Tolerance defaults;
+		// Tolerances by column name, or by "table.column", which wins over the name alone
+		std::map<std::string, Tolerance> columns;
+		// Compared exactly even when they hold numbers, e.g. FBFM and STAGE
+		std::set<std::string> categorical;
+		// Not compared at all
+		std::set<std::string> ignored;
+		// Plots listed with their first diverging year, the rest are only counted
+		size_t reportPlots;
+	};
+
+	// Exact matching, FBFM, STAGE and COHORT_TYPE categorical, 20 plots reported
+	CompareOptions defaultCompareOptions(void);
+
+	// Parses "column:absolute:relative" entries, column "*" sets the defaults. False if an
+	// entry is malformed.
+	bool parseTolerances(const std::vector<std::string>& entries, CompareOptions* options);
+
+	// Compares every table of the two output databases and writes the divergence report to
+	// out. Returns 0 when they match, 1 when they diverge, or the sqlite error that stopped
+	// the comparison.
+	int compareOutputs(const char* referencePath, const char* candidatePath, const CompareOptions& options,
+		std::ostream& out);
+}
+}
+
+#endif
@@ -0,0 +1,177 @@
+#include "SelfTests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <sstream>
+
+#include <sqlite3.h>
+
+#include "../RVSDBNAMES.h"
+
+using RVS::Fuels::FBFMClassifier;
+using RVS::Fuels::FBFMCondition;
+using RVS::Fuels::FBFMRule;
+using RVS::Fuels::FuelTotals;
+
+namespace
+{
+	int exec(sqlite3* db, const std::string& sql)
+	{
+		char* err = NULL;
+		int rc = sqlite3_exec(db, sql.c_str(), NULL, NULL, &err);
+		if (rc != SQLITE_OK)
+		{
+			std::cerr << "SQL error: " << (err != NULL ? err : sqlite3_errmsg(db)) << std::endl << sql << std::endl;
+			sqlite3_free(err);
+		}
+		return rc;
+	}
+
+	const char* opText(FBFMCondition::Op op)
+	{
+		switch (op)
+		{
+		case FBFMCondition::LESS: return "<";
+		case FBFMCondition::LESS_EQUAL: return "<=";
+		case FBFMCondition::GREATER: return ">";
+		case FBFMCondition::GREATER_EQUAL: return ">=";
+		}
+		return "";
+	}
+}
+
+int RVS::Tools::writeRuleTable(const char* path, const std::vector<FBFMRule>& rules)
+{
+	// Bound columns of each feature, in FuelFeature order. Kept apart from the reader's list on
+	// purpose, the check catches the two drifting.
+	const char* bounds[RVS::Fuels::NUM_FUEL_FEATURES][2] = {
+		{ FC_PROPORTION_LOWER, FC_PROPORTION_UPPER },
+		{ FC_HERB_PROPORTION_LOWER, FC_HERB_PROPORTION_UPPER },
+		{ FC_SHRUB_FUEL_LOWER, FC_SHRUB_FUEL_UPPER },
+		{ FC_SHRUB_FINE_FUEL_LOWER, FC_SHRUB_FINE_FUEL_UPPER },
+		{ FC_HERB_1HR_LOWER, FC_HERB_1HR_UPPER },
+		{ FC_TOTAL_FUEL_LOWER, FC_TOTAL_FUEL_UPPER },
+		{ FC_HT_LOWER, FC_HT_UPPER },
+		{ FC_SHRUB_COV_LOWER, FC_SHRUB_COV_UPPER },
+		{ FC_HERB_PROD_LOWER, FC_HERB_PROD_UPPER }
+	};
+
+	sqlite3* db = NULL;
+	int rc = sqlite3_open(path, &db);
+	if (rc != SQLITE_OK) { sqlite3_close(db); return rc; }
+
+	// FBFM, Priority, isDry, then value and op of every bound
+	std::stringstream create;
+	create << "DROP TABLE IF EXISTS " << FUEL_CLASSRULES_TABLE << "; CREATE TABLE " << FUEL_CLASSRULES_TABLE << " (" << \
+		FC_FBFM_FIELD << " TEXT, " << FC_PRIORITY_FIELD << " INTEGER, " << FC_ISDRY_FIELD << " INTEGER";
+	std::stringstream insert;
+	insert << "INSERT INTO " << FUEL_CLASSRULES_TABLE << " VALUES (?, ?, ?";
+	for (int f = 0; f < RVS::Fuels::NUM_FUEL_FEATURES; f++)
+	{
+		for (int b = 0; b < 2; b++)
+		{
+			create << ", " << bounds[f][b] << " REAL, " << bounds[f][b] << FC_BOUND_OP_SUFFIX << " TEXT";
+			insert << ", ?, ?";
+		}
+	}
+	create << ");";
+	insert << ");";
+
+	rc = exec(db, "BEGIN TRANSACTION;");
+	if (rc == SQLITE_OK) { rc = exec(db, create.str()); }
+
+	sqlite3_stmt* stmt = NULL;
+	if (rc == SQLITE_OK) { rc = sqlite3_prepare_v2(db, insert.str().c_str(), -1, &stmt, NULL); }
+	for (size_t r = 0; r < rules.size() && rc == SQLITE_OK; r++)
+	{
+		const FBFMRule& rule = rules[r];
+		sqlite3_reset(stmt);
+		sqlite3_clear_bindings(stmt);
+		sqlite3_bind_text(stmt, 1, FBFMClassifier::NAME(rule.fbfm), -1, SQLITE_TRANSIENT);
+		sqlite3_bind_int(stmt, 2, rule.priority);
+		// NULL applies the rule to both climates
+		if (rule.climate != FBFMRule::ANY) { sqlite3_bind_int(stmt, 3, rule.climate == FBFMRule::DRY ? 1 : 0); }
+
+		for (int c = 0; c < rule.numConditions; c++)
+		{
+			const FBFMCondition* cond = &rule.conditions[c];
+			int b = cond->op == FBFMCondition::LESS || cond->op == FBFMCondition::LESS_EQUAL ? 1 : 0;
+			int column = 4 + 4 * cond->feature + 2 * b;
+			sqlite3_bind_double(stmt, column, cond->bound);
+			// Default comparisons are left NULL, so the defaults are read too
+			if (cond->op == FBFMCondition::GREATER || cond->op == FBFMCondition::LESS_EQUAL)
+			{
+				sqlite3_bind_text(stmt, column + 1, opText(cond->op), -1, SQLITE_TRANSIENT);
+			}
+		}
+
+		rc = sqlite3_step(stmt) == SQLITE_DONE ? SQLITE_OK : sqlite3_errcode(db);
+	}
+	sqlite3_finalize(stmt);
+
+	if (rc == SQLITE_OK) { rc = exec(db, "COMMIT;"); }
+	sqlite3_close(db);
+	return rc;
+}
+
+int RVS::Tools::flattenHerbCoverGrowth(const char* path)
+{
+	sqlite3* db = NULL;
+	int rc = sqlite3_open(path, &db);
+	if (rc != SQLITE_OK) { sqlite3_close(db); return rc; }
+
+	std::stringstream sql;
+	sql << "UPDATE " << SUCCESSION_TABLE << " SET " << SUCCESSION_GR_COV_FIELD << " = 0 WHERE " << \
+		COHORT_TYPE_FIELD << " = 'H';";
+	rc = exec(db, sql.str());
+	sqlite3_close(db);
+	return rc;
+}
+
+int RVS::Tools::classifierDifferences(const std::vector<FBFMRule>& rules,
+	const FBFMClassifier& a, const FBFMClassifier& b, int samples)
+{
+	// Values worth testing for each feature: zero, and every bound and its neighbors
+	std::vector<double> candidates[RVS::Fuels::NUM_FUEL_FEATURES];
+	for (int f = 0; f < RVS::Fuels::NUM_FUEL_FEATURES; f++)
+	{
+		candidates[f].push_back(0);
+	}
+	for (const FBFMRule& rule : rules)
+	{
+		for (int c = 0; c < rule.numConditions; c++)
+		{
+			const FBFMCondition* cond = &rule.conditions[c];
+			double step = 1e-6 * std::max(1.0, std::abs(cond->bound));
+			candidates[cond->feature].push_back(cond->bound - step);
+			candidates[cond->feature].push_back(cond->bound);
+			candidates[cond->feature].push_back(cond->bound + step);
+		}
+	}
+
+	// Seeded, the check draws the same totals every run
+	std::mt19937 engine(12345);
+	int differences = 0;
+	for (int s = 0; s < samples; s++)
+	{
+		FuelTotals totals = FuelTotals();
+		for (int f = 0; f < RVS::Fuels::NUM_FUEL_FEATURES; f++)
+		{
+			std::uniform_int_distribution<size_t> pick(0, candidates[f].size() - 1);
+			totals.values[f] = candidates[f][pick(engine)];
+		}
+		totals.isDry = s % 2 == 0;
+
+		if (a.classify(totals) != b.classify(totals)) { differences++; }
+	}
+	return differences;
+}
+
+int RVS::Tools::reportCheck(std::ostream& out, const std::string& name, bool passed, const std::string& detail)
+{
+	out << (passed ? "PASS " : "FAIL ") << name;
+	if (!detail.empty()) { out << ": " << detail; }
+	out << std::endl;
+	return passed ? 0 : 1;
+}
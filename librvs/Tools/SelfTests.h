@@ -0,0 +1,42 @@
+/// ********************************************************** ///
+/// Name: SelfTests.h                                          ///
+/// Desc: Pieces of the checks rvs selftest runs against a     ///
+/// generated landscape. Each check prints one PASS or FAIL    ///
+/// line, the subcommand returns the number that failed.       ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef SELFTESTS_H
+#define SELFTESTS_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../Fuels/FBFMClassifier.h"
+
+namespace RVS
+{
+namespace Tools
+{
+	// Writes the rules as the Fuel_ClassRules table of the database at path, replacing any
+	// there. Returns SQLITE_OK or the first sqlite error.
+	int writeRuleTable(const char* path, const std::vector<RVS::Fuels::FBFMRule>& rules);
+
+	// Sets GR_COV of the herb cohorts in the database at path to 0, as the Landfire derived
+	// inputs have them. Returns SQLITE_OK or the first sqlite error.
+	int flattenHerbCoverGrowth(const char* path);
+
+	// Classifies fuel totals drawn from every bound of the rules, and just either side of it,
+	// with both classifiers. Returns the number of totals they assign different models.
+	int classifierDifferences(const std::vector<RVS::Fuels::FBFMRule>& rules,
+		const RVS::Fuels::FBFMClassifier& a, const RVS::Fuels::FBFMClassifier& b, int samples);
+
+	// Prints the check's line, returns 1 when it failed so results can be summed
+	int reportCheck(std::ostream& out, const std::string& name, bool passed, const std::string& detail);
+}
+}
+
+#endif
@@ -0,0 +1,389 @@
+#include "SensitivityAnalysis.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <random>
+#include <sstream>
+
+#if USEMULTIT
+#include <thread>
+#endif
+
+#include "../DataManagement/Arena.h"
+#include "../DataManagement/PlotScheduler.h"
+
+using RVS::Succession::GrowthScales;
+using RVS::Tools::Elasticity;
+using RVS::Tools::SensitivityAnalysis;
+using RVS::Tools::SensitivityPlan;
+
+// Levels of the Morris grid. A step moves half the levels, rounded up.
+static const int MORRIS_LEVELS = 4;
+static const int MORRIS_STEP = 2;
+
+namespace
+{
+	const char* PARAMETER_NAMES[] = { "gr_cov", "gr_ht", "herb_cover_slope", "herb_height_slope",
+		"production_intercept", "production_ppt", "production_ndvi" };
+	const char* OUTPUT_NAMES[] = { "shrub_cover", "shrub_height", "shrub_biomass", "herb_cover",
+		"herb_height", "herb_biomass", "production", "fuel_total" };
+
+	double* scaleOf(GrowthScales* scales, int parameter)
+	{
+		switch (parameter)
+		{
+		case RVS::Tools::SENSITIVITY_GR_COV: return &scales->grCov;
+		case RVS::Tools::SENSITIVITY_GR_HT: return &scales->grHt;
+		case RVS::Tools::SENSITIVITY_HERB_COVER_SLOPE: return &scales->herbCover;
+		case RVS::Tools::SENSITIVITY_HERB_HEIGHT_SLOPE: return &scales->herbHeight;
+		case RVS::Tools::SENSITIVITY_PRODUCTION_INTERCEPT: return &scales->productionIntercept;
+		case RVS::Tools::SENSITIVITY_PRODUCTION_PPT: return &scales->productionPpt;
+		default: return &scales->productionNdvi;
+		}
+	}
+
+	double scaleOf(GrowthScales scales, int parameter)
+	{
+		return *scaleOf(&scales, parameter);
+	}
+
+	// Simulates every plot from its starting values on the scratch plot and adds up the outputs
+	// of all plot-years
+	void simulateLandscape(const std::vector<RVS::DataManagement::AnalysisPlot*>& plots,
+		RVS::DataManagement::AnalysisPlot* scratch, RVS::Biomass::BiomassDriver* bd, RVS::Fuels::FuelsDriver* fd,
+		RVS::Succession::SuccessionDriver* sd, std::vector<double>* sums)
+	{
+		int lastYear = *YEARS - 1;
+		for (auto &p : plots)
+		{
+			scratch->resetTo(*p);
+			for (int year = 0; year < *YEARS; year++)
+			{
+				RC = sd->SuccessionMain(year, CLIMATE, scratch);
+				RC = bd->BioMain(year, CLIMATE, scratch);
+				RC = fd->calcFuelLoads(year, scratch);
+				RC = fd->finishFuels(year, scratch);
+				RVS::DataManagement::Arena::scratch()->reset();
+
+				// A steady plot has the same values for the remaining years
+				bool steady = year < lastYear && scratch->checkSteadyState(year);
+				double years = steady ? lastYear - year + 1 : 1;
+
+				(*sums)[RVS::Tools::SENSITIVITY_SHRUB_COVER] += years * scratch->SHRUBCOVER();
+				(*sums)[RVS::Tools::SENSITIVITY_SHRUB_HEIGHT] += years * scratch->SHRUBHEIGHT();
+				(*sums)[RVS::Tools::SENSITIVITY_SHRUB_BIOMASS] += years * scratch->SHRUBBIOMASS();
+				(*sums)[RVS::Tools::SENSITIVITY_HERB_COVER] += years * scratch->HERBCOVER();
+				(*sums)[RVS::Tools::SENSITIVITY_HERB_HEIGHT] += years * scratch->HERBHEIGHT();
+				(*sums)[RVS::Tools::SENSITIVITY_HERB_BIOMASS] += years * scratch->HERBBIOMASS();
+				(*sums)[RVS::Tools::SENSITIVITY_PRODUCTION] += years * scratch->PRIMARYPRODUCTION();
+				(*sums)[RVS::Tools::SENSITIVITY_FUEL_TOTAL] += years * scratch->FUEL_TOTAL();
+
+				if (steady) { break; }
+			}
+		}
+	}
+
+	// Relative change of an output over the relative change of a parameter, NaN when the
+	// output was 0
+	double elasticity(double output, double changedOutput, double scale, double changedScale)
+	{
+		if (output == 0) { return NAN; }
+		return ((changedOutput - output) / output) / ((changedScale - scale) / scale);
+	}
+}
+
+RVS::Tools::SensitivityPlan RVS::Tools::defaultSensitivityPlan(void)
+{
+	SensitivityPlan plan = SensitivityPlan();
+	for (int p = 0; p < NUM_SENSITIVITY_PARAMETERS; p++)
+	{
+		plan.parameters.push_back(p);
+	}
+	plan.morris = false;
+	plan.delta = 0.1;
+	plan.trajectories = 10;
+	plan.threads = 0;
+	plan.seed = 1;
+	return plan;
+}
+
+const char* RVS::Tools::sensitivityParameterName(int parameter)
+{
+	return PARAMETER_NAMES[parameter];
+}
+
+const char* RVS::Tools::sensitivityOutputName(int output)
+{
+	return OUTPUT_NAMES[output];
+}
+
+bool RVS::Tools::parseSensitivityParameters(const std::vector<std::string>& names, std::vector<int>* parameters)
+{
+	parameters->clear();
+	for (auto &name : names)
+	{
+		const char** found = std::find_if(PARAMETER_NAMES, PARAMETER_NAMES + NUM_SENSITIVITY_PARAMETERS,
+			[&](const char* p) { return name == p; });
+		if (found == PARAMETER_NAMES + NUM_SENSITIVITY_PARAMETERS) { return false; }
+		parameters->push_back((int)(found - PARAMETER_NAMES));
+	}
+	return true;
+}
+
+SensitivityAnalysis::SensitivityAnalysis(std::vector<RVS::DataManagement::AnalysisPlot*> plots,
+	const RVS::Biomass::BiomassDriver& bd, const RVS::Fuels::FuelsDriver& fd,
+	const RVS::Succession::SuccessionDriver& sd)
+	: plots(plots), bd(bd), fd(fd), sd(sd)
+{
+}
+
+std::vector<GrowthScales> SensitivityAnalysis::scenarios(const SensitivityPlan& plan)
+{
+	std::vector<GrowthScales> result;
+	result.push_back(RVS::Succession::DEFAULT_SCALES);
+
+	if (!plan.morris)
+	{
+		for (auto &p : plan.parameters)
+		{
+			GrowthScales low = RVS::Succession::DEFAULT_SCALES;
+			GrowthScales high = RVS::Succession::DEFAULT_SCALES;
+			*scaleOf(&low, p) = 1 - plan.delta;
+			*scaleOf(&high, p) = 1 + plan.delta;
+			result.push_back(low);
+			result.push_back(high);
+		}
+		return result;
+	}
+
+	// Each trajectory starts at a random grid point and moves every parameter once, in random order
+	std::mt19937 engine(plan.seed);
+	double spacing = 2 * plan.delta / (MORRIS_LEVELS - 1);
+	for (int t = 0; t < plan.trajectories; t++)
+	{
+		std::vector<int> levels;
+		GrowthScales point = RVS::Succession::DEFAULT_SCALES;
+		for (auto &p : plan.parameters)
+		{
+			levels.push_back((int)(engine() % MORRIS_LEVELS));
+			*scaleOf(&point, p) = 1 - plan.delta + spacing * levels.back();
+		}
+		result.push_back(point);
+
+		std::vector<size_t> order(plan.parameters.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::shuffle(order.begin(), order.end(), engine);
+		for (auto &i : order)
+		{
+			levels[i] += levels[i] + MORRIS_STEP < MORRIS_LEVELS ? MORRIS_STEP : -MORRIS_STEP;
+			*scaleOf(&point, plan.parameters[i]) = 1 - plan.delta + spacing * levels[i];
+			result.push_back(point);
+		}
+	}
+	return result;
+}
+
+std::vector<std::vector<double>> SensitivityAnalysis::run(const std::vector<GrowthScales>& scenarios, int threads)
+{
+	std::vector<std::vector<double>> outputs = std::vector<std::vector<double>>(scenarios.size(),
+		std::vector<double>(NUM_SENSITIVITY_OUTPUTS, 0));
+	if (plots.empty()) { return outputs; }
+
+	int numWorkers = 1;
+#if USEMULTIT
+	numWorkers = threads > 0 ? threads : (int)std::thread::hardware_concurrency();
+#else
+	(void)threads;
+#endif
+	RVS::DataManagement::PlotScheduler scheduler = RVS::DataManagement::PlotScheduler(numWorkers);
+	numWorkers = scheduler.NUM_WORKERS();
+
+	// Drivers keep the current plot and their scales as state, every worker needs its own
+	std::vector<RVS::Biomass::BiomassDriver> bds = std::vector<RVS::Biomass::BiomassDriver>(numWorkers, bd);
+	std::vector<RVS::Fuels::FuelsDriver> fds = std::vector<RVS::Fuels::FuelsDriver>(numWorkers, fd);
+	std::vector<RVS::Succession::SuccessionDriver> sds = std::vector<RVS::Succession::SuccessionDriver>(numWorkers, sd);
+	std::vector<RVS::DataManagement::AnalysisPlot*> scratch;
+	for (int w = 0; w < numWorkers; w++)
+	{
+		scratch.push_back(plots[0]->clone());
+	}
+
+	// Scenarios cost about the same, the scheduler only spreads them
+	std::vector<int> ids = std::vector<int>(scenarios.size());
+	std::iota(ids.begin(), ids.end(), 0);
+	std::vector<double> costs = std::vector<double>(scenarios.size(), 1.0);
+	double plotYears = (double)plots.size() * *YEARS;
+
+	scheduler.run(&ids, &costs, [&](int worker, int s)
+	{
+		RVS::DataManagement::DIO::begin_write_slot(RVS::DataManagement::DIO::DISCARD_WRITES);
+		sds[worker].setScales(scenarios[s]);
+		simulateLandscape(plots, scratch[worker], &bds[worker], &fds[worker], &sds[worker], &outputs[s]);
+		for (auto &o : outputs[s])
+		{
+			o /= plotYears;
+		}
+		RVS::DataManagement::DIO::begin_write_slot(-1);
+	});
+
+	for (auto &p : scratch)
+	{
+		delete p;
+	}
+	return outputs;
+}
+
+std::vector<Elasticity> SensitivityAnalysis::elasticities(const SensitivityPlan& plan,
+	const std::vector<GrowthScales>& scenarios, const std::vector<std::vector<double>>& outputs)
+{
+	// Effects of every parameter on every output
+	size_t numParameters = plan.parameters.size();
+	std::vector<std::vector<double>> effects = std::vector<std::vector<double>>(numParameters * NUM_SENSITIVITY_OUTPUTS);
+
+	if (!plan.morris)
+	{
+		for (size_t i = 0; i < numParameters; i++)
+		{
+			const std::vector<double>& low = outputs[1 + 2 * i];
+			const std::vector<double>& high = outputs[2 + 2 * i];
+			for (int o = 0; o < NUM_SENSITIVITY_OUTPUTS; o++)
+			{
+				double reference = outputs[0][o];
+				double e = reference == 0 ? NAN : ((high[o] - low[o]) / reference) / (2 * plan.delta);
+				effects[i * NUM_SENSITIVITY_OUTPUTS + o].push_back(e);
+			}
+		}
+	}
+	else
+	{
+		// Consecutive points of a trajectory differ in one parameter
+		size_t pointsPerTrajectory = numParameters + 1;
+		for (size_t start = 1; start + pointsPerTrajectory <= scenarios.size(); start += pointsPerTrajectory)
+		{
+			for (size_t s = start; s + 1 < start + pointsPerTrajectory; s++)
+			{
+				for (size_t i = 0; i < numParameters; i++)
+				{
+					double scale = scaleOf(scenarios[s], plan.parameters[i]);
+					double changedScale = scaleOf(scenarios[s + 1], plan.parameters[i]);
+					if (scale == changedScale) { continue; }
+
+					for (int o = 0; o < NUM_SENSITIVITY_OUTPUTS; o++)
+					{
+						effects[i * NUM_SENSITIVITY_OUTPUTS + o].push_back(
+							elasticity(outputs[s][o], outputs[s + 1][o], scale, changedScale));
+					}
+				}
+			}
+		}
+	}
+
+	std::vector<Elasticity> result;
+	for (size_t i = 0; i < numParameters; i++)
+	{
+		for (int o = 0; o < NUM_SENSITIVITY_OUTPUTS; o++)
+		{
+			const std::vector<double>& e = effects[i * NUM_SENSITIVITY_OUTPUTS + o];
+			Elasticity el = Elasticity();
+			el.parameter = plan.parameters[i];
+			el.output = o;
+
+			double n = 0;
+			for (auto &v : e)
+			{
+				if (std::isnan(v)) { continue; }
+				el.mean += v;
+				el.meanAbsolute += std::fabs(v);
+				n++;
+			}
+			el.mean = n > 0 ? el.mean / n : NAN;
+			el.meanAbsolute = n > 0 ? el.meanAbsolute / n : NAN;
+
+			double squares = 0;
+			for (auto &v : e)
+			{
+				if (!std::isnan(v)) { squares += (v - el.mean) * (v - el.mean); }
+			}
+			el.deviation = n > 1 ? std::sqrt(squares / (n - 1)) : 0;
+			result.push_back(el);
+		}
+	}
+	return result;
+}
+
+void SensitivityAnalysis::report(std::ostream& out, const SensitivityPlan& plan, const std::vector<Elasticity>& elasticities)
+{
+	// One row per parameter. Morris rows give mu* and sigma, one at a time rows the elasticity.
+	out << (plan.morris ? "Morris mu* (sigma)" : "Elasticities") << std::endl << std::left << std::setw(22) << "parameter";
+	for (int o = 0; o < NUM_SENSITIVITY_OUTPUTS; o++)
+	{
+		out << std::right << std::setw(plan.morris ? 22 : 15) << OUTPUT_NAMES[o];
+	}
+	out << std::endl << std::fixed << std::setprecision(4);
+	for (size_t e = 0; e < elasticities.size(); e++)
+	{
+		const Elasticity& el = elasticities[e];
+		if (el.output == 0)
+		{
+			out << std::left << std::setw(22) << PARAMETER_NAMES[el.parameter] << std::right;
+		}
+		if (plan.morris)
+		{
+			std::stringstream cell;
+			cell << std::fixed << std::setprecision(4) << el.meanAbsolute << " (" << el.deviation << ")";
+			out << std::setw(22) << cell.str();
+		}
+		else
+		{
+			out << std::setw(15) << el.mean;
+		}
+		if (el.output == NUM_SENSITIVITY_OUTPUTS - 1) { out << std::endl; }
+	}
+	out.unsetf(std::ios::floatfield);
+}
+
+bool SensitivityAnalysis::writeJson(const char* path, const SensitivityPlan& plan, const std::vector<double>& reference,
+	const std::vector<Elasticity>& elasticities, size_t numScenarios, double seconds)
+{
+	std::ofstream out(path, std::ios::out);
+	if (!out.good()) { return false; }
+
+	// JSON has no NaN, outputs that were 0 give null
+	auto number = [](double v) -> std::string
+	{
+		if (std::isnan(v)) { return "null"; }
+		std::stringstream ss;
+		ss << std::setprecision(9) << v;
+		return ss.str();
+	};
+
+	out << "{\"mode\": \"" << (plan.morris ? "morris" : "oat") << "\", \"delta\": " << plan.delta;
+	if (plan.morris)
+	{
+		out << ", \"trajectories\": " << plan.trajectories << ", \"levels\": " << MORRIS_LEVELS << ", \"seed\": " << plan.seed;
+	}
+	out << ", \"years\": " << *YEARS << ", \"scenarios\": " << numScenarios << ", \"seconds\": " << number(seconds) << \
+		", \"scenarios_per_s\": " << number(seconds > 0 ? numScenarios / seconds : 0) << ",\n \"reference\": {";
+	for (int o = 0; o < NUM_SENSITIVITY_OUTPUTS; o++)
+	{
+		out << (o == 0 ? "" : ", ") << "\"" << OUTPUT_NAMES[o] << "\": " << number(reference[o]);
+	}
+	out << "},\n \"elasticities\": [";
+	for (size_t e = 0; e < elasticities.size(); e++)
+	{
+		const Elasticity& el = elasticities[e];
+		out << (e == 0 ? "" : ",") << "\n  {\"parameter\": \"" << PARAMETER_NAMES[el.parameter] << "\", \"output\": \"" << \
+			OUTPUT_NAMES[el.output] << "\", \"mean\": " << number(el.mean);
+		if (plan.morris)
+		{
+			out << ", \"mu_star\": " << number(el.meanAbsolute) << ", \"sigma\": " << number(el.deviation);
+		}
+		out << "}";
+	}
+	out << "\n]}" << std::endl;
+	out.close();
+	return true;
+}
@@ -0,0 +1,122 @@
+/// ********************************************************** ///
+/// Name: SensitivityAnalysis.h                                ///
+/// Desc: Local sensitivity of landscape outputs to the shrub  ///
+/// growth rates, the herb growth slopes and the production    ///
+/// coefficients. Each scenario scales the parameters through  ///
+/// the succession driver and simulates the landscape from     ///
+/// its starting values with the output discarded. Parameters  ///
+/// are perturbed one at a time around their reference values  ///
+/// or along Morris trajectories, and the results reported as  ///
+/// elasticities. Scenarios are spread over threads.           ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef SENSITIVITYANALYSIS_H
+#define SENSITIVITYANALYSIS_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../DataManagement/AnalysisPlot.h"
+#include "../Biomass/BiomassDriver.h"
+#include "../Fuels/FuelsDriver.h"
+#include "../Succession/SuccessionDriver.h"
+
+namespace RVS
+{
+namespace Tools
+{
+	// The fields of Succession::GrowthScales
+	enum SensitivityParameter
+	{
+		SENSITIVITY_GR_COV,
+		SENSITIVITY_GR_HT,
+		SENSITIVITY_HERB_COVER_SLOPE,
+		SENSITIVITY_HERB_HEIGHT_SLOPE,
+		SENSITIVITY_PRODUCTION_INTERCEPT,
+		SENSITIVITY_PRODUCTION_PPT,
+		SENSITIVITY_PRODUCTION_NDVI,
+		NUM_SENSITIVITY_PARAMETERS
+	};
+
+	// Means over every plot and year of the landscape
+	enum SensitivityOutput
+	{
+		SENSITIVITY_SHRUB_COVER,
+		SENSITIVITY_SHRUB_HEIGHT,
+		SENSITIVITY_SHRUB_BIOMASS,
+		SENSITIVITY_HERB_COVER,
+		SENSITIVITY_HERB_HEIGHT,
+		SENSITIVITY_HERB_BIOMASS,
+		SENSITIVITY_PRODUCTION,
+		SENSITIVITY_FUEL_TOTAL,
+		NUM_SENSITIVITY_OUTPUTS
+	};
+
+	struct SensitivityPlan
+	{
+		std::vector<int> parameters;   // SensitivityParameter values
+		bool morris;                   // Morris trajectories instead of one at a time
+		// One at a time: scales of 1 - delta and 1 + delta. Morris: a 4 level grid over the same range.
+		double delta;
+		int trajectories;              // Morris trajectories
+		int threads;                   // 0 uses every core
+		unsigned int seed;
+	};
+
+	// Elasticity of an output to a parameter: relative change of the output over the relative
+	// change of the parameter
+	struct Elasticity
+	{
+		int parameter;
+		int output;
+		double mean;           // One at a time: the central difference. Morris: mean elementary effect.
+		double meanAbsolute;   // Morris mu*, the mean of the absolute effects
+		double deviation;      // Morris sigma, 0 one at a time
+	};
+
+	// Every parameter one at a time, delta 0.1, 10 trajectories for Morris, every core
+	SensitivityPlan defaultSensitivityPlan(void);
+
+	const char* sensitivityParameterName(int parameter);
+	const char* sensitivityOutputName(int output);
+	// Parameters by name, false if a name is unknown
+	bool parseSensitivityParameters(const std::vector<std::string>& names, std::vector<int>* parameters);
+
+	class SensitivityAnalysis
+	{
+	public:
+		// Plots as loaded, which are left untouched. Every worker gets its own copies of the
+		// drivers and one scratch plot, which is reset to each plot in turn.
+		SensitivityAnalysis(std::vector<RVS::DataManagement::AnalysisPlot*> plots,
+			const RVS::Biomass::BiomassDriver& bd, const RVS::Fuels::FuelsDriver& fd,
+			const RVS::Succession::SuccessionDriver& sd);
+
+		// Scales of the plan's scenarios, the reference (all 1) first. One at a time it is followed
+		// by the low and high scenario of every parameter, Morris by the trajectories, each a base
+		// point and one step per parameter.
+		static std::vector<RVS::Succession::GrowthScales> scenarios(const SensitivityPlan& plan);
+
+		// Landscape outputs of every scenario, NUM_SENSITIVITY_OUTPUTS each
+		std::vector<std::vector<double>> run(const std::vector<RVS::Succession::GrowthScales>& scenarios, int threads);
+
+		static std::vector<Elasticity> elasticities(const SensitivityPlan& plan,
+			const std::vector<RVS::Succession::GrowthScales>& scenarios, const std::vector<std::vector<double>>& outputs);
+
+		static void report(std::ostream& out, const SensitivityPlan& plan, const std::vector<Elasticity>& elasticities);
+		static bool writeJson(const char* path, const SensitivityPlan& plan, const std::vector<double>& reference,
+			const std::vector<Elasticity>& elasticities, size_t numScenarios, double seconds);
+
+	private:
+		std::vector<RVS::DataManagement::AnalysisPlot*> plots;
+		RVS::Biomass::BiomassDriver bd;
+		RVS::Fuels::FuelsDriver fd;
+		RVS::Succession::SuccessionDriver sd;
+	};
+}
+}
+
+#endif
@@ -0,0 +1,408 @@
+#include "ShardTools.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include "../RVSDBNAMES.h"
+#include "../DataManagement/PlotScheduler.h"
+
+using RVS::Tools::PartitionMode;
+using RVS::Tools::PlotCost;
+
+// Cells per side of the grid tiles are ordered on
+static const int TILE_GRID = 1024;
+
+static int exec(sqlite3* db, const std::string& sql)
+{
+	char* err = NULL;
+	int rc = sqlite3_exec(db, sql.c_str(), NULL, NULL, &err);
+	if (rc != SQLITE_OK)
+	{
+		std::cerr << "SQL error: " << (err != NULL ? err : sqlite3_errmsg(db)) << std::endl << sql << std::endl;
+		sqlite3_free(err);
+	}
+	return rc;
+}
+
+static std::string quoted(const std::string& name)
+{
+	return "\"" + name + "\"";
+}
+
+static std::string text(sqlite3_stmt* stmt, int column)
+{
+	const unsigned char* value = sqlite3_column_text(stmt, column);
+	return value == NULL ? "" : std::string((const char*)value);
+}
+
+// Tables (or indexes) of a schema with the statements that created them
+static std::vector<std::pair<std::string, std::string>> schemaObjects(sqlite3* db, const std::string& schema, const char* type)
+{
+	std::vector<std::pair<std::string, std::string>> objects;
+	std::string sql = "SELECT name, sql FROM " + schema + ".sqlite_master WHERE type = '" + type + \
+		"' AND sql IS NOT NULL AND name NOT LIKE 'sqlite_%' ORDER BY rowid;";
+	sqlite3_stmt* stmt;
+	if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) { return objects; }
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		objects.push_back(std::make_pair(text(stmt, 0), text(stmt, 1)));
+	}
+	sqlite3_finalize(stmt);
+	return objects;
+}
+
+static bool hasColumn(sqlite3* db, const std::string& schema, const std::string& table, const char* column)
+{
+	std::string sql = "PRAGMA " + schema + ".table_info(" + quoted(table) + ");";
+	sqlite3_stmt* stmt;
+	bool found = false;
+	if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) { return false; }
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		if (text(stmt, 1).compare(column) == 0) { found = true; }
+	}
+	sqlite3_finalize(stmt);
+	return found;
+}
+
+// Interleaves the bits of x and y
+static unsigned int zOrder(unsigned int x, unsigned int y)
+{
+	unsigned int code = 0;
+	for (int b = 0; b < 16; b++)
+	{
+		code |= ((x >> b) & 1u) << (2 * b);
+		code |= ((y >> b) & 1u) << (2 * b + 1);
+	}
+	return code;
+}
+
+std::string RVS::Tools::shardPath(const std::string& prefix, int shard)
+{
+	std::stringstream ss;
+	ss << prefix << "_" << shard << ".db";
+	return ss.str();
+}
+
+std::string RVS::Tools::shardOutputPath(const std::string& prefix, int shard)
+{
+	std::stringstream ss;
+	ss << prefix << "_" << shard << "_out.db";
+	return ss.str();
+}
+
+std::string RVS::Tools::shardDebugPath(const std::string& prefix, int shard)
+{
+	std::stringstream ss;
+	ss << prefix << "_" << shard << "_debug.txt";
+	return ss.str();
+}
+
+int RVS::Tools::queryPlotCosts(sqlite3* db, std::vector<PlotCost>* plots)
+{
+	sqlite3_stmt* stmt;
+	std::string sql;
+
+	// Weight of each species' biomass equation, as the scheduler weighs them
+	std::map<int, double> equationWeights;
+	sql = std::string("SELECT ") + EQUATION_NUMBER_FIELD + ", PA1_CODE, PA2_CODE, PA3_CODE FROM " + BIOMASS_EQUATION_TABLE + ";";
+	if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) { return exec(db, sql); }
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		double weight = 0;
+		for (int i = 1; i <= 3; i++)
+		{
+			if (!text(stmt, i).empty()) { weight += 0.25; }
+		}
+		equationWeights[sqlite3_column_int(stmt, 0)] = weight;
+	}
+	sqlite3_finalize(stmt);
+
+	std::map<std::string, double> speciesWeights;
+	sql = std::string("SELECT ") + SPP_CODE_FIELD + ", " + BIOMASS_EQUATION_FIELD + " FROM " + BIOMASS_CROSSWALK_TABLE + ";";
+	if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) { return exec(db, sql); }
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		speciesWeights[text(stmt, 0)] = equationWeights[sqlite3_column_int(stmt, 1)];
+	}
+	sqlite3_finalize(stmt);
+	double backupWeight = speciesWeights[BIOMASS_BACKUP_SPP_CODE];
+
+	std::map<int, size_t> index;
+	sql = std::string("SELECT ") + PLOT_NUM_FIELD + ", " + LATITUDE_FIELD + ", " + LONGITUDE_FIELD + " FROM " + RVS_INPUT_TABLE + ";";
+	if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) { return exec(db, sql); }
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		PlotCost p = PlotCost();
+		p.plotId = sqlite3_column_int(stmt, 0);
+		p.latitude = sqlite3_column_double(stmt, 1);
+		p.longitude = sqlite3_column_double(stmt, 2);
+		index[p.plotId] = plots->size();
+		plots->push_back(p);
+	}
+	sqlite3_finalize(stmt);
+
+	std::vector<size_t> numShrubs = std::vector<size_t>(plots->size(), 0);
+	std::vector<double> weights = std::vector<double>(plots->size(), 0);
+	std::vector<size_t> numDisturbances = std::vector<size_t>(plots->size(), 0);
+
+	sql = std::string("SELECT ") + PLOT_NUM_FIELD + ", " + SPP_CODE_FIELD + " FROM " + SHRUB_INPUT_TABLE + ";";
+	if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) != SQLITE_OK) { return exec(db, sql); }
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+	{
+		std::map<int, size_t>::iterator p = index.find(sqlite3_column_int(stmt, 0));
+		if (p == index.end()) { continue; }
+		std::map<std::string, double>::iterator w = speciesWeights.find(text(stmt, 1));
+		numShrubs[p->second]++;
+		weights[p->second] += w == speciesWeights.end() ? backupWeight : w->second;
+	}
+	sqlite3_finalize(stmt);
+
+	// Repeating actions count once per year they happen
+	sql = std::string("SELECT ") + PLOT_NUM_FIELD + ", " + DIST_BEGIN_FIELD + ", " + DIST_END_FIELD + ", " + \
+		DIST_FREQ_FIELD + " FROM " + DISTURBANCE_PLOT_TABLE + ";";
+	if (sqlite3_prepare_v2(db, sql.c_str(), -1, &stmt, NULL) == SQLITE_OK)
+	{
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+		{
+			std::map<int, size_t>::iterator p = index.find(sqlite3_column_int(stmt, 0));
+			if (p == index.end()) { continue; }
+			int start = sqlite3_column_int(stmt, 1);
+			int stop = sqlite3_column_int(stmt, 2);
+			int freq = sqlite3_column_int(stmt, 3);
+			numDisturbances[p->second] += freq > 0 && stop >= start ? (stop - start) / freq + 1 : 1;
+		}
+		sqlite3_finalize(stmt);
+	}
+
+	for (size_t i = 0; i < plots->size(); i++)
+	{
+		plots->at(i).cost = RVS::DataManagement::PlotScheduler::estimateCost(numShrubs[i], weights[i], numDisturbances[i]);
+	}
+
+	return SQLITE_OK;
+}
+
+std::vector<std::vector<int>> RVS::Tools::partitionPlots(std::vector<PlotCost> plots, int numShards, PartitionMode mode)
+{
+	numShards = std::max(1, std::min(numShards, (int)plots.size()));
+
+	if (mode == PARTITION_TILES && !plots.empty())
+	{
+		double minLat = plots[0].latitude, maxLat = plots[0].latitude;
+		double minLon = plots[0].longitude, maxLon = plots[0].longitude;
+		for (auto &p : plots)
+		{
+			minLat = std::min(minLat, p.latitude);
+			maxLat = std::max(maxLat, p.latitude);
+			minLon = std::min(minLon, p.longitude);
+			maxLon = std::max(maxLon, p.longitude);
+		}
+		double latSpan = std::max(maxLat - minLat, 1e-9);
+		double lonSpan = std::max(maxLon - minLon, 1e-9);
+
+		std::map<int, unsigned int> codes;
+		for (auto &p : plots)
+		{
+			unsigned int x = (unsigned int)std::min((p.longitude - minLon) / lonSpan * TILE_GRID, TILE_GRID - 1.0);
+			unsigned int y = (unsigned int)std::min((p.latitude - minLat) / latSpan * TILE_GRID, TILE_GRID - 1.0);
+			codes[p.plotId] = zOrder(x, y);
+		}
+		std::stable_sort(plots.begin(), plots.end(), [&codes](const PlotCost& a, const PlotCost& b)
+		{
+			unsigned int ca = codes[a.plotId];
+			unsigned int cb = codes[b.plotId];
+			return ca != cb ? ca < cb : a.plotId < b.plotId;
+		});
+	}
+	else
+	{
+		std::stable_sort(plots.begin(), plots.end(), [](const PlotCost& a, const PlotCost& b) { return a.plotId < b.plotId; });
+	}
+
+	double total = 0;
+	for (auto &p : plots)
+	{
+		total += p.cost;
+	}
+
+	// Same cut as PlotScheduler::partition: a shard ends once it holds its share of the cost
+	std::vector<std::vector<int>> shards = std::vector<std::vector<int>>(numShards);
+	double share = total / numShards;
+	double assigned = 0;
+	int shard = 0;
+	for (size_t i = 0; i < plots.size(); i++)
+	{
+		shards[shard].push_back(plots[i].plotId);
+		assigned += plots[i].cost;
+
+		// Later shards keep at least one plot each
+		size_t left = plots.size() - i - 1;
+		if (shard < numShards - 1 && (assigned >= share * (shard + 1) || left <= (size_t)(numShards - shard - 1)))
+		{
+			shard++;
+		}
+	}
+
+	return shards;
+}
+
+int RVS::Tools::partitionInput(const char* inPath, const std::string& prefix, int numShards, PartitionMode mode,
+	int* shardsWritten)
+{
+	if (shardsWritten != NULL) { *shardsWritten = 0; }
+
+	sqlite3* in;
+	int rc = sqlite3_open_v2(inPath, &in, SQLITE_OPEN_READONLY, NULL);
+	if (rc != SQLITE_OK)
+	{
+		std::cerr << "Can't open database: " << sqlite3_errmsg(in) << std::endl;
+		sqlite3_close(in);
+		return rc;
+	}
+
+	std::vector<PlotCost> plots;
+	rc = queryPlotCosts(in, &plots);
+	std::vector<std::pair<std::string, std::string>> tables = schemaObjects(in, "main", "table");
+	std::vector<std::pair<std::string, std::string>> indexes = schemaObjects(in, "main", "index");
+	std::vector<bool> byPlot;
+	for (auto &t : tables)
+	{
+		byPlot.push_back(hasColumn(in, "main", t.first, PLOT_NUM_FIELD));
+	}
+	sqlite3_close(in);
+	if (rc != SQLITE_OK) { return rc; }
+
+	std::map<int, double> costs;
+	for (auto &p : plots)
+	{
+		costs[p.plotId] = p.cost;
+	}
+
+	std::vector<std::vector<int>> shards = partitionPlots(plots, numShards, mode);
+	for (size_t k = 0; k < shards.size() && rc == SQLITE_OK; k++)
+	{
+		std::string path = shardPath(prefix, (int)k);
+		std::remove(path.c_str());
+		// An output left from an earlier run would be appended to
+		std::remove(shardOutputPath(prefix, (int)k).c_str());
+
+		sqlite3* db;
+		rc = sqlite3_open(path.c_str(), &db);
+		if (rc == SQLITE_OK) { rc = exec(db, "ATTACH DATABASE '" + std::string(inPath) + "' AS src;"); }
+		if (rc == SQLITE_OK) { rc = exec(db, "BEGIN; CREATE TEMP TABLE shard_plots (PLOT_ID INTEGER PRIMARY KEY);"); }
+
+		double cost = 0;
+		if (rc == SQLITE_OK)
+		{
+			sqlite3_stmt* insert;
+			sqlite3_prepare_v2(db, "INSERT INTO temp.shard_plots VALUES (?);", -1, &insert, NULL);
+			for (auto &id : shards[k])
+			{
+				sqlite3_bind_int(insert, 1, id);
+				sqlite3_step(insert);
+				sqlite3_reset(insert);
+				cost += costs[id];
+			}
+			sqlite3_finalize(insert);
+		}
+
+		// Every table is copied, the ones keyed by plot only for the shard's plots
+		for (size_t t = 0; t < tables.size() && rc == SQLITE_OK; t++)
+		{
+			rc = exec(db, tables[t].second + ";");
+			if (rc != SQLITE_OK) { break; }
+
+			std::string copy = "INSERT INTO main." + quoted(tables[t].first) + " SELECT * FROM src." + quoted(tables[t].first);
+			if (byPlot[t]) { copy += std::string(" WHERE ") + PLOT_NUM_FIELD + " IN (SELECT PLOT_ID FROM temp.shard_plots)"; }
+			rc = exec(db, copy + ";");
+		}
+		for (size_t i = 0; i < indexes.size() && rc == SQLITE_OK; i++)
+		{
+			rc = exec(db, indexes[i].second + ";");
+		}
+
+		if (rc == SQLITE_OK) { rc = exec(db, "COMMIT;"); }
+		exec(db, "DETACH DATABASE src;");
+		sqlite3_close(db);
+		if (rc == SQLITE_OK && shardsWritten != NULL) { (*shardsWritten)++; }
+
+		std::cout << "Shard " << k << ": " << shards[k].size() << " plots, cost " << cost << " -> " << path << std::endl;
+	}
+
+	return rc;
+}
+
+int RVS::Tools::mergeOutputs(const char* outPath, const std::vector<std::string>& shardOutputs)
+{
+	// The output is written from scratch, it must not be one of the shards read
+	if (std::find(shardOutputs.begin(), shardOutputs.end(), std::string(outPath)) != shardOutputs.end())
+	{
+		std::cerr << "The merged database is written as a new file, not over a shard output" << std::endl;
+		return SQLITE_MISUSE;
+	}
+	std::remove(outPath);
+
+	sqlite3* db;
+	int rc = sqlite3_open(outPath, &db);
+	if (rc != SQLITE_OK)
+	{
+		std::cerr << "Can't open database: " << sqlite3_errmsg(db) << std::endl;
+		sqlite3_close(db);
+		return rc;
+	}
+
+	// Rows of each table are staged from every shard, then written in plot and year order
+	std::vector<std::string> tables;
+	std::map<std::string, std::string> indexes;
+	for (size_t k = 0; k < shardOutputs.size() && rc == SQLITE_OK; k++)
+	{
+		rc = exec(db, "ATTACH DATABASE '" + shardOutputs[k] + "' AS shard;");
+		if (rc != SQLITE_OK) { break; }
+		rc = exec(db, "BEGIN;");
+
+		for (auto &t : schemaObjects(db, "shard", "table"))
+		{
+			if (rc != SQLITE_OK) { break; }
+			std::string stage = "temp." + quoted("stage_" + t.first);
+			if (std::find(tables.begin(), tables.end(), t.first) == tables.end())
+			{
+				tables.push_back(t.first);
+				rc = exec(db, t.second + ";");
+				if (rc == SQLITE_OK) { rc = exec(db, "CREATE TABLE " + stage + " AS SELECT * FROM shard." + quoted(t.first) + " WHERE 0;"); }
+			}
+			if (rc == SQLITE_OK) { rc = exec(db, "INSERT INTO " + stage + " SELECT * FROM shard." + quoted(t.first) + ";"); }
+		}
+		for (auto &i : schemaObjects(db, "shard", "index"))
+		{
+			indexes.insert(i);
+		}
+
+		if (rc == SQLITE_OK) { rc = exec(db, "COMMIT;"); }
+		exec(db, "DETACH DATABASE shard;");
+	}
+
+	if (rc == SQLITE_OK) { rc = exec(db, "BEGIN;"); }
+	for (size_t t = 0; t < tables.size() && rc == SQLITE_OK; t++)
+	{
+		std::string stage = "temp." + quoted("stage_" + tables[t]);
+		std::string order = " ORDER BY ";
+		if (hasColumn(db, "main", tables[t], PLOT_NUM_FIELD)) { order += std::string(PLOT_NUM_FIELD) + ", "; }
+		if (hasColumn(db, "main", tables[t], YEAR_OUT_FIELD)) { order += std::string(YEAR_OUT_FIELD) + ", "; }
+		order += "rowid";
+
+		rc = exec(db, "INSERT INTO main." + quoted(tables[t]) + " SELECT * FROM " + stage + order + ";");
+		if (rc == SQLITE_OK) { rc = exec(db, "DROP TABLE " + stage + ";"); }
+	}
+	for (auto &i : indexes)
+	{
+		if (rc == SQLITE_OK) { rc = exec(db, i.second + ";"); }
+	}
+	if (rc == SQLITE_OK) { rc = exec(db, "COMMIT;"); }
+
+	sqlite3_close(db);
+	return rc;
+}
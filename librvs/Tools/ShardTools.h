@@ -0,0 +1,64 @@
+/// ********************************************************** ///
+/// Name: ShardTools.h                                         ///
+/// Desc: Splits an input database into shards that run as    ///
+/// independent RVS processes, and merges their outputs. Each  ///
+/// shard is a full snapshot of the input with only its own    ///
+/// plots in the tables keyed by PLOT_ID. Shards hold equal    ///
+/// shares of the scheduler's cost estimate.                   ///
+/// Base Class(es): none                                       ///
+/// ********************************************************** ///
+
+#pragma once
+
+#ifndef SHARDTOOLS_H
+#define SHARDTOOLS_H
+
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+namespace RVS
+{
+namespace Tools
+{
+	enum PartitionMode
+	{
+		PARTITION_IDS,    // Consecutive PLOT_ID ranges
+		PARTITION_TILES   // Lat/long tiles, visited in Z order so neighbors share a shard
+	};
+
+	struct PlotCost
+	{
+		int plotId;
+		double latitude;
+		double longitude;
+		double cost;
+	};
+
+	// Path of shard k's input (prefix_k.db), output (prefix_k_out.db) and debug file (prefix_k_debug.txt)
+	std::string shardPath(const std::string& prefix, int shard);
+	std::string shardOutputPath(const std::string& prefix, int shard);
+	std::string shardDebugPath(const std::string& prefix, int shard);
+
+	// Cost estimate of every plot in Plots_Active, from its shrub records, their biomass
+	// equations and its disturbances (see PlotScheduler::estimateCost)
+	int queryPlotCosts(sqlite3* db, std::vector<PlotCost>* plots);
+
+	// Orders the plots for the mode and cuts them into numShards ranges of equal cost.
+	// Returns the plot ids of each shard.
+	std::vector<std::vector<int>> partitionPlots(std::vector<PlotCost> plots, int numShards, PartitionMode mode);
+
+	// Writes the shard snapshots of inPath, fewer than numShards when there are fewer plots, and
+	// removes their outputs of an earlier run. Sets shardsWritten to the number written when it
+	// isn't NULL. Returns SQLITE_OK or the first sqlite error.
+	int partitionInput(const char* inPath, const std::string& prefix, int numShards, PartitionMode mode,
+		int* shardsWritten = NULL);
+
+	// Combines shard outputs into outPath. Rows are ordered by plot, then year. outPath may not
+	// be one of the shard outputs.
+	int mergeOutputs(const char* outPath, const std::vector<std::string>& shardOutputs);
+}
+}
+
+#endif
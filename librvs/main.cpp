@@ -8,36 +8,98 @@
 
 #include <ctime>
 #include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
 #include <exception>
 #include <iostream>
+#include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "RVSDEF.h"
 #include "DataManagement/DIO.h"
+#include "DataManagement/Instrumentation.h"
+#include "DataManagement/TraceRecorder.h"
 #include "DataManagement/AnalysisPlot.h"
+#include "DataManagement/PlotScheduler.h"
 #include "DataManagement/RVSException.h"
+#include "DataManagement/SqlProfiler.h"
 #include "Biomass/BiomassDIO.h"
 #include "Biomass/BiomassDriver.h"
 #include "Biomass/BiomassEqDriver.h"
 #include "Fuels/FuelsDIO.h"
 #include "Fuels/FuelsDriver.h"
 #include "Succession/SuccessionDIO.h"
+#include "Succession/Recolonization.h"
 #include "Succession/SuccessionDriver.h"
 #include "Disturbance/DisturbanceDIO.h"
 #include "Disturbance/DisturbanceDriver.h"
+#include "Disturbance/RotationScheduler.h"
+#include "Tools/BenchmarkTools.h"
+#include "Tools/Calibration.h"
+#include "Tools/EquationSweep.h"
+#include "Tools/LandscapeGenerator.h"
+#include "Tools/Microbenchmarks.h"
+#include "Tools/OutputComparator.h"
+#include "Tools/SelfTests.h"
+#include "Tools/SensitivityAnalysis.h"
+#include "Tools/ShardTools.h"
 
 using namespace std;
 using namespace RVS;
 using namespace RVS::DataManagement;
 
-int* RC = new int(SQLITE_OK);
+RVS_THREAD_LOCAL int* RC = new int(SQLITE_OK);
 int* YEARS = new int(20);
 bool* SUPPRESS_MSG = new bool(true);
 const char* DEBUG_FILE = "RVS_Debug.txt";
+// Equation numbers the shrub equation test runs, one per line, # starts a comment. Without
+// the file it tests the equations of the plots' species.
+const char* EQUATION_LIST_FILE = "biomass_text_equations.txt";
+// Stage times and counters of instrumented builds (RVS_INSTRUMENT)
+const char* INSTRUMENT_FILE = "RVS_Instrument.json";
+// Timeline of traced builds (RVS_TRACE), and the plots it follows: those with a PLOT_ID
+// divisible by TRACE_SAMPLE
+const char* TRACE_FILE = "RVS_Trace.json";
+int* TRACE_SAMPLE = new int(1);
+// Repeated input queries allowed per plot-year in SQL profiling builds (RVS_PROFILE_SQL).
+// Queries of a form a simulation thread already ran count, caches that load a key at a time
+// repeat theirs a few times per run. A query made every plot-year is well over it.
+double* SQL_BUDGET = new double(0.01);
 string* CLIMATE = new string("Normal");
 bool* USE_MEM = new bool(true);
 bool* RANDOM_CLIMATE = new bool(false);
+// Plan shrub growth of undisturbed plots instead of growing it every year
+bool* FAST_FORWARD = new bool(true);
+// Stop simulating plots whose output no longer changes and repeat their last records instead
+bool* STEADY_STATE = new bool(true);
+// Run each plot through all years before moving to the next plot. Only used when plots
+// do not interact (no random climate, which draws from a shared generator)
+bool* PLOT_MAJOR = new bool(true);
+// Simulation threads for plot-major runs (USEMULTIT builds only). 0 uses every core
+int* THREADS = new int(0);
+// Sum shrub fuels from each species' Fuel_Equation entries instead of partitioning plot biomass
+bool* SPECIES_FUELS = new bool(false);
+// Run the Rothermel surface fire model on each plot-year's fuel model and loads
+bool* FIRE_BEHAVIOR = new bool(false);
+// Apply the fire and grazing actions of the disturbance input, and the pasture rotation of the
+// Grazing_Pastures and Grazing_Herds tables. Grazing and fires act on all plots of a year at
+// once, so these runs go year by year.
+bool* DISTURBANCES = new bool(false);
+// Kill or spare each burned shrub record by a draw instead of killing its expected share
+bool* STOCHASTIC_FIRE = new bool(false);
+// Seed of the draws. Runs of an ensemble differ only in their seed.
+unsigned int* ENSEMBLE_SEED = new unsigned int(1);
+// Burned and shrubless plots are recolonized by the shrubs within this many km. 0 turns the
+// neighbor search off. Plots then depend on each other, so these runs go year by year.
+double* SEED_RADIUS = new double(0);
+// Phase times, throughput and memory of the last run, written by benchmark runs
+Tools::RunStats* RUN_STATS = new Tools::RunStats();
 char* RVS_DB_PATH = "C:/Users/robbl/Documents/GitHub/RVS/rvs_in.db";
 char* OUT_DB_PATH = "";
 
@@ -48,6 +110,162 @@ char* OUT_DB_PATH = "";
 // 4: shrub equation test
 const int* runmode = new int(1);
 
+// Plot-years whose fire behavior runs through the spread kernel together (FIRE_BEHAVIOR)
+const size_t FIRE_BATCH_PLOTS = 512;
+
+
+// Execution order for plot-major runs: plots grouped by BPS model, then by the set of shrub
+// species on the plot. Plots keep their input order within a group.
+vector<int> orderPlots(vector<int>* plots, map<int, AnalysisPlot*>* aps)
+{
+	map<int, string> speciesSets;
+	for (auto &p : *plots)
+	{
+		vector<string> codes;
+		for (auto &s : *aps->at(p)->SHRUB_RECORDS())
+		{
+			codes.push_back(s->SPP_CODE());
+		}
+		std::sort(codes.begin(), codes.end());
+		codes.erase(std::unique(codes.begin(), codes.end()), codes.end());
+
+		string key;
+		for (auto &c : codes)
+		{
+			key += c + ";";
+		}
+		speciesSets[p] = key;
+	}
+
+	vector<int> order = *plots;
+	std::stable_sort(order.begin(), order.end(), [&](int a, int b)
+	{
+		int model = aps->at(a)->BPS_MODEL_NUM().compare(aps->at(b)->BPS_MODEL_NUM());
+		if (model != 0) { return model < 0; }
+		return speciesSets[a] < speciesSets[b];
+	});
+
+	return order;
+}
+
+// Weight of each shrub species' biomass equation form for the scheduler's cost model.
+// Equations with more parameters need more lookups and arithmetic per record.
+std::map<std::string, double> equationWeights(Biomass::BiomassDIO* bdio, map<int, AnalysisPlot*>* aps)
+{
+	std::map<std::string, double> weights;
+
+	for (auto &p : *aps)
+	{
+		for (auto &s : *p.second->SHRUB_RECORDS())
+		{
+			if (weights.find(s->SPP_CODE()) != weights.end()) { continue; }
+
+			int equationNumber = bdio->query_crosswalk_table(s->SPP_CODE(), BIOMASS_EQUATION_FIELD);
+			if (equationNumber == 0)
+			{
+				equationNumber = bdio->query_crosswalk_table(BIOMASS_BACKUP_SPP_CODE, BIOMASS_EQUATION_FIELD);
+			}
+
+			string params[3];
+			bdio->query_equation_parameters(equationNumber, params);
+
+			double weight = 0;
+			for (int i = 0; i < 3; i++)
+			{
+				if (!params[i].empty()) { weight += 0.25; }
+			}
+			weights[s->SPP_CODE()] = weight;
+		}
+	}
+
+	return weights;
+}
+
+#if RVS_COUNT_ALLOCS
+// Plot-years that allocated although their plot was in a steady state
+std::atomic<long> allocationViolations(0);
+#endif
+
+// A plot at the start of a year, to tell whether the year changed its state
+struct PlotYearStart
+{
+	size_t shrubRecords;
+	Succession::ShrubTrajectory* trajectory;
+};
+
+// Makes room in the output queue for a plot-year of currentPlot, before the year runs.
+// Counting builds start counting the year's heap allocations.
+PlotYearStart beginPlotYear(RVS::DataManagement::AnalysisPlot* currentPlot)
+{
+	PlotYearStart start = PlotYearStart();
+	start.shrubRecords = currentPlot->SHRUB_RECORDS()->size();
+	start.trajectory = currentPlot->TRAJECTORY();
+	DIO::reserve_writes(start.shrubRecords);
+#if RVS_COUNT_ALLOCS
+	AllocationCounter::reset();
+#endif
+	return start;
+}
+
+// Releases the year's scratch memory. Counting builds check that a plot-year in a steady
+// state did not touch the heap, its output included. A plot is steady after its first
+// year, in every year that neither adds nor removes shrub records nor plans its trajectory.
+void endPlotYear(int year, RVS::DataManagement::AnalysisPlot* currentPlot, const PlotYearStart& start, Biomass::BiomassDIO* bdio)
+{
+#if RVS_COUNT_ALLOCS
+	long allocations = AllocationCounter::COUNT();
+	bool steady = year > 0 && currentPlot->SHRUB_RECORDS()->size() == start.shrubRecords &&
+		currentPlot->TRAJECTORY() == start.trajectory;
+	if (steady && allocations > 0)
+	{
+		allocationViolations++;
+		RVS_ALLOC_PAUSE();
+		stringstream ss;
+		ss << "PLOT_ID: " << currentPlot->PLOT_ID() << ". " << allocations << " heap allocations in steady year " << year;
+		bdio->write_debug_msg(ss.str().c_str());
+	}
+#endif
+
+	Arena::scratch()->reset();
+}
+
+// Simulates one year of a plot
+void simulatePlotYear(int year, RVS::DataManagement::AnalysisPlot* currentPlot,
+	void(*simFunc)(int year, RVS::DataManagement::AnalysisPlot* currentPlot,
+		Biomass::BiomassDriver* bd,
+		Fuels::FuelsDriver* fd,
+		Succession::SuccessionDriver* sd,
+		Disturbance::DisturbanceDriver* dd),
+	Biomass::BiomassDriver* bd,
+	Fuels::FuelsDriver* fd,
+	Succession::SuccessionDriver* sd,
+	Disturbance::DisturbanceDriver* dd,
+	Biomass::BiomassDIO* bdio)
+{
+	RVS_TRACE_PLOT_SPAN("plot_year", currentPlot->PLOT_ID());
+	RVS_SQL_PLOT_YEAR(year);
+	PlotYearStart start = beginPlotYear(currentPlot);
+
+	simFunc(year, currentPlot, bd, fd, sd, dd);
+
+	endPlotYear(year, currentPlot, start, bdio);
+}
+
+// Checks a plot for a steady state after year. A steady plot's records for the year are
+// repeated for the remaining years when the output is written and the plot needs no
+// further simulation.
+bool retireIfSteady(int year, int lastYear, RVS::DataManagement::AnalysisPlot* currentPlot,
+	Biomass::BiomassDIO* bdio,
+	Fuels::FuelsDIO* fdio,
+	Succession::SuccessionDIO* sdio)
+{
+	if (year >= lastYear || !currentPlot->checkSteadyState(year)) { return false; }
+
+	sdio->write_repeat_records(&year, &lastYear, currentPlot);
+	bdio->write_repeat_records(&year, &lastYear, currentPlot);
+	fdio->write_repeat_records(&year, &lastYear, currentPlot);
+	return true;
+}
 
 void simulate(int year, RVS::DataManagement::AnalysisPlot* currentPlot, 
 	Biomass::BiomassDriver* bd, 
@@ -55,6 +273,13 @@ void simulate(int year, RVS::DataManagement::AnalysisPlot* currentPlot,
 	Succession::SuccessionDriver* sd, 
 	Disturbance::DisturbanceDriver* dd);
 
+// simulate up to the fuel loads. The year's grazing, fires and the rest of the fuels run for all plots after.
+void simulateToFuelLoads(int year, RVS::DataManagement::AnalysisPlot* currentPlot,
+	Biomass::BiomassDriver* bd,
+	Fuels::FuelsDriver* fd,
+	Succession::SuccessionDriver* sd,
+	Disturbance::DisturbanceDriver* dd);
+
 void fiveYearHerbTest(int year, RVS::DataManagement::AnalysisPlot* currentPlot,
 	Biomass::BiomassDriver* bd,
 	Fuels::FuelsDriver* fd,
@@ -63,6 +288,16 @@ void fiveYearHerbTest(int year, RVS::DataManagement::AnalysisPlot* currentPlot,
 
 void shrubEquationTest();
 
+vector<AnalysisPlot*> loadPlots(Biomass::BiomassDIO* bdio, Fuels::FuelsDIO* fdio);
+
+int microbenchmarks(const char* resultsPath, double secondsPerKernel);
+
+int sensitivity(const char* resultsPath, const Tools::SensitivityPlan& plan);
+
+int calibrate(const char* outPath, const Tools::CalibrationOptions& options);
+
+int selftest(char* inPath);
+
 void run(
 	void(*simFunc)(int year, RVS::DataManagement::AnalysisPlot* currentPlot,
 		Biomass::BiomassDriver* bd,
@@ -72,6 +307,47 @@ void run(
 
 void randomClimate();
 
+std::map<std::string, double> equationWeights(Biomass::BiomassDIO* bdio, map<int, AnalysisPlot*>* aps);
+
+vector<int> orderPlots(vector<int>* plots, map<int, AnalysisPlot*>* aps);
+
+bool retireIfSteady(int year, int lastYear, RVS::DataManagement::AnalysisPlot* currentPlot,
+	Biomass::BiomassDIO* bdio,
+	Fuels::FuelsDIO* fdio,
+	Succession::SuccessionDIO* sdio);
+
+// Subcommands: rvs partition <in.db> <prefix> <shards> [ids|tiles]
+//              rvs merge <out.db> <shard outputs...>
+//              rvs shards <in.db> <out.db> <years> <shards> [threads] [ids|tiles]
+//              rvs generate <out.db> <plots> [shrubs per plot] [models] [species] [disturbance rules]
+//                  [climate columns] [seed]
+//              rvs bench <results.json> [years] [plot counts] [thread counts] [modes] [label]
+//                  Lists are comma separated. Modes: simulate, herb, equations
+//              rvs benchrun <mode> <in.db> <out.db> <years> <threads> <stats.json>
+//                  One benchmark configuration, as run by rvs bench
+//              rvs microbench <in.db> [results.json] [ms per kernel]
+//                  Generates a 1000 plot landscape at in.db when there is no file there
+//              rvs sweep <in.db> [results.json] [heights] [covers] [widths] [threads]
+//                  Checks every Bio_Equation over the grid of the comma separated values. Returns 1
+//                  when equations are flagged.
+//              rvs compare <reference.db> <candidate.db> [tolerances] [categorical columns] [ignored columns]
+//                  Tolerances are column:absolute:relative, column * sets the default (exact).
+//                  Columns may be given as table.column. Returns 1 when the outputs diverge.
+//              rvs sensitivity <in.db> [results.json] [years] [oat|morris] [delta] [parameters] [trajectories]
+//                  [threads] [seed]
+//                  Parameters: gr_cov, gr_ht, herb_cover_slope, herb_height_slope, production_intercept,
+//                  production_ppt, production_ndvi. All of them by default.
+//              rvs calibrate <in.db> <calibrated.db> [max evaluations] [threads]
+//                  Fits GR_COV and GR_HT of every BPS model with plots in Plot_Observations
+//              rvs selftest <in.db>
+//                  Generates a small landscape at in.db, replacing any file there, and checks it.
+//                  Returns the number of failed checks.
+// Returns -1 when argv is a plain run.
+int toolMain(int argc, char* argv[]);
+
+int runShards(const char* exe, const char* inPath, const char* outPath, int years, int numShards, int threads,
+	Tools::PartitionMode mode);
+
 int main(int argc, char* argv[])
 {   
 	//std::cout << argc << std::endl;
@@ -81,11 +357,17 @@ int main(int argc, char* argv[])
 	}
 
 
-	if (argc == 4)
+	int toolRC = toolMain(argc, argv);
+	if (toolRC != -1) { return toolRC; }
+
+	if (argc >= 4)
 	{
 		RVS_DB_PATH = argv[1];
 		OUT_DB_PATH = argv[2];
 		*YEARS = atoi(argv[3]);
+		if (argc >= 5) { *THREADS = atoi(argv[4]); }
+		if (argc >= 6) { *ENSEMBLE_SEED = (unsigned int)strtoul(argv[5], NULL, 10); }
+		if (argc >= 7) { DEBUG_FILE = argv[6]; }
 	}
 	else
 	{
@@ -109,6 +391,16 @@ void run(void(*simFunc)(int year, RVS::DataManagement::AnalysisPlot* currentPlot
 	unique_ptr<ofstream> dfile(new ofstream(DEBUG_FILE, ios::out));
 	*dfile << ctime(&t) << "\n";
 	dfile->close();
+	std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+	*RUN_STATS = Tools::RunStats();
+
+#if RVS_INSTRUMENT
+	Instrumentation::start();
+#endif
+#if RVS_TRACE
+	TraceRecorder::start(*TRACE_SAMPLE);
+	uint64_t traceBegin = Instrumentation::TICKS();
+#endif
 
 	///////////////////////////
 	/// User execution args ///
@@ -140,6 +432,7 @@ void run(void(*simFunc)(int year, RVS::DataManagement::AnalysisPlot* currentPlot
 		currentPlot = new AnalysisPlot(fdio, plots_dt);
 		aps.insert(pair<int, AnalysisPlot*>(currentPlot->PLOT_ID(), currentPlot));
 		*RC = sqlite3_step(plots_dt->getStmt());
+		Arena::scratch()->reset();
 	}
 
 	bdio->write_debug_msg("Plots loaded");
@@ -153,6 +446,7 @@ void run(void(*simFunc)(int year, RVS::DataManagement::AnalysisPlot* currentPlot
 		currentPlot = aps[plot_id];
 		currentPlot->push_shrub(bdio, shrub_dt);
 		*RC = sqlite3_step(shrub_dt->getStmt());
+		Arena::scratch()->reset();
 	}
 
 	for (auto &p : plotcounts)
@@ -163,19 +457,32 @@ void run(void(*simFunc)(int year, RVS::DataManagement::AnalysisPlot* currentPlot
 
 	bdio->write_debug_msg("Plants loaded");
 
-	/*
-	map<int, vector<RVS::Disturbance::DisturbAction>> disturbances = ddio->query_disturbance_input();
-	std::cout << "Loading disturbances..." << std::endl;
-
-	for (auto &d : disturbances)
+	// Animals of the grazing actions and herds, checked against the grazer classes
+	set<Symbol> grazers;
+	if (*DISTURBANCES)
 	{
-		aps[d.first]->setDisturbances(d.second);
-	}
+		map<int, vector<RVS::Disturbance::DisturbAction>> disturbances = ddio->query_disturbance_input();
+		std::cout << "Loading disturbances..." << std::endl;
 
-	bdio->write_debug_msg("Disturbances loaded");
-	*/
+		for (auto &d : disturbances)
+		{
+			if (aps.count(d.first) > 0) { aps[d.first]->setDisturbances(d.second); }
+			for (auto &a : d.second)
+			{
+				if (a.KIND() == Disturbance::DisturbAction::KIND_GRAZE) { grazers.insert(a.SUBTYPE_ID()); }
+			}
+		}
+
+		bdio->write_debug_msg("Disturbances loaded");
+	}
 
 	std::cout << "Done." << std::endl;
+	RUN_STATS->loadSeconds = Tools::secondsSince(runStart);
+
+#if RVS_TRACE
+	TraceRecorder::span("load", "run", traceBegin, Instrumentation::TICKS(), (int)plotcounts.size());
+	traceBegin = Instrumentation::TICKS();
+#endif
 
 	///////////////////////////////
 	/// Prepare for simulation
@@ -186,35 +493,340 @@ void run(void(*simFunc)(int year, RVS::DataManagement::AnalysisPlot* currentPlot
 	Succession::SuccessionDriver sd = Succession::SuccessionDriver(sdio, *SUPPRESS_MSG);
 	Disturbance::DisturbanceDriver dd = Disturbance::DisturbanceDriver(ddio, *SUPPRESS_MSG);
 
-	for (int year = 0; year < *YEARS; year++)
+	unique_ptr<Disturbance::RotationScheduler> rotation;
+	if (*DISTURBANCES)
 	{
-		std::cout << "\n===================================" << std::endl;
-		std::cout << "YEAR " << year << std::endl;
-		std::cout << "===================================\n" << std::endl;
+		vector<Disturbance::Pasture> pastures;
+		vector<Disturbance::Herd> herds;
+		if (ddio->query_pastures(&pastures) && ddio->query_herds(&herds))
+		{
+			for (auto &h : herds) { grazers.insert(h.animal); }
+			rotation.reset(new Disturbance::RotationScheduler(pastures, herds, dd.GRAZING()));
+			rotation->bind(&aps);
+			ddio->create_rotation_table();
+
+			stringstream ss;
+			ss << "Rotation of " << rotation->NUM_HERDS() << " herds over " << rotation->NUM_PASTURES() << " pastures";
+			bdio->write_debug_msg(ss.str().c_str());
+		}
+		dd.reportUnknownGrazers(grazers);
+	}
 
-		for (int &p : plotcounts)
+	// A plot that did not change can only be assumed to stay that way if every year
+	// sees the same climate
+	bool detectSteady = *STEADY_STATE && !*RANDOM_CLIMATE && simFunc == &simulate;
+	bool plotMajor = *PLOT_MAJOR && !*RANDOM_CLIMATE && !*DISTURBANCES && *SEED_RADIUS <= 0;
+	// Grazed plots wait for the year's forage removal before their fuels are written
+	bool batchGrazing = *DISTURBANCES && simFunc == &simulate;
+	int lastYear = *YEARS - 1;
+
+	unique_ptr<Succession::Recolonization> recolonization;
+	if (*SEED_RADIUS > 0 && simFunc == &simulate)
+	{
+		vector<AnalysisPlot*> indexed;
+		for (auto &p : plotcounts)
 		{
-			currentPlot = aps[p];
-			simFunc(year, currentPlot, &bd, &fd, &sd, &dd);
+			indexed.push_back(aps[p]);
 		}
+		recolonization.reset(new Succession::Recolonization(indexed, *SEED_RADIUS));
+		recolonization->update();
+	}
 
-		stringstream ss;
-		ss << "Year " << year << " finished";
-		bdio->write_debug_msg(ss.str().c_str());
+	if (plotMajor)
+	{
+		// Each plot stays in cache for all of its years. Output rows come out grouped by
+		// plot, the output tables get a year index once written.
+		// Plots are independent units of work here, so they can be spread over threads. Other
+		// simulation functions change globals between years and stay on one thread.
+		int numWorkers = 1;
+#if USEMULTIT
+		if (simFunc == &simulate)
+		{
+			numWorkers = *THREADS > 0 ? *THREADS : (int)std::thread::hardware_concurrency();
+		}
+#endif
+		PlotScheduler scheduler = PlotScheduler(numWorkers);
+		numWorkers = scheduler.NUM_WORKERS();
+
+		std::cout << "Simulating " << plotcounts.size() << " plots for " << *YEARS << " years on " << \
+			numWorkers << " thread(s)" << std::endl;
+
+		// Plots sharing a BPS model and shrub species run back to back, so their parameters stay
+		// cached. Each plot writes to the slot of its original position, keeping the output order.
+		vector<int> executionOrder = orderPlots(&plotcounts, &aps);
+		map<int, int> writeSlots;
+		for (size_t i = 0; i < plotcounts.size(); i++)
+		{
+			writeSlots[plotcounts[i]] = (int)i;
+		}
+		DIO::reserve_write_slots(plotcounts.size());
+
+		vector<double> costs = vector<double>(executionOrder.size(), 1.0);
+		if (numWorkers > 1)
+		{
+			std::map<std::string, double> weights = equationWeights(bdio, &aps);
+			for (size_t i = 0; i < executionOrder.size(); i++)
+			{
+				costs[i] = PlotScheduler::estimateCost(aps[executionOrder[i]], &weights);
+			}
+		}
+
+		// Drivers keep the current plot as state, every worker needs its own
+		vector<Biomass::BiomassDriver> bds = vector<Biomass::BiomassDriver>(numWorkers, bd);
+		vector<Fuels::FuelsDriver> fds = vector<Fuels::FuelsDriver>(numWorkers, fd);
+		vector<Succession::SuccessionDriver> sds = vector<Succession::SuccessionDriver>(numWorkers, sd);
+		vector<Disturbance::DisturbanceDriver> dds = vector<Disturbance::DisturbanceDriver>(numWorkers, dd);
+		for (auto &w : fds)
+		{
+			w.batchFireBehavior(FIRE_BATCH_PLOTS);
+		}
+
+		scheduler.run(&executionOrder, &costs, [&](int worker, int p)
+		{
+			AnalysisPlot* plot = aps.at(p);
+			DIO::begin_write_slot(writeSlots.at(p));
+			for (int year = 0; year < *YEARS; year++)
+			{
+				simulatePlotYear(year, plot, simFunc, &bds[worker], &fds[worker], &sds[worker], &dds[worker], bdio);
+				if (detectSteady && retireIfSteady(year, lastYear, plot, bdio, fdio, sdio)) { break; }
+			}
+			DIO::begin_write_slot(-1);
+		});
+
+		// What is left of each worker's batch
+		for (auto &w : fds)
+		{
+			w.flushFireBehavior();
+		}
+
+		string report = scheduler.report();
+		std::cout << report << std::endl;
+		bdio->write_debug_msg(report.c_str());
+		bdio->write_debug_msg("All plots finished");
+	}
+	else if (batchGrazing)
+	{
+		// Every year runs in two phases over all plots, with the workers meeting at a barrier
+		// after each: the plots up to their fuel loads, then the rest of their fuels. The
+		// year's grazing, pasture rotation and fires need every plot's fuels and run in between.
+		int numWorkers = 1;
+#if USEMULTIT
+		numWorkers = *THREADS > 0 ? *THREADS : (int)std::thread::hardware_concurrency();
+#endif
+		PlotScheduler scheduler = PlotScheduler(numWorkers);
+		numWorkers = scheduler.NUM_WORKERS();
+
+		std::cout << "Simulating " << plotcounts.size() << " plots for " << *YEARS << " years on " << \
+			numWorkers << " thread(s)" << std::endl;
+
+		map<int, int> writeSlots;
+		for (size_t i = 0; i < plotcounts.size(); i++)
+		{
+			writeSlots[plotcounts[i]] = (int)i;
+		}
+		DIO::reserve_write_slots(plotcounts.size());
+
+		vector<double> costs = vector<double>(plotcounts.size(), 1.0);
+		if (numWorkers > 1)
+		{
+			std::map<std::string, double> weights = equationWeights(bdio, &aps);
+			for (size_t i = 0; i < plotcounts.size(); i++)
+			{
+				costs[i] = PlotScheduler::estimateCost(aps[plotcounts[i]], &weights);
+			}
+		}
+
+		vector<Biomass::BiomassDriver> bds = vector<Biomass::BiomassDriver>(numWorkers, bd);
+		vector<Fuels::FuelsDriver> fds = vector<Fuels::FuelsDriver>(numWorkers, fd);
+		vector<Succession::SuccessionDriver> sds = vector<Succession::SuccessionDriver>(numWorkers, sd);
+		vector<Disturbance::DisturbanceDriver> dds = vector<Disturbance::DisturbanceDriver>(numWorkers, dd);
+		for (auto &w : dds)
+		{
+			w.reserveRequests(plotcounts.size());
+		}
+		for (auto &w : fds)
+		{
+			w.batchFireBehavior(FIRE_BATCH_PLOTS);
+		}
+
+		// Steady plots are skipped for the rest of the run. Indexed by write slot.
+		vector<char> retired = vector<char>(plotcounts.size(), 0);
+		vector<Disturbance::GrazingRequest> rotationRequests;
+		vector<Disturbance::PastureAssignment> assignments;
+
+		scheduler.runPhased(&plotcounts, &costs, *YEARS, 2, [&](int worker, int p, int year, int phase)
+		{
+			int slot = writeSlots.at(p);
+			if (retired[slot]) { return; }
+
+			AnalysisPlot* plot = aps.at(p);
+			DIO::begin_write_slot(slot);
+			if (phase == 0)
+			{
+				simulatePlotYear(year, plot, &simulateToFuelLoads, &bds[worker], &fds[worker], &sds[worker], &dds[worker], bdio);
+			}
+			else
+			{
+				RVS_TRACE_PLOT_SPAN("finish_fuels", p);
+				RVS_SQL_YEAR(year);
+				PlotYearStart start = beginPlotYear(plot);
+				RC = fds[worker].finishFuels(year, plot);
+				endPlotYear(year, plot, start, bdio);
+				if (detectSteady && retireIfSteady(year, lastYear, plot, bdio, fdio, sdio)) { retired[slot] = 1; }
+			}
+			DIO::begin_write_slot(-1);
+		},
+		[&](int year, int phase)
+		{
+			if (phase == 0)
+			{
+				for (auto &w : dds)
+				{
+					w.GrazeMain();
+				}
+
+				if (rotation)
+				{
+					rotationRequests.clear();
+					assignments.clear();
+					rotation->schedule(year, &rotationRequests, &assignments);
+					dd.GRAZING()->removeForage(rotationRequests);
+					for (auto &a : assignments)
+					{
+						ddio->write_rotation_record(&year, a);
+					}
+				}
+
+				for (auto &w : dds)
+				{
+					w.FireMain();
+				}
+				Arena::scratch()->reset();
+			}
+			else
+			{
+				for (auto &w : fds)
+				{
+					w.flushFireBehavior();
+				}
+				if (recolonization) { recolonization->update(); }
+
+				stringstream ss;
+				ss << "Year " << year << " finished";
+				bdio->write_debug_msg(ss.str().c_str());
+			}
+		});
+
+		string report = scheduler.report();
+		std::cout << report << std::endl;
+		bdio->write_debug_msg(report.c_str());
+		bdio->write_debug_msg("All plots finished");
+	}
+	else
+	{
+		vector<int> activePlots = plotcounts;
+		vector<int> stillActive;
+		fd.batchFireBehavior(FIRE_BATCH_PLOTS);
+
+		for (int year = 0; year < *YEARS; year++)
+		{
+			RVS_TRACE_SPAN("year", "run", year);
+			std::cout << "\n===================================" << std::endl;
+			std::cout << "YEAR " << year << std::endl;
+			std::cout << "===================================\n" << std::endl;
+
+			for (int &p : activePlots)
+			{
+				currentPlot = aps[p];
+				simulatePlotYear(year, currentPlot, simFunc, &bd, &fd, &sd, &dd, bdio);
+			}
+			fd.flushFireBehavior();
+
+			// Steady plots leave the active set
+			if (detectSteady)
+			{
+				stillActive.clear();
+				for (int &p : activePlots)
+				{
+					if (!retireIfSteady(year, lastYear, aps[p], bdio, fdio, sdio))
+					{
+						stillActive.push_back(p);
+					}
+				}
+				activePlots.swap(stillActive);
+			}
+
+			if (recolonization) { recolonization->update(); }
+
+			stringstream ss;
+			ss << "Year " << year << " finished, " << activePlots.size() << " plots active";
+			bdio->write_debug_msg(ss.str().c_str());
+		}
 	}
 
+#if RVS_TRACE
+	TraceRecorder::span("simulate", "run", traceBegin, Instrumentation::TICKS(), *YEARS);
+	traceBegin = Instrumentation::TICKS();
+#endif
+	RUN_STATS->simulateSeconds = Tools::secondsSince(runStart) - RUN_STATS->loadSeconds;
+	RUN_STATS->plotYears = (long)plotcounts.size() * *YEARS;
+
 	bdio->write_output();
+	RUN_STATS->firstOutputSeconds = Tools::secondsSince(runStart);
+
+#if RVS_TRACE
+	TraceRecorder::span("write_output", "run", traceBegin, Instrumentation::TICKS(), 0);
+#endif
+
+#if RVS_COUNT_ALLOCS
+	std::cout << "Steady plot-years with heap allocations: " << allocationViolations << std::endl;
+	assert(allocationViolations == 0);
+#endif
+
+#if RVS_PROFILE_SQL
+	SqlProfiler::report(std::cout, 20);
+	bool withinBudget = SqlProfiler::REPEATED_QUERIES() <= *SQL_BUDGET * SqlProfiler::PLOT_YEARS();
+	std::cout << "Budget of " << *SQL_BUDGET << " repeated input queries per plot-year: " << \
+		(withinBudget ? "met" : "EXCEEDED") << std::endl;
+	if (!withinBudget)
+	{
+		std::cerr << "SQL budget exceeded: " << SqlProfiler::REPEATED_QUERIES() << " repeated input queries in " << \
+			SqlProfiler::PLOT_YEARS() << " plot-years, " << *SQL_BUDGET << " per plot-year allowed" << std::endl;
+	}
+#endif
+
+	if (plotMajor || batchGrazing)
+	{
+		sdio->create_year_index();
+		bdio->create_year_index();
+		fdio->create_year_index();
+	}
 
 	delete bdio;
 	delete fdio;
 	delete sdio;
 
+#if RVS_INSTRUMENT
+	Instrumentation::report(std::cout);
+	Instrumentation::writeJson(INSTRUMENT_FILE);
+#endif
+#if RVS_TRACE
+	TraceRecorder::writeJson(TRACE_FILE);
+#endif
+
+	RUN_STATS->totalSeconds = Tools::secondsSince(runStart);
+	RUN_STATS->peakRssKb = Tools::peakRssKb();
 	std::cout << std::endl << "Ran to completion." << std::endl;
 
 	t = time(NULL);
 	dfile = unique_ptr<ofstream>(new ofstream(DEBUG_FILE, ios::app));
 	*dfile << ctime(&t) << "\n";
 	dfile->close();
+
+#if RVS_PROFILE_SQL
+	// Set last, closing the databases overwrites RC
+	if (!withinBudget) { *RC = 1; }
+#endif
 }
 
 void simulate(int year, RVS::DataManagement::AnalysisPlot* currentPlot, 
@@ -233,9 +845,27 @@ void simulate(int year, RVS::DataManagement::AnalysisPlot* currentPlot,
 	if (*RANDOM_CLIMATE) { randomClimate(); }
 
 	RC = sd->SuccessionMain(year, CLIMATE, currentPlot);
-	//RC = dd->DisturbanceMain(year, currentPlot);
+	if (*DISTURBANCES) { RC = dd->DisturbanceMain(year, currentPlot); }
 	RC = bd->BioMain(year, CLIMATE, currentPlot);
-	RC = fd->FuelsMain(year, currentPlot);
+	RC = fd->calcFuelLoads(year, currentPlot);
+	if (*DISTURBANCES)
+	{
+		RC = dd->GrazeMain();
+		RC = dd->FireMain();
+	}
+	RC = fd->finishFuels(year, currentPlot);
+}
+
+void simulateToFuelLoads(int year, RVS::DataManagement::AnalysisPlot* currentPlot,
+	Biomass::BiomassDriver* bd,
+	Fuels::FuelsDriver* fd,
+	Succession::SuccessionDriver* sd,
+	Disturbance::DisturbanceDriver* dd)
+{
+	RC = sd->SuccessionMain(year, CLIMATE, currentPlot);
+	RC = dd->DisturbanceMain(year, currentPlot);
+	RC = bd->BioMain(year, CLIMATE, currentPlot);
+	RC = fd->calcFuelLoads(year, currentPlot);
 }
 
 void fiveYearHerbTest(int year, RVS::DataManagement::AnalysisPlot* currentPlot,
@@ -262,6 +892,8 @@ void shrubEquationTest()
 	unique_ptr<ofstream> dfile(new ofstream(DEBUG_FILE, ios::out));
 	*dfile << ctime(&t) << "\n";
 	dfile->close();
+	std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now();
+	*RUN_STATS = Tools::RunStats();
 
 	///////////////////////////
 	/// User execution args ///
@@ -312,11 +944,12 @@ void shrubEquationTest()
 	}
 
 	std::cout << "Done." << std::endl;
+	RUN_STATS->loadSeconds = Tools::secondsSince(runStart);
 
 	Biomass::BiomassEqDriver beqd = Biomass::BiomassEqDriver(bdio, *SUPPRESS_MSG);
 	vector<int> testEquations = vector<int>();
 	ifstream equationsFile;
-	equationsFile.open("C:\\Users\\robblankston\\Documents\\GitHub\\RVS\\librvs\\biomass_text_equations.txt");
+	equationsFile.open(EQUATION_LIST_FILE);
 	string line;
 	if (equationsFile.is_open())
 	{
@@ -332,6 +965,22 @@ void shrubEquationTest()
 		equationsFile.close();
 	}
 
+	// Without the list, the equations of the plots' species are tested
+	if (testEquations.empty())
+	{
+		for (auto &p : aps)
+		{
+			for (auto &s : *p.second->SHRUB_RECORDS())
+			{
+				int eqNum = bdio->query_crosswalk_table(s->SPP_CODE(), BIOMASS_EQUATION_FIELD);
+				if (eqNum != 0 && std::find(testEquations.begin(), testEquations.end(), eqNum) == testEquations.end())
+				{
+					testEquations.push_back(eqNum);
+				}
+			}
+		}
+	}
+
 	for (vector<int>::iterator it = testEquations.begin(); it != testEquations.end(); ++it)
 	{
 		std::cout << "\n===================================" << std::endl;
@@ -346,13 +995,18 @@ void shrubEquationTest()
 		ss << "EQUATION " << *it << " finished";
 		bdio->write_debug_msg(ss.str().c_str());
 	}
+	RUN_STATS->simulateSeconds = Tools::secondsSince(runStart) - RUN_STATS->loadSeconds;
+	RUN_STATS->plotYears = (long)(plotcounts.size() * testEquations.size());
 
 	bdio->write_output();
+	RUN_STATS->firstOutputSeconds = Tools::secondsSince(runStart);
 
 	delete bdio;
 	delete fdio;
 	delete sdio;
 
+	RUN_STATS->totalSeconds = Tools::secondsSince(runStart);
+	RUN_STATS->peakRssKb = Tools::peakRssKb();
 	std::cout << std::endl << "Ran to completion." << std::endl;
 
 	t = time(NULL);
@@ -361,6 +1015,275 @@ void shrubEquationTest()
 	dfile->close();
 }
 
+// Plots of the input database with their shrub records, in input order
+vector<AnalysisPlot*> loadPlots(Biomass::BiomassDIO* bdio, Fuels::FuelsDIO* fdio)
+{
+	vector<int> plotcounts = bdio->query_analysis_plots();
+	map<int, AnalysisPlot*> aps;
+
+	std::cout << "Loading records..." << std::endl;
+	AnalysisPlot* currentPlot = NULL;
+
+	RVS::DataManagement::DataTable* plots_dt = bdio->query_input_table();
+
+	while (*RC == SQLITE_ROW)
+	{
+		currentPlot = new AnalysisPlot(fdio, plots_dt);
+		aps.insert(pair<int, AnalysisPlot*>(currentPlot->PLOT_ID(), currentPlot));
+		*RC = sqlite3_step(plots_dt->getStmt());
+		Arena::scratch()->reset();
+	}
+
+	RVS::DataManagement::DataTable* shrub_dt = bdio->query_shrubs_table();
+
+	int plot_id = 0;
+	while (*RC == SQLITE_ROW)
+	{
+		bdio->getVal(shrub_dt->getStmt(), shrub_dt->Columns[PLOT_NUM_FIELD], &plot_id);
+		currentPlot = aps[plot_id];
+		currentPlot->push_shrub(bdio, shrub_dt);
+		*RC = sqlite3_step(shrub_dt->getStmt());
+		Arena::scratch()->reset();
+	}
+
+	vector<AnalysisPlot*> plots;
+	for (auto &p : plotcounts)
+	{
+		aps[p]->update_shrubvalues();
+		plots.push_back(aps[p]);
+	}
+	return plots;
+}
+
+// Simulates the first year of every plot, without writing the output, and times the
+// kernels on the plots' values
+int microbenchmarks(const char* resultsPath, double secondsPerKernel)
+{
+	static char memoryDb[] = ":memory:";
+	OUT_DB_PATH = memoryDb;
+
+	Biomass::BiomassDIO* bdio = new Biomass::BiomassDIO();
+	Fuels::FuelsDIO* fdio = new Fuels::FuelsDIO();
+	Succession::SuccessionDIO* sdio = new Succession::SuccessionDIO();
+	Disturbance::DisturbanceDIO* ddio = new Disturbance::DisturbanceDIO();
+
+	vector<AnalysisPlot*> plots = loadPlots(bdio, fdio);
+
+	Biomass::BiomassDriver bd = Biomass::BiomassDriver(bdio, *SUPPRESS_MSG);
+	Fuels::FuelsDriver fd = Fuels::FuelsDriver(fdio, *SUPPRESS_MSG);
+	Succession::SuccessionDriver sd = Succession::SuccessionDriver(sdio, *SUPPRESS_MSG);
+	Disturbance::DisturbanceDriver dd = Disturbance::DisturbanceDriver(ddio, *SUPPRESS_MSG);
+
+	std::cout << "Simulating year 0 of " << plots.size() << " plots..." << std::endl;
+	for (auto &p : plots)
+	{
+		simulate(0, p, &bd, &fd, &sd, &dd);
+		Arena::scratch()->reset();
+	}
+
+	Tools::Microbenchmarks bench = Tools::Microbenchmarks(plots, &fd, &sd);
+	vector<Tools::KernelTiming> timings = bench.run(secondsPerKernel);
+	Tools::Microbenchmarks::report(std::cout, timings);
+
+	delete bdio;
+	delete fdio;
+	delete sdio;
+
+	if (timings.empty())
+	{
+		std::cerr << "No plots with shrubs to take inputs from" << std::endl;
+		return 1;
+	}
+	return Tools::Microbenchmarks::writeJson(resultsPath, timings) ? 0 : 1;
+}
+
+// Runs the plan's scenarios over the plots of the input database, without output, and
+// writes the elasticities of the landscape outputs
+int sensitivity(const char* resultsPath, const Tools::SensitivityPlan& plan)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	static char memoryDb[] = ":memory:";
+	OUT_DB_PATH = memoryDb;
+
+	Biomass::BiomassDIO* bdio = new Biomass::BiomassDIO();
+	Fuels::FuelsDIO* fdio = new Fuels::FuelsDIO();
+	Succession::SuccessionDIO* sdio = new Succession::SuccessionDIO();
+
+	vector<AnalysisPlot*> plots = loadPlots(bdio, fdio);
+	if (plots.empty())
+	{
+		std::cerr << "No plots to simulate" << std::endl;
+		return 1;
+	}
+
+	Biomass::BiomassDriver bd = Biomass::BiomassDriver(bdio, *SUPPRESS_MSG);
+	Fuels::FuelsDriver fd = Fuels::FuelsDriver(fdio, *SUPPRESS_MSG);
+	Succession::SuccessionDriver sd = Succession::SuccessionDriver(sdio, *SUPPRESS_MSG);
+
+	vector<Succession::GrowthScales> scenarios = Tools::SensitivityAnalysis::scenarios(plan);
+	std::cout << "Simulating " << scenarios.size() << " scenarios of " << plots.size() << " plots for " << \
+		*YEARS << " years..." << std::endl;
+
+	Tools::SensitivityAnalysis analysis = Tools::SensitivityAnalysis(plots, bd, fd, sd);
+	vector<vector<double>> outputs = analysis.run(scenarios, plan.threads);
+	vector<Tools::Elasticity> elasticities = Tools::SensitivityAnalysis::elasticities(plan, scenarios, outputs);
+	double seconds = Tools::secondsSince(start);
+
+	Tools::SensitivityAnalysis::report(std::cout, plan, elasticities);
+	std::cout << scenarios.size() << " scenarios in " << seconds << " s" << std::endl;
+
+	delete bdio;
+	delete fdio;
+	delete sdio;
+
+	return Tools::SensitivityAnalysis::writeJson(resultsPath, plan, outputs[0], elasticities, scenarios.size(), seconds) ? 0 : 1;
+}
+
+// Fits the growth rates of the models with observed plots, simulating up to the last observed
+// year without output, and writes a copy of the input database with the fitted rates
+int calibrate(const char* outPath, const Tools::CalibrationOptions& options)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	static char memoryDb[] = ":memory:";
+	OUT_DB_PATH = memoryDb;
+
+	Biomass::BiomassDIO* bdio = new Biomass::BiomassDIO();
+	Fuels::FuelsDIO* fdio = new Fuels::FuelsDIO();
+	Succession::SuccessionDIO* sdio = new Succession::SuccessionDIO();
+
+	map<int, vector<Succession::PlotObservation>> observations;
+	if (!sdio->query_observations(&observations))
+	{
+		std::cerr << "No " << OBSERVATION_TABLE << " table in " << RVS_DB_PATH << std::endl;
+		return 1;
+	}
+	int lastYear = 0;
+	for (auto &o : observations)
+	{
+		lastYear = std::max(lastYear, o.second.back().year);
+	}
+	*YEARS = lastYear + 1;
+
+	vector<AnalysisPlot*> plots = loadPlots(bdio, fdio);
+	Biomass::BiomassDriver bd = Biomass::BiomassDriver(bdio, *SUPPRESS_MSG);
+	Succession::SuccessionDriver sd = Succession::SuccessionDriver(sdio, *SUPPRESS_MSG);
+
+	Tools::Calibration calibration = Tools::Calibration(plots, observations, bd, sd);
+	if (calibration.NUM_MODELS() == 0)
+	{
+		std::cerr << "No observations of the input plots" << std::endl;
+		return 1;
+	}
+	std::cout << "Fitting " << calibration.NUM_MODELS() << " BPS models over " << *YEARS << " years..." << std::endl;
+
+	vector<Tools::CalibrationResult> results = calibration.run(options);
+	Tools::Calibration::report(std::cout, results);
+	std::cout << "Calibrated in " << Tools::secondsSince(start) << " s" << std::endl;
+
+	delete bdio;
+	delete fdio;
+	delete sdio;
+
+	return Tools::Calibration::writeCalibrated(RVS_DB_PATH, outPath, results) == SQLITE_OK ? 0 : 1;
+}
+
+// Checks of a generated landscape that need the drivers. Returns the number that failed.
+int selftest(char* inPath)
+{
+	Tools::LandscapeSpec spec = Tools::defaultLandscape(200);
+	int rc = Tools::generateLandscape(inPath, spec);
+	if (rc == SQLITE_OK) { rc = Tools::writeRuleTable(inPath, Fuels::FBFMClassifier::builtinRules()); }
+	if (rc == SQLITE_OK) { rc = Tools::flattenHerbCoverGrowth(inPath); }
+	if (rc != SQLITE_OK)
+	{
+		std::cerr << "Could not write the test landscape to " << inPath << std::endl;
+		return 1;
+	}
+
+	static char memoryDb[] = ":memory:";
+	RVS_DB_PATH = inPath;
+	OUT_DB_PATH = memoryDb;
+
+	Fuels::FuelsDIO* fdio = new Fuels::FuelsDIO();
+	int failed = 0;
+
+	// The built in rules written as a Fuel_ClassRules table classify like the built in rules
+	vector<Fuels::FBFMRule> tableRules;
+	bool read = fdio->query_fbfm_rule_table(&tableRules);
+	vector<Fuels::FBFMRule> builtin = Fuels::FBFMClassifier::builtinRules();
+	int differences = Tools::classifierDifferences(builtin, Fuels::FBFMClassifier(tableRules), Fuels::FBFMClassifier(), 100000);
+	stringstream detail;
+	detail << tableRules.size() << " of " << builtin.size() << " rules read, " << differences << " of 100000 totals differ";
+	failed += Tools::reportCheck(std::cout, "fbfm rule table", read && tableRules.size() == builtin.size() && differences == 0, \
+		detail.str());
+
+	// Animals without a grazer class eat as much as a cow, as the disturbance module had them
+	Disturbance::GrazingEngine grazing = Disturbance::GrazingEngine();
+	double demand = grazing.demand(grazing.classOf(SymbolTable::intern("ELK")), 10, 100, 30);
+	double cowDemand = 26.0 * 10 * 30 / 100 * AnalysisPlot::POUNDS_TO_GRAMS;
+	detail.str("");
+	detail << demand << " g/ac, a cow's " << cowDemand;
+	failed += Tools::reportCheck(std::cout, "generic grazer intake", std::abs(demand - cowDemand) < 1e-9 * cowDemand, detail.str());
+
+	// Burned plots restart in the herb stage and leave it after the stage's years, although
+	// herb cohorts don't grow cover to date them by
+	const int burnYear = 1;
+	*DISTURBANCES = true;
+	*YEARS = burnYear + 12;
+
+	Biomass::BiomassDIO* bdio = new Biomass::BiomassDIO();
+	Succession::SuccessionDIO* sdio = new Succession::SuccessionDIO();
+	Disturbance::DisturbanceDIO* ddio = new Disturbance::DisturbanceDIO();
+	vector<AnalysisPlot*> plots = loadPlots(bdio, fdio);
+
+	map<string, double> params;
+	params["INTENSITY"] = 3;
+	vector<Disturbance::DisturbAction> fire;
+	fire.push_back(Disturbance::DisturbAction(burnYear, "FIRE", "WILD", params));
+	for (auto &p : plots)
+	{
+		p->setDisturbances(fire);
+	}
+
+	Biomass::BiomassDriver bd = Biomass::BiomassDriver(bdio, true);
+	Fuels::FuelsDriver fd = Fuels::FuelsDriver(fdio, true);
+	Succession::SuccessionDriver sd = Succession::SuccessionDriver(sdio, true);
+	Disturbance::DisturbanceDriver dd = Disturbance::DisturbanceDriver(ddio, true);
+
+	// Plots in the herb stage the year after the fire, and those still there at the end
+	int restarted = 0;
+	int stuck = 0;
+	vector<char> inHerbStage = vector<char>(plots.size(), 0);
+	for (int year = 0; year < *YEARS; year++)
+	{
+		for (size_t i = 0; i < plots.size(); i++)
+		{
+			simulatePlotYear(year, plots[i], &simulate, &bd, &fd, &sd, &dd, bdio);
+			if (year == burnYear + 1 && plots[i]->CURRENT_STAGE_TYPE() == "H")
+			{
+				inHerbStage[i] = 1;
+				restarted++;
+			}
+		}
+	}
+	for (size_t i = 0; i < plots.size(); i++)
+	{
+		if (inHerbStage[i] && plots[i]->CURRENT_SUCCESSION_STAGE() == 1) { stuck++; }
+	}
+	*DISTURBANCES = false;
+
+	detail.str("");
+	detail << restarted << " of " << plots.size() << " plots restarted in the herb stage, " << stuck << \
+		" still there after " << *YEARS - burnYear - 2 << " years";
+	failed += Tools::reportCheck(std::cout, "burned plots leave the herb stage", restarted > 0 && stuck == 0, detail.str());
+
+	delete bdio;
+	delete fdio;
+	delete sdio;
+	delete ddio;
+	return failed;
+}
+
 void randomClimate()
 {
 	int i = rand() % 5;
@@ -382,4 +1305,235 @@ void randomClimate()
 		*CLIMATE = "Wet";
 		break;
 	}
-}
\ No newline at end of file
+}
+
+Tools::PartitionMode partitionMode(int argc, char* argv[], int i)
+{
+	return argc > i && string(argv[i]) == "tiles" ? Tools::PARTITION_TILES : Tools::PARTITION_IDS;
+}
+
+// Comma separated list argument i, or fallback when it is missing
+vector<string> listArg(int argc, char* argv[], int i, const char* fallback)
+{
+	vector<string> items;
+	stringstream ss(argc > i ? argv[i] : fallback);
+	string item;
+	while (getline(ss, item, ','))
+	{
+		if (!item.empty()) { items.push_back(item); }
+	}
+	return items;
+}
+
+vector<int> intListArg(int argc, char* argv[], int i, const char* fallback)
+{
+	vector<int> values;
+	for (auto &item : listArg(argc, argv, i, fallback))
+	{
+		values.push_back(atoi(item.c_str()));
+	}
+	return values;
+}
+
+// Sorted ascending
+vector<double> doubleListArg(int argc, char* argv[], int i, const vector<double>& fallback)
+{
+	vector<double> values;
+	for (auto &item : listArg(argc, argv, i, ""))
+	{
+		values.push_back(atof(item.c_str()));
+	}
+	if (values.empty()) { values = fallback; }
+	std::sort(values.begin(), values.end());
+	return values;
+}
+
+int toolMain(int argc, char* argv[])
+{
+	if (argc < 2) { return -1; }
+	string command = argv[1];
+
+	if (command == "partition" && argc >= 5)
+	{
+		return Tools::partitionInput(argv[2], argv[3], atoi(argv[4]), partitionMode(argc, argv, 5));
+	}
+	if (command == "merge" && argc >= 4)
+	{
+		return Tools::mergeOutputs(argv[2], vector<string>(argv + 3, argv + argc));
+	}
+	if (command == "shards" && argc >= 6)
+	{
+		int threads = argc >= 7 ? atoi(argv[6]) : 0;
+		return runShards(argv[0], argv[2], argv[3], atoi(argv[4]), atoi(argv[5]), threads, partitionMode(argc, argv, 7));
+	}
+	if (command == "generate" && argc >= 4)
+	{
+		Tools::LandscapeSpec spec = Tools::defaultLandscape(atoi(argv[3]));
+		if (argc >= 5) { spec.shrubsPerPlot = atof(argv[4]); }
+		if (argc >= 6) { spec.models = atoi(argv[5]); }
+		if (argc >= 7) { spec.species = atoi(argv[6]); }
+		if (argc >= 8) { spec.disturbanceRules = atoi(argv[7]); }
+		if (argc >= 9) { spec.climateColumns = atoi(argv[8]); }
+		if (argc >= 10) { spec.seed = (unsigned int)strtoul(argv[9], NULL, 10); }
+		return Tools::generateLandscape(argv[2], spec);
+	}
+	if (command == "bench" && argc >= 3)
+	{
+		Tools::BenchmarkPlan plan = Tools::BenchmarkPlan();
+		plan.years = argc >= 4 ? atoi(argv[3]) : 20;
+		plan.sizes = intListArg(argc, argv, 4, "1000,10000,100000");
+		plan.threads = intListArg(argc, argv, 5, "1");
+		plan.modes = listArg(argc, argv, 6, "simulate,herb,equations");
+		plan.label = argc >= 8 ? argv[7] : "";
+		return Tools::runBenchmarks(argv[0], argv[2], plan);
+	}
+	if (command == "benchrun" && argc >= 8)
+	{
+		string mode = argv[2];
+		RVS_DB_PATH = argv[3];
+		OUT_DB_PATH = argv[4];
+		*YEARS = atoi(argv[5]);
+		*THREADS = atoi(argv[6]);
+		if (mode == "simulate") { run(&simulate); }
+		else if (mode == "herb") { run(&fiveYearHerbTest); }
+		else if (mode == "equations") { shrubEquationTest(); }
+		else { return 1; }
+		return Tools::writeRunStats(argv[7], *RUN_STATS) ? 0 : 1;
+	}
+	if (command == "sweep" && argc >= 3)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		Tools::SweepGrid grid = Tools::defaultSweepGrid();
+		grid.heights = doubleListArg(argc, argv, 4, grid.heights);
+		grid.covers = doubleListArg(argc, argv, 5, grid.covers);
+		grid.widths = doubleListArg(argc, argv, 6, grid.widths);
+		int threads = argc >= 8 ? atoi(argv[7]) : 0;
+
+		vector<Tools::SweepResult> results;
+		int rc = Tools::sweepEquations(argv[2], grid, threads, &results);
+		if (rc != SQLITE_OK) { return rc; }
+		int flagged = Tools::writeSweepResults(argc >= 4 ? argv[3] : "RVS_Sweep.json", grid, results, Tools::secondsSince(start));
+		return flagged == 0 ? 0 : 1;
+	}
+	if (command == "compare" && argc >= 4)
+	{
+		Tools::CompareOptions options = Tools::defaultCompareOptions();
+		if (!Tools::parseTolerances(listArg(argc, argv, 4, ""), &options))
+		{
+			std::cerr << "Tolerances are column:absolute:relative" << std::endl;
+			return 1;
+		}
+		for (auto &c : listArg(argc, argv, 5, ""))
+		{
+			options.categorical.insert(c);
+		}
+		for (auto &c : listArg(argc, argv, 6, ""))
+		{
+			options.ignored.insert(c);
+		}
+		return Tools::compareOutputs(argv[2], argv[3], options, std::cout);
+	}
+	if (command == "sensitivity" && argc >= 3)
+	{
+		RVS_DB_PATH = argv[2];
+		if (argc >= 5) { *YEARS = atoi(argv[4]); }
+		Tools::SensitivityPlan plan = Tools::defaultSensitivityPlan();
+		plan.morris = argc >= 6 && string(argv[5]) == "morris";
+		if (argc >= 7) { plan.delta = atof(argv[6]); }
+		vector<string> parameters = listArg(argc, argv, 7, "");
+		if (!parameters.empty() && !Tools::parseSensitivityParameters(parameters, &plan.parameters))
+		{
+			std::cerr << "Unknown parameter in " << argv[7] << std::endl;
+			return 1;
+		}
+		if (argc >= 9) { plan.trajectories = atoi(argv[8]); }
+		if (argc >= 10) { plan.threads = atoi(argv[9]); }
+		if (argc >= 11) { plan.seed = (unsigned int)strtoul(argv[10], NULL, 10); }
+		if (plan.parameters.empty() || plan.delta <= 0 || plan.delta >= 1)
+		{
+			std::cerr << "Perturbations need parameters and a delta between 0 and 1" << std::endl;
+			return 1;
+		}
+		return sensitivity(argc >= 4 ? argv[3] : "RVS_Sensitivity.json", plan);
+	}
+	if (command == "calibrate" && argc >= 4)
+	{
+		if (string(argv[2]) == argv[3])
+		{
+			std::cerr << "The calibrated database is written as a copy, not over the input" << std::endl;
+			return 1;
+		}
+		RVS_DB_PATH = argv[2];
+		Tools::CalibrationOptions options = Tools::defaultCalibrationOptions();
+		if (argc >= 5) { options.maxEvaluations = atoi(argv[4]); }
+		if (argc >= 6) { options.threads = atoi(argv[5]); }
+		return calibrate(argv[3], options);
+	}
+	if (command == "selftest" && argc >= 3)
+	{
+		return selftest(argv[2]);
+	}
+	if (command == "microbench" && argc >= 3)
+	{
+		ifstream landscape(argv[2]);
+		if (!landscape.good())
+		{
+			int rc = Tools::generateLandscape(argv[2], Tools::defaultLandscape(1000));
+			if (rc != SQLITE_OK) { return rc; }
+		}
+		landscape.close();
+		RVS_DB_PATH = argv[2];
+		double seconds = argc >= 5 ? atof(argv[4]) / 1000 : 0.2;
+		return microbenchmarks(argc >= 4 ? argv[3] : "RVS_Microbench.json", seconds);
+	}
+	return -1;
+}
+
+int runShards(const char* exe, const char* inPath, const char* outPath, int years, int numShards, int threads,
+	Tools::PartitionMode mode)
+{
+	// Shard files go next to the output
+	string prefix = string(outPath);
+	size_t ext = prefix.rfind(".db");
+	if (ext != string::npos && ext == prefix.size() - 3) { prefix.erase(ext); }
+	prefix += "_shard";
+
+	int written = 0;
+	int rc = Tools::partitionInput(inPath, prefix, numShards, mode, &written);
+	if (rc != SQLITE_OK) { return rc; }
+
+	// Each shard runs with its own debug file, they would overwrite one another's otherwise
+	vector<string> outputs;
+	vector<string> commands;
+	for (int k = 0; k < written; k++)
+	{
+		stringstream ss;
+		ss << "\"" << exe << "\" \"" << Tools::shardPath(prefix, k) << "\" \"" << Tools::shardOutputPath(prefix, k) << \
+			"\" " << years << " " << threads << " " << *ENSEMBLE_SEED << " \"" << Tools::shardDebugPath(prefix, k) << "\"";
+		commands.push_back(ss.str());
+		outputs.push_back(Tools::shardOutputPath(prefix, k));
+	}
+
+	// The shards are separate processes, they run side by side whether or not this build is threaded
+	vector<int> codes = vector<int>(commands.size(), 0);
+	vector<std::thread> processes;
+	for (size_t k = 0; k < commands.size(); k++)
+	{
+		processes.push_back(std::thread([&commands, &codes, k]() { codes[k] = std::system(commands[k].c_str()); }));
+	}
+	for (auto &p : processes)
+	{
+		p.join();
+	}
+
+	for (size_t k = 0; k < codes.size(); k++)
+	{
+		if (codes[k] != 0)
+		{
+			std::cerr << "Shard " << k << " failed: " << commands[k] << std::endl;
+			return codes[k];
+		}
+	}
+
+	return Tools::mergeOutputs(outPath, outputs);
+}